@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECAST_PROFILE_H
+#define RECAST_PROFILE_H
+
+#include "Recast.h"
+
+struct duFileIO;
+
+/// Returns the current time of the profiling clock. [Units: usec]
+typedef long long (*duProfileClock)();
+
+/// The number of duration buckets in the histogram of a timer label.
+static const int DU_PROFILE_BUCKETS = 24;
+
+/// The maximum nesting depth of the recorded timer scopes.
+static const int DU_PROFILE_MAX_DEPTH = 32;
+
+/// A timer scope recorded by #duBuildProfiler.
+struct duProfileEvent
+{
+	long long start;	///< The time the scope was entered. [Units: usec]
+	int duration;		///< The duration of the scope. [Units: usec]
+	int label;			///< The timer of the scope, or #RC_MAX_TIMERS for work outside of any timer.
+	int depth;			///< The nesting depth of the scope.
+	int tx, ty;			///< The tile being built when the scope was entered, or -1 if not set.
+};
+
+/// The durations of the scopes of a single timer, aggregated by #duBuildProfiler.
+struct duProfileStats
+{
+	int count;			///< The number of scopes.
+	long long total;	///< The total duration of the scopes. [Units: usec]
+	int minTime;		///< The shortest duration. [Units: usec]
+	int maxTime;		///< The longest duration. [Units: usec]
+
+	/// The number of scopes per duration. Bucket i counts durations in the range [2^i, 2^(i+1)) usec,
+	/// the first bucket also counts durations below 1 usec and the last any longer durations.
+	int histogram[DU_PROFILE_BUCKETS];
+};
+
+/// Records the nested timer scopes of a build context, and the work of the
+/// workers running its parallel tasks.
+///
+/// A profiler records the builds of a single thread. When several builds run
+/// concurrently, give each build context its own profiler with a distinct id and
+/// pass all of them to the export functions.
+/// @see rcContext::setProfiler, duExportProfileTrace, duExportProfileCsv
+class duBuildProfiler : public rcProfiler
+{
+public:
+	duBuildProfiler();
+	virtual ~duBuildProfiler();
+
+	/// Initializes the profiler and clears any recorded scopes.
+	///  @param[in]		clock		The clock used to time the scopes.
+	///  @param[in]		id			The id of the profiler, exported as the process of its scopes.
+	///  @param[in]		maxWorkers	The maximum number of workers of the parallel tasks. [Limit: >= 1]
+	/// @returns True if the profiler was successfully initialized.
+	bool init(duProfileClock clock, const int id, const int maxWorkers);
+
+	/// Clears the recorded scopes and statistics.
+	void reset();
+
+	/// Sets the tile the following scopes belong to.
+	///  @param[in]		tx		The x-index of the tile, or -1 if not building tiles.
+	///  @param[in]		ty		The y-index of the tile, or -1 if not building tiles.
+	void setTile(const int tx, const int ty);
+
+	virtual void beginScope(const rcTimerLabel label);
+	virtual void endScope(const rcTimerLabel label);
+	virtual void beginWork(const int worker);
+	virtual void endWork(const int worker);
+
+	/// Returns the id of the profiler.
+	inline int getId() const { return m_id; }
+
+	/// Returns the number of threads of the profiler. Thread 0 is the build thread and
+	/// thread i+1 the worker i of the parallel tasks.
+	inline int getThreadCount() const { return m_nthreads; }
+
+	/// Returns the number of scopes recorded for the specified thread.
+	inline int getEventCount(const int thread) const { return m_threads[thread].nevents; }
+
+	/// Returns a scope recorded for the specified thread, in the order the scopes were entered.
+	inline const duProfileEvent& getEvent(const int thread, const int i) const { return m_threads[thread].events[i]; }
+
+	/// Returns the statistics of the scopes of the build thread for the specified timer.
+	inline const duProfileStats& getStats(const rcTimerLabel label) const { return m_stats[label]; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	duBuildProfiler(const duBuildProfiler&);
+	duBuildProfiler& operator=(const duBuildProfiler&);
+
+	struct Thread
+	{
+		duProfileEvent* events;
+		int nevents;
+		int cevents;
+		int open[DU_PROFILE_MAX_DEPTH];
+		int nopen;
+	};
+
+	int openScope(Thread& thread, const int label, const int depth);
+	void closeScope(Thread& thread, const int index);
+	void purge();
+
+	duProfileClock m_clock;
+	int m_id;
+	Thread* m_threads;
+	int m_nthreads;
+	int m_tx, m_ty;
+	duProfileStats m_stats[RC_MAX_TIMERS];
+};
+
+/// Returns the name of the specified timer.
+const char* duGetTimerLabelName(const int label);
+
+/// Writes the recorded scopes of the profilers in the Chrome trace event format.
+/// Times are relative to the first recorded scope.
+///  @param[in]		profilers	The profilers to export.
+///  @param[in]		nprofilers	The number of profilers.
+///  @param[in]		io			The output to write to.
+/// @returns True if the trace was successfully written.
+bool duExportProfileTrace(const duBuildProfiler* const* profilers, const int nprofilers, duFileIO* io);
+
+/// Writes the recorded scopes of the profilers as comma separated values, one scope per row.
+/// Times are relative to the first recorded scope.
+///  @param[in]		profilers	The profilers to export.
+///  @param[in]		nprofilers	The number of profilers.
+///  @param[in]		io			The output to write to.
+/// @returns True if the values were successfully written.
+bool duExportProfileCsv(const duBuildProfiler* const* profilers, const int nprofilers, duFileIO* io);
+
+/// Logs the combined statistics of the build threads of the profilers, one timer per line.
+///  @param[in]		ctx			The context to log to.
+///  @param[in]		profilers	The profilers to log.
+///  @param[in]		nprofilers	The number of profilers.
+void duLogProfileStats(rcContext& ctx, const duBuildProfiler* const* profilers, const int nprofilers);
+
+#endif // RECAST_PROFILE_H
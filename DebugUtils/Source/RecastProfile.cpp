@@ -0,0 +1,390 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastDump.h"
+#include "RecastProfile.h"
+
+
+static const char* s_timerNames[RC_MAX_TIMERS] =
+{
+	"Total",
+	"Temp",
+	"Rasterize",
+	"Build Compact",
+	"Build Contours",
+	"Trace Contours",
+	"Simplify Contours",
+	"Filter Border",
+	"Filter Walkable",
+	"Median Area",
+	"Filter Low Obstacles",
+	"Build Polymesh",
+	"Merge Polymeshes",
+	"Erode Area",
+	"Mark Box Area",
+	"Mark Cylinder Area",
+	"Mark Convex Area",
+	"Build Distance Field",
+	"Distance",
+	"Blur",
+	"Build Regions",
+	"Watershed",
+	"Expand",
+	"Find Basins",
+	"Filter Regions",
+	"Build Layers",
+	"Build Polymesh Detail",
+	"Merge Polymesh Details",
+};
+
+const char* duGetTimerLabelName(const int label)
+{
+	if (label < 0 || label >= RC_MAX_TIMERS)
+		return "Work";
+	return s_timerNames[label];
+}
+
+static void ioprintf(duFileIO* io, const char* format, ...)
+{
+	char line[256];
+	va_list ap;
+	va_start(ap, format);
+	const int n = vsnprintf(line, sizeof(line), format, ap);
+	va_end(ap);
+	if (n > 0)
+		io->write(line, sizeof(char)*n);
+}
+
+static int durationBucket(const int duration)
+{
+	int b = 0;
+	while (b < DU_PROFILE_BUCKETS-1 && (duration >> (b+1)) > 0)
+		b++;
+	return b;
+}
+
+duBuildProfiler::duBuildProfiler() :
+	m_clock(0),
+	m_id(0),
+	m_threads(0),
+	m_nthreads(0),
+	m_tx(-1),
+	m_ty(-1)
+{
+	memset(m_stats, 0, sizeof(m_stats));
+}
+
+duBuildProfiler::~duBuildProfiler()
+{
+	purge();
+}
+
+void duBuildProfiler::purge()
+{
+	for (int i = 0; i < m_nthreads; ++i)
+		rcFree(m_threads[i].events);
+	rcFree(m_threads);
+	m_threads = 0;
+	m_nthreads = 0;
+}
+
+bool duBuildProfiler::init(duProfileClock clock, const int id, const int maxWorkers)
+{
+	purge();
+
+	m_clock = clock;
+	m_id = id;
+
+	const int nthreads = 1 + rcMax(1, maxWorkers);
+	m_threads = (Thread*)rcAlloc(sizeof(Thread)*nthreads, RC_ALLOC_PERM);
+	if (!m_threads)
+		return false;
+	memset(m_threads, 0, sizeof(Thread)*nthreads);
+	m_nthreads = nthreads;
+
+	reset();
+
+	return m_clock != 0;
+}
+
+void duBuildProfiler::reset()
+{
+	for (int i = 0; i < m_nthreads; ++i)
+	{
+		m_threads[i].nevents = 0;
+		m_threads[i].nopen = 0;
+	}
+	memset(m_stats, 0, sizeof(m_stats));
+	m_tx = -1;
+	m_ty = -1;
+}
+
+void duBuildProfiler::setTile(const int tx, const int ty)
+{
+	m_tx = tx;
+	m_ty = ty;
+}
+
+int duBuildProfiler::openScope(Thread& thread, const int label, const int depth)
+{
+	if (thread.nevents >= thread.cevents)
+	{
+		const int cevents = thread.cevents ? thread.cevents*2 : 256;
+		duProfileEvent* events = (duProfileEvent*)rcAlloc(sizeof(duProfileEvent)*cevents, RC_ALLOC_PERM);
+		if (!events)
+			return -1;
+		if (thread.nevents)
+			memcpy(events, thread.events, sizeof(duProfileEvent)*thread.nevents);
+		rcFree(thread.events);
+		thread.events = events;
+		thread.cevents = cevents;
+	}
+
+	duProfileEvent& ev = thread.events[thread.nevents];
+	ev.start = m_clock();
+	ev.duration = 0;
+	ev.label = label;
+	ev.depth = depth;
+	ev.tx = m_tx;
+	ev.ty = m_ty;
+	return thread.nevents++;
+}
+
+void duBuildProfiler::closeScope(Thread& thread, const int index)
+{
+	if (index < 0)
+		return;
+	duProfileEvent& ev = thread.events[index];
+	ev.duration = (int)(m_clock() - ev.start);
+
+	// Only the build thread contributes to the statistics, the work of the
+	// workers is already included in the scope running the parallel task.
+	if (&thread != &m_threads[0] || ev.label >= RC_MAX_TIMERS)
+		return;
+	duProfileStats& stats = m_stats[ev.label];
+	if (stats.count == 0 || ev.duration < stats.minTime)
+		stats.minTime = ev.duration;
+	if (stats.count == 0 || ev.duration > stats.maxTime)
+		stats.maxTime = ev.duration;
+	stats.count++;
+	stats.total += ev.duration;
+	stats.histogram[durationBucket(ev.duration)]++;
+}
+
+void duBuildProfiler::beginScope(const rcTimerLabel label)
+{
+	if (!m_nthreads)
+		return;
+	Thread& thread = m_threads[0];
+	if (thread.nopen >= DU_PROFILE_MAX_DEPTH)
+		return;
+	thread.open[thread.nopen] = openScope(thread, label, thread.nopen);
+	thread.nopen++;
+}
+
+void duBuildProfiler::endScope(const rcTimerLabel label)
+{
+	if (!m_nthreads)
+		return;
+	Thread& thread = m_threads[0];
+
+	// Find the innermost open scope of the timer. Scopes left open inside of it
+	// are closed along with it.
+	int n = thread.nopen-1;
+	while (n >= 0 && (thread.open[n] < 0 || thread.events[thread.open[n]].label != (int)label))
+		n--;
+	if (n < 0)
+		return;
+	for (int i = thread.nopen-1; i >= n; --i)
+		closeScope(thread, thread.open[i]);
+	thread.nopen = n;
+}
+
+void duBuildProfiler::beginWork(const int worker)
+{
+	if (worker < 0 || worker+1 >= m_nthreads)
+		return;
+
+	// The workers run while the build thread waits for the task, the innermost
+	// open scope of the build thread is the stage the work belongs to.
+	const Thread& build = m_threads[0];
+	int label = RC_MAX_TIMERS;
+	if (build.nopen > 0 && build.open[build.nopen-1] >= 0)
+		label = build.events[build.open[build.nopen-1]].label;
+
+	Thread& thread = m_threads[worker+1];
+	if (thread.nopen >= DU_PROFILE_MAX_DEPTH)
+		return;
+	thread.open[thread.nopen] = openScope(thread, label, build.nopen);
+	thread.nopen++;
+}
+
+void duBuildProfiler::endWork(const int worker)
+{
+	if (worker < 0 || worker+1 >= m_nthreads)
+		return;
+	Thread& thread = m_threads[worker+1];
+	if (thread.nopen <= 0)
+		return;
+	thread.nopen--;
+	closeScope(thread, thread.open[thread.nopen]);
+}
+
+static long long findStartTime(const duBuildProfiler* const* profilers, const int nprofilers)
+{
+	bool found = false;
+	long long start = 0;
+	for (int i = 0; i < nprofilers; ++i)
+	{
+		const duBuildProfiler* prof = profilers[i];
+		for (int j = 0; j < prof->getThreadCount(); ++j)
+		{
+			for (int k = 0; k < prof->getEventCount(j); ++k)
+			{
+				const long long t = prof->getEvent(j, k).start;
+				if (!found || t < start)
+					start = t;
+				found = true;
+			}
+		}
+	}
+	return start;
+}
+
+static bool checkOutput(duFileIO* io, const char* func)
+{
+	if (!io)
+	{
+		printf("%s: input IO is null.\n", func);
+		return false;
+	}
+	if (!io->isWriting())
+	{
+		printf("%s: input IO not writing.\n", func);
+		return false;
+	}
+	return true;
+}
+
+bool duExportProfileTrace(const duBuildProfiler* const* profilers, const int nprofilers, duFileIO* io)
+{
+	if (!checkOutput(io, "duExportProfileTrace"))
+		return false;
+
+	const long long start = findStartTime(profilers, nprofilers);
+
+	ioprintf(io, "{\"traceEvents\":[\n");
+	const char* sep = "";
+	for (int i = 0; i < nprofilers; ++i)
+	{
+		const duBuildProfiler* prof = profilers[i];
+		const int pid = prof->getId();
+
+		ioprintf(io, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"Build %d\"}}", sep, pid, pid);
+		sep = ",\n";
+		for (int j = 0; j < prof->getThreadCount(); ++j)
+		{
+			if (j == 0)
+				ioprintf(io, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"Build\"}}", sep, pid);
+			else if (prof->getEventCount(j) > 0)
+				ioprintf(io, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"Worker %d\"}}", sep, pid, j, j-1);
+
+			for (int k = 0; k < prof->getEventCount(j); ++k)
+			{
+				const duProfileEvent& ev = prof->getEvent(j, k);
+				ioprintf(io, "%s{\"name\":\"%s\",\"cat\":\"recast\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%d,\"args\":{\"tx\":%d,\"ty\":%d}}",
+						 sep, duGetTimerLabelName(ev.label), pid, j, ev.start - start, ev.duration, ev.tx, ev.ty);
+			}
+		}
+	}
+	ioprintf(io, "\n]}\n");
+
+	return true;
+}
+
+bool duExportProfileCsv(const duBuildProfiler* const* profilers, const int nprofilers, duFileIO* io)
+{
+	if (!checkOutput(io, "duExportProfileCsv"))
+		return false;
+
+	const long long start = findStartTime(profilers, nprofilers);
+
+	ioprintf(io, "profiler,thread,tx,ty,depth,name,start_us,duration_us\n");
+	for (int i = 0; i < nprofilers; ++i)
+	{
+		const duBuildProfiler* prof = profilers[i];
+		for (int j = 0; j < prof->getThreadCount(); ++j)
+		{
+			for (int k = 0; k < prof->getEventCount(j); ++k)
+			{
+				const duProfileEvent& ev = prof->getEvent(j, k);
+				ioprintf(io, "%d,%d,%d,%d,%d,%s,%lld,%d\n", prof->getId(), j, ev.tx, ev.ty, ev.depth,
+						 duGetTimerLabelName(ev.label), ev.start - start, ev.duration);
+			}
+		}
+	}
+
+	return true;
+}
+
+static float percentile(const duProfileStats& stats, const float p)
+{
+	// Upper bound of the histogram bucket holding the percentile.
+	const int n = (int)(stats.count*p + 0.5f);
+	int acc = 0;
+	for (int i = 0; i < DU_PROFILE_BUCKETS; ++i)
+	{
+		acc += stats.histogram[i];
+		if (acc >= n)
+			return rcMin((long long)stats.maxTime, 2LL << i) / 1000.0f;
+	}
+	return stats.maxTime / 1000.0f;
+}
+
+void duLogProfileStats(rcContext& ctx, const duBuildProfiler* const* profilers, const int nprofilers)
+{
+	ctx.log(RC_LOG_PROGRESS, "Build Profile");
+	for (int label = 0; label < RC_MAX_TIMERS; ++label)
+	{
+		duProfileStats stats;
+		memset(&stats, 0, sizeof(stats));
+		for (int i = 0; i < nprofilers; ++i)
+		{
+			const duProfileStats& s = profilers[i]->getStats((rcTimerLabel)label);
+			if (!s.count)
+				continue;
+			stats.minTime = stats.count ? rcMin(stats.minTime, s.minTime) : s.minTime;
+			stats.maxTime = rcMax(stats.maxTime, s.maxTime);
+			stats.count += s.count;
+			stats.total += s.total;
+			for (int j = 0; j < DU_PROFILE_BUCKETS; ++j)
+				stats.histogram[j] += s.histogram[j];
+		}
+		if (!stats.count)
+			continue;
+
+		ctx.log(RC_LOG_PROGRESS, "- %s:\t%.2fms\t(%d x %.3fms, min %.3fms, p50 <%.3fms, p95 <%.3fms, max %.3fms)",
+				duGetTimerLabelName(label), stats.total/1000.0f, stats.count, stats.total/1000.0f/stats.count,
+				stats.minTime/1000.0f, percentile(stats, 0.5f), percentile(stats, 0.95f), stats.maxTime/1000.0f);
+	}
+}
@@ -29,6 +29,35 @@ enum dtAllocHint
 	DT_ALLOC_TEMP		///< Memory used temporarily within a function.
 };
 
+/// The parts of Detour the allocated memory is accounted to.
+/// @see dtAlloc, dtGetAllocStats
+enum dtAllocSubsystem
+{
+	DT_MEM_OTHER,					///< Memory not accounted to a specific subsystem.
+	DT_MEM_NAVMESH,					///< Navigation meshes and their tile data.
+	DT_MEM_NAVMESH_QUERY,			///< Navigation mesh queries, excluding their node pools.
+	DT_MEM_NODE_POOL,				///< The node pools and open lists of the queries.
+	DT_MEM_TILE_CACHE,				///< Tile caches and the tile cache builder.
+	DT_MEM_CROWD,					///< Crowds, path corridors and obstacle avoidance.
+	DT_MAX_MEM_SUBSYSTEMS			///< The number of subsystems.
+};
+
+// Undefine (or define in a build config) the following line to account the memory
+// allocated through dtAlloc per hint and per subsystem. (See: dtGetAllocStats)
+// Note: every allocation then carries a small header, so the custom allocation
+// functions have to be set before any memory is allocated.
+//#define DT_MEMORY_STATS 1
+
+/// The memory usage accounted by #dtAlloc and #dtFree.
+/// @see dtGetAllocStats
+struct dtAllocStats
+{
+	size_t liveBytes;		///< The size of the allocations in use. [Units: bytes]
+	size_t peakBytes;		///< The largest size in use since the last reset. [Units: bytes]
+	size_t liveCount;		///< The number of allocations in use.
+	size_t totalCount;		///< The number of allocations made since the last reset.
+};
+
 /// A memory allocation function.
 //  @param[in]		size			The size, in bytes of memory, to allocate.
 //  @param[in]		rcAllocHint	A hint to the allocator on how long the memory is expected to be in use.
@@ -53,9 +82,37 @@ void dtAllocSetCustom(dtAllocFunc *allocFunc, dtFreeFunc *freeFunc);
 /// @see dtFree
 void* dtAlloc(size_t size, dtAllocHint hint);
 
+/// Allocates a memory block and accounts it to the specified subsystem.
+///  @param[in]		size		The size, in bytes of memory, to allocate.
+///  @param[in]		hint		A hint to the allocator on how long the memory is expected to be in use.
+///  @param[in]		subsystem	The subsystem the memory is accounted to.
+///  @return A pointer to the beginning of the allocated memory block, or null if the allocation failed.
+/// @see dtFree
+void* dtAlloc(size_t size, dtAllocHint hint, dtAllocSubsystem subsystem);
+
 /// Deallocates a memory block.
 ///  @param[in]		ptr		A pointer to a memory block previously allocated using #dtAlloc.
 /// @see dtAlloc
 void dtFree(void* ptr);
 
+/// Gets the memory usage of the allocations made with the specified hint.
+///  @param[in]		hint		The allocation hint.
+///  @param[out]	stats		The memory usage.
+///  @return True if the memory usage is accounted. (DT_MEMORY_STATS is defined.)
+bool dtGetAllocStats(dtAllocHint hint, dtAllocStats& stats);
+
+/// Gets the memory usage of the allocations accounted to the specified subsystem.
+///  @param[in]		subsystem	The subsystem.
+///  @param[out]	stats		The memory usage.
+///  @return True if the memory usage is accounted. (DT_MEMORY_STATS is defined.)
+bool dtGetAllocStats(dtAllocSubsystem subsystem, dtAllocStats& stats);
+
+/// Gets the memory usage of all allocations.
+///  @param[out]	stats		The memory usage.
+///  @return True if the memory usage is accounted. (DT_MEMORY_STATS is defined.)
+bool dtGetAllocTotalStats(dtAllocStats& stats);
+
+/// Restarts the peak sizes from the sizes in use and clears the allocation counts.
+void dtResetAllocStats();
+
 #endif
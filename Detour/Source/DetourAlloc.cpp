@@ -17,6 +17,7 @@
 //
 
 #include <stdlib.h>
+#include <string.h>
 #include "DetourAlloc.h"
 
 static void *dtAllocDefault(size_t size, dtAllocHint)
@@ -38,13 +39,211 @@ void dtAllocSetCustom(dtAllocFunc *allocFunc, dtFreeFunc *freeFunc)
 	sFreeFunc = freeFunc ? freeFunc : dtFreeDefault;
 }
 
+#ifdef DT_MEMORY_STATS
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static long long dtAtomicCompareExchange(volatile long long* dst, long long value, long long comparand)
+{
+	return _InterlockedCompareExchange64(dst, value, comparand);
+}
+#else
+static long long dtAtomicCompareExchange(volatile long long* dst, long long value, long long comparand)
+{
+	return __sync_val_compare_and_swap(dst, comparand, value);
+}
+#endif
+
+static long long dtAtomicAdd(volatile long long* dst, long long value)
+{
+	long long cur = *dst;
+	for (;;)
+	{
+		const long long prev = dtAtomicCompareExchange(dst, cur + value, cur);
+		if (prev == cur)
+			return cur + value;
+		cur = prev;
+	}
+}
+
+static void dtAtomicMax(volatile long long* dst, long long value)
+{
+	long long cur = *dst;
+	while (value > cur)
+	{
+		const long long prev = dtAtomicCompareExchange(dst, value, cur);
+		if (prev == cur)
+			return;
+		cur = prev;
+	}
+}
+
+static long long dtAtomicLoad(volatile long long* src)
+{
+	// Exchanging zero for zero leaves the value unchanged.
+	return dtAtomicCompareExchange(src, 0, 0);
+}
+
+static void dtAtomicStore(volatile long long* dst, long long value)
+{
+	long long cur = *dst;
+	for (;;)
+	{
+		const long long prev = dtAtomicCompareExchange(dst, value, cur);
+		if (prev == cur)
+			return;
+		cur = prev;
+	}
+}
+
+struct dtAllocCounter
+{
+	volatile long long liveBytes;
+	volatile long long peakBytes;
+	volatile long long liveCount;
+	volatile long long totalCount;
+};
+
+static dtAllocCounter sHintCounters[DT_ALLOC_TEMP+1];
+static dtAllocCounter sSubsystemCounters[DT_MAX_MEM_SUBSYSTEMS];
+static dtAllocCounter sTotalCounter;
+
+// The header in front of each allocation. Its size keeps the returned memory
+// aligned like the memory of the allocation function.
+struct dtAllocHeader
+{
+	size_t size;
+	unsigned short hint;
+	unsigned short subsystem;
+};
+static const size_t DT_ALLOC_HEADER_SIZE = 16;
+
+static void dtCountAlloc(dtAllocCounter& counter, const long long size)
+{
+	dtAtomicMax(&counter.peakBytes, dtAtomicAdd(&counter.liveBytes, size));
+	dtAtomicAdd(&counter.liveCount, 1);
+	dtAtomicAdd(&counter.totalCount, 1);
+}
+
+static void dtCountFree(dtAllocCounter& counter, const long long size)
+{
+	dtAtomicAdd(&counter.liveBytes, -size);
+	dtAtomicAdd(&counter.liveCount, -1);
+}
+
+static void dtGetCounter(dtAllocCounter& counter, dtAllocStats& stats)
+{
+	stats.liveBytes = (size_t)dtAtomicLoad(&counter.liveBytes);
+	stats.peakBytes = (size_t)dtAtomicLoad(&counter.peakBytes);
+	stats.liveCount = (size_t)dtAtomicLoad(&counter.liveCount);
+	stats.totalCount = (size_t)dtAtomicLoad(&counter.totalCount);
+}
+
+static void dtResetCounter(dtAllocCounter& counter)
+{
+	// An allocation can raise the peak between the load of the live bytes and the store,
+	// raising the peak again afterwards keeps it at least the live bytes.
+	dtAtomicStore(&counter.peakBytes, dtAtomicLoad(&counter.liveBytes));
+	dtAtomicMax(&counter.peakBytes, dtAtomicLoad(&counter.liveBytes));
+	dtAtomicStore(&counter.totalCount, 0);
+}
+
+#endif // DT_MEMORY_STATS
+
 void* dtAlloc(size_t size, dtAllocHint hint)
 {
+	return dtAlloc(size, hint, DT_MEM_OTHER);
+}
+
+/// @par
+///
+/// The subsystem is only used to account the memory when DT_MEMORY_STATS is defined,
+/// the allocation function receives just the size and the hint.
+///
+/// @see dtAllocSetCustom, dtGetAllocStats
+void* dtAlloc(size_t size, dtAllocHint hint, dtAllocSubsystem subsystem)
+{
+#ifdef DT_MEMORY_STATS
+	unsigned char* mem = (unsigned char*)sAllocFunc(DT_ALLOC_HEADER_SIZE + size, hint);
+	if (!mem)
+		return 0;
+	dtAllocHeader* header = (dtAllocHeader*)mem;
+	header->size = size;
+	header->hint = (unsigned short)hint;
+	header->subsystem = (unsigned short)subsystem;
+	dtCountAlloc(sHintCounters[hint], (long long)size);
+	dtCountAlloc(sSubsystemCounters[subsystem], (long long)size);
+	dtCountAlloc(sTotalCounter, (long long)size);
+	return mem + DT_ALLOC_HEADER_SIZE;
+#else
+	(void)subsystem;
 	return sAllocFunc(size, hint);
+#endif
 }
 
 void dtFree(void* ptr)
 {
-	if (ptr)
-		sFreeFunc(ptr);
+	if (!ptr)
+		return;
+#ifdef DT_MEMORY_STATS
+	unsigned char* mem = (unsigned char*)ptr - DT_ALLOC_HEADER_SIZE;
+	const dtAllocHeader* header = (const dtAllocHeader*)mem;
+	dtCountFree(sHintCounters[header->hint], (long long)header->size);
+	dtCountFree(sSubsystemCounters[header->subsystem], (long long)header->size);
+	dtCountFree(sTotalCounter, (long long)header->size);
+	sFreeFunc(mem);
+#else
+	sFreeFunc(ptr);
+#endif
+}
+
+/// @par
+///
+/// Always fails when DT_MEMORY_STATS is not defined.
+/// The counters are updated atomically, but the values are read one at a time, so
+/// they can be slightly out of sync while other threads allocate memory.
+bool dtGetAllocStats(dtAllocHint hint, dtAllocStats& stats)
+{
+#ifdef DT_MEMORY_STATS
+	dtGetCounter(sHintCounters[hint], stats);
+	return true;
+#else
+	(void)hint;
+	memset(&stats, 0, sizeof(stats));
+	return false;
+#endif
+}
+
+bool dtGetAllocStats(dtAllocSubsystem subsystem, dtAllocStats& stats)
+{
+#ifdef DT_MEMORY_STATS
+	dtGetCounter(sSubsystemCounters[subsystem], stats);
+	return true;
+#else
+	(void)subsystem;
+	memset(&stats, 0, sizeof(stats));
+	return false;
+#endif
+}
+
+bool dtGetAllocTotalStats(dtAllocStats& stats)
+{
+#ifdef DT_MEMORY_STATS
+	dtGetCounter(sTotalCounter, stats);
+	return true;
+#else
+	memset(&stats, 0, sizeof(stats));
+	return false;
+#endif
+}
+
+void dtResetAllocStats()
+{
+#ifdef DT_MEMORY_STATS
+	for (int i = 0; i <= DT_ALLOC_TEMP; ++i)
+		dtResetCounter(sHintCounters[i]);
+	for (int i = 0; i < DT_MAX_MEM_SUBSYSTEMS; ++i)
+		dtResetCounter(sSubsystemCounters[i]);
+	dtResetCounter(sTotalCounter);
+#endif
 }
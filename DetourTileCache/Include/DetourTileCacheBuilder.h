@@ -84,7 +84,7 @@ struct dtTileCacheAlloc
 	
 	virtual void* alloc(const size_t size)
 	{
-		return dtAlloc(size, DT_ALLOC_TEMP);
+		return dtAlloc(size, DT_ALLOC_TEMP, DT_MEM_TILE_CACHE);
 	}
 	
 	virtual void free(void* ptr)
@@ -2051,7 +2051,7 @@ dtStatus dtBuildTileCacheLayer(dtTileCacheCompressor* comp,
 	const int headerSize = dtAlign4(sizeof(dtTileCacheLayerHeader));
 	const int gridSize = (int)header->width * (int)header->height;
 	const int maxDataSize = headerSize + comp->maxCompressedSize(gridSize*3);
-	unsigned char* data = (unsigned char*)dtAlloc(maxDataSize, DT_ALLOC_PERM);
+	unsigned char* data = (unsigned char*)dtAlloc(maxDataSize, DT_ALLOC_PERM, DT_MEM_TILE_CACHE);
 	if (!data)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	memset(data, 0, maxDataSize);
@@ -2061,7 +2061,7 @@ dtStatus dtBuildTileCacheLayer(dtTileCacheCompressor* comp,
 	
 	// Concatenate grid data for compression.
 	const int bufferSize = gridSize*3;
-	unsigned char* buffer = (unsigned char*)dtAlloc(bufferSize, DT_ALLOC_TEMP);
+	unsigned char* buffer = (unsigned char*)dtAlloc(bufferSize, DT_ALLOC_TEMP, DT_MEM_TILE_CACHE);
 	if (!buffer)
 	{
 		dtFree(data);
@@ -95,6 +95,45 @@ enum rcTimerLabel
 	RC_MAX_TIMERS
 };
 
+/// A unit of work that can be distributed across the workers of a build context.
+/// @see rcContext::runParallel
+class rcParallelTask
+{
+public:
+	virtual ~rcParallelTask() {}
+
+	/// Processes a single work item.
+	///  @param[in]		index	The index of the work item. [Limits: 0 <= value < count]
+	///  @param[in]		worker	The index of the worker processing the item.
+	///  						[Limits: 0 <= value < rcContext::getWorkerCount()]
+	virtual void run(const int index, const int worker) = 0;
+};
+
+/// Receives the nested timer scopes of a build context, for profiling beyond the
+/// accumulated timers.
+/// @see rcContext::setProfiler
+class rcProfiler
+{
+public:
+	virtual ~rcProfiler() {}
+
+	/// Called after the specified timer has been started.
+	///  @param[in]		label	The category of the timer.
+	virtual void beginScope(const rcTimerLabel label) = 0;
+
+	/// Called before the specified timer is stopped.
+	///  @param[in]		label	The category of the timer.
+	virtual void endScope(const rcTimerLabel label) = 0;
+
+	/// Called on the thread of a worker before it processes the items of a parallel task.
+	///  @param[in]		worker	The index of the worker.
+	virtual void beginWork(const int /*worker*/) {}
+
+	/// Called on the thread of a worker after it has processed the items of a parallel task.
+	///  @param[in]		worker	The index of the worker.
+	virtual void endWork(const int /*worker*/) {}
+};
+
 /// Provides an interface for optional logging and performance tracking of the Recast 
 /// build process.
 /// @ingroup recast
@@ -104,7 +143,7 @@ public:
 
 	/// Contructor.
 	///  @param[in]		state	TRUE if the logging and performance timers should be enabled.  [Default: true]
-	inline rcContext(bool state = true) : m_logEnabled(state), m_timerEnabled(state) {}
+	inline rcContext(bool state = true) : m_logEnabled(state), m_timerEnabled(state), m_profiler(0) {}
 	virtual ~rcContext() {}
 
 	/// Enables or disables logging.
@@ -128,17 +167,43 @@ public:
 
 	/// Starts the specified performance timer.
 	///  @param	label	The category of the timer.
-	inline void startTimer(const rcTimerLabel label) { if (m_timerEnabled) doStartTimer(label); }
+	inline void startTimer(const rcTimerLabel label)
+	{
+		if (!m_timerEnabled) return;
+		doStartTimer(label);
+		if (m_profiler) m_profiler->beginScope(label);
+	}
 
 	/// Stops the specified performance timer.
 	///  @param	label	The category of the timer.
-	inline void stopTimer(const rcTimerLabel label) { if (m_timerEnabled) doStopTimer(label); }
+	inline void stopTimer(const rcTimerLabel label)
+	{
+		if (!m_timerEnabled) return;
+		if (m_profiler) m_profiler->endScope(label);
+		doStopTimer(label);
+	}
 
 	/// Returns the total accumulated time of the specified performance timer.
 	///  @param	label	The category of the timer.
 	///  @return The accumulated time of the timer, or -1 if timers are disabled or the timer has never been started.
 	inline int getAccumulatedTime(const rcTimerLabel label) const { return m_timerEnabled ? doGetAccumulatedTime(label) : -1; }
 
+	/// Sets the profiler that receives the timer scopes while the timers are enabled.
+	///  @param[in]		profiler	The profiler to use, or null to disable profiling.
+	inline void setProfiler(rcProfiler* profiler) { m_profiler = profiler; }
+
+	/// Returns the profiler receiving the timer scopes, or null if none is set.
+	inline rcProfiler* getProfiler() const { return m_profiler; }
+
+	/// Returns the number of workers that may run tasks concurrently.
+	///  @return The number of workers. [Limit: >= 1]
+	inline int getWorkerCount() const { const int n = doGetWorkerCount(); return n > 0 ? n : 1; }
+
+	/// Runs a task for each work item and returns once all of them are processed.
+	///  @param[in]		task	The task to run.
+	///  @param[in]		count	The number of work items.
+	inline void runParallel(rcParallelTask& task, const int count) { if (count > 0) doRunParallel(task, count); }
+
 protected:
 
 	/// Clears all log entries.
@@ -165,12 +230,26 @@ protected:
 	///  @param[in]		label	The category of the timer.
 	///  @return The accumulated time of the timer, or -1 if timers are disabled or the timer has never been started.
 	virtual int doGetAccumulatedTime(const rcTimerLabel /*label*/) const { return -1; }
+
+	/// Returns the number of workers that may run tasks concurrently.
+	///  @return The number of workers.
+	virtual int doGetWorkerCount() const { return 1; }
+
+	/// Runs a task for each work item and returns once all of them are processed.
+	/// The default implementation processes the items in order on the calling thread.
+	///  @param[in]		task	The task to run.
+	///  @param[in]		count	The number of work items. [Limit: > 0]
+	virtual void doRunParallel(rcParallelTask& task, const int count) { for (int i = 0; i < count; ++i) task.run(i, 0); }
 	
 	/// True if logging is enabled.
 	bool m_logEnabled;
 
 	/// True if the performance timers are enabled.
 	bool m_timerEnabled;
+
+	/// The profiler receiving the timer scopes, or null if profiling is disabled.
+	/// Implementations of #doRunParallel should report the work of each worker to it.
+	rcProfiler* m_profiler;
 };
 
 /// A helper to first start a timer and then stop it when this helper goes out of scope.
@@ -312,6 +391,29 @@ private:
 	rcHeightfield& operator=(const rcHeightfield&);
 };
 
+/// Spans reserved from a heightfield, so that columns can be added to the
+/// heightfield from several threads, each using its own reserved spans.
+/// @ingroup recast
+/// @see rcReserveSpans, rcAddReservedSpanColumn, rcReleaseSpans
+struct rcReservedSpans
+{
+	rcSpan* freelist;	///< Free reserved spans, used before the spans of the pools.
+	rcSpanPool* pool;	///< The pool the next span is taken from, or null if there are no pools left.
+	int used;			///< The number of spans taken from the current pool.
+	int npools;			///< The number of pools left, including the current pool.
+};
+
+/// Tracks the columns of a heightfield touched by each triangle of a rasterized mesh,
+/// so the heightfield can be updated for the changed triangles only.
+/// @ingroup recast
+/// @see rcAllocHeightfieldSources, rcRasterizeTrianglesTracked, rcUpdateRasterizedTriangles
+struct rcHeightfieldSources
+{
+	int* bounds;		///< The columns touched by each triangle, empty if minx > maxx. [(minx, miny, maxx, maxy) * #ntris]
+	int ntris;			///< The number of tracked triangles.
+	int maxTris;		///< The number of triangles allocated in #bounds.
+};
+
 /// Provides information on the content of a cell column in a compact heightfield. 
 struct rcCompactCell
 {
@@ -350,6 +452,26 @@ struct rcCompactHeightfield
 	unsigned char* areas;		///< Array containing area id data. [Size: #spanCount]
 };
 
+/// A set of convex volumes indexed on the xz-plane, for applying the area id's
+/// of many volumes at once.
+/// @ingroup recast
+/// @see rcAllocAreaVolumeSet, rcBuildAreaVolumeSet, rcMarkAreaVolumes
+struct rcAreaVolumeSet
+{
+	float* verts;			///< The vertices of the volumes. [(x, y, z) * vertex count]
+	int* polys;				///< The first vertex and vertex count of each volume. [(first, count) * #nvolumes]
+	float* bounds;			///< The bounds of each volume. [(minx, miny, minz, maxx, maxy, maxz) * #nvolumes]
+	unsigned char* areas;	///< The area id of each volume. [Size: #nvolumes]
+	int nvolumes;			///< The number of volumes.
+	int maxVerts;			///< The largest vertex count of the volumes.
+	float bmin[2];			///< The minimum bounds of the index. [(x, z)]
+	float cs;				///< The size of each index cell on the xz-plane.
+	int width;				///< The width of the index. (Along the x-axis in cell units.)
+	int height;				///< The height of the index. (Along the z-axis in cell units.)
+	int* cellFirst;			///< The first item of each index cell. [Size: #width * #height + 1]
+	int* cellItems;			///< The volumes overlapping the index cells, in volume order. [Size: cellFirst[#width * #height]]
+};
+
 /// Represents a heightfield layer within a layer set.
 /// @see rcHeightfieldLayerSet
 struct rcHeightfieldLayer
@@ -458,6 +580,30 @@ rcHeightfield* rcAllocHeightfield();
 ///  @see rcAllocHeightfield
 void rcFreeHeightField(rcHeightfield* hf);
 
+/// Allocates a heightfield sources object using the Recast allocator.
+///  @return A heightfield sources object that is ready for tracking, or null on failure.
+///  @ingroup recast
+///  @see rcRasterizeTrianglesTracked, rcFreeHeightfieldSources
+rcHeightfieldSources* rcAllocHeightfieldSources();
+
+/// Frees the specified heightfield sources object using the Recast allocator.
+///  @param[in]		sources	A heightfield sources object allocated using #rcAllocHeightfieldSources
+///  @ingroup recast
+///  @see rcAllocHeightfieldSources
+void rcFreeHeightfieldSources(rcHeightfieldSources* sources);
+
+/// Allocates an area volume set using the Recast allocator.
+///  @return An area volume set that is ready for initialization, or null on failure.
+///  @ingroup recast
+///  @see rcBuildAreaVolumeSet, rcFreeAreaVolumeSet
+rcAreaVolumeSet* rcAllocAreaVolumeSet();
+
+/// Frees the specified area volume set using the Recast allocator.
+///  @param[in]		vset	An area volume set allocated using #rcAllocAreaVolumeSet
+///  @ingroup recast
+///  @see rcAllocAreaVolumeSet
+void rcFreeAreaVolumeSet(rcAreaVolumeSet* vset);
+
 /// Allocates a compact heightfield object using the Recast allocator.
 ///  @return A compact heightfield that is ready for initialization, or null on failure.
 ///  @ingroup recast
@@ -834,6 +980,60 @@ bool rcAddSpan(rcContext* ctx, rcHeightfield& hf, const int x, const int y,
 			   const unsigned short smin, const unsigned short smax,
 			   const unsigned char area, const int flagMergeThr);
 
+/// Adds a column of spans, sorted from bottom to top, to the specified heightfield.
+/// The result is the same as adding the spans one by one with #rcAddSpan.
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in,out]	hf				An initialized heightfield.
+///  @param[in]		x				The width index where the spans are to be added.
+///  								[Limits: 0 <= value < rcHeightfield::width]
+///  @param[in]		y				The height index where the spans are to be added.
+///  								[Limits: 0 <= value < rcHeightfield::height]
+///  @param[in]		smin			The minimum heights of the spans. [(smin) * @p count] [Units: vx]
+///  @param[in]		smax			The maximum heights of the spans. [(smax) * @p count] [Units: vx]
+///  @param[in]		areas			The area ids of the spans. [(area) * @p count]
+///  @param[in]		count			The number of spans in the column.
+///  @param[in]		flagMergeThr	The merge theshold. [Limit: >= 0] [Units: vx]
+///  @returns True if the operation completed successfully.
+bool rcAddSpanColumn(rcContext* ctx, rcHeightfield& hf, const int x, const int y,
+					 const unsigned short* smin, const unsigned short* smax,
+					 const unsigned char* areas, const int count, const int flagMergeThr);
+
+/// Reserves spans of the specified heightfield, to be added to the heightfield
+/// with #rcAddReservedSpanColumn.
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in,out]	hf				An initialized heightfield.
+///  @param[in]		count			The minimum number of spans to reserve.
+///  @param[out]	spans			The reserved spans.
+///  @returns True if the operation completed successfully.
+bool rcReserveSpans(rcContext* ctx, rcHeightfield& hf, const int count, rcReservedSpans& spans);
+
+/// Returns the unused reserved spans to the free list of the heightfield they were reserved from.
+///  @ingroup recast
+///  @param[in,out]	hf				The heightfield the spans were reserved from.
+///  @param[in,out]	spans			The reserved spans. Empty on return.
+void rcReleaseSpans(rcHeightfield& hf, rcReservedSpans& spans);
+
+/// Adds a column of spans, sorted from bottom to top, to the specified heightfield
+/// using the reserved spans of the caller. Does not log.
+///  @ingroup recast
+///  @param[in,out]	hf				An initialized heightfield.
+///  @param[in,out]	spans			The reserved spans. [Size: >= @p count]
+///  @param[in]		x				The width index where the spans are to be added.
+///  								[Limits: 0 <= value < rcHeightfield::width]
+///  @param[in]		y				The height index where the spans are to be added.
+///  								[Limits: 0 <= value < rcHeightfield::height]
+///  @param[in]		smin			The minimum heights of the spans. [(smin) * @p count] [Units: vx]
+///  @param[in]		smax			The maximum heights of the spans. [(smax) * @p count] [Units: vx]
+///  @param[in]		areas			The area ids of the spans. [(area) * @p count]
+///  @param[in]		count			The number of spans in the column.
+///  @param[in]		flagMergeThr	The merge theshold. [Limit: >= 0] [Units: vx]
+///  @returns False if the reserved spans ran out.
+bool rcAddReservedSpanColumn(rcHeightfield& hf, rcReservedSpans& spans, const int x, const int y,
+							 const unsigned short* smin, const unsigned short* smax,
+							 const unsigned char* areas, const int count, const int flagMergeThr);
+
 /// Rasterizes a triangle into the specified heightfield.
 ///  @ingroup recast
 ///  @param[in,out]	ctx				The build context to use during the operation.
@@ -894,6 +1094,70 @@ bool rcRasterizeTriangles(rcContext* ctx, const float* verts, const int nv,
 bool rcRasterizeTriangles(rcContext* ctx, const float* verts, const unsigned char* areas, const int nt,
 						  rcHeightfield& solid, const int flagMergeThr = 1);
 
+/// Rasterizes a heightmap into the specified heightfield.
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in]		heights			The heights of the samples, relative to @p orig. [Size: @p hw * @p hh]
+///  @param[in]		hw				The number of samples along the x-axis. [Limit: >= 2]
+///  @param[in]		hh				The number of samples along the z-axis. [Limit: >= 2]
+///  @param[in]		orig			The world space position of the first sample. [(x, y, z)]
+///  @param[in]		spacing			The distance between the samples on the xz-plane. [Limit: > 0]
+///  @param[in]		holes			Non-zero for the cells between the samples that are holes, or null.
+///  								[Size: (@p hw - 1) * (@p hh - 1)]
+///  @param[in]		areas			The area id's of the cells, or null to use @p area.
+///  								[Limit: <= #RC_WALKABLE_AREA] [Size: (@p hw - 1) * (@p hh - 1)]
+///  @param[in]		area			The area id of the cells if @p areas is null. [Limit: <= #RC_WALKABLE_AREA]
+///  @param[in,out]	solid			An initialized heightfield.
+///  @param[in]		flagMergeThr	The distance where the walkable flag is favored over the non-walkable flag. 
+///  								[Limit: >= 0] [Units: vx]
+///  @returns True if the operation completed successfully.
+bool rcRasterizeHeightmap(rcContext* ctx, const float* heights, const int hw, const int hh,
+						  const float* orig, const float spacing,
+						  const unsigned char* holes, const unsigned char* areas, const unsigned char area,
+						  rcHeightfield& solid, const int flagMergeThr = 1);
+
+/// Rasterizes an indexed triangle mesh into the specified heightfield, and tracks the
+/// columns touched by each triangle for later updates.
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in]		verts			The vertices. [(x, y, z) * @p nv]
+///  @param[in]		nv				The number of vertices.
+///  @param[in]		tris			The triangle indices, or -1 for an empty slot. [(vertA, vertB, vertC) * @p nt]
+///  @param[in]		areas			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nt]
+///  @param[in]		nt				The number of triangles.
+///  @param[in,out]	solid			An initialized, empty heightfield.
+///  @param[out]	sources			The tracked columns of the triangles.
+///  @param[in]		flagMergeThr	The distance where the walkable flag is favored over the non-walkable flag. 
+///  								[Limit: >= 0] [Units: vx]
+///  @returns True if the operation completed successfully.
+bool rcRasterizeTrianglesTracked(rcContext* ctx, const float* verts, const int nv,
+								 const int* tris, const unsigned char* areas, const int nt,
+								 rcHeightfield& solid, rcHeightfieldSources& sources,
+								 const int flagMergeThr = 1);
+
+/// Updates a heightfield rasterized with #rcRasterizeTrianglesTracked after some of the
+/// triangles of the mesh were added, removed or changed.
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in]		verts			The vertices of the edited mesh. [(x, y, z) * @p nv]
+///  @param[in]		nv				The number of vertices.
+///  @param[in]		tris			The triangle indices, or -1 for an empty slot. [(vertA, vertB, vertC) * @p nt]
+///  @param[in]		areas			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nt]
+///  @param[in]		nt				The number of triangles.
+///  @param[in]		changed			The indices of the changed triangles. [Size: @p nchanged]
+///  @param[in]		nchanged		The number of changed triangles.
+///  @param[in,out]	solid			The heightfield to update.
+///  @param[in,out]	sources			The tracked columns of the triangles.
+///  @param[out]	dirty			The rasterized columns, empty if minx > maxx. [(minx, miny, maxx, maxy)]
+///  @param[in]		flagMergeThr	The distance where the walkable flag is favored over the non-walkable flag. 
+///  								[Limit: >= 0] [Units: vx]
+///  @returns True if the operation completed successfully.
+bool rcUpdateRasterizedTriangles(rcContext* ctx, const float* verts, const int nv,
+								 const int* tris, const unsigned char* areas, const int nt,
+								 const int* changed, const int nchanged,
+								 rcHeightfield& solid, rcHeightfieldSources& sources,
+								 int* dirty, const int flagMergeThr = 1);
+
 /// Marks non-walkable spans as walkable if their maximum is within @p walkableClimp of a walkable neighbor. 
 ///  @ingroup recast
 ///  @param[in,out]	ctx				The build context to use during the operation.
@@ -902,6 +1166,17 @@ bool rcRasterizeTriangles(rcContext* ctx, const float* verts, const unsigned cha
 ///  @param[in,out]	solid			A fully built heightfield.  (All spans have been added.)
 void rcFilterLowHangingWalkableObstacles(rcContext* ctx, const int walkableClimb, rcHeightfield& solid);
 
+/// Marks non-walkable spans as walkable if their maximum is within @p walkableClimp of a walkable neighbor,
+/// within a rectangle of columns.
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in]		walkableClimb	Maximum ledge height that is considered to still be traversable. 
+///  								[Limit: >=0] [Units: vx]
+///  @param[in,out]	solid			A fully built heightfield.  (All spans have been added.)
+///  @param[in]		rect			The columns to filter. [(minx, miny, maxx, maxy)]
+void rcFilterLowHangingWalkableObstacles(rcContext* ctx, const int walkableClimb, rcHeightfield& solid,
+										 const int* rect);
+
 /// Marks spans that are ledges as not-walkable. 
 ///  @ingroup recast
 ///  @param[in,out]	ctx				The build context to use during the operation.
@@ -913,6 +1188,18 @@ void rcFilterLowHangingWalkableObstacles(rcContext* ctx, const int walkableClimb
 void rcFilterLedgeSpans(rcContext* ctx, const int walkableHeight,
 						const int walkableClimb, rcHeightfield& solid);
 
+/// Marks spans that are ledges as not-walkable, within a rectangle of columns. 
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in]		walkableHeight	Minimum floor to 'ceiling' height that will still allow the floor area to 
+///  								be considered walkable. [Limit: >= 3] [Units: vx]
+///  @param[in]		walkableClimb	Maximum ledge height that is considered to still be traversable. 
+///  								[Limit: >=0] [Units: vx]
+///  @param[in,out]	solid			A fully built heightfield.  (All spans have been added.)
+///  @param[in]		rect			The columns to filter. [(minx, miny, maxx, maxy)]
+void rcFilterLedgeSpans(rcContext* ctx, const int walkableHeight,
+						const int walkableClimb, rcHeightfield& solid, const int* rect);
+
 /// Marks walkable spans as not walkable if the clearence above the span is less than the specified height. 
 ///  @ingroup recast
 ///  @param[in,out]	ctx				The build context to use during the operation.
@@ -921,6 +1208,16 @@ void rcFilterLedgeSpans(rcContext* ctx, const int walkableHeight,
 ///  @param[in,out]	solid			A fully built heightfield.  (All spans have been added.)
 void rcFilterWalkableLowHeightSpans(rcContext* ctx, int walkableHeight, rcHeightfield& solid);
 
+/// Marks walkable spans as not walkable if the clearence above the span is less than the specified height,
+/// within a rectangle of columns. 
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in]		walkableHeight	Minimum floor to 'ceiling' height that will still allow the floor area to 
+///  								be considered walkable. [Limit: >= 3] [Units: vx]
+///  @param[in,out]	solid			A fully built heightfield.  (All spans have been added.)
+///  @param[in]		rect			The columns to filter. [(minx, miny, maxx, maxy)]
+void rcFilterWalkableLowHeightSpans(rcContext* ctx, int walkableHeight, rcHeightfield& solid, const int* rect);
+
 /// Returns the number of spans contained in the specified heightfield.
 ///  @ingroup recast
 ///  @param[in,out]	ctx		The build context to use during the operation.
@@ -946,6 +1243,33 @@ int rcGetHeightFieldSpanCount(rcContext* ctx, rcHeightfield& hf);
 bool rcBuildCompactHeightfield(rcContext* ctx, const int walkableHeight, const int walkableClimb,
 							   rcHeightfield& hf, rcCompactHeightfield& chf);
 
+/// Builds a compact heightfield directly from triangles, rasterizing and filtering the solid 
+/// heightfield in strips of rows so that only one strip of it exists at a time.
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in]		cfg				The configuration of the build. The grid size, bounds, cell size, 
+///  								cell height, walkable height and walkable climb are used.
+///  @param[in]		verts			The vertices. [(x, y, z) * @p nv]
+///  @param[in]		nv				The number of vertices.
+///  @param[in]		tris			The triangle indices. [(vertA, vertB, vertC) * @p nt]
+///  @param[in]		areas			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nt]
+///  @param[in]		nt				The number of triangles.
+///  @param[in]		stripSize		The number of rows rasterized at a time. [Limit: > 0] [Units: vx]
+///  @param[out]	chf				The resulting compact heightfield. (Must be pre-allocated.)
+///  @returns True if the operation completed successfully.
+bool rcBuildCompactHeightfieldStreamed(rcContext* ctx, const rcConfig& cfg,
+									   const float* verts, const int nv,
+									   const int* tris, const unsigned char* areas, const int nt,
+									   const int stripSize, rcCompactHeightfield& chf);
+
+/// Finds the neighbour connections of the spans of a compact heightfield whose cells and 
+/// spans have been filled in.
+///  @ingroup recast
+///  @param[in,out]	ctx		The build context to use during the operation.
+///  @param[in,out]	chf		The compact heightfield.
+///  @returns True if the operation completed successfully.
+bool rcBuildCompactHeightfieldConnections(rcContext* ctx, rcCompactHeightfield& chf);
+
 /// Erodes the walkable area within the heightfield by the specified radius. 
 ///  @ingroup recast
 ///  @param[in,out]	ctx		The build context to use during the operation.
@@ -954,6 +1278,15 @@ bool rcBuildCompactHeightfield(rcContext* ctx, const int walkableHeight, const i
 ///  @returns True if the operation completed successfully.
 bool rcErodeWalkableArea(rcContext* ctx, int radius, rcCompactHeightfield& chf);
 
+/// Erodes the walkable area within the heightfield by the specified radius, using the exact
+/// distance to the boundary so the eroded area follows circles of the radius.
+///  @ingroup recast
+///  @param[in,out]	ctx		The build context to use during the operation.
+///  @param[in]		radius	The radius of erosion. [Limits: 0 < value < 255] [Units: vx]
+///  @param[in,out]	chf		The populated compact heightfield to erode.
+///  @returns True if the operation completed successfully.
+bool rcErodeWalkableAreaExact(rcContext* ctx, int radius, rcCompactHeightfield& chf);
+
 /// Applies a median filter to walkable area types (based on area id), removing noise.
 ///  @ingroup recast
 ///  @param[in,out]	ctx		The build context to use during the operation.
@@ -961,6 +1294,15 @@ bool rcErodeWalkableArea(rcContext* ctx, int radius, rcCompactHeightfield& chf);
 ///  @returns True if the operation completed successfully.
 bool rcMedianFilterWalkableArea(rcContext* ctx, rcCompactHeightfield& chf);
 
+/// Applies a median filter to walkable area types (based on area id), removing noise,
+/// using a caller-supplied buffer instead of allocating one.
+///  @ingroup recast
+///  @param[in,out]	ctx		The build context to use during the operation.
+///  @param[in,out]	chf		A populated compact heightfield.
+///  @param[out]	scratch	A buffer for the filtered area ids. [Size: >= chf.spanCount]
+///  @returns True if the operation completed successfully.
+bool rcMedianFilterWalkableArea(rcContext* ctx, rcCompactHeightfield& chf, unsigned char* scratch);
+
 /// Applies an area id to all spans within the specified bounding box. (AABB) 
 ///  @ingroup recast
 ///  @param[in,out]	ctx		The build context to use during the operation.
@@ -984,6 +1326,31 @@ void rcMarkConvexPolyArea(rcContext* ctx, const float* verts, const int nverts,
 						  const float hmin, const float hmax, unsigned char areaId,
 						  rcCompactHeightfield& chf);
 
+/// Builds a set of convex volumes and its spatial index for #rcMarkAreaVolumes.
+///  @ingroup recast
+///  @param[in,out]	ctx			The build context to use during the operation.
+///  @param[in]		verts		The vertices of all the volumes, one volume after another. [(x, y, z) * vertex count]
+///  @param[in]		nverts		The number of vertices of each volume. [Size: @p nvolumes]
+///  @param[in]		hmin		The height of the base of each volume. [Size: @p nvolumes]
+///  @param[in]		hmax		The height of the top of each volume. [Size: @p nvolumes]
+///  @param[in]		areas		The area id of each volume. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nvolumes]
+///  @param[in]		nvolumes	The number of volumes.
+///  @param[in]		cellSize	The size of the index cells on the xz-plane, e.g. the tile size. [Limit: > 0]
+///  @param[out]	vset		The resulting volume set.
+///  @returns True if the operation completed successfully.
+bool rcBuildAreaVolumeSet(rcContext* ctx, const float* verts, const int* nverts,
+						  const float* hmin, const float* hmax, const unsigned char* areas,
+						  const int nvolumes, const float cellSize, rcAreaVolumeSet& vset);
+
+/// Applies the area id's of the volumes of a set to the spans within them, as if calling
+/// #rcMarkConvexPolyArea for each volume in order.
+///  @ingroup recast
+///  @param[in,out]	ctx		The build context to use during the operation.
+///  @param[in]		vset	The volume set.
+///  @param[in,out]	chf		A populated compact heightfield.
+///  @returns True if the operation completed successfully.
+bool rcMarkAreaVolumes(rcContext* ctx, const rcAreaVolumeSet& vset, rcCompactHeightfield& chf);
+
 /// Helper function to offset voncex polygons for rcMarkConvexPolyArea.
 ///  @ingroup recast
 ///  @param[in]		verts		The vertices of the polygon [Form: (x, y, z) * @p nverts]
@@ -1124,6 +1491,22 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 							  const int borderSize, const int walkableHeight,
 							  rcHeightfieldLayerSet& lset);
 
+/// Builds the layer sets of several compact heightfields, processing the heightfields in parallel.
+///  @ingroup recast
+///  @param[in,out]	ctx			The build context to use during the operation.
+///  @param[in]		chfs		The fully built compact heightfields. [Size: @p count]
+///  @param[in]		count		The number of heightfields.
+///  @param[in]		borderSize	The size of the non-navigable border around the heightfields. [Limit: >=0] 
+///  							[Units: vx]
+///  @param[in]		walkableHeight	Minimum floor to 'ceiling' height that will still allow the floor area 
+///  							to be considered walkable. [Limit: >= 3] [Units: vx]
+///  @param[out]	lsets		The resulting layer set of each heightfield. (Must be pre-allocated.) 
+///  							[Size: @p count]
+///  @returns True if the layers of all of the heightfields were built successfully.
+bool rcBuildHeightfieldLayersBatch(rcContext* ctx, const rcCompactHeightfield* const* chfs, const int count,
+								   const int borderSize, const int walkableHeight,
+								   rcHeightfieldLayerSet* const* lsets);
+
 /// Builds a contour set from the region outlines in the provided compact heightfield.
 ///  @ingroup recast
 ///  @param[in,out]	ctx			The build context to use during the operation.
@@ -29,6 +29,37 @@ enum rcAllocHint
 	RC_ALLOC_TEMP		///< Memory used temporarily within a function.
 };
 
+/// The parts of Recast the allocated memory is accounted to.
+/// @see rcAlloc, rcGetAllocStats
+enum rcAllocSubsystem
+{
+	RC_MEM_OTHER,					///< Memory not accounted to a specific subsystem.
+	RC_MEM_HEIGHTFIELD,				///< Heightfields and their spans.
+	RC_MEM_COMPACT_HEIGHTFIELD,		///< Compact heightfields and the area passes on them.
+	RC_MEM_REGIONS,					///< Distance fields and region partitioning.
+	RC_MEM_LAYERS,					///< Heightfield layers.
+	RC_MEM_CONTOURS,				///< Contour sets.
+	RC_MEM_POLYMESH,				///< Polygon meshes.
+	RC_MEM_POLYMESH_DETAIL,			///< Detail meshes.
+	RC_MAX_MEM_SUBSYSTEMS			///< The number of subsystems.
+};
+
+// Undefine (or define in a build config) the following line to account the memory
+// allocated through rcAlloc per hint and per subsystem. (See: rcGetAllocStats)
+// Note: every allocation then carries a small header, so the custom allocation
+// functions have to be set before any memory is allocated.
+//#define RC_MEMORY_STATS 1
+
+/// The memory usage accounted by #rcAlloc and #rcFree.
+/// @see rcGetAllocStats
+struct rcAllocStats
+{
+	size_t liveBytes;		///< The size of the allocations in use. [Units: bytes]
+	size_t peakBytes;		///< The largest size in use since the last reset. [Units: bytes]
+	size_t liveCount;		///< The number of allocations in use.
+	size_t totalCount;		///< The number of allocations made since the last reset.
+};
+
 /// A memory allocation function.
 //  @param[in]		size			The size, in bytes of memory, to allocate.
 //  @param[in]		rcAllocHint	A hint to the allocator on how long the memory is expected to be in use.
@@ -53,11 +84,39 @@ void rcAllocSetCustom(rcAllocFunc *allocFunc, rcFreeFunc *freeFunc);
 /// @see rcFree
 void* rcAlloc(size_t size, rcAllocHint hint);
 
+/// Allocates a memory block and accounts it to the specified subsystem.
+///  @param[in]		size		The size, in bytes of memory, to allocate.
+///  @param[in]		hint		A hint to the allocator on how long the memory is expected to be in use.
+///  @param[in]		subsystem	The subsystem the memory is accounted to.
+///  @return A pointer to the beginning of the allocated memory block, or null if the allocation failed.
+/// @see rcFree
+void* rcAlloc(size_t size, rcAllocHint hint, rcAllocSubsystem subsystem);
+
 /// Deallocates a memory block.
 ///  @param[in]		ptr		A pointer to a memory block previously allocated using #rcAlloc.
 /// @see rcAlloc
 void rcFree(void* ptr);
 
+/// Gets the memory usage of the allocations made with the specified hint.
+///  @param[in]		hint		The allocation hint.
+///  @param[out]	stats		The memory usage.
+///  @return True if the memory usage is accounted. (RC_MEMORY_STATS is defined.)
+bool rcGetAllocStats(rcAllocHint hint, rcAllocStats& stats);
+
+/// Gets the memory usage of the allocations accounted to the specified subsystem.
+///  @param[in]		subsystem	The subsystem.
+///  @param[out]	stats		The memory usage.
+///  @return True if the memory usage is accounted. (RC_MEMORY_STATS is defined.)
+bool rcGetAllocStats(rcAllocSubsystem subsystem, rcAllocStats& stats);
+
+/// Gets the memory usage of all allocations.
+///  @param[out]	stats		The memory usage.
+///  @return True if the memory usage is accounted. (RC_MEMORY_STATS is defined.)
+bool rcGetAllocTotalStats(rcAllocStats& stats);
+
+/// Restarts the peak sizes from the sizes in use and clears the allocation counts.
+void rcResetAllocStats();
+
 
 /// A simple dynamic array of integers.
 class rcIntArray
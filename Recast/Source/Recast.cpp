@@ -45,6 +45,15 @@ float rcSqrt(float x)
 /// If no logging or timers are required, just pass an instance of this 
 /// class through the Recast build process.
 ///
+/// Some build functions split their work into independent items and hand 
+/// them to #runParallel.  By default the items are processed serially on the 
+/// calling thread.  Implementations may override #doGetWorkerCount and 
+/// #doRunParallel to process the items concurrently, for example with a 
+/// thread pool.  Tasks never log or touch the timers while running, so the 
+/// logging and timer overrides do not need to be thread safe.  Tasks may 
+/// allocate memory though, so a custom allocator installed with 
+/// #rcAllocSetCustom must be thread safe when the items run concurrently.
+///
 
 /// @par
 ///
@@ -73,7 +82,7 @@ void rcContext::log(const rcLogCategory category, const char* format, ...)
 
 rcHeightfield* rcAllocHeightfield()
 {
-	return new (rcAlloc(sizeof(rcHeightfield), RC_ALLOC_PERM)) rcHeightfield;
+	return new (rcAlloc(sizeof(rcHeightfield), RC_ALLOC_PERM, RC_MEM_HEIGHTFIELD)) rcHeightfield;
 }
 
 rcHeightfield::rcHeightfield()
@@ -109,9 +118,42 @@ void rcFreeHeightField(rcHeightfield* hf)
 	rcFree(hf);
 }
 
+rcHeightfieldSources* rcAllocHeightfieldSources()
+{
+	rcHeightfieldSources* sources = (rcHeightfieldSources*)rcAlloc(sizeof(rcHeightfieldSources), RC_ALLOC_PERM, RC_MEM_HEIGHTFIELD);
+	memset(sources, 0, sizeof(rcHeightfieldSources));
+	return sources;
+}
+
+void rcFreeHeightfieldSources(rcHeightfieldSources* sources)
+{
+	if (!sources) return;
+	rcFree(sources->bounds);
+	rcFree(sources);
+}
+
+rcAreaVolumeSet* rcAllocAreaVolumeSet()
+{
+	rcAreaVolumeSet* vset = (rcAreaVolumeSet*)rcAlloc(sizeof(rcAreaVolumeSet), RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+	memset(vset, 0, sizeof(rcAreaVolumeSet));
+	return vset;
+}
+
+void rcFreeAreaVolumeSet(rcAreaVolumeSet* vset)
+{
+	if (!vset) return;
+	rcFree(vset->verts);
+	rcFree(vset->polys);
+	rcFree(vset->bounds);
+	rcFree(vset->areas);
+	rcFree(vset->cellFirst);
+	rcFree(vset->cellItems);
+	rcFree(vset);
+}
+
 rcCompactHeightfield* rcAllocCompactHeightfield()
 {
-	rcCompactHeightfield* chf = (rcCompactHeightfield*)rcAlloc(sizeof(rcCompactHeightfield), RC_ALLOC_PERM);
+	rcCompactHeightfield* chf = (rcCompactHeightfield*)rcAlloc(sizeof(rcCompactHeightfield), RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
 	memset(chf, 0, sizeof(rcCompactHeightfield));
 	return chf;
 }
@@ -128,7 +170,7 @@ void rcFreeCompactHeightfield(rcCompactHeightfield* chf)
 
 rcHeightfieldLayerSet* rcAllocHeightfieldLayerSet()
 {
-	rcHeightfieldLayerSet* lset = (rcHeightfieldLayerSet*)rcAlloc(sizeof(rcHeightfieldLayerSet), RC_ALLOC_PERM);
+	rcHeightfieldLayerSet* lset = (rcHeightfieldLayerSet*)rcAlloc(sizeof(rcHeightfieldLayerSet), RC_ALLOC_PERM, RC_MEM_LAYERS);
 	memset(lset, 0, sizeof(rcHeightfieldLayerSet));
 	return lset;
 }
@@ -149,7 +191,7 @@ void rcFreeHeightfieldLayerSet(rcHeightfieldLayerSet* lset)
 
 rcContourSet* rcAllocContourSet()
 {
-	rcContourSet* cset = (rcContourSet*)rcAlloc(sizeof(rcContourSet), RC_ALLOC_PERM);
+	rcContourSet* cset = (rcContourSet*)rcAlloc(sizeof(rcContourSet), RC_ALLOC_PERM, RC_MEM_CONTOURS);
 	memset(cset, 0, sizeof(rcContourSet));
 	return cset;
 }
@@ -168,7 +210,7 @@ void rcFreeContourSet(rcContourSet* cset)
 
 rcPolyMesh* rcAllocPolyMesh()
 {
-	rcPolyMesh* pmesh = (rcPolyMesh*)rcAlloc(sizeof(rcPolyMesh), RC_ALLOC_PERM);
+	rcPolyMesh* pmesh = (rcPolyMesh*)rcAlloc(sizeof(rcPolyMesh), RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	memset(pmesh, 0, sizeof(rcPolyMesh));
 	return pmesh;
 }
@@ -186,7 +228,7 @@ void rcFreePolyMesh(rcPolyMesh* pmesh)
 
 rcPolyMeshDetail* rcAllocPolyMeshDetail()
 {
-	rcPolyMeshDetail* dmesh = (rcPolyMeshDetail*)rcAlloc(sizeof(rcPolyMeshDetail), RC_ALLOC_PERM);
+	rcPolyMeshDetail* dmesh = (rcPolyMeshDetail*)rcAlloc(sizeof(rcPolyMeshDetail), RC_ALLOC_PERM, RC_MEM_POLYMESH_DETAIL);
 	memset(dmesh, 0, sizeof(rcPolyMeshDetail));
 	return dmesh;
 }
@@ -236,7 +278,7 @@ bool rcCreateHeightfield(rcContext* ctx, rcHeightfield& hf, int width, int heigh
 	rcVcopy(hf.bmax, bmax);
 	hf.cs = cs;
 	hf.ch = ch;
-	hf.spans = (rcSpan**)rcAlloc(sizeof(rcSpan*)*hf.width*hf.height, RC_ALLOC_PERM);
+	hf.spans = (rcSpan**)rcAlloc(sizeof(rcSpan*)*hf.width*hf.height, RC_ALLOC_PERM, RC_MEM_HEIGHTFIELD);
 	if (!hf.spans)
 		return false;
 	memset(hf.spans, 0, sizeof(rcSpan*)*hf.width*hf.height);
@@ -364,21 +406,21 @@ bool rcBuildCompactHeightfield(rcContext* ctx, const int walkableHeight, const i
 	chf.bmax[1] += walkableHeight*hf.ch;
 	chf.cs = hf.cs;
 	chf.ch = hf.ch;
-	chf.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell)*w*h, RC_ALLOC_PERM);
+	chf.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell)*w*h, RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
 	if (!chf.cells)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.cells' (%d)", w*h);
 		return false;
 	}
 	memset(chf.cells, 0, sizeof(rcCompactCell)*w*h);
-	chf.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan)*spanCount, RC_ALLOC_PERM);
+	chf.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan)*spanCount, RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
 	if (!chf.spans)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.spans' (%d)", spanCount);
 		return false;
 	}
 	memset(chf.spans, 0, sizeof(rcCompactSpan)*spanCount);
-	chf.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*spanCount, RC_ALLOC_PERM);
+	chf.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*spanCount, RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
 	if (!chf.areas)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.areas' (%d)", spanCount);
@@ -417,6 +459,24 @@ bool rcBuildCompactHeightfield(rcContext* ctx, const int walkableHeight, const i
 		}
 	}
 
+	return rcBuildCompactHeightfieldConnections(ctx, chf);
+}
+
+/// @par
+///
+/// Uses the walkable height and climb of the compact heightfield to decide which
+/// neighbour spans are accessible.
+///
+/// @see rcBuildCompactHeightfield, rcBuildCompactHeightfieldStreamed
+bool rcBuildCompactHeightfieldConnections(rcContext* ctx, rcCompactHeightfield& chf)
+{
+	rcAssert(ctx);
+	
+	const int w = chf.width;
+	const int h = chf.height;
+	const int walkableHeight = chf.walkableHeight;
+	const int walkableClimb = chf.walkableClimb;
+	
 	// Find neighbour connections.
 	const int MAX_LAYERS = RC_NOT_CONNECTED-1;
 	int tooHighNeighbour = 0;
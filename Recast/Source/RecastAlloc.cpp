@@ -41,10 +41,147 @@ void rcAllocSetCustom(rcAllocFunc *allocFunc, rcFreeFunc *freeFunc)
 	sRecastFreeFunc = freeFunc ? freeFunc : rcFreeDefault;
 }
 
+#ifdef RC_MEMORY_STATS
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static long long rcAtomicCompareExchange(volatile long long* dst, long long value, long long comparand)
+{
+	return _InterlockedCompareExchange64(dst, value, comparand);
+}
+#else
+static long long rcAtomicCompareExchange(volatile long long* dst, long long value, long long comparand)
+{
+	return __sync_val_compare_and_swap(dst, comparand, value);
+}
+#endif
+
+static long long rcAtomicAdd(volatile long long* dst, long long value)
+{
+	long long cur = *dst;
+	for (;;)
+	{
+		const long long prev = rcAtomicCompareExchange(dst, cur + value, cur);
+		if (prev == cur)
+			return cur + value;
+		cur = prev;
+	}
+}
+
+static void rcAtomicMax(volatile long long* dst, long long value)
+{
+	long long cur = *dst;
+	while (value > cur)
+	{
+		const long long prev = rcAtomicCompareExchange(dst, value, cur);
+		if (prev == cur)
+			return;
+		cur = prev;
+	}
+}
+
+static long long rcAtomicLoad(volatile long long* src)
+{
+	// Exchanging zero for zero leaves the value unchanged.
+	return rcAtomicCompareExchange(src, 0, 0);
+}
+
+static void rcAtomicStore(volatile long long* dst, long long value)
+{
+	long long cur = *dst;
+	for (;;)
+	{
+		const long long prev = rcAtomicCompareExchange(dst, value, cur);
+		if (prev == cur)
+			return;
+		cur = prev;
+	}
+}
+
+struct rcAllocCounter
+{
+	volatile long long liveBytes;
+	volatile long long peakBytes;
+	volatile long long liveCount;
+	volatile long long totalCount;
+};
+
+static rcAllocCounter sHintCounters[RC_ALLOC_TEMP+1];
+static rcAllocCounter sSubsystemCounters[RC_MAX_MEM_SUBSYSTEMS];
+static rcAllocCounter sTotalCounter;
+
+// The header in front of each allocation. Its size keeps the returned memory
+// aligned like the memory of the allocation function.
+struct rcAllocHeader
+{
+	size_t size;
+	unsigned short hint;
+	unsigned short subsystem;
+};
+static const size_t RC_ALLOC_HEADER_SIZE = 16;
+
+static void rcCountAlloc(rcAllocCounter& counter, const long long size)
+{
+	rcAtomicMax(&counter.peakBytes, rcAtomicAdd(&counter.liveBytes, size));
+	rcAtomicAdd(&counter.liveCount, 1);
+	rcAtomicAdd(&counter.totalCount, 1);
+}
+
+static void rcCountFree(rcAllocCounter& counter, const long long size)
+{
+	rcAtomicAdd(&counter.liveBytes, -size);
+	rcAtomicAdd(&counter.liveCount, -1);
+}
+
+static void rcGetCounter(rcAllocCounter& counter, rcAllocStats& stats)
+{
+	stats.liveBytes = (size_t)rcAtomicLoad(&counter.liveBytes);
+	stats.peakBytes = (size_t)rcAtomicLoad(&counter.peakBytes);
+	stats.liveCount = (size_t)rcAtomicLoad(&counter.liveCount);
+	stats.totalCount = (size_t)rcAtomicLoad(&counter.totalCount);
+}
+
+static void rcResetCounter(rcAllocCounter& counter)
+{
+	// An allocation can raise the peak between the load of the live bytes and the store,
+	// raising the peak again afterwards keeps it at least the live bytes.
+	rcAtomicStore(&counter.peakBytes, rcAtomicLoad(&counter.liveBytes));
+	rcAtomicMax(&counter.peakBytes, rcAtomicLoad(&counter.liveBytes));
+	rcAtomicStore(&counter.totalCount, 0);
+}
+
+#endif // RC_MEMORY_STATS
+
 /// @see rcAllocSetCustom
 void* rcAlloc(size_t size, rcAllocHint hint)
 {
+	return rcAlloc(size, hint, RC_MEM_OTHER);
+}
+
+/// @par
+///
+/// The subsystem is only used to account the memory when RC_MEMORY_STATS is defined,
+/// the allocation function receives just the size and the hint.
+///
+/// @see rcAllocSetCustom, rcGetAllocStats
+void* rcAlloc(size_t size, rcAllocHint hint, rcAllocSubsystem subsystem)
+{
+#ifdef RC_MEMORY_STATS
+	unsigned char* mem = (unsigned char*)sRecastAllocFunc(RC_ALLOC_HEADER_SIZE + size, hint);
+	if (!mem)
+		return 0;
+	rcAllocHeader* header = (rcAllocHeader*)mem;
+	header->size = size;
+	header->hint = (unsigned short)hint;
+	header->subsystem = (unsigned short)subsystem;
+	rcCountAlloc(sHintCounters[hint], (long long)size);
+	rcCountAlloc(sSubsystemCounters[subsystem], (long long)size);
+	rcCountAlloc(sTotalCounter, (long long)size);
+	return mem + RC_ALLOC_HEADER_SIZE;
+#else
+	(void)subsystem;
 	return sRecastAllocFunc(size, hint);
+#endif
 }
 
 /// @par
@@ -55,8 +192,71 @@ void* rcAlloc(size_t size, rcAllocHint hint)
 /// @see rcAllocSetCustom
 void rcFree(void* ptr)
 {
-	if (ptr)
-		sRecastFreeFunc(ptr);
+	if (!ptr)
+		return;
+#ifdef RC_MEMORY_STATS
+	unsigned char* mem = (unsigned char*)ptr - RC_ALLOC_HEADER_SIZE;
+	const rcAllocHeader* header = (const rcAllocHeader*)mem;
+	rcCountFree(sHintCounters[header->hint], (long long)header->size);
+	rcCountFree(sSubsystemCounters[header->subsystem], (long long)header->size);
+	rcCountFree(sTotalCounter, (long long)header->size);
+	sRecastFreeFunc(mem);
+#else
+	sRecastFreeFunc(ptr);
+#endif
+}
+
+/// @par
+///
+/// Always fails when RC_MEMORY_STATS is not defined.
+/// The counters are updated atomically, but the values are read one at a time, so
+/// they can be slightly out of sync while other threads allocate memory.
+bool rcGetAllocStats(rcAllocHint hint, rcAllocStats& stats)
+{
+#ifdef RC_MEMORY_STATS
+	rcGetCounter(sHintCounters[hint], stats);
+	return true;
+#else
+	(void)hint;
+	memset(&stats, 0, sizeof(stats));
+	return false;
+#endif
+}
+
+/// @see rcGetAllocStats(rcAllocHint, rcAllocStats&)
+bool rcGetAllocStats(rcAllocSubsystem subsystem, rcAllocStats& stats)
+{
+#ifdef RC_MEMORY_STATS
+	rcGetCounter(sSubsystemCounters[subsystem], stats);
+	return true;
+#else
+	(void)subsystem;
+	memset(&stats, 0, sizeof(stats));
+	return false;
+#endif
+}
+
+/// @see rcGetAllocStats(rcAllocHint, rcAllocStats&)
+bool rcGetAllocTotalStats(rcAllocStats& stats)
+{
+#ifdef RC_MEMORY_STATS
+	rcGetCounter(sTotalCounter, stats);
+	return true;
+#else
+	memset(&stats, 0, sizeof(stats));
+	return false;
+#endif
+}
+
+void rcResetAllocStats()
+{
+#ifdef RC_MEMORY_STATS
+	for (int i = 0; i <= RC_ALLOC_TEMP; ++i)
+		rcResetCounter(sHintCounters[i]);
+	for (int i = 0; i < RC_MAX_MEM_SUBSYSTEMS; ++i)
+		rcResetCounter(sSubsystemCounters[i]);
+	rcResetCounter(sTotalCounter);
+#endif
 }
 
 /// @class rcIntArray
@@ -43,7 +43,7 @@ bool rcErodeWalkableArea(rcContext* ctx, int radius, rcCompactHeightfield& chf)
 	
 	rcScopedTimer timer(ctx, RC_TIMER_ERODE_AREA);
 	
-	unsigned char* dist = (unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP);
+	unsigned char* dist = (unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP, RC_MEM_COMPACT_HEIGHTFIELD);
 	if (!dist)
 	{
 		ctx->log(RC_LOG_ERROR, "erodeWalkableArea: Out of memory 'dist' (%d).", chf.spanCount);
@@ -218,43 +218,206 @@ bool rcErodeWalkableArea(rcContext* ctx, int radius, rcCompactHeightfield& chf)
 	return true;
 }
 
-static void insertSort(unsigned char* a, const int n)
+// Returns the neighbour of a span in the specified direction, or -1 if not connected.
+inline int getNeighbourSpan(const rcCompactHeightfield& chf, const int x, const int y, const int i, const int dir)
 {
-	int i, j;
-	for (i = 1; i < n; i++)
+	const rcCompactSpan& s = chf.spans[i];
+	if (rcGetCon(s, dir) == RC_NOT_CONNECTED)
+		return -1;
+	const int nx = x + rcGetDirOffsetX(dir);
+	const int ny = y + rcGetDirOffsetY(dir);
+	return (int)chf.cells[nx+ny*chf.width].index + rcGetCon(s, dir);
+}
+
+// Computes the exact squared distance transform along a chain of spans, following
+// Meijster et al. The input is the distance of each span to the nearest boundary along
+// the first axis, or a distance larger than any in the heightfield if none. [Size: n]
+static void distanceTransformChain(const int* g, const int n, int* sq, int* st, int* dt)
+{
+	int q = 0;
+	sq[0] = 0;
+	st[0] = 0;
+	for (int u = 1; u < n; ++u)
 	{
-		const unsigned char value = a[i];
-		for (j = i - 1; j >= 0 && a[j] > value; j--)
-			a[j+1] = a[j];
-		a[j+1] = value;
+		// Remove the parabolas hidden by the new one.
+		while (q >= 0 && (st[q]-sq[q])*(st[q]-sq[q]) + g[sq[q]]*g[sq[q]] > (st[q]-u)*(st[q]-u) + g[u]*g[u])
+			q--;
+		if (q < 0)
+		{
+			q = 0;
+			sq[0] = u;
+		}
+		else
+		{
+			const int i = sq[q];
+			const int w = 1 + (u*u - i*i + g[u]*g[u] - g[i]*g[i]) / (2*(u-i));
+			if (w < n)
+			{
+				q++;
+				sq[q] = u;
+				st[q] = w;
+			}
+		}
+	}
+	for (int u = n-1; u >= 0; --u)
+	{
+		dt[u] = (u-sq[q])*(u-sq[q]) + g[sq[q]]*g[sq[q]];
+		if (u == st[q])
+			q--;
 	}
 }
 
+// Computes the distance of the spans of one row to the nearest boundary span along
+// the chains of spans connected on the x-axis, and stores it in the column chain
+// of each span.
+struct rcErodeRowTask : public rcParallelTask
+{
+	const rcCompactHeightfield* chf;
+	const int* chainOf;		// The column chain of each span.
+	const int* chainPos;	// The position of each span in its column chain.
+	const int* chainFirst;	// The first item of each column chain in #dist.
+	int* dist;				// The distances in column chain order.
+	int* scratch;			// Chain buffer per worker. [Size: maxLen * workers]
+	int maxLen;
+	int inf;
+
+	inline bool isBoundarySpan(const int x, const int y, const int i) const
+	{
+		if (chf->areas[i] == RC_NULL_AREA)
+			return true;
+		for (int dir = 0; dir < 4; ++dir)
+		{
+			const int ni = getNeighbourSpan(*chf, x, y, i, dir);
+			if (ni == -1 || chf->areas[ni] == RC_NULL_AREA)
+				return true;
+		}
+		return false;
+	}
+
+	virtual void run(const int y, const int worker)
+	{
+		const rcCompactHeightfield& c = *chf;
+		const int w = c.width;
+		int* chain = &scratch[worker*maxLen];
+
+		// Mark the spans of the row as not visited.
+		for (int x = 0; x < w; ++x)
+		{
+			const rcCompactCell& cell = c.cells[x+y*w];
+			for (int i = (int)cell.index, ni = (int)(cell.index+cell.count); i < ni; ++i)
+				dist[chainFirst[chainOf[i]] + chainPos[i]] = -1;
+		}
+
+		for (int x = 0; x < w; ++x)
+		{
+			const rcCompactCell& cell = c.cells[x+y*w];
+			for (int i = (int)cell.index, ni = (int)(cell.index+cell.count); i < ni; ++i)
+			{
+				// Start a chain from each span not visited yet. The links are not symmetric,
+				// a span linked on -x is not always reached from the chain of its neighbour.
+				if (dist[chainFirst[chainOf[i]] + chainPos[i]] != -1)
+					continue;
+
+				// A chain meeting the spans of an earlier chain continues their distances.
+				int n = 0;
+				int right = inf;
+				for (int j = i, cx = x; j != -1 && n < maxLen; j = getNeighbourSpan(c, cx, y, j, 2), ++cx)
+				{
+					if (n > 0 && dist[chainFirst[chainOf[j]] + chainPos[j]] != -1)
+					{
+						right = dist[chainFirst[chainOf[j]] + chainPos[j]];
+						break;
+					}
+					chain[n++] = j;
+				}
+				const int li = getNeighbourSpan(c, x, y, i, 0);
+				int d = li != -1 ? dist[chainFirst[chainOf[li]] + chainPos[li]] : inf;
+
+				// Distance to the nearest boundary span on the left, then on the right.
+				for (int k = 0; k < n; ++k)
+				{
+					d = isBoundarySpan(x+k, y, chain[k]) ? 0 : rcMin(d+1, inf);
+					chain[k] = chainFirst[chainOf[chain[k]]] + chainPos[chain[k]];
+					dist[chain[k]] = d;
+				}
+				d = right;
+				for (int k = n-1; k >= 0; --k)
+				{
+					d = dist[chain[k]] == 0 ? 0 : rcMin(d+1, inf);
+					dist[chain[k]] = rcMin(dist[chain[k]], d);
+				}
+			}
+		}
+	}
+};
+
+// Combines the row distances along the chains of spans connected on the z-axis.
+// Each work item is a batch of consecutive chains.
+struct rcErodeColumnTask : public rcParallelTask
+{
+	const int* chainFirst;	// The first item of each column chain in #dist. [Size: nchains + 1]
+	int* dist;				// The distances in column chain order, replaced by the squared distances.
+	int* scratch;			// Chain buffers per worker. [Size: maxLen * 3 * workers]
+	int maxLen;
+	int nchains;
+	int batchSize;
+
+	virtual void run(const int batch, const int worker)
+	{
+		int* sq = &scratch[worker*maxLen*3];
+		int* st = sq + maxLen;
+		int* dt = st + maxLen;
+		const int end = rcMin((batch+1)*batchSize, nchains);
+		for (int i = batch*batchSize; i < end; ++i)
+		{
+			int* g = &dist[chainFirst[i]];
+			const int n = chainFirst[i+1] - chainFirst[i];
+			distanceTransformChain(g, n, sq, st, dt);
+			memcpy(g, dt, sizeof(int)*n);
+		}
+	}
+};
+
 /// @par
 ///
-/// This filter is usually applied after applying area id's using functions
-/// such as #rcMarkBoxArea, #rcMarkConvexPolyArea, and #rcMarkCylinderArea.
-/// 
-/// @see rcCompactHeightfield
-bool rcMedianFilterWalkableArea(rcContext* ctx, rcCompactHeightfield& chf)
+/// Unlike #rcErodeWalkableArea, which approximates the distance to the boundary with
+/// a chamfer distance, the spans are eroded by their exact Euclidean distance to the
+/// nearest boundary span, which gives round corners of exactly @p radius.
+///
+/// The distance is computed separably: first along the chains of spans connected on
+/// the x-axis, then along the chains connected on the z-axis. On a single layer of spans
+/// this is the exact distance transform; where layers overlap, the distance follows
+/// the connections of the spans. The rows and then the column chains are processed with
+/// rcContext::runParallel.
+///
+/// @see rcCompactHeightfield, rcErodeWalkableArea, rcConfig::walkableRadius
+bool rcErodeWalkableAreaExact(rcContext* ctx, int radius, rcCompactHeightfield& chf)
 {
 	rcAssert(ctx);
-	
+
 	const int w = chf.width;
 	const int h = chf.height;
-	
-	rcScopedTimer timer(ctx, RC_TIMER_MEDIAN_AREA);
-	
-	unsigned char* areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP);
-	if (!areas)
+
+	rcScopedTimer timer(ctx, RC_TIMER_ERODE_AREA);
+
+	const int nworkers = ctx->getWorkerCount();
+	const int maxLen = rcMax(rcMax(w, h), 1);
+	const int nspans = rcMax(chf.spanCount, 1);
+
+	rcScopedDelete<int> chainOf((int*)rcAlloc(sizeof(int)*nspans, RC_ALLOC_TEMP, RC_MEM_COMPACT_HEIGHTFIELD));
+	rcScopedDelete<int> chainPos((int*)rcAlloc(sizeof(int)*nspans, RC_ALLOC_TEMP, RC_MEM_COMPACT_HEIGHTFIELD));
+	rcScopedDelete<int> chainFirst((int*)rcAlloc(sizeof(int)*(nspans+1), RC_ALLOC_TEMP, RC_MEM_COMPACT_HEIGHTFIELD));
+	rcScopedDelete<int> dist((int*)rcAlloc(sizeof(int)*nspans, RC_ALLOC_TEMP, RC_MEM_COMPACT_HEIGHTFIELD));
+	rcScopedDelete<int> scratch((int*)rcAlloc(sizeof(int)*maxLen*3*nworkers, RC_ALLOC_TEMP, RC_MEM_COMPACT_HEIGHTFIELD));
+	if (!chainOf || !chainPos || !chainFirst || !dist || !scratch)
 	{
-		ctx->log(RC_LOG_ERROR, "medianFilterWalkableArea: Out of memory 'areas' (%d).", chf.spanCount);
+		ctx->log(RC_LOG_ERROR, "rcErodeWalkableAreaExact: Out of memory 'dist' (%d).", chf.spanCount);
 		return false;
 	}
-	
-	// Init distance.
-	memset(areas, 0xff, sizeof(unsigned char)*chf.spanCount);
-	
+
+	// Split the spans into chains connected on the z-axis. A span continues the chain
+	// of the span below it, unless another span already did.
+	int nchains = 0;
 	for (int y = 0; y < h; ++y)
 	{
 		for (int x = 0; x < w; ++x)
@@ -262,16 +425,106 @@ bool rcMedianFilterWalkableArea(rcContext* ctx, rcCompactHeightfield& chf)
 			const rcCompactCell& c = chf.cells[x+y*w];
 			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 			{
-				const rcCompactSpan& s = chf.spans[i];
-				if (chf.areas[i] == RC_NULL_AREA)
+				const int ai = getNeighbourSpan(chf, x, y, i, 3);
+				if (ai != -1 && chainFirst[chainOf[ai]] == chainPos[ai]+1)
+				{
+					chainOf[i] = chainOf[ai];
+					chainPos[i] = chainPos[ai]+1;
+				}
+				else
+				{
+					chainOf[i] = nchains++;
+					chainPos[i] = 0;
+				}
+				// Track the chain lengths, turned into the chain starts below.
+				chainFirst[chainOf[i]] = chainPos[i]+1;
+			}
+		}
+	}
+	int first = 0;
+	for (int i = 0; i < nchains; ++i)
+	{
+		const int n = chainFirst[i];
+		chainFirst[i] = first;
+		first += n;
+	}
+	chainFirst[nchains] = first;
+
+	rcErodeRowTask rowTask;
+	rowTask.chf = &chf;
+	rowTask.chainOf = chainOf;
+	rowTask.chainPos = chainPos;
+	rowTask.chainFirst = chainFirst;
+	rowTask.dist = dist;
+	rowTask.scratch = scratch;
+	rowTask.maxLen = maxLen;
+	rowTask.inf = w + h;
+	ctx->runParallel(rowTask, h);
+
+	rcErodeColumnTask columnTask;
+	columnTask.chainFirst = chainFirst;
+	columnTask.dist = dist;
+	columnTask.scratch = scratch;
+	columnTask.maxLen = maxLen;
+	columnTask.nchains = nchains;
+	columnTask.batchSize = 256;
+	ctx->runParallel(columnTask, (nchains + columnTask.batchSize-1) / columnTask.batchSize);
+
+	const int thr = radius*radius;
+	for (int i = 0; i < chf.spanCount; ++i)
+		if (dist[chainFirst[chainOf[i]] + chainPos[i]] < thr)
+			chf.areas[i] = RC_NULL_AREA;
+
+	return true;
+}
+
+inline void sortPair(unsigned char& a, unsigned char& b)
+{
+	const unsigned char t = rcMin(a, b);
+	b = rcMax(a, b);
+	a = t;
+}
+
+// Returns the median of 9 values with a sorting network of 19 branchless
+// compare-exchanges, instead of sorting all of them.
+static unsigned char median9(unsigned char* p)
+{
+	sortPair(p[1], p[2]); sortPair(p[4], p[5]); sortPair(p[7], p[8]);
+	sortPair(p[0], p[1]); sortPair(p[3], p[4]); sortPair(p[6], p[7]);
+	sortPair(p[1], p[2]); sortPair(p[4], p[5]); sortPair(p[7], p[8]);
+	sortPair(p[0], p[3]); sortPair(p[5], p[8]); sortPair(p[4], p[7]);
+	sortPair(p[3], p[6]); sortPair(p[1], p[4]); sortPair(p[2], p[5]);
+	sortPair(p[4], p[7]); sortPair(p[4], p[2]); sortPair(p[6], p[4]);
+	sortPair(p[4], p[2]);
+	return p[4];
+}
+
+// Filters the areas of the spans of one row. The rows only read the input areas,
+// so they can be processed in parallel.
+struct rcMedianRowTask : public rcParallelTask
+{
+	const rcCompactHeightfield* chf;
+	unsigned char* areas;
+
+	virtual void run(const int y, const int /*worker*/)
+	{
+		const rcCompactHeightfield& c = *chf;
+		const int w = c.width;
+		for (int x = 0; x < w; ++x)
+		{
+			const rcCompactCell& cell = c.cells[x+y*w];
+			for (int i = (int)cell.index, ni = (int)(cell.index+cell.count); i < ni; ++i)
+			{
+				const rcCompactSpan& s = c.spans[i];
+				if (c.areas[i] == RC_NULL_AREA)
 				{
-					areas[i] = chf.areas[i];
+					areas[i] = c.areas[i];
 					continue;
 				}
 				
 				unsigned char nei[9];
 				for (int j = 0; j < 9; ++j)
-					nei[j] = chf.areas[i];
+					nei[j] = c.areas[i];
 				
 				for (int dir = 0; dir < 4; ++dir)
 				{
@@ -279,32 +532,72 @@ bool rcMedianFilterWalkableArea(rcContext* ctx, rcCompactHeightfield& chf)
 					{
 						const int ax = x + rcGetDirOffsetX(dir);
 						const int ay = y + rcGetDirOffsetY(dir);
-						const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
-						if (chf.areas[ai] != RC_NULL_AREA)
-							nei[dir*2+0] = chf.areas[ai];
+						const int ai = (int)c.cells[ax+ay*w].index + rcGetCon(s, dir);
+						if (c.areas[ai] != RC_NULL_AREA)
+							nei[dir*2+0] = c.areas[ai];
 						
-						const rcCompactSpan& as = chf.spans[ai];
+						const rcCompactSpan& as = c.spans[ai];
 						const int dir2 = (dir+1) & 0x3;
 						if (rcGetCon(as, dir2) != RC_NOT_CONNECTED)
 						{
 							const int ax2 = ax + rcGetDirOffsetX(dir2);
 							const int ay2 = ay + rcGetDirOffsetY(dir2);
-							const int ai2 = (int)chf.cells[ax2+ay2*w].index + rcGetCon(as, dir2);
-							if (chf.areas[ai2] != RC_NULL_AREA)
-								nei[dir*2+1] = chf.areas[ai2];
+							const int ai2 = (int)c.cells[ax2+ay2*w].index + rcGetCon(as, dir2);
+							if (c.areas[ai2] != RC_NULL_AREA)
+								nei[dir*2+1] = c.areas[ai2];
 						}
 					}
 				}
-				insertSort(nei, 9);
-				areas[i] = nei[4];
+				areas[i] = median9(nei);
 			}
 		}
 	}
+};
+
+/// @par
+///
+/// This filter is usually applied after applying area id's using functions
+/// such as #rcMarkBoxArea, #rcMarkConvexPolyArea, and #rcMarkCylinderArea.
+/// 
+/// @see rcCompactHeightfield
+bool rcMedianFilterWalkableArea(rcContext* ctx, rcCompactHeightfield& chf)
+{
+	rcAssert(ctx);
+	
+	unsigned char* areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP, RC_MEM_COMPACT_HEIGHTFIELD);
+	if (!areas)
+	{
+		ctx->log(RC_LOG_ERROR, "medianFilterWalkableArea: Out of memory 'areas' (%d).", chf.spanCount);
+		return false;
+	}
 	
-	memcpy(chf.areas, areas, sizeof(unsigned char)*chf.spanCount);
+	const bool result = rcMedianFilterWalkableArea(ctx, chf, areas);
 	
 	rcFree(areas);
 	
+	return result;
+}
+
+/// @par
+///
+/// The rows of the heightfield are filtered with rcContext::runParallel. Reusing
+/// @p scratch between builds avoids allocating a copy of the areas for each call.
+/// 
+/// @see rcCompactHeightfield
+bool rcMedianFilterWalkableArea(rcContext* ctx, rcCompactHeightfield& chf, unsigned char* scratch)
+{
+	rcAssert(ctx);
+	rcAssert(scratch);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_MEDIAN_AREA);
+	
+	rcMedianRowTask task;
+	task.chf = &chf;
+	task.areas = scratch;
+	ctx->runParallel(task, chf.height);
+	
+	memcpy(chf.areas, scratch, sizeof(unsigned char)*chf.spanCount);
+	
 	return true;
 }
 
@@ -443,6 +736,276 @@ void rcMarkConvexPolyArea(rcContext* ctx, const float* verts, const int nverts,
 	}
 }
 
+/// @par
+///
+/// The volumes are bucketed into a uniform grid of @p cellSize cells on the xz-plane,
+/// so that #rcMarkAreaVolumes only visits the volumes near the heightfield.
+/// Any previous content of @p vset is freed.
+///
+/// @see rcAreaVolumeSet, rcMarkAreaVolumes
+bool rcBuildAreaVolumeSet(rcContext* ctx, const float* verts, const int* nverts,
+						  const float* hmin, const float* hmax, const unsigned char* areas,
+						  const int nvolumes, const float cellSize, rcAreaVolumeSet& vset)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_MARK_CONVEXPOLY_AREA);
+
+	rcFree(vset.verts);
+	rcFree(vset.polys);
+	rcFree(vset.bounds);
+	rcFree(vset.areas);
+	rcFree(vset.cellFirst);
+	rcFree(vset.cellItems);
+	memset(&vset, 0, sizeof(rcAreaVolumeSet));
+
+	int totalVerts = 0;
+	for (int i = 0; i < nvolumes; ++i)
+		totalVerts += nverts[i];
+
+	vset.verts = (float*)rcAlloc(sizeof(float)*rcMax(totalVerts, 1)*3, RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+	vset.polys = (int*)rcAlloc(sizeof(int)*rcMax(nvolumes, 1)*2, RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+	vset.bounds = (float*)rcAlloc(sizeof(float)*rcMax(nvolumes, 1)*6, RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+	vset.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*rcMax(nvolumes, 1), RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+	if (!vset.verts || !vset.polys || !vset.bounds || !vset.areas)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildAreaVolumeSet: Out of memory 'volumes' (%d).", nvolumes);
+		return false;
+	}
+	if (totalVerts > 0)
+		memcpy(vset.verts, verts, sizeof(float)*totalVerts*3);
+
+	// Calculate the bounds of the volumes.
+	float bmin[2] = { FLT_MAX, FLT_MAX };
+	float bmax[2] = { -FLT_MAX, -FLT_MAX };
+	for (int i = 0, first = 0; i < nvolumes; first += nverts[i], ++i)
+	{
+		vset.polys[i*2+0] = first;
+		vset.polys[i*2+1] = nverts[i];
+		vset.areas[i] = areas[i];
+		vset.maxVerts = rcMax(vset.maxVerts, nverts[i]);
+
+		float* b = &vset.bounds[i*6];
+		rcVcopy(&b[0], &verts[first*3]);
+		rcVcopy(&b[3], &verts[first*3]);
+		for (int j = 1; j < nverts[i]; ++j)
+		{
+			rcVmin(&b[0], &verts[(first+j)*3]);
+			rcVmax(&b[3], &verts[(first+j)*3]);
+		}
+		b[1] = hmin[i];
+		b[4] = hmax[i];
+
+		bmin[0] = rcMin(bmin[0], b[0]);
+		bmin[1] = rcMin(bmin[1], b[2]);
+		bmax[0] = rcMax(bmax[0], b[3]);
+		bmax[1] = rcMax(bmax[1], b[5]);
+	}
+	vset.nvolumes = nvolumes;
+
+	// Bucket the volumes into the index cells they overlap.
+	vset.cs = cellSize;
+	if (nvolumes > 0)
+	{
+		vset.bmin[0] = bmin[0];
+		vset.bmin[1] = bmin[1];
+		vset.width = (int)((bmax[0] - bmin[0])/cellSize) + 1;
+		vset.height = (int)((bmax[1] - bmin[1])/cellSize) + 1;
+		// Keep the index roughly proportional to the number of volumes.
+		const int maxCells = rcMax(nvolumes*4, 64);
+		while (vset.width*vset.height > maxCells)
+		{
+			vset.cs *= 2.0f;
+			vset.width = (int)((bmax[0] - bmin[0])/vset.cs) + 1;
+			vset.height = (int)((bmax[1] - bmin[1])/vset.cs) + 1;
+		}
+	}
+	const int ncells = vset.width*vset.height;
+	vset.cellFirst = (int*)rcAlloc(sizeof(int)*(ncells+1), RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+	if (!vset.cellFirst)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildAreaVolumeSet: Out of memory 'cellFirst' (%d).", ncells+1);
+		return false;
+	}
+	memset(vset.cellFirst, 0, sizeof(int)*(ncells+1));
+
+	const float ics = 1.0f/vset.cs;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (int i = 0; i < nvolumes; ++i)
+		{
+			const float* b = &vset.bounds[i*6];
+			const int x0 = rcClamp((int)((b[0] - vset.bmin[0])*ics), 0, vset.width-1);
+			const int z0 = rcClamp((int)((b[2] - vset.bmin[1])*ics), 0, vset.height-1);
+			const int x1 = rcClamp((int)((b[3] - vset.bmin[0])*ics), 0, vset.width-1);
+			const int z1 = rcClamp((int)((b[5] - vset.bmin[1])*ics), 0, vset.height-1);
+			for (int z = z0; z <= z1; ++z)
+			{
+				for (int x = x0; x <= x1; ++x)
+				{
+					// Count the items in the first pass, store them in the second.
+					if (pass == 0)
+						vset.cellFirst[x + z*vset.width + 1]++;
+					else
+						vset.cellItems[vset.cellFirst[x + z*vset.width]++] = i;
+				}
+			}
+		}
+		if (pass == 0)
+		{
+			for (int i = 0; i < ncells; ++i)
+				vset.cellFirst[i+1] += vset.cellFirst[i];
+			vset.cellItems = (int*)rcAlloc(sizeof(int)*rcMax(vset.cellFirst[ncells], 1), RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+			if (!vset.cellItems)
+			{
+				ctx->log(RC_LOG_ERROR, "rcBuildAreaVolumeSet: Out of memory 'cellItems' (%d).", vset.cellFirst[ncells]);
+				return false;
+			}
+		}
+	}
+	// The second pass advanced each cell start to the next cell, shift them back.
+	for (int i = ncells; i > 0; --i)
+		vset.cellFirst[i] = vset.cellFirst[i-1];
+	vset.cellFirst[0] = 0;
+
+	return true;
+}
+
+/// @par
+///
+/// Only the volumes whose index cells overlap the heightfield are visited, and each
+/// volume is filled one row at a time between the crossings of its edges with the row.
+/// A span is marked under the same conditions as in #rcMarkConvexPolyArea, and the volumes
+/// are applied in order, so the result is the same as marking the volumes one by one.
+///
+/// @see rcAreaVolumeSet, rcBuildAreaVolumeSet, rcMarkConvexPolyArea
+bool rcMarkAreaVolumes(rcContext* ctx, const rcAreaVolumeSet& vset, rcCompactHeightfield& chf)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_MARK_CONVEXPOLY_AREA);
+
+	if (!vset.nvolumes)
+		return true;
+
+	// Find the index cells overlapping the heightfield.
+	const float ics = 1.0f/vset.cs;
+	const float hbmaxx = chf.bmin[0] + chf.width*chf.cs;
+	const float hbmaxz = chf.bmin[2] + chf.height*chf.cs;
+	if (hbmaxx < vset.bmin[0] || hbmaxz < vset.bmin[1])
+		return true;
+	const int cx0 = rcMax((int)floorf((chf.bmin[0] - vset.bmin[0])*ics), 0);
+	const int cz0 = rcMax((int)floorf((chf.bmin[2] - vset.bmin[1])*ics), 0);
+	const int cx1 = rcMin((int)((hbmaxx - vset.bmin[0])*ics), vset.width-1);
+	const int cz1 = rcMin((int)((hbmaxz - vset.bmin[1])*ics), vset.height-1);
+	if (cx0 > cx1 || cz0 > cz1)
+		return true;
+
+	rcScopedDelete<unsigned char> visit((unsigned char*)rcAlloc(sizeof(unsigned char)*vset.nvolumes, RC_ALLOC_TEMP, RC_MEM_COMPACT_HEIGHTFIELD));
+	rcScopedDelete<float> cross((float*)rcAlloc(sizeof(float)*rcMax(vset.maxVerts, 1), RC_ALLOC_TEMP, RC_MEM_COMPACT_HEIGHTFIELD));
+	if (!visit || !cross)
+	{
+		ctx->log(RC_LOG_ERROR, "rcMarkAreaVolumes: Out of memory 'visit' (%d).", vset.nvolumes);
+		return false;
+	}
+	memset(visit, 0, sizeof(unsigned char)*vset.nvolumes);
+
+	// Collect the candidate volumes.
+	int first = vset.nvolumes, last = -1;
+	for (int z = cz0; z <= cz1; ++z)
+	{
+		for (int x = cx0; x <= cx1; ++x)
+		{
+			const int c = x + z*vset.width;
+			for (int i = vset.cellFirst[c]; i < vset.cellFirst[c+1]; ++i)
+			{
+				const int v = vset.cellItems[i];
+				visit[v] = 1;
+				first = rcMin(first, v);
+				last = rcMax(last, v);
+			}
+		}
+	}
+
+	for (int v = first; v <= last; ++v)
+	{
+		if (!visit[v])
+			continue;
+
+		const float* verts = &vset.verts[vset.polys[v*2+0]*3];
+		const int nverts = vset.polys[v*2+1];
+		const float* bmin = &vset.bounds[v*6];
+		const float* bmax = &vset.bounds[v*6+3];
+		const unsigned char areaId = vset.areas[v];
+
+		// Same cell range as rcMarkConvexPolyArea.
+		int minx = (int)((bmin[0]-chf.bmin[0])/chf.cs);
+		const int miny = (int)((bmin[1]-chf.bmin[1])/chf.ch);
+		int minz = (int)((bmin[2]-chf.bmin[2])/chf.cs);
+		int maxx = (int)((bmax[0]-chf.bmin[0])/chf.cs);
+		const int maxy = (int)((bmax[1]-chf.bmin[1])/chf.ch);
+		int maxz = (int)((bmax[2]-chf.bmin[2])/chf.cs);
+
+		if (maxx < 0) continue;
+		if (minx >= chf.width) continue;
+		if (maxz < 0) continue;
+		if (minz >= chf.height) continue;
+
+		if (minx < 0) minx = 0;
+		if (maxx >= chf.width) maxx = chf.width-1;
+		if (minz < 0) minz = 0;
+		if (maxz >= chf.height) maxz = chf.height-1;
+
+		for (int z = minz; z <= maxz; ++z)
+		{
+			// Find where the edges cross the row through the cell centers, using the
+			// same crossing rule and arithmetic as pointInPoly().
+			const float pz = chf.bmin[2] + (z+0.5f)*chf.cs;
+			int ncross = 0;
+			for (int i = 0, j = nverts-1; i < nverts; j = i++)
+			{
+				const float* vi = &verts[i*3];
+				const float* vj = &verts[j*3];
+				if ((vi[2] > pz) != (vj[2] > pz))
+				{
+					const float cx = (vj[0]-vi[0]) * (pz-vi[2]) / (vj[2]-vi[2]) + vi[0];
+					int k = ncross++;
+					for (; k > 0 && cross[k-1] > cx; --k)
+						cross[k] = cross[k-1];
+					cross[k] = cx;
+				}
+			}
+
+			// A cell center is inside if an odd number of crossings are to its right,
+			// that is between every other pair of crossings.
+			for (int k = 0; k+1 < ncross; k += 2)
+			{
+				int x = rcClamp((int)floorf((cross[k] - chf.bmin[0])/chf.cs - 0.5f), minx, maxx);
+				while (x > minx && !(chf.bmin[0] + (x-0.5f)*chf.cs < cross[k]))
+					--x;
+				while (x <= maxx && chf.bmin[0] + (x+0.5f)*chf.cs < cross[k])
+					++x;
+				for (; x <= maxx; ++x)
+				{
+					if (!(chf.bmin[0] + (x+0.5f)*chf.cs < cross[k+1]))
+						break;
+					const rcCompactCell& c = chf.cells[x+z*chf.width];
+					for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+					{
+						if (chf.areas[i] == RC_NULL_AREA)
+							continue;
+						const int sy = (int)chf.spans[i].y;
+						if (sy >= miny && sy <= maxy)
+							chf.areas[i] = areaId;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
 int rcOffsetPoly(const float* verts, const int nverts, const float offset,
 				 float* outVerts, const int maxOutVerts)
 {
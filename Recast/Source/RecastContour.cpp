@@ -21,6 +21,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <new>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
@@ -606,7 +607,7 @@ static void removeDegenerateSegments(rcIntArray& simplified)
 static bool mergeContours(rcContour& ca, rcContour& cb, int ia, int ib)
 {
 	const int maxVerts = ca.nverts + cb.nverts + 2;
-	int* verts = (int*)rcAlloc(sizeof(int)*maxVerts*4, RC_ALLOC_PERM);
+	int* verts = (int*)rcAlloc(sizeof(int)*maxVerts*4, RC_ALLOC_PERM, RC_MEM_CONTOURS);
 	if (!verts)
 		return false;
 	
@@ -731,7 +732,7 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 	for (int i = 0; i < region.nholes; i++)
 		maxVerts += region.holes[i].contour->nverts;
 	
-	rcScopedDelete<rcPotentialDiagonal> diags((rcPotentialDiagonal*)rcAlloc(sizeof(rcPotentialDiagonal)*maxVerts, RC_ALLOC_TEMP));
+	rcScopedDelete<rcPotentialDiagonal> diags((rcPotentialDiagonal*)rcAlloc(sizeof(rcPotentialDiagonal)*maxVerts, RC_ALLOC_TEMP, RC_MEM_CONTOURS));
 	if (!diags)
 	{
 		ctx->log(RC_LOG_WARNING, "mergeRegionHoles: Failed to allocated diags %d.", maxVerts);
@@ -808,6 +809,109 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 }
 
 
+// Per worker buffers used while tracing and simplifying contours.
+struct rcContourScratch
+{
+	rcIntArray verts;		// Raw contour being simplified.
+	rcIntArray simplified;	// Simplified contour being cleaned up.
+	rcIntArray traced;		// Traced contours, (span, region, area, first raw vertex, raw vertex count) each.
+	rcIntArray raw;			// Raw vertices of the traced contours.
+	rcIntArray poly;		// Simplified vertices of the simplified contours.
+};
+
+struct rcTracedContour
+{
+	int span;		// Span the contour was traced from.
+	int worker;		// Worker holding the raw vertices.
+	int index;		// Index of the contour in the worker's traced list.
+	int polyWorker;	// Worker holding the simplified vertices.
+	int polyFirst;
+	int polyCount;
+};
+
+static int compareTracedContours(const void* va, const void* vb)
+{
+	const rcTracedContour* a = (const rcTracedContour*)va;
+	const rcTracedContour* b = (const rcTracedContour*)vb;
+	if (a->span < b->span)
+		return -1;
+	if (a->span > b->span)
+		return 1;
+	return 0;
+}
+
+static void freeContourScratch(rcContourScratch* scratch, const int n)
+{
+	for (int i = 0; i < n; ++i)
+		scratch[i].~rcContourScratch();
+}
+
+// Traces all contours of one region. A region only ever walks and clears
+// the flags of its own spans, so the regions can be traced independently.
+struct rcContourTraceTask : public rcParallelTask
+{
+	rcCompactHeightfield* chf;
+	unsigned char* flags;
+	const int* regionSpans;		// Boundary spans of the regions in span order (x,y,i).
+	const int* regionFirst;		// Index of the first boundary span of each region.
+	rcContourScratch* scratch;
+
+	virtual void run(const int region, const int worker)
+	{
+		rcContourScratch& cs = scratch[worker];
+		for (int j = regionFirst[region]; j < regionFirst[region+1]; ++j)
+		{
+			const int x = regionSpans[j*3+0];
+			const int y = regionSpans[j*3+1];
+			const int i = regionSpans[j*3+2];
+			if (flags[i] == 0 || flags[i] == 0xf)
+				continue;
+			
+			cs.verts.resize(0);
+			walkContour(x, y, i, *chf, flags, cs.verts);
+			
+			cs.traced.push(i);
+			cs.traced.push(chf->spans[i].reg);
+			cs.traced.push(chf->areas[i]);
+			cs.traced.push(cs.raw.size());
+			cs.traced.push(cs.verts.size());
+			for (int k = 0; k < cs.verts.size(); ++k)
+				cs.raw.push(cs.verts[k]);
+		}
+	}
+};
+
+struct rcContourSimplifyTask : public rcParallelTask
+{
+	rcTracedContour* contours;
+	rcContourScratch* scratch;
+	float maxError;
+	int maxEdgeLen;
+	int buildFlags;
+
+	virtual void run(const int index, const int worker)
+	{
+		rcTracedContour& tc = contours[index];
+		const rcContourScratch& src = scratch[tc.worker];
+		rcContourScratch& cs = scratch[worker];
+		const int* traced = &src.traced[tc.index*5];
+		
+		cs.verts.resize(traced[4]);
+		if (traced[4] > 0)
+			memcpy(&cs.verts[0], &src.raw[traced[3]], sizeof(int)*traced[4]);
+		cs.simplified.resize(0);
+		simplifyContour(cs.verts, cs.simplified, maxError, maxEdgeLen, buildFlags);
+		removeDegenerateSegments(cs.simplified);
+		
+		tc.polyWorker = worker;
+		tc.polyFirst = cs.poly.size();
+		tc.polyCount = cs.simplified.size();
+		for (int k = 0; k < cs.simplified.size(); ++k)
+			cs.poly.push(cs.simplified[k]);
+	}
+};
+
+
 /// @par
 ///
 /// The raw contours will match the region outlines exactly. The @p maxError and @p maxEdgeLen
@@ -818,6 +922,10 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 ///
 /// Setting @p maxEdgeLength to zero will disabled the edge length feature.
 ///
+/// The regions are traced and the contours simplified as independent work items 
+/// through rcContext::runParallel.  The contours are stored in the order a scan 
+/// over the spans finds them, so the result does not depend on the worker count.
+///
 /// See the #rcConfig documentation for more information on the configuration parameters.
 ///
 /// @see rcAllocContourSet, rcCompactHeightfield, rcContourSet, rcConfig
@@ -851,13 +959,9 @@ bool rcBuildContours(rcContext* ctx, rcCompactHeightfield& chf,
 	cset.borderSize = chf.borderSize;
 	cset.maxError = maxError;
 	
-	int maxContours = rcMax((int)chf.maxRegions, 8);
-	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-	if (!cset.conts)
-		return false;
 	cset.nconts = 0;
 	
-	rcScopedDelete<unsigned char> flags((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned char> flags((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP, RC_MEM_CONTOURS));
 	if (!flags)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'flags' (%d).", chf.spanCount);
@@ -899,117 +1003,189 @@ bool rcBuildContours(rcContext* ctx, rcCompactHeightfield& chf,
 		}
 	}
 	
+	// Group the boundary spans per region, keeping them in span order.
+	int nregions = 0;
+	int nboundary = 0;
+	for (int i = 0; i < chf.spanCount; ++i)
+	{
+		if (flags[i] == 0 || flags[i] == 0xf)
+			continue;
+		nregions = rcMax(nregions, (int)chf.spans[i].reg+1);
+		nboundary++;
+	}
+	rcIntArray regionFirst(nregions+1);
+	memset(&regionFirst[0], 0, sizeof(int)*(nregions+1));
+	rcScopedDelete<int> regionSpans((int*)rcAlloc(sizeof(int)*rcMax(nboundary, 1)*3, RC_ALLOC_TEMP, RC_MEM_CONTOURS));
+	if (!regionSpans)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'regionSpans' (%d).", nboundary*3);
+		return false;
+	}
+	for (int i = 0; i < chf.spanCount; ++i)
+	{
+		if (flags[i] != 0 && flags[i] != 0xf)
+			regionFirst[chf.spans[i].reg]++;
+	}
+	for (int r = 0, n = 0; r <= nregions; ++r)
+	{
+		const int count = regionFirst[r];
+		regionFirst[r] = n;
+		n += count;
+	}
+	{
+		rcIntArray cursor(nregions+1);
+		memcpy(&cursor[0], &regionFirst[0], sizeof(int)*(nregions+1));
+		for (int y = 0; y < h; ++y)
+		{
+			for (int x = 0; x < w; ++x)
+			{
+				const rcCompactCell& c = chf.cells[x+y*w];
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+				{
+					if (flags[i] == 0 || flags[i] == 0xf)
+						continue;
+					const int j = cursor[chf.spans[i].reg]++;
+					regionSpans[j*3+0] = x;
+					regionSpans[j*3+1] = y;
+					regionSpans[j*3+2] = i;
+				}
+			}
+		}
+	}
+	
+	const int nworkers = ctx->getWorkerCount();
+	rcScopedDelete<rcContourScratch> scratch((rcContourScratch*)rcAlloc(sizeof(rcContourScratch)*nworkers, RC_ALLOC_TEMP, RC_MEM_CONTOURS));
+	if (!scratch)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'scratch' (%d).", nworkers);
+		return false;
+	}
+	for (int i = 0; i < nworkers; ++i)
+		new(&scratch[i]) rcContourScratch;
+	
+	// Trace the regions.
+	{
+		rcContourTraceTask task;
+		task.chf = &chf;
+		task.flags = flags;
+		task.regionSpans = regionSpans;
+		task.regionFirst = &regionFirst[0];
+		task.scratch = scratch;
+		ctx->runParallel(task, nregions);
+	}
+	
+	// Order the traced contours as a scan over the spans would have found them.
+	int ntraced = 0;
+	for (int i = 0; i < nworkers; ++i)
+		ntraced += scratch[i].traced.size()/5;
+	rcScopedDelete<rcTracedContour> traced((rcTracedContour*)rcAlloc(sizeof(rcTracedContour)*rcMax(ntraced, 1), RC_ALLOC_TEMP, RC_MEM_CONTOURS));
+	if (!traced)
+	{
+		freeContourScratch(scratch, nworkers);
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'traced' (%d).", ntraced);
+		return false;
+	}
+	for (int i = 0, n = 0; i < nworkers; ++i)
+	{
+		for (int j = 0, nj = scratch[i].traced.size()/5; j < nj; ++j, ++n)
+		{
+			traced[n].span = scratch[i].traced[j*5+0];
+			traced[n].worker = i;
+			traced[n].index = j;
+		}
+	}
+	qsort(traced, ntraced, sizeof(rcTracedContour), compareTracedContours);
+	
 	ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
 	
-	rcIntArray verts(256);
-	rcIntArray simplified(64);
+	// Simplify the contours.
+	{
+		rcScopedTimer timerSimplify(ctx, RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
+		rcContourSimplifyTask task;
+		task.contours = traced;
+		task.scratch = scratch;
+		task.maxError = maxError;
+		task.maxEdgeLen = maxEdgeLen;
+		task.buildFlags = buildFlags;
+		ctx->runParallel(task, ntraced);
+	}
 	
-	for (int y = 0; y < h; ++y)
+	// Create contours.
+	int ncontours = 0;
+	for (int i = 0; i < ntraced; ++i)
 	{
-		for (int x = 0; x < w; ++x)
+		if (traced[i].polyCount/4 >= 3)
+			ncontours++;
+	}
+	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*rcMax(ncontours, 1), RC_ALLOC_PERM, RC_MEM_CONTOURS);
+	if (!cset.conts)
+	{
+		freeContourScratch(scratch, nworkers);
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'conts' (%d).", ncontours);
+		return false;
+	}
+	memset(cset.conts, 0, sizeof(rcContour)*rcMax(ncontours, 1));
+	
+	for (int i = 0; i < ntraced; ++i)
+	{
+		const rcTracedContour& tc = traced[i];
+		if (tc.polyCount/4 < 3)
+			continue;
+		const int* info = &scratch[tc.worker].traced[tc.index*5];
+		
+		rcContour* cont = &cset.conts[cset.nconts++];
+		
+		cont->nverts = tc.polyCount/4;
+		cont->verts = (int*)rcAlloc(sizeof(int)*cont->nverts*4, RC_ALLOC_PERM, RC_MEM_CONTOURS);
+		if (!cont->verts)
 		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			freeContourScratch(scratch, nworkers);
+			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'verts' (%d).", cont->nverts);
+			return false;
+		}
+		memcpy(cont->verts, &scratch[tc.polyWorker].poly[tc.polyFirst], sizeof(int)*cont->nverts*4);
+		if (borderSize > 0)
+		{
+			// If the heightfield was build with bordersize, remove the offset.
+			for (int j = 0; j < cont->nverts; ++j)
 			{
-				if (flags[i] == 0 || flags[i] == 0xf)
-				{
-					flags[i] = 0;
-					continue;
-				}
-				const unsigned short reg = chf.spans[i].reg;
-				if (!reg || (reg & RC_BORDER_REG))
-					continue;
-				const unsigned char area = chf.areas[i];
-				
-				verts.resize(0);
-				simplified.resize(0);
-				
-				ctx->startTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
-				walkContour(x, y, i, chf, flags, verts);
-				ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
-				
-				ctx->startTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
-				simplifyContour(verts, simplified, maxError, maxEdgeLen, buildFlags);
-				removeDegenerateSegments(simplified);
-				ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
-				
-				
-				// Store region->contour remap info.
-				// Create contour.
-				if (simplified.size()/4 >= 3)
-				{
-					if (cset.nconts >= maxContours)
-					{
-						// Allocate more contours.
-						// This happens when a region has holes.
-						const int oldMax = maxContours;
-						maxContours *= 2;
-						rcContour* newConts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-						for (int j = 0; j < cset.nconts; ++j)
-						{
-							newConts[j] = cset.conts[j];
-							// Reset source pointers to prevent data deletion.
-							cset.conts[j].verts = 0;
-							cset.conts[j].rverts = 0;
-						}
-						rcFree(cset.conts);
-						cset.conts = newConts;
-						
-						ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", oldMax, maxContours);
-					}
-					
-					rcContour* cont = &cset.conts[cset.nconts++];
-					
-					cont->nverts = simplified.size()/4;
-					cont->verts = (int*)rcAlloc(sizeof(int)*cont->nverts*4, RC_ALLOC_PERM);
-					if (!cont->verts)
-					{
-						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'verts' (%d).", cont->nverts);
-						return false;
-					}
-					memcpy(cont->verts, &simplified[0], sizeof(int)*cont->nverts*4);
-					if (borderSize > 0)
-					{
-						// If the heightfield was build with bordersize, remove the offset.
-						for (int j = 0; j < cont->nverts; ++j)
-						{
-							int* v = &cont->verts[j*4];
-							v[0] -= borderSize;
-							v[2] -= borderSize;
-						}
-					}
-					
-					cont->nrverts = verts.size()/4;
-					cont->rverts = (int*)rcAlloc(sizeof(int)*cont->nrverts*4, RC_ALLOC_PERM);
-					if (!cont->rverts)
-					{
-						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'rverts' (%d).", cont->nrverts);
-						return false;
-					}
-					memcpy(cont->rverts, &verts[0], sizeof(int)*cont->nrverts*4);
-					if (borderSize > 0)
-					{
-						// If the heightfield was build with bordersize, remove the offset.
-						for (int j = 0; j < cont->nrverts; ++j)
-						{
-							int* v = &cont->rverts[j*4];
-							v[0] -= borderSize;
-							v[2] -= borderSize;
-						}
-					}
-					
-					cont->reg = reg;
-					cont->area = area;
-				}
+				int* v = &cont->verts[j*4];
+				v[0] -= borderSize;
+				v[2] -= borderSize;
 			}
 		}
+		
+		cont->nrverts = info[4]/4;
+		cont->rverts = (int*)rcAlloc(sizeof(int)*cont->nrverts*4, RC_ALLOC_PERM, RC_MEM_CONTOURS);
+		if (!cont->rverts)
+		{
+			freeContourScratch(scratch, nworkers);
+			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'rverts' (%d).", cont->nrverts);
+			return false;
+		}
+		memcpy(cont->rverts, &scratch[tc.worker].raw[info[3]], sizeof(int)*cont->nrverts*4);
+		if (borderSize > 0)
+		{
+			// If the heightfield was build with bordersize, remove the offset.
+			for (int j = 0; j < cont->nrverts; ++j)
+			{
+				int* v = &cont->rverts[j*4];
+				v[0] -= borderSize;
+				v[2] -= borderSize;
+			}
+		}
+		
+		cont->reg = (unsigned short)info[1];
+		cont->area = (unsigned char)info[2];
 	}
 	
+	freeContourScratch(scratch, nworkers);
+	
 	// Merge holes if needed.
 	if (cset.nconts > 0)
 	{
 		// Calculate winding of all polygons.
-		rcScopedDelete<char> winding((char*)rcAlloc(sizeof(char)*cset.nconts, RC_ALLOC_TEMP));
+		rcScopedDelete<char> winding((char*)rcAlloc(sizeof(char)*cset.nconts, RC_ALLOC_TEMP, RC_MEM_CONTOURS));
 		if (!winding)
 		{
 			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'hole' (%d).", cset.nconts);
@@ -1030,7 +1206,7 @@ bool rcBuildContours(rcContext* ctx, rcCompactHeightfield& chf,
 			// Collect outline contour and holes contours per region.
 			// We assume that there is one outline and multiple holes.
 			const int nregions = chf.maxRegions+1;
-			rcScopedDelete<rcContourRegion> regions((rcContourRegion*)rcAlloc(sizeof(rcContourRegion)*nregions, RC_ALLOC_TEMP));
+			rcScopedDelete<rcContourRegion> regions((rcContourRegion*)rcAlloc(sizeof(rcContourRegion)*nregions, RC_ALLOC_TEMP, RC_MEM_CONTOURS));
 			if (!regions)
 			{
 				ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'regions' (%d).", nregions);
@@ -1038,7 +1214,7 @@ bool rcBuildContours(rcContext* ctx, rcCompactHeightfield& chf,
 			}
 			memset(regions, 0, sizeof(rcContourRegion)*nregions);
 			
-			rcScopedDelete<rcContourHole> holes((rcContourHole*)rcAlloc(sizeof(rcContourHole)*cset.nconts, RC_ALLOC_TEMP));
+			rcScopedDelete<rcContourHole> holes((rcContourHole*)rcAlloc(sizeof(rcContourHole)*cset.nconts, RC_ALLOC_TEMP, RC_MEM_CONTOURS));
 			if (!holes)
 			{
 				ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'holes' (%d).", cset.nconts);
@@ -34,17 +34,29 @@
 ///
 /// @see rcHeightfield, rcConfig
 void rcFilterLowHangingWalkableObstacles(rcContext* ctx, const int walkableClimb, rcHeightfield& solid)
+{
+	const int rect[4] = { 0, 0, solid.width-1, solid.height-1 };
+	rcFilterLowHangingWalkableObstacles(ctx, walkableClimb, solid, rect);
+}
+
+/// @par
+///
+/// Only the spans of the columns within @p rect are modified. The filter is not
+/// idempotent, so each column should be filtered once after it has been rasterized.
+///
+/// @see rcHeightfield, rcConfig, rcUpdateRasterizedTriangles
+void rcFilterLowHangingWalkableObstacles(rcContext* ctx, const int walkableClimb, rcHeightfield& solid,
+										 const int* rect)
 {
 	rcAssert(ctx);
 
 	rcScopedTimer timer(ctx, RC_TIMER_FILTER_LOW_OBSTACLES);
 	
 	const int w = solid.width;
-	const int h = solid.height;
 	
-	for (int y = 0; y < h; ++y)
+	for (int y = rect[1]; y <= rect[3]; ++y)
 	{
-		for (int x = 0; x < w; ++x)
+		for (int x = rect[0]; x <= rect[2]; ++x)
 		{
 			rcSpan* ps = 0;
 			bool previousWalkable = false;
@@ -81,6 +93,19 @@ void rcFilterLowHangingWalkableObstacles(rcContext* ctx, const int walkableClimb
 /// @see rcHeightfield, rcConfig
 void rcFilterLedgeSpans(rcContext* ctx, const int walkableHeight, const int walkableClimb,
 						rcHeightfield& solid)
+{
+	const int rect[4] = { 0, 0, solid.width-1, solid.height-1 };
+	rcFilterLedgeSpans(ctx, walkableHeight, walkableClimb, solid, rect);
+}
+
+/// @par
+///
+/// Only the spans of the columns within @p rect are modified, but their neighbour
+/// columns outside of the rectangle are read.
+///
+/// @see rcHeightfield, rcConfig, rcUpdateRasterizedTriangles
+void rcFilterLedgeSpans(rcContext* ctx, const int walkableHeight, const int walkableClimb,
+						rcHeightfield& solid, const int* rect)
 {
 	rcAssert(ctx);
 	
@@ -91,9 +116,9 @@ void rcFilterLedgeSpans(rcContext* ctx, const int walkableHeight, const int walk
 	const int MAX_HEIGHT = 0xffff;
 	
 	// Mark border spans.
-	for (int y = 0; y < h; ++y)
+	for (int y = rect[1]; y <= rect[3]; ++y)
 	{
-		for (int x = 0; x < w; ++x)
+		for (int x = rect[0]; x <= rect[2]; ++x)
 		{
 			for (rcSpan* s = solid.spans[x + y*w]; s; s = s->next)
 			{
@@ -175,20 +200,30 @@ void rcFilterLedgeSpans(rcContext* ctx, const int walkableHeight, const int walk
 /// 
 /// @see rcHeightfield, rcConfig
 void rcFilterWalkableLowHeightSpans(rcContext* ctx, int walkableHeight, rcHeightfield& solid)
+{
+	const int rect[4] = { 0, 0, solid.width-1, solid.height-1 };
+	rcFilterWalkableLowHeightSpans(ctx, walkableHeight, solid, rect);
+}
+
+/// @par
+///
+/// Only the spans of the columns within @p rect are modified.
+///
+/// @see rcHeightfield, rcConfig, rcUpdateRasterizedTriangles
+void rcFilterWalkableLowHeightSpans(rcContext* ctx, int walkableHeight, rcHeightfield& solid, const int* rect)
 {
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_FILTER_WALKABLE);
 	
 	const int w = solid.width;
-	const int h = solid.height;
 	const int MAX_HEIGHT = 0xffff;
 	
 	// Remove walkable flag from spans which do not have enough
 	// space above them for the agent to stand there.
-	for (int y = 0; y < h; ++y)
+	for (int y = rect[1]; y <= rect[3]; ++y)
 	{
-		for (int x = 0; x < w; ++x)
+		for (int x = rect[0]; x <= rect[2]; ++x)
 		{
 			for (rcSpan* s = solid.spans[x + y*w]; s; s = s->next)
 			{
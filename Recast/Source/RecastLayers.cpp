@@ -84,37 +84,86 @@ struct rcLayerSweepSpan
 	unsigned char nei;	// neighbour id
 };
 
-/// @par
-/// 
-/// See the #rcConfig documentation for more information on the configuration parameters.
-/// 
-/// @see rcAllocHeightfieldLayerSet, rcCompactHeightfield, rcHeightfieldLayerSet, rcConfig
-bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
-							  const int borderSize, const int walkableHeight,
-							  rcHeightfieldLayerSet& lset)
+// Region ids are stored as a byte where 255 is a special value.
+static const int RC_MAX_LAYER_REGIONS = 255;
+
+enum rcLayerStatus
 {
-	rcAssert(ctx);
-	
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_LAYERS);
-	
-	const int w = chf.width;
-	const int h = chf.height;
-	
-	rcScopedDelete<unsigned char> srcReg((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP));
-	if (!srcReg)
+	RC_LAYERS_OK,
+	RC_LAYERS_REGION_OVERFLOW,
+	RC_LAYERS_LAYER_OVERFLOW,
+	RC_LAYERS_OUT_OF_MEMORY_LAYERS,
+	RC_LAYERS_OUT_OF_MEMORY_HEIGHTS,
+	RC_LAYERS_OUT_OF_MEMORY_AREAS,
+	RC_LAYERS_OUT_OF_MEMORY_CONS
+};
+
+// Temporary buffers used to build the layers of a heightfield. A worker reuses its
+// buffers for each heightfield it builds, so they are sized for the largest of them.
+struct rcLayerScratch
+{
+	unsigned char* srcReg;		// [Size: >= chf.spanCount]
+	rcLayerSweepSpan* sweeps;	// [Size: >= chf.width]
+	rcLayerRegion* regs;		// [Size: RC_MAX_LAYER_REGIONS]
+};
+
+static void logLayerStatus(rcContext* ctx, const rcLayerStatus status, const int errorSize)
+{
+	switch (status)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'srcReg' (%d).", chf.spanCount);
-		return false;
+	case RC_LAYERS_OK:
+		break;
+	case RC_LAYERS_REGION_OVERFLOW:
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Region ID overflow.");
+		break;
+	case RC_LAYERS_LAYER_OVERFLOW:
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
+		break;
+	case RC_LAYERS_OUT_OF_MEMORY_LAYERS:
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'layers' (%d).", errorSize);
+		break;
+	case RC_LAYERS_OUT_OF_MEMORY_HEIGHTS:
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'heights' (%d).", errorSize);
+		break;
+	case RC_LAYERS_OUT_OF_MEMORY_AREAS:
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'areas' (%d).", errorSize);
+		break;
+	case RC_LAYERS_OUT_OF_MEMORY_CONS:
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'cons' (%d).", errorSize);
+		break;
 	}
-	memset(srcReg,0xff,sizeof(unsigned char)*chf.spanCount);
-	
-	const int nsweeps = chf.width;
-	rcScopedDelete<rcLayerSweepSpan> sweeps((rcLayerSweepSpan*)rcAlloc(sizeof(rcLayerSweepSpan)*nsweeps, RC_ALLOC_TEMP));
-	if (!sweeps)
+}
+
+// Frees the layers of a layer set, leaving it empty.
+static void clearLayerSet(rcHeightfieldLayerSet& lset)
+{
+	if (lset.layers)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'sweeps' (%d).", nsweeps);
-		return false;
+		for (int i = 0; i < lset.nlayers; ++i)
+		{
+			rcFree(lset.layers[i].heights);
+			rcFree(lset.layers[i].areas);
+			rcFree(lset.layers[i].cons);
+		}
+		rcFree(lset.layers);
 	}
+	lset.layers = 0;
+	lset.nlayers = 0;
+}
+
+// Builds the layers of a heightfield using the specified scratch buffers. Does not log,
+// so that it can run on the workers of a parallel task. Sets errorSize to the size of
+// the failed allocation when running out of memory.
+static rcLayerStatus buildLayers(const rcCompactHeightfield& chf, const int borderSize, const int walkableHeight,
+								 rcLayerScratch& scratch, rcHeightfieldLayerSet& lset, int& errorSize)
+{
+	const int w = chf.width;
+	const int h = chf.height;
+	
+	unsigned char* srcReg = scratch.srcReg;
+	rcLayerSweepSpan* sweeps = scratch.sweeps;
+	rcLayerRegion* regs = scratch.regs;
+	memset(srcReg,0xff,sizeof(unsigned char)*chf.spanCount);
 	
 	
 	// Partition walkable area into monotone regions.
@@ -198,10 +247,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 			else
 			{
 				if (regId == 255)
-				{
-					ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Region ID overflow.");
-					return false;
-				}
+					return RC_LAYERS_REGION_OVERFLOW;
 				sweeps[i].id = regId++;
 			}
 		}
@@ -220,12 +266,6 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 
 	// Allocate and init layer regions.
 	const int nregs = (int)regId;
-	rcScopedDelete<rcLayerRegion> regs((rcLayerRegion*)rcAlloc(sizeof(rcLayerRegion)*nregs, RC_ALLOC_TEMP));
-	if (!regs)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'regs' (%d).", nregs);
-		return false;
-	}
 	memset(regs, 0, sizeof(rcLayerRegion)*nregs);
 	for (int i = 0; i < nregs; ++i)
 	{
@@ -291,8 +331,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 						if (!addUnique(ri.layers, ri.nlayers, RC_MAX_LAYERS, lregs[j]) ||
 							!addUnique(rj.layers, rj.nlayers, RC_MAX_LAYERS, lregs[i]))
 						{
-							ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
-							return false;
+							return RC_LAYERS_LAYER_OVERFLOW;
 						}
 					}
 				}
@@ -359,8 +398,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 					{
 						if (!addUnique(root.layers, root.nlayers, RC_MAX_LAYERS, regn.layers[k]))
 						{
-							ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
-							return false;
+							return RC_LAYERS_LAYER_OVERFLOW;
 						}
 					}
 					root.ymin = rcMin(root.ymin, regn.ymin);
@@ -443,8 +481,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 					{
 						if (!addUnique(ri.layers, ri.nlayers, RC_MAX_LAYERS, rj.layers[k]))
 						{
-							ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
-							return false;
+							return RC_LAYERS_LAYER_OVERFLOW;
 						}
 					}
 
@@ -477,7 +514,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 	
 	// No layers, return empty.
 	if (layerId == 0)
-		return true;
+		return RC_LAYERS_OK;
 	
 	// Create layers.
 	rcAssert(lset.layers == 0);
@@ -496,11 +533,11 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 	
 	lset.nlayers = (int)layerId;
 	
-	lset.layers = (rcHeightfieldLayer*)rcAlloc(sizeof(rcHeightfieldLayer)*lset.nlayers, RC_ALLOC_PERM);
+	lset.layers = (rcHeightfieldLayer*)rcAlloc(sizeof(rcHeightfieldLayer)*lset.nlayers, RC_ALLOC_PERM, RC_MEM_LAYERS);
 	if (!lset.layers)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'layers' (%d).", lset.nlayers);
-		return false;
+		errorSize = lset.nlayers;
+		return RC_LAYERS_OUT_OF_MEMORY_LAYERS;
 	}
 	memset(lset.layers, 0, sizeof(rcHeightfieldLayer)*lset.nlayers);
 
@@ -514,27 +551,27 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 
 		const int gridSize = sizeof(unsigned char)*lw*lh;
 
-		layer->heights = (unsigned char*)rcAlloc(gridSize, RC_ALLOC_PERM);
+		layer->heights = (unsigned char*)rcAlloc(gridSize, RC_ALLOC_PERM, RC_MEM_LAYERS);
 		if (!layer->heights)
 		{
-			ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'heights' (%d).", gridSize);
-			return false;
+			errorSize = gridSize;
+			return RC_LAYERS_OUT_OF_MEMORY_HEIGHTS;
 		}
 		memset(layer->heights, 0xff, gridSize);
 
-		layer->areas = (unsigned char*)rcAlloc(gridSize, RC_ALLOC_PERM);
+		layer->areas = (unsigned char*)rcAlloc(gridSize, RC_ALLOC_PERM, RC_MEM_LAYERS);
 		if (!layer->areas)
 		{
-			ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'areas' (%d).", gridSize);
-			return false;
+			errorSize = gridSize;
+			return RC_LAYERS_OUT_OF_MEMORY_AREAS;
 		}
 		memset(layer->areas, 0, gridSize);
 
-		layer->cons = (unsigned char*)rcAlloc(gridSize, RC_ALLOC_PERM);
+		layer->cons = (unsigned char*)rcAlloc(gridSize, RC_ALLOC_PERM, RC_MEM_LAYERS);
 		if (!layer->cons)
 		{
-			ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'cons' (%d).", gridSize);
-			return false;
+			errorSize = gridSize;
+			return RC_LAYERS_OUT_OF_MEMORY_CONS;
 		}
 		memset(layer->cons, 0, gridSize);
 		
@@ -640,5 +677,162 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
 			layer->miny = layer->maxy = 0;
 	}
 	
+	return RC_LAYERS_OK;
+}
+
+/// @par
+/// 
+/// See the #rcConfig documentation for more information on the configuration parameters.
+/// 
+/// @see rcAllocHeightfieldLayerSet, rcCompactHeightfield, rcHeightfieldLayerSet, rcConfig
+bool rcBuildHeightfieldLayers(rcContext* ctx, rcCompactHeightfield& chf,
+							  const int borderSize, const int walkableHeight,
+							  rcHeightfieldLayerSet& lset)
+{
+	rcAssert(ctx);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_LAYERS);
+	
+	rcScopedDelete<unsigned char> srcReg((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP, RC_MEM_LAYERS));
+	if (!srcReg)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'srcReg' (%d).", chf.spanCount);
+		return false;
+	}
+	
+	const int nsweeps = chf.width;
+	rcScopedDelete<rcLayerSweepSpan> sweeps((rcLayerSweepSpan*)rcAlloc(sizeof(rcLayerSweepSpan)*nsweeps, RC_ALLOC_TEMP, RC_MEM_LAYERS));
+	if (!sweeps)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'sweeps' (%d).", nsweeps);
+		return false;
+	}
+	
+	rcScopedDelete<rcLayerRegion> regs((rcLayerRegion*)rcAlloc(sizeof(rcLayerRegion)*RC_MAX_LAYER_REGIONS, RC_ALLOC_TEMP, RC_MEM_LAYERS));
+	if (!regs)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'regs' (%d).", RC_MAX_LAYER_REGIONS);
+		return false;
+	}
+	
+	rcLayerScratch scratch;
+	scratch.srcReg = srcReg;
+	scratch.sweeps = sweeps;
+	scratch.regs = regs;
+	
+	int errorSize = 0;
+	const rcLayerStatus status = buildLayers(chf, borderSize, walkableHeight, scratch, lset, errorSize);
+	if (status != RC_LAYERS_OK)
+	{
+		logLayerStatus(ctx, status, errorSize);
+		return false;
+	}
+	
 	return true;
 }
+
+// Builds the layers of one heightfield of a batch with the scratch buffers of the worker.
+struct rcLayerBatchTask : public rcParallelTask
+{
+	const rcCompactHeightfield* const* chfs;
+	rcHeightfieldLayerSet* const* lsets;
+	int borderSize;
+	int walkableHeight;
+	rcLayerScratch* scratch;
+	rcLayerStatus* status;
+	int* errorSize;
+
+	virtual void run(const int index, const int worker)
+	{
+		status[index] = buildLayers(*chfs[index], borderSize, walkableHeight, scratch[worker],
+									*lsets[index], errorSize[index]);
+	}
+};
+
+/// @par
+/// 
+/// The heightfields are processed with rcContext::runParallel.  Each worker reuses its own 
+/// scratch buffers for the heightfields it builds, so the temporary memory used grows with 
+/// the number of workers and the size of the largest heightfield, not with the size of the batch.
+/// 
+/// The layer sets are the same as built by #rcBuildHeightfieldLayers for each heightfield.
+/// If the layers of a heightfield cannot be built, the error is logged, its layer set is 
+/// left empty and the remaining heightfields are still processed.
+/// 
+/// @see rcBuildHeightfieldLayers
+bool rcBuildHeightfieldLayersBatch(rcContext* ctx, const rcCompactHeightfield* const* chfs, const int count,
+								   const int borderSize, const int walkableHeight,
+								   rcHeightfieldLayerSet* const* lsets)
+{
+	rcAssert(ctx);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_LAYERS);
+	
+	if (count <= 0)
+		return true;
+	
+	int maxSpans = 1, maxWidth = 1;
+	for (int i = 0; i < count; ++i)
+	{
+		maxSpans = rcMax(maxSpans, chfs[i]->spanCount);
+		maxWidth = rcMax(maxWidth, chfs[i]->width);
+	}
+	
+	const int nworkers = ctx->getWorkerCount();
+	// Rounded up so that the buffers of the next worker stay aligned too.
+	static const int SCRATCH_ALIGN = 16;
+	const int scratchSize = (maxSpans*(int)sizeof(unsigned char) + maxWidth*(int)sizeof(rcLayerSweepSpan) +
+		RC_MAX_LAYER_REGIONS*(int)sizeof(rcLayerRegion) + SCRATCH_ALIGN-1) & ~(SCRATCH_ALIGN-1);
+	rcScopedDelete<unsigned char> buffer((unsigned char*)rcAlloc(sizeof(unsigned char)*scratchSize*nworkers, RC_ALLOC_TEMP, RC_MEM_LAYERS));
+	if (!buffer)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayersBatch: Out of memory 'buffer' (%d).", scratchSize*nworkers);
+		return false;
+	}
+	rcScopedDelete<rcLayerScratch> scratch((rcLayerScratch*)rcAlloc(sizeof(rcLayerScratch)*nworkers, RC_ALLOC_TEMP, RC_MEM_LAYERS));
+	if (!scratch)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayersBatch: Out of memory 'scratch' (%d).", nworkers);
+		return false;
+	}
+	for (int i = 0; i < nworkers; ++i)
+	{
+		// Regions first, so that each buffer stays aligned.
+		unsigned char* base = &buffer[i*scratchSize];
+		scratch[i].regs = (rcLayerRegion*)base;
+		scratch[i].sweeps = (rcLayerSweepSpan*)(base + RC_MAX_LAYER_REGIONS*sizeof(rcLayerRegion));
+		scratch[i].srcReg = base + RC_MAX_LAYER_REGIONS*sizeof(rcLayerRegion) + maxWidth*sizeof(rcLayerSweepSpan);
+	}
+	
+	rcScopedDelete<rcLayerStatus> status((rcLayerStatus*)rcAlloc(sizeof(rcLayerStatus)*count, RC_ALLOC_TEMP, RC_MEM_LAYERS));
+	rcScopedDelete<int> errorSize((int*)rcAlloc(sizeof(int)*count, RC_ALLOC_TEMP, RC_MEM_LAYERS));
+	if (!status || !errorSize)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayersBatch: Out of memory 'status' (%d).", count);
+		return false;
+	}
+	memset(errorSize, 0, sizeof(int)*count);
+	
+	rcLayerBatchTask task;
+	task.chfs = chfs;
+	task.lsets = lsets;
+	task.borderSize = borderSize;
+	task.walkableHeight = walkableHeight;
+	task.scratch = scratch;
+	task.status = status;
+	task.errorSize = errorSize;
+	ctx->runParallel(task, count);
+	
+	bool result = true;
+	for (int i = 0; i < count; ++i)
+	{
+		if (status[i] == RC_LAYERS_OK)
+			continue;
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayersBatch: Could not build the layers of heightfield %d.", i);
+		logLayerStatus(ctx, status[i], errorSize[i]);
+		clearLayerSet(*lsets[i]);
+		result = false;
+	}
+	
+	return result;
+}
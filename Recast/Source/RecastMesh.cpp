@@ -38,13 +38,13 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 	// http://www.terathon.com/code/edges.php
 	
 	int maxEdgeCount = npolys*vertsPerPoly;
-	unsigned short* firstEdge = (unsigned short*)rcAlloc(sizeof(unsigned short)*(nverts + maxEdgeCount), RC_ALLOC_TEMP);
+	int* firstEdge = (int*)rcAlloc(sizeof(int)*(nverts + maxEdgeCount), RC_ALLOC_TEMP, RC_MEM_POLYMESH);
 	if (!firstEdge)
 		return false;
-	unsigned short* nextEdge = firstEdge + nverts;
+	int* nextEdge = firstEdge + nverts;
 	int edgeCount = 0;
 	
-	rcEdge* edges = (rcEdge*)rcAlloc(sizeof(rcEdge)*maxEdgeCount, RC_ALLOC_TEMP);
+	rcEdge* edges = (rcEdge*)rcAlloc(sizeof(rcEdge)*maxEdgeCount, RC_ALLOC_TEMP, RC_MEM_POLYMESH);
 	if (!edges)
 	{
 		rcFree(firstEdge);
@@ -52,7 +52,7 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 	}
 	
 	for (int i = 0; i < nverts; i++)
-		firstEdge[i] = RC_MESH_NULL_IDX;
+		firstEdge[i] = -1;
 	
 	for (int i = 0; i < npolys; ++i)
 	{
@@ -73,7 +73,7 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 				edge.polyEdge[1] = 0;
 				// Insert edge
 				nextEdge[edgeCount] = firstEdge[v0];
-				firstEdge[v0] = (unsigned short)edgeCount;
+				firstEdge[v0] = edgeCount;
 				edgeCount++;
 			}
 		}
@@ -89,7 +89,7 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 			unsigned short v1 = (j+1 >= vertsPerPoly || t[j+1] == RC_MESH_NULL_IDX) ? t[0] : t[j+1];
 			if (v0 > v1)
 			{
-				for (unsigned short e = firstEdge[v1]; e != RC_MESH_NULL_IDX; e = nextEdge[e])
+				for (int e = firstEdge[v1]; e != -1; e = nextEdge[e])
 				{
 					rcEdge& edge = edges[e];
 					if (edge.vert[1] == v0 && edge.poly[0] == edge.poly[1])
@@ -124,20 +124,31 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 
 
 static const int VERTEX_BUCKET_COUNT = (1<<12);
+static const int MAX_VERTEX_BUCKET_COUNT = (1<<16);
 
-inline int computeVertexHash(int x, int y, int z)
+// Returns the number of vertex hash buckets to use for the specified number of vertices.
+static int calcVertexBucketCount(const int nverts)
+{
+	int n = VERTEX_BUCKET_COUNT;
+	while (n < nverts && n < MAX_VERTEX_BUCKET_COUNT)
+		n <<= 1;
+	return n;
+}
+
+inline int computeVertexHash(int x, int y, int z, const int bucketCount)
 {
 	const unsigned int h1 = 0x8da6b343; // Large multiplicative constants;
 	const unsigned int h2 = 0xd8163841; // here arbitrarily chosen primes
 	const unsigned int h3 = 0xcb1ab31f;
 	unsigned int n = h1 * x + h2 * y + h3 * z;
-	return (int)(n & (VERTEX_BUCKET_COUNT-1));
+	return (int)(n & (bucketCount-1));
 }
 
 static unsigned short addVertex(unsigned short x, unsigned short y, unsigned short z,
-								unsigned short* verts, int* firstVert, int* nextVert, int& nv)
+								unsigned short* verts, int* firstVert, int* nextVert,
+								const int bucketCount, int& nv)
 {
-	int bucket = computeVertexHash(x, 0, z);
+	int bucket = computeVertexHash(x, 0, z, bucketCount);
 	int i = firstVert[bucket];
 	
 	while (i != -1)
@@ -548,6 +559,154 @@ static void mergePolyVerts(unsigned short* pa, unsigned short* pb, int ea, int e
 }
 
 
+// A possible merge of two polygons of the contour being processed.
+struct rcMergeCandidate
+{
+	int value;			// Merge value, see getPolyMergeValue().
+	int pa, pb;			// The polygons to merge, pa < pb.
+	int ea, eb;			// The shared edge in pa and pb.
+	int stampa, stampb;	// Versions of the polygons the value was calculated for.
+};
+
+// Returns true if candidate a is better than b. Ties are resolved in favour of
+// the lowest polygon indices, in the same order as a scan over all pairs would.
+inline bool betterMerge(const rcMergeCandidate& a, const rcMergeCandidate& b)
+{
+	if (a.value != b.value)
+		return a.value > b.value;
+	if (a.pa != b.pa)
+		return a.pa < b.pa;
+	return a.pb < b.pb;
+}
+
+static void pushMergeCandidate(rcMergeCandidate* heap, int& nheap, const rcMergeCandidate& c)
+{
+	int i = nheap++;
+	while (i > 0)
+	{
+		const int parent = (i-1)/2;
+		if (!betterMerge(c, heap[parent]))
+			break;
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = c;
+}
+
+static void popMergeCandidate(rcMergeCandidate* heap, int& nheap)
+{
+	const rcMergeCandidate c = heap[--nheap];
+	int i = 0;
+	for (;;)
+	{
+		int child = i*2+1;
+		if (child >= nheap)
+			break;
+		if (child+1 < nheap && betterMerge(heap[child+1], heap[child]))
+			child++;
+		if (!betterMerge(heap[child], c))
+			break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	if (nheap > 0)
+		heap[i] = c;
+}
+
+// Undirected polygon edges of the contour being processed, hashed by their vertices.
+// Each edge stores (va, vb, polygon), the polygon is -1 once the edge is inside a
+// merged polygon.
+struct rcMergeEdges
+{
+	int* first;
+	int* next;
+	int* edges;
+	int nedges;
+	int mask;
+};
+
+inline int computeEdgeHash(int va, int vb, const int mask)
+{
+	if (va > vb)
+		rcSwap(va, vb);
+	const unsigned int n = 0x8da6b343 * (unsigned int)va + 0xd8163841 * (unsigned int)vb;
+	return (int)(n & mask);
+}
+
+static void addMergeEdge(rcMergeEdges& me, const int va, const int vb, const int poly)
+{
+	const int bucket = computeEdgeHash(va, vb, me.mask);
+	const int i = me.nedges++;
+	me.edges[i*3+0] = va;
+	me.edges[i*3+1] = vb;
+	me.edges[i*3+2] = poly;
+	me.next[i] = me.first[bucket];
+	me.first[bucket] = i;
+}
+
+inline bool sameEdge(const int* e, const int va, const int vb)
+{
+	return (e[0] == va && e[1] == vb) || (e[0] == vb && e[1] == va);
+}
+
+static void moveMergeEdge(rcMergeEdges& me, const int va, const int vb, const int from, const int to)
+{
+	for (int i = me.first[computeEdgeHash(va, vb, me.mask)]; i != -1; i = me.next[i])
+	{
+		int* e = &me.edges[i*3];
+		if (e[2] == from && sameEdge(e, va, vb))
+		{
+			e[2] = to;
+			return;
+		}
+	}
+}
+
+// Queues the merges of polygon pa with the polygons it shares an edge with.
+// If onlyAbove is set, only the polygons with higher index are considered.
+static void queuePolyMerges(const rcMergeEdges& me, const int pa, const bool onlyAbove,
+							unsigned short* polys, const unsigned short* verts, const int* stamps,
+							const int nvp, rcMergeCandidate* heap, int& nheap, const int maxHeap)
+{
+	unsigned short* p = &polys[pa*nvp];
+	const int n = countPolyVerts(p, nvp);
+	for (int j = 0; j < n; ++j)
+	{
+		const int va = p[j];
+		const int vb = p[(j+1) % n];
+		for (int i = me.first[computeEdgeHash(va, vb, me.mask)]; i != -1; i = me.next[i])
+		{
+			const int* e = &me.edges[i*3];
+			const int pb = e[2];
+			if (pb < 0 || pb == pa || (onlyAbove && pb < pa) || !sameEdge(e, va, vb))
+				continue;
+			rcMergeCandidate c;
+			c.pa = rcMin(pa, pb);
+			c.pb = rcMax(pa, pb);
+			c.value = getPolyMergeValue(&polys[c.pa*nvp], &polys[c.pb*nvp], verts, c.ea, c.eb, nvp);
+			if (c.value <= 0)
+				continue;
+			c.stampa = stamps[c.pa];
+			c.stampb = stamps[c.pb];
+			if (nheap < maxHeap)
+				pushMergeCandidate(heap, nheap, c);
+		}
+	}
+}
+
+// Removes the candidates that refer to polygons that have changed since.
+static void compactMergeCandidates(rcMergeCandidate* heap, int& nheap, const int* stamps, const int npolys)
+{
+	int n = 0;
+	for (int i = 0; i < nheap; ++i)
+	{
+		const rcMergeCandidate& c = heap[i];
+		if (c.pb < npolys && stamps[c.pa] == c.stampa && stamps[c.pb] == c.stampb)
+			pushMergeCandidate(heap, n, c);
+	}
+	nheap = n;
+}
+
 static void pushFront(int v, int* arr, int& an)
 {
 	an++;
@@ -601,7 +760,7 @@ static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned sho
 	// Find edges which share the removed vertex.
 	const int maxEdges = numTouchedVerts*2;
 	int nedges = 0;
-	rcScopedDelete<int> edges((int*)rcAlloc(sizeof(int)*maxEdges*3, RC_ALLOC_TEMP));
+	rcScopedDelete<int> edges((int*)rcAlloc(sizeof(int)*maxEdges*3, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!edges)
 	{
 		ctx->log(RC_LOG_WARNING, "canRemoveVertex: Out of memory 'edges' (%d).", maxEdges*3);
@@ -681,7 +840,7 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	}
 	
 	int nedges = 0;
-	rcScopedDelete<int> edges((int*)rcAlloc(sizeof(int)*numRemovedVerts*nvp*4, RC_ALLOC_TEMP));
+	rcScopedDelete<int> edges((int*)rcAlloc(sizeof(int)*numRemovedVerts*nvp*4, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!edges)
 	{
 		ctx->log(RC_LOG_WARNING, "removeVertex: Out of memory 'edges' (%d).", numRemovedVerts*nvp*4);
@@ -689,7 +848,7 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	}
 
 	int nhole = 0;
-	rcScopedDelete<int> hole((int*)rcAlloc(sizeof(int)*numRemovedVerts*nvp, RC_ALLOC_TEMP));
+	rcScopedDelete<int> hole((int*)rcAlloc(sizeof(int)*numRemovedVerts*nvp, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!hole)
 	{
 		ctx->log(RC_LOG_WARNING, "removeVertex: Out of memory 'hole' (%d).", numRemovedVerts*nvp);
@@ -697,7 +856,7 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	}
 
 	int nhreg = 0;
-	rcScopedDelete<int> hreg((int*)rcAlloc(sizeof(int)*numRemovedVerts*nvp, RC_ALLOC_TEMP));
+	rcScopedDelete<int> hreg((int*)rcAlloc(sizeof(int)*numRemovedVerts*nvp, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!hreg)
 	{
 		ctx->log(RC_LOG_WARNING, "removeVertex: Out of memory 'hreg' (%d).", numRemovedVerts*nvp);
@@ -705,7 +864,7 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	}
 
 	int nharea = 0;
-	rcScopedDelete<int> harea((int*)rcAlloc(sizeof(int)*numRemovedVerts*nvp, RC_ALLOC_TEMP));
+	rcScopedDelete<int> harea((int*)rcAlloc(sizeof(int)*numRemovedVerts*nvp, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!harea)
 	{
 		ctx->log(RC_LOG_WARNING, "removeVertex: Out of memory 'harea' (%d).", numRemovedVerts*nvp);
@@ -822,21 +981,21 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 			break;
 	}
 
-	rcScopedDelete<int> tris((int*)rcAlloc(sizeof(int)*nhole*3, RC_ALLOC_TEMP));
+	rcScopedDelete<int> tris((int*)rcAlloc(sizeof(int)*nhole*3, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!tris)
 	{
 		ctx->log(RC_LOG_WARNING, "removeVertex: Out of memory 'tris' (%d).", nhole*3);
 		return false;
 	}
 
-	rcScopedDelete<int> tverts((int*)rcAlloc(sizeof(int)*nhole*4, RC_ALLOC_TEMP));
+	rcScopedDelete<int> tverts((int*)rcAlloc(sizeof(int)*nhole*4, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!tverts)
 	{
 		ctx->log(RC_LOG_WARNING, "removeVertex: Out of memory 'tverts' (%d).", nhole*4);
 		return false;
 	}
 
-	rcScopedDelete<int> thole((int*)rcAlloc(sizeof(int)*nhole, RC_ALLOC_TEMP));
+	rcScopedDelete<int> thole((int*)rcAlloc(sizeof(int)*nhole, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!thole)
 	{
 		ctx->log(RC_LOG_WARNING, "removeVertex: Out of memory 'thole' (%d).", nhole);
@@ -863,19 +1022,19 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	}
 	
 	// Merge the hole triangles back to polygons.
-	rcScopedDelete<unsigned short> polys((unsigned short*)rcAlloc(sizeof(unsigned short)*(ntris+1)*nvp, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> polys((unsigned short*)rcAlloc(sizeof(unsigned short)*(ntris+1)*nvp, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!polys)
 	{
 		ctx->log(RC_LOG_ERROR, "removeVertex: Out of memory 'polys' (%d).", (ntris+1)*nvp);
 		return false;
 	}
-	rcScopedDelete<unsigned short> pregs((unsigned short*)rcAlloc(sizeof(unsigned short)*ntris, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> pregs((unsigned short*)rcAlloc(sizeof(unsigned short)*ntris, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!pregs)
 	{
 		ctx->log(RC_LOG_ERROR, "removeVertex: Out of memory 'pregs' (%d).", ntris);
 		return false;
 	}
-	rcScopedDelete<unsigned char> pareas((unsigned char*)rcAlloc(sizeof(unsigned char)*ntris, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned char> pareas((unsigned char*)rcAlloc(sizeof(unsigned char)*ntris, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!pareas)
 	{
 		ctx->log(RC_LOG_ERROR, "removeVertex: Out of memory 'pareas' (%d).", ntris);
@@ -1020,7 +1179,7 @@ bool rcBuildPolyMesh(rcContext* ctx, rcContourSet& cset, const int nvp, rcPolyMe
 		return false;
 	}
 		
-	rcScopedDelete<unsigned char> vflags((unsigned char*)rcAlloc(sizeof(unsigned char)*maxVertices, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned char> vflags((unsigned char*)rcAlloc(sizeof(unsigned char)*maxVertices, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!vflags)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'vflags' (%d).", maxVertices);
@@ -1028,25 +1187,25 @@ bool rcBuildPolyMesh(rcContext* ctx, rcContourSet& cset, const int nvp, rcPolyMe
 	}
 	memset(vflags, 0, maxVertices);
 	
-	mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertices*3, RC_ALLOC_PERM);
+	mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertices*3, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.verts)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.verts' (%d).", maxVertices);
 		return false;
 	}
-	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris*nvp*2, RC_ALLOC_PERM);
+	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris*nvp*2, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.polys)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.polys' (%d).", maxTris*nvp*2);
 		return false;
 	}
-	mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
+	mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.regs)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.regs' (%d).", maxTris);
 		return false;
 	}
-	mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris, RC_ALLOC_PERM);
+	mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.areas)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.areas' (%d).", maxTris);
@@ -1063,7 +1222,7 @@ bool rcBuildPolyMesh(rcContext* ctx, rcContourSet& cset, const int nvp, rcPolyMe
 	memset(mesh.regs, 0, sizeof(unsigned short)*maxTris);
 	memset(mesh.areas, 0, sizeof(unsigned char)*maxTris);
 	
-	rcScopedDelete<int> nextVert((int*)rcAlloc(sizeof(int)*maxVertices, RC_ALLOC_TEMP));
+	rcScopedDelete<int> nextVert((int*)rcAlloc(sizeof(int)*maxVertices, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!nextVert)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'nextVert' (%d).", maxVertices);
@@ -1071,34 +1230,65 @@ bool rcBuildPolyMesh(rcContext* ctx, rcContourSet& cset, const int nvp, rcPolyMe
 	}
 	memset(nextVert, 0, sizeof(int)*maxVertices);
 	
-	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*VERTEX_BUCKET_COUNT, RC_ALLOC_TEMP));
+	const int vertexBucketCount = calcVertexBucketCount(maxVertices);
+	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*vertexBucketCount, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!firstVert)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'firstVert' (%d).", VERTEX_BUCKET_COUNT);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'firstVert' (%d).", vertexBucketCount);
 		return false;
 	}
-	for (int i = 0; i < VERTEX_BUCKET_COUNT; ++i)
+	for (int i = 0; i < vertexBucketCount; ++i)
 		firstVert[i] = -1;
 	
-	rcScopedDelete<int> indices((int*)rcAlloc(sizeof(int)*maxVertsPerCont, RC_ALLOC_TEMP));
+	rcScopedDelete<int> indices((int*)rcAlloc(sizeof(int)*maxVertsPerCont, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!indices)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'indices' (%d).", maxVertsPerCont);
 		return false;
 	}
-	rcScopedDelete<int> tris((int*)rcAlloc(sizeof(int)*maxVertsPerCont*3, RC_ALLOC_TEMP));
+	rcScopedDelete<int> tris((int*)rcAlloc(sizeof(int)*maxVertsPerCont*3, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!tris)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'tris' (%d).", maxVertsPerCont*3);
 		return false;
 	}
-	rcScopedDelete<unsigned short> polys((unsigned short*)rcAlloc(sizeof(unsigned short)*(maxVertsPerCont+1)*nvp, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> polys((unsigned short*)rcAlloc(sizeof(unsigned short)*(maxVertsPerCont+1)*nvp, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!polys)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'polys' (%d).", maxVertsPerCont*nvp);
 		return false;
 	}
 	unsigned short* tmpPoly = &polys[maxVertsPerCont*nvp];
+	
+	int maxEdgeBuckets = 1;
+	while (maxEdgeBuckets < maxVertsPerCont*3)
+		maxEdgeBuckets <<= 1;
+	rcScopedDelete<int> edgeBuf((int*)rcAlloc(sizeof(int)*(maxEdgeBuckets + maxVertsPerCont*3*4), RC_ALLOC_TEMP, RC_MEM_POLYMESH));
+	if (!edgeBuf)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'edgeBuf' (%d).", maxEdgeBuckets + maxVertsPerCont*3*4);
+		return false;
+	}
+	rcMergeEdges mergeEdges;
+	mergeEdges.first = edgeBuf;
+	mergeEdges.next = mergeEdges.first + maxEdgeBuckets;
+	mergeEdges.edges = mergeEdges.next + maxVertsPerCont*3;
+	mergeEdges.nedges = 0;
+	mergeEdges.mask = 0;
+	
+	const int maxHeap = maxVertsPerCont*4 + nvp*8;
+	rcScopedDelete<rcMergeCandidate> heap((rcMergeCandidate*)rcAlloc(sizeof(rcMergeCandidate)*maxHeap, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
+	if (!heap)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'heap' (%d).", maxHeap);
+		return false;
+	}
+	rcScopedDelete<int> stamps((int*)rcAlloc(sizeof(int)*rcMax(maxVertsPerCont, 1), RC_ALLOC_TEMP, RC_MEM_POLYMESH));
+	if (!stamps)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'stamps' (%d).", maxVertsPerCont);
+		return false;
+	}
 
 	for (int i = 0; i < cset.nconts; ++i)
 	{
@@ -1135,7 +1325,7 @@ bool rcBuildPolyMesh(rcContext* ctx, rcContourSet& cset, const int nvp, rcPolyMe
 		{
 			const int* v = &cont.verts[j*4];
 			indices[j] = addVertex((unsigned short)v[0], (unsigned short)v[1], (unsigned short)v[2],
-								   mesh.verts, firstVert, nextVert, mesh.nverts);
+								   mesh.verts, firstVert, nextVert, vertexBucketCount, mesh.nverts);
 			if (v[3] & RC_BORDER_VERTEX)
 			{
 				// This vertex should be removed.
@@ -1163,47 +1353,70 @@ bool rcBuildPolyMesh(rcContext* ctx, rcContourSet& cset, const int nvp, rcPolyMe
 		// Merge polygons.
 		if (nvp > 3)
 		{
-			for(;;)
+			// Hash the triangle edges so that the neighbours of a polygon can be
+			// found quickly, and queue the possible merges.
+			mergeEdges.mask = 1;
+			while (mergeEdges.mask < npolys*3)
+				mergeEdges.mask <<= 1;
+			mergeEdges.mask--;
+			for (int j = 0; j <= mergeEdges.mask; ++j)
+				mergeEdges.first[j] = -1;
+			mergeEdges.nedges = 0;
+			for (int j = 0; j < npolys; ++j)
+			{
+				const unsigned short* p = &polys[j*nvp];
+				addMergeEdge(mergeEdges, p[0], p[1], j);
+				addMergeEdge(mergeEdges, p[1], p[2], j);
+				addMergeEdge(mergeEdges, p[2], p[0], j);
+				stamps[j] = 0;
+			}
+			int nheap = 0;
+			for (int j = 0; j < npolys; ++j)
+				queuePolyMerges(mergeEdges, j, true, polys, mesh.verts, stamps, nvp, heap, nheap, maxHeap);
+			
+			// Merge the best pair of polygons until no more merges are possible.
+			while (nheap > 0)
 			{
-				// Find best polygons to merge.
-				int bestMergeVal = 0;
-				int bestPa = 0, bestPb = 0, bestEa = 0, bestEb = 0;
+				const rcMergeCandidate c = heap[0];
+				popMergeCandidate(heap, nheap);
+				if (c.pb >= npolys || stamps[c.pa] != c.stampa || stamps[c.pb] != c.stampb)
+					continue;
 				
-				for (int j = 0; j < npolys-1; ++j)
-				{
-					unsigned short* pj = &polys[j*nvp];
-					for (int k = j+1; k < npolys; ++k)
-					{
-						unsigned short* pk = &polys[k*nvp];
-						int ea, eb;
-						int v = getPolyMergeValue(pj, pk, mesh.verts, ea, eb, nvp);
-						if (v > bestMergeVal)
-						{
-							bestMergeVal = v;
-							bestPa = j;
-							bestPb = k;
-							bestEa = ea;
-							bestEb = eb;
-						}
-					}
-				}
+				unsigned short* pa = &polys[c.pa*nvp];
+				unsigned short* pb = &polys[c.pb*nvp];
+				const int na = countPolyVerts(pa, nvp);
+				const int nb = countPolyVerts(pb, nvp);
 				
-				if (bestMergeVal > 0)
+				// The shared edge becomes internal, the rest of pb's edges move to pa.
+				moveMergeEdge(mergeEdges, pa[c.ea], pa[(c.ea+1) % na], c.pa, -1);
+				moveMergeEdge(mergeEdges, pb[c.eb], pb[(c.eb+1) % nb], c.pb, -1);
+				for (int j = 0; j < nb; ++j)
 				{
-					// Found best, merge.
-					unsigned short* pa = &polys[bestPa*nvp];
-					unsigned short* pb = &polys[bestPb*nvp];
-					mergePolyVerts(pa, pb, bestEa, bestEb, tmpPoly, nvp);
-					unsigned short* lastPoly = &polys[(npolys-1)*nvp];
-					if (pb != lastPoly)
-						memcpy(pb, lastPoly, sizeof(unsigned short)*nvp);
-					npolys--;
+					if (j != c.eb)
+						moveMergeEdge(mergeEdges, pb[j], pb[(j+1) % nb], c.pb, c.pa);
 				}
-				else
+				mergePolyVerts(pa, pb, c.ea, c.eb, tmpPoly, nvp);
+				
+				// Move the last polygon to the place of pb.
+				const int last = npolys-1;
+				if (c.pb != last)
 				{
-					// Could not merge any polygons, stop.
-					break;
+					unsigned short* lastPoly = &polys[last*nvp];
+					const int nl = countPolyVerts(lastPoly, nvp);
+					for (int j = 0; j < nl; ++j)
+						moveMergeEdge(mergeEdges, lastPoly[j], lastPoly[(j+1) % nl], last, c.pb);
+					memcpy(pb, lastPoly, sizeof(unsigned short)*nvp);
 				}
+				npolys--;
+				stamps[c.pa]++;
+				stamps[c.pb]++;
+				stamps[last]++;
+				
+				if (nheap + nvp*4 > maxHeap)
+					compactMergeCandidates(heap, nheap, stamps, npolys);
+				queuePolyMerges(mergeEdges, c.pa, false, polys, mesh.verts, stamps, nvp, heap, nheap, maxHeap);
+				if (c.pb < npolys)
+					queuePolyMerges(mergeEdges, c.pb, false, polys, mesh.verts, stamps, nvp, heap, nheap, maxHeap);
 			}
 		}
 		
@@ -1287,7 +1500,7 @@ bool rcBuildPolyMesh(rcContext* ctx, rcContourSet& cset, const int nvp, rcPolyMe
 	}
 
 	// Just allocate the mesh flags array. The user is resposible to fill it.
-	mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*mesh.npolys, RC_ALLOC_PERM);
+	mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*mesh.npolys, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.flags)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.flags' (%d).", mesh.npolys);
@@ -1336,7 +1549,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 	
 	mesh.nverts = 0;
-	mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVerts*3, RC_ALLOC_PERM);
+	mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVerts*3, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.verts)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.verts' (%d).", maxVerts*3);
@@ -1344,7 +1557,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 
 	mesh.npolys = 0;
-	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys*2*mesh.nvp, RC_ALLOC_PERM);
+	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys*2*mesh.nvp, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.polys)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.polys' (%d).", maxPolys*2*mesh.nvp);
@@ -1352,7 +1565,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 	memset(mesh.polys, 0xff, sizeof(unsigned short)*maxPolys*2*mesh.nvp);
 
-	mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys, RC_ALLOC_PERM);
+	mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.regs)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.regs' (%d).", maxPolys);
@@ -1360,7 +1573,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 	memset(mesh.regs, 0, sizeof(unsigned short)*maxPolys);
 
-	mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxPolys, RC_ALLOC_PERM);
+	mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxPolys, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.areas)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.areas' (%d).", maxPolys);
@@ -1368,7 +1581,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 	memset(mesh.areas, 0, sizeof(unsigned char)*maxPolys);
 
-	mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys, RC_ALLOC_PERM);
+	mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!mesh.flags)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.flags' (%d).", maxPolys);
@@ -1376,7 +1589,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 	memset(mesh.flags, 0, sizeof(unsigned short)*maxPolys);
 	
-	rcScopedDelete<int> nextVert((int*)rcAlloc(sizeof(int)*maxVerts, RC_ALLOC_TEMP));
+	rcScopedDelete<int> nextVert((int*)rcAlloc(sizeof(int)*maxVerts, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!nextVert)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'nextVert' (%d).", maxVerts);
@@ -1384,16 +1597,17 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 	memset(nextVert, 0, sizeof(int)*maxVerts);
 	
-	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*VERTEX_BUCKET_COUNT, RC_ALLOC_TEMP));
+	const int vertexBucketCount = calcVertexBucketCount(maxVerts);
+	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*vertexBucketCount, RC_ALLOC_TEMP, RC_MEM_POLYMESH));
 	if (!firstVert)
 	{
-		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'firstVert' (%d).", VERTEX_BUCKET_COUNT);
+		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'firstVert' (%d).", vertexBucketCount);
 		return false;
 	}
-	for (int i = 0; i < VERTEX_BUCKET_COUNT; ++i)
+	for (int i = 0; i < vertexBucketCount; ++i)
 		firstVert[i] = -1;
 
-	rcScopedDelete<unsigned short> vremap((unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertsPerMesh, RC_ALLOC_PERM));
+	rcScopedDelete<unsigned short> vremap((unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertsPerMesh, RC_ALLOC_PERM, RC_MEM_POLYMESH));
 	if (!vremap)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'vremap' (%d).", maxVertsPerMesh);
@@ -1418,7 +1632,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		{
 			unsigned short* v = &pmesh->verts[j*3];
 			vremap[j] = addVertex(v[0]+ox, v[1], v[2]+oz,
-								  mesh.verts, firstVert, nextVert, mesh.nverts);
+								  mesh.verts, firstVert, nextVert, vertexBucketCount, mesh.nverts);
 		}
 		
 		for (int j = 0; j < pmesh->npolys; ++j)
@@ -1508,7 +1722,7 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 	dst.borderSize = src.borderSize;
 	dst.maxEdgeError = src.maxEdgeError;
 	
-	dst.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.nverts*3, RC_ALLOC_PERM);
+	dst.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.nverts*3, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!dst.verts)
 	{
 		ctx->log(RC_LOG_ERROR, "rcCopyPolyMesh: Out of memory 'dst.verts' (%d).", src.nverts*3);
@@ -1516,7 +1730,7 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 	}
 	memcpy(dst.verts, src.verts, sizeof(unsigned short)*src.nverts*3);
 	
-	dst.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.npolys*2*src.nvp, RC_ALLOC_PERM);
+	dst.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.npolys*2*src.nvp, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!dst.polys)
 	{
 		ctx->log(RC_LOG_ERROR, "rcCopyPolyMesh: Out of memory 'dst.polys' (%d).", src.npolys*2*src.nvp);
@@ -1524,7 +1738,7 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 	}
 	memcpy(dst.polys, src.polys, sizeof(unsigned short)*src.npolys*2*src.nvp);
 	
-	dst.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.npolys, RC_ALLOC_PERM);
+	dst.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.npolys, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!dst.regs)
 	{
 		ctx->log(RC_LOG_ERROR, "rcCopyPolyMesh: Out of memory 'dst.regs' (%d).", src.npolys);
@@ -1532,7 +1746,7 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 	}
 	memcpy(dst.regs, src.regs, sizeof(unsigned short)*src.npolys);
 	
-	dst.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*src.npolys, RC_ALLOC_PERM);
+	dst.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*src.npolys, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!dst.areas)
 	{
 		ctx->log(RC_LOG_ERROR, "rcCopyPolyMesh: Out of memory 'dst.areas' (%d).", src.npolys);
@@ -1540,7 +1754,7 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 	}
 	memcpy(dst.areas, src.areas, sizeof(unsigned char)*src.npolys);
 	
-	dst.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.npolys, RC_ALLOC_PERM);
+	dst.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.npolys, RC_ALLOC_PERM, RC_MEM_POLYMESH);
 	if (!dst.flags)
 	{
 		ctx->log(RC_LOG_ERROR, "rcCopyPolyMesh: Out of memory 'dst.flags' (%d).", src.npolys);
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <new>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
@@ -281,255 +282,333 @@ static unsigned short getHeight(const float fx, const float fy, const float fz,
 }
 
 
-enum EdgeValues
-{
-	EV_UNDEF = -1,
-	EV_HULL = -2,
-};
+// The detail triangles are stored in 'tris' as (a, b, c, flags) and the
+// neighbour across each of their edges (ab, bc, ca) in 'adj', -1 on the hull.
 
-static int findEdge(const int* edges, int nedges, int s, int t)
+static void buildTriAdjacency(const rcIntArray& tris, rcIntArray& adj)
 {
-	for (int i = 0; i < nedges; i++)
+	const int ntris = tris.size()/4;
+	adj.resize(ntris*3);
+	for (int i = 0; i < ntris*3; ++i)
+		adj[i] = -1;
+	for (int i = 0; i < ntris; ++i)
 	{
-		const int* e = &edges[i*4];
-		if ((e[0] == s && e[1] == t) || (e[0] == t && e[1] == s))
-			return i;
+		for (int j = 0; j < 3; ++j)
+		{
+			if (adj[i*3+j] != -1)
+				continue;
+			const int a = tris[i*4+j];
+			const int b = tris[i*4+(j+1)%3];
+			for (int k = i+1; k < ntris && adj[i*3+j] == -1; ++k)
+			{
+				for (int l = 0; l < 3; ++l)
+				{
+					if (tris[k*4+l] == b && tris[k*4+(l+1)%3] == a)
+					{
+						adj[i*3+j] = k;
+						adj[k*3+l] = i;
+						break;
+					}
+				}
+			}
+		}
 	}
-	return EV_UNDEF;
 }
 
-static int addEdge(rcContext* ctx, int* edges, int& nedges, const int maxEdges, int s, int t, int l, int r)
+static void replaceNeighbour(rcIntArray& adj, const int t, const int from, const int to)
 {
-	if (nedges >= maxEdges)
+	if (t < 0)
+		return;
+	for (int j = 0; j < 3; ++j)
 	{
-		ctx->log(RC_LOG_ERROR, "addEdge: Too many edges (%d/%d).", nedges, maxEdges);
-		return EV_UNDEF;
+		if (adj[t*3+j] == from)
+		{
+			adj[t*3+j] = to;
+			return;
+		}
 	}
-	
-	// Add edge if not already in the triangulation.
-	int e = findEdge(edges, nedges, s, t);
-	if (e == EV_UNDEF)
+}
+
+// Rotates the vertices of triangle t so that edge e becomes the first edge.
+static void rotateTri(rcIntArray& tris, rcIntArray& adj, const int t, const int e)
+{
+	if (e == 0)
+		return;
+	int* v = &tris[t*4];
+	int* n = &adj[t*3];
+	const int v0 = v[0], v1 = v[1], v2 = v[2];
+	const int n0 = n[0], n1 = n[1], n2 = n[2];
+	if (e == 1)
 	{
-		int* edge = &edges[nedges*4];
-		edge[0] = s;
-		edge[1] = t;
-		edge[2] = l;
-		edge[3] = r;
-		return nedges++;
+		v[0] = v1; v[1] = v2; v[2] = v0;
+		n[0] = n1; n[1] = n2; n[2] = n0;
 	}
 	else
 	{
-		return EV_UNDEF;
+		v[0] = v2; v[1] = v0; v[2] = v1;
+		n[0] = n2; n[1] = n0; n[2] = n1;
+	}
+}
+
+// Returns the vertex of the neighbour across edge e of triangle t opposite to the edge.
+static int oppositeVertex(const rcIntArray& tris, const rcIntArray& adj, const int t, const int e)
+{
+	const int n = adj[t*3+e];
+	if (n < 0)
+		return -1;
+	const int a = tris[t*4+e];
+	const int b = tris[t*4+(e+1)%3];
+	for (int j = 0; j < 3; ++j)
+	{
+		if (tris[n*4+j] == b && tris[n*4+(j+1)%3] == a)
+			return tris[n*4+(j+2)%3];
 	}
+	return -1;
 }
 
-static void updateLeftFace(int* e, int s, int t, int f)
+// Returns true if edge e of triangle t must be flipped to make the triangulation Delaunay.
+static bool shouldFlipEdge(const float* verts, const rcIntArray& tris, const rcIntArray& adj,
+						   const int t, const int e, const float orient)
 {
-	if (e[0] == s && e[1] == t && e[2] == EV_UNDEF)
-		e[2] = f;
-	else if (e[1] == s && e[0] == t && e[3] == EV_UNDEF)
-		e[3] = f;
+	static const float EPS = 1e-5f;
+	
+	const int d = oppositeVertex(tris, adj, t, e);
+	if (d == -1)
+		return false;
+	const float* va = &verts[tris[t*4+e]*3];
+	const float* vb = &verts[tris[t*4+(e+1)%3]*3];
+	const float* vc = &verts[tris[t*4+(e+2)%3]*3];
+	const float* vd = &verts[d*3];
+	
+	// The quad must be convex for the flipped triangles to be valid.
+	if (vcross2(va, vd, vc)*orient <= EPS || vcross2(vd, vb, vc)*orient <= EPS)
+		return false;
+	
+	float c[3], r;
+	if (!circumCircle(va, vb, vc, c, r))
+		return true;
+	// Points on the circle within tolerance keep the current edge.
+	const float tol = 0.001f;
+	return vdist2(c, vd) < r*(1-tol);
 }
 
-static int overlapSegSeg2d(const float* a, const float* b, const float* c, const float* d)
+// Flips edge e of triangle t, the quad (a,d,b,c) made of t=(a,b,c) and its
+// neighbour n=(b,a,d) becomes the triangles t=(a,d,c) and n=(d,b,c).
+static int flipEdge(rcIntArray& tris, rcIntArray& adj, const int t, const int e)
 {
-	const float a1 = vcross2(a, b, d);
-	const float a2 = vcross2(a, b, c);
-	if (a1*a2 < 0.0f)
+	rotateTri(tris, adj, t, e);
+	const int n = adj[t*3];
+	const int a = tris[t*4+0];
+	const int b = tris[t*4+1];
+	const int c = tris[t*4+2];
+	for (int j = 0; j < 3; ++j)
 	{
-		float a3 = vcross2(c, d, a);
-		float a4 = a3 + a2 - a1;
-		if (a3 * a4 < 0.0f)
-			return 1;
+		if (tris[n*4+j] == b && tris[n*4+(j+1)%3] == a)
+		{
+			rotateTri(tris, adj, n, j);
+			break;
+		}
 	}
-	return 0;
+	const int d = tris[n*4+2];
+	const int nbc = adj[t*3+1];
+	const int nca = adj[t*3+2];
+	const int nad = adj[n*3+1];
+	const int ndb = adj[n*3+2];
+	
+	tris[t*4+0] = a; tris[t*4+1] = d; tris[t*4+2] = c;
+	adj[t*3+0] = nad; adj[t*3+1] = n; adj[t*3+2] = nca;
+	tris[n*4+0] = d; tris[n*4+1] = b; tris[n*4+2] = c;
+	adj[n*3+0] = ndb; adj[n*3+1] = nbc; adj[n*3+2] = t;
+	
+	replaceNeighbour(adj, nad, n, t);
+	replaceNeighbour(adj, nbc, t, n);
+	
+	return n;
 }
 
-static bool overlapEdges(const float* pts, const int* edges, int nedges, int s1, int t1)
+// Flips the edges on the stack, and the edges around the flipped ones, until
+// the triangulation is Delaunay.
+static void legalizeEdges(const float* verts, rcIntArray& tris, rcIntArray& adj,
+						  rcIntArray& stack, const float orient)
 {
-	for (int i = 0; i < nedges; ++i)
+	const int ntris = tris.size()/4;
+	const int maxFlips = ntris*ntris;
+	int nflips = 0;
+	while (stack.size() > 0)
 	{
-		const int s0 = edges[i*4+0];
-		const int t0 = edges[i*4+1];
-		// Same or connected edges do not overlap.
-		if (s0 == s1 || s0 == t1 || t0 == s1 || t0 == t1)
+		const int e = stack.pop();
+		const int t = stack.pop();
+		if (!shouldFlipEdge(verts, tris, adj, t, e, orient))
 			continue;
-		if (overlapSegSeg2d(&pts[s0*3],&pts[t0*3], &pts[s1*3],&pts[t1*3]))
-			return true;
+		if (nflips++ >= maxFlips)
+			break;
+		const int n = flipEdge(tris, adj, t, e);
+		stack.push(t); stack.push(0);
+		stack.push(t); stack.push(2);
+		stack.push(n); stack.push(0);
+		stack.push(n); stack.push(1);
 	}
-	return false;
+	stack.resize(0);
 }
 
-static void completeFacet(rcContext* ctx, const float* pts, int npts, int* edges, int& nedges, const int maxEdges, int& nfaces, int e)
+// Flips the edges of the triangulation until it is Delaunay.
+static void delaunayFlip(const float* verts, rcIntArray& tris, rcIntArray& adj,
+						 rcIntArray& stack, const float orient)
 {
-	static const float EPS = 1e-5f;
-	
-	int* edge = &edges[e*4];
-	
-	// Cache s and t.
-	int s,t;
-	if (edge[2] == EV_UNDEF)
-	{
-		s = edge[0];
-		t = edge[1];
-	}
-	else if (edge[3] == EV_UNDEF)
-	{
-		s = edge[1];
-		t = edge[0];
-	}
-	else
-	{
-	    // Edge already completed.
-	    return;
-	}
-    
-	// Find best point on left of edge.
-	int pt = npts;
-	float c[3] = {0,0,0};
-	float r = -1;
-	for (int u = 0; u < npts; ++u)
+	const int ntris = tris.size()/4;
+	stack.resize(0);
+	for (int i = 0; i < ntris; ++i)
 	{
-		if (u == s || u == t) continue;
-		if (vcross2(&pts[s*3], &pts[t*3], &pts[u*3]) > EPS)
+		for (int j = 0; j < 3; ++j)
 		{
-			if (r < 0)
-			{
-				// The circle is not updated yet, do it now.
-				pt = u;
-				circumCircle(&pts[s*3], &pts[t*3], &pts[u*3], c, r);
-				continue;
-			}
-			const float d = vdist2(c, &pts[u*3]);
-			const float tol = 0.001f;
-			if (d > r*(1+tol))
-			{
-				// Outside current circumcircle, skip.
-				continue;
-			}
-			else if (d < r*(1-tol))
+			if (adj[i*3+j] > i)
 			{
-				// Inside safe circumcircle, update circle.
-				pt = u;
-				circumCircle(&pts[s*3], &pts[t*3], &pts[u*3], c, r);
+				stack.push(i);
+				stack.push(j);
 			}
-			else
+		}
+	}
+	legalizeEdges(verts, tris, adj, stack, orient);
+}
+
+// Finds the triangle containing p by walking towards it from triangle start.
+static int locateTri(const float* p, const float* verts, const rcIntArray& tris, const rcIntArray& adj,
+					 const int start, const float orient)
+{
+	const int ntris = tris.size()/4;
+	int t = (start >= 0 && start < ntris) ? start : 0;
+	for (int iter = 0; iter < ntris; ++iter)
+	{
+		const int* tv = &tris[t*4];
+		int next = -1;
+		bool inside = true;
+		for (int j = 0; j < 3; ++j)
+		{
+			if (vcross2(&verts[tv[j]*3], &verts[tv[(j+1)%3]*3], p)*orient < 0)
 			{
-				// Inside epsilon circum circle, do extra tests to make sure the edge is valid.
-				// s-u and t-u cannot overlap with s-pt nor t-pt if they exists.
-				if (overlapEdges(pts, edges, nedges, s,u))
-					continue;
-				if (overlapEdges(pts, edges, nedges, t,u))
-					continue;
-				// Edge is valid.
-				pt = u;
-				circumCircle(&pts[s*3], &pts[t*3], &pts[u*3], c, r);
+				inside = false;
+				if (adj[t*3+j] >= 0)
+				{
+					next = adj[t*3+j];
+					break;
+				}
 			}
 		}
+		if (inside)
+			return t;
+		if (next == -1)
+			break;
+		t = next;
 	}
 	
-	// Add new triangle or update edge info if s-t is on hull.
-	if (pt < npts)
-	{
-		// Update face information of edge being completed.
-		updateLeftFace(&edges[e*4], s, t, nfaces);
-		
-		// Add new edge or update face info of old edge.
-		e = findEdge(edges, nedges, pt, s);
-		if (e == EV_UNDEF)
-		    addEdge(ctx, edges, nedges, maxEdges, pt, s, nfaces, EV_UNDEF);
-		else
-		    updateLeftFace(&edges[e*4], pt, s, nfaces);
-		
-		// Add new edge or update face info of old edge.
-		e = findEdge(edges, nedges, t, pt);
-		if (e == EV_UNDEF)
-		    addEdge(ctx, edges, nedges, maxEdges, t, pt, nfaces, EV_UNDEF);
-		else
-		    updateLeftFace(&edges[e*4], t, pt, nfaces);
-		
-		nfaces++;
-	}
-	else
+	// The walk did not converge, check all triangles.
+	for (int i = 0; i < ntris; ++i)
 	{
-		updateLeftFace(&edges[e*4], s, t, EV_HULL);
+		const int* tv = &tris[i*4];
+		if (vcross2(&verts[tv[0]*3], &verts[tv[1]*3], p)*orient >= 0 &&
+			vcross2(&verts[tv[1]*3], &verts[tv[2]*3], p)*orient >= 0 &&
+			vcross2(&verts[tv[2]*3], &verts[tv[0]*3], p)*orient >= 0)
+			return i;
 	}
+	return -1;
 }
 
-static void delaunayHull(rcContext* ctx, const int npts, const float* pts,
-						 const int nhull, const int* hull,
-						 rcIntArray& tris, rcIntArray& edges)
+// Splits edge (a,b) of triangle t=(a,b,c) at vertex p, and the neighbour
+// n=(b,a,d) across the edge if there is one.
+static void splitEdge(const int p, const int t, rcIntArray& tris, rcIntArray& adj, rcIntArray& stack)
 {
-	int nfaces = 0;
-	int nedges = 0;
-	const int maxEdges = npts*10;
-	edges.resize(maxEdges*4);
+	const int a = tris[t*4+0];
+	const int b = tris[t*4+1];
+	const int c = tris[t*4+2];
+	const int n = adj[t*3+0];
+	const int nbc = adj[t*3+1];
+	const int t1 = tris.size()/4;
+	const int n1 = n >= 0 ? t1+1 : -1;
 	
-	for (int i = 0, j = nhull-1; i < nhull; j=i++)
-		addEdge(ctx, &edges[0], nedges, maxEdges, hull[j],hull[i], EV_HULL, EV_UNDEF);
+	// t=(a,p,c), t1=(p,b,c)
+	tris[t*4+1] = p;
+	adj[t*3+0] = n1;
+	adj[t*3+1] = t1;
+	tris.push(p); tris.push(b); tris.push(c); tris.push(0);
+	adj.push(n); adj.push(nbc); adj.push(t);
+	replaceNeighbour(adj, nbc, t, t1);
+	stack.push(t); stack.push(2);
+	stack.push(t1); stack.push(1);
 	
-	int currentEdge = 0;
-	while (currentEdge < nedges)
-	{
-		if (edges[currentEdge*4+2] == EV_UNDEF)
-			completeFacet(ctx, pts, npts, &edges[0], nedges, maxEdges, nfaces, currentEdge);
-		if (edges[currentEdge*4+3] == EV_UNDEF)
-			completeFacet(ctx, pts, npts, &edges[0], nedges, maxEdges, nfaces, currentEdge);
-		currentEdge++;
-	}
+	if (n < 0)
+		return;
 	
-	// Create tris
-	tris.resize(nfaces*4);
-	for (int i = 0; i < nfaces*4; ++i)
-		tris[i] = -1;
-	
-	for (int i = 0; i < nedges; ++i)
+	for (int j = 0; j < 3; ++j)
 	{
-		const int* e = &edges[i*4];
-		if (e[3] >= 0)
-		{
-			// Left face
-			int* t = &tris[e[3]*4];
-			if (t[0] == -1)
-			{
-				t[0] = e[0];
-				t[1] = e[1];
-			}
-			else if (t[0] == e[1])
-				t[2] = e[0];
-			else if (t[1] == e[0])
-				t[2] = e[1];
-		}
-		if (e[2] >= 0)
+		if (tris[n*4+j] == b && tris[n*4+(j+1)%3] == a)
 		{
-			// Right
-			int* t = &tris[e[2]*4];
-			if (t[0] == -1)
-			{
-				t[0] = e[1];
-				t[1] = e[0];
-			}
-			else if (t[0] == e[0])
-				t[2] = e[1];
-			else if (t[1] == e[1])
-				t[2] = e[0];
+			rotateTri(tris, adj, n, j);
+			break;
 		}
 	}
+	const int d = tris[n*4+2];
+	const int nad = adj[n*3+1];
 	
-	for (int i = 0; i < tris.size()/4; ++i)
+	// n=(b,p,d), n1=(p,a,d)
+	tris[n*4+1] = p;
+	adj[n*3+0] = t1;
+	adj[n*3+1] = n1;
+	tris.push(p); tris.push(a); tris.push(d); tris.push(0);
+	adj.push(t); adj.push(nad); adj.push(n);
+	replaceNeighbour(adj, nad, n, n1);
+	stack.push(n); stack.push(2);
+	stack.push(n1); stack.push(1);
+}
+
+// Inserts vertex p into triangle t and flips the edges around it until the
+// triangulation is Delaunay again.
+static void insertPoint(const float* verts, const int p, const int t,
+						rcIntArray& tris, rcIntArray& adj, rcIntArray& stack, const float orient)
+{
+	// A vertex on one of the edges would leave a degenerate triangle which
+	// cannot be flipped away when its neighbours are collinear too, split the
+	// edge instead.
+	static const float EDGE_EPS = 1e-3f;
+	const float* vp = &verts[p*3];
+	stack.resize(0);
+	for (int j = 0; j < 3; ++j)
 	{
-		int* t = &tris[i*4];
-		if (t[0] == -1 || t[1] == -1 || t[2] == -1)
+		const float* va = &verts[tris[t*4+j]*3];
+		const float* vb = &verts[tris[t*4+(j+1)%3]*3];
+		const float d = fabsf(vcross2(va, vb, vp));
+		if (d <= EDGE_EPS*vdistSq2(va, vb))
 		{
-			ctx->log(RC_LOG_WARNING, "delaunayHull: Removing dangling face %d [%d,%d,%d].", i, t[0],t[1],t[2]);
-			t[0] = tris[tris.size()-4];
-			t[1] = tris[tris.size()-3];
-			t[2] = tris[tris.size()-2];
-			t[3] = tris[tris.size()-1];
-			tris.resize(tris.size()-4);
-			--i;
+			rotateTri(tris, adj, t, j);
+			splitEdge(p, t, tris, adj, stack);
+			legalizeEdges(verts, tris, adj, stack, orient);
+			return;
 		}
 	}
+	
+	const int a = tris[t*4+0];
+	const int b = tris[t*4+1];
+	const int c = tris[t*4+2];
+	const int nbc = adj[t*3+1];
+	const int nca = adj[t*3+2];
+	const int t1 = tris.size()/4;
+	const int t2 = t1+1;
+	
+	tris[t*4+2] = p;
+	adj[t*3+1] = t1;
+	adj[t*3+2] = t2;
+	
+	tris.push(b); tris.push(c); tris.push(p); tris.push(0);
+	adj.push(nbc); adj.push(t2); adj.push(t);
+	tris.push(c); tris.push(a); tris.push(p); tris.push(0);
+	adj.push(nca); adj.push(t); adj.push(t1);
+	
+	replaceNeighbour(adj, nbc, t, t1);
+	replaceNeighbour(adj, nca, t, t2);
+	
+	stack.push(t); stack.push(0);
+	stack.push(t1); stack.push(0);
+	stack.push(t2); stack.push(0);
+	legalizeEdges(verts, tris, adj, stack, orient);
 }
 
 // Calculate minimum extend of the polygon.
@@ -638,7 +717,7 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 							const float sampleDist, const float sampleMaxError,
 							const int heightSearchRadius, const rcCompactHeightfield& chf,
 							const rcHeightPatch& hp, float* verts, int& nverts,
-							rcIntArray& tris, rcIntArray& edges, rcIntArray& samples)
+							rcIntArray& tris, rcIntArray& adj, rcIntArray& stack, rcIntArray& samples)
 {
 	static const int MAX_VERTS = 127;
 	static const int MAX_TRIS = 255;	// Max tris for delaunay is 2n-2-k (n=num verts, k=num hull verts).
@@ -652,7 +731,6 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 	for (int i = 0; i < nin; ++i)
 		rcVcopy(&verts[i*3], &in[i*3]);
 	
-	edges.resize(0);
 	tris.resize(0);
 	
 	const float cs = chf.cs;
@@ -775,7 +853,7 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 	}
 	
 	// Tessellate the base mesh.
-	// We're using the triangulateHull instead of delaunayHull as it tends to
+	// We're using the triangulateHull instead of a Delaunay triangulation as it tends to
 	// create a bit better triangulation for long thin triangles when there
 	// are no internal points.
 	triangulateHull(nverts, verts, nhull, hull, tris);
@@ -817,13 +895,25 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 				samples.push(getHeight(pt[0], pt[1], pt[2], cs, ics, chf.ch, heightSearchRadius, hp));
 				samples.push(z);
 				samples.push(0); // Not added
+				samples.push(0); // Triangle containing the sample
 			}
 		}
 		
+		// Winding of the triangles, used by the orientation tests.
+		float area = 0;
+		for (int i = 2; i < nin; ++i)
+			area += vcross2(&in[0], &in[(i-1)*3], &in[i*3]);
+		const float orient = area < 0 ? -1.0f : 1.0f;
+		buildTriAdjacency(tris, adj);
+		
 		// Add the samples starting from the one that has the most
 		// error. The procedure stops when all samples are added
 		// or when the max error is within treshold.
-		const int nsamples = samples.size()/4;
+		// The triangulation is updated incrementally, each new sample is
+		// inserted into the triangle containing it and the edges around it are
+		// flipped until the triangulation is Delaunay again.
+		const int nsamples = samples.size()/5;
+		bool flipped = false;
 		for (int iter = 0; iter < nsamples; ++iter)
 		{
 			if (nverts >= MAX_VERTS)
@@ -835,7 +925,7 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 			int besti = -1;
 			for (int i = 0; i < nsamples; ++i)
 			{
-				const int* s = &samples[i*4];
+				int* s = &samples[i*5];
 				if (s[3]) continue; // skip added.
 				float pt[3];
 				// The sample location is jittered to get rid of some bad triangulations
@@ -843,7 +933,16 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 				pt[0] = s[0]*sampleDist + getJitterX(i)*cs*0.1f;
 				pt[1] = s[1]*chf.ch;
 				pt[2] = s[2]*sampleDist + getJitterY(i)*cs*0.1f;
-				float d = distToTriMesh(pt, verts, nverts, &tris[0], tris.size()/4);
+				// Start the search from the triangle that contained the sample last time.
+				float d = -1;
+				const int t = locateTri(pt, verts, tris, adj, s[4], orient);
+				if (t != -1)
+				{
+					s[4] = t;
+					d = distPtTri(pt, &verts[tris[t*4+0]*3], &verts[tris[t*4+1]*3], &verts[tris[t*4+2]*3]);
+				}
+				if (d < 0 || d == FLT_MAX)
+					d = distToTriMesh(pt, verts, nverts, &tris[0], tris.size()/4);
 				if (d < 0) continue; // did not hit the mesh.
 				if (d > bestd)
 				{
@@ -855,17 +954,22 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 			// If the max error is within accepted threshold, stop tesselating.
 			if (bestd <= sampleMaxError || besti == -1)
 				break;
+			// The hull triangulation is made Delaunay before the first sample is added.
+			if (!flipped)
+			{
+				delaunayFlip(verts, tris, adj, stack, orient);
+				flipped = true;
+			}
 			// Mark sample as added.
-			samples[besti*4+3] = 1;
+			samples[besti*5+3] = 1;
+			// A sample outside of the triangulation is skipped, the others are still refined.
+			const int t = locateTri(bestpt, verts, tris, adj, samples[besti*5+4], orient);
+			if (t == -1)
+				continue;
 			// Add the new sample point.
 			rcVcopy(&verts[nverts*3],bestpt);
+			insertPoint(verts, nverts, t, tris, adj, stack, orient);
 			nverts++;
-			
-			// Create new triangulation.
-			// TODO: Incremental add instead of full rebuild.
-			edges.resize(0);
-			tris.resize(0);
-			delaunayHull(ctx, nverts, verts, nhull, hull, tris, edges);
 		}
 	}
 	
@@ -1161,8 +1265,218 @@ static unsigned char getTriFlags(const float* va, const float* vb, const float*
 	return flags;
 }
 
+// Keeps the messages logged while building the polygons of one worker so
+// they can be passed on to the build context in polygon order.
+class rcDetailLogContext : public rcContext
+{
+public:
+	inline rcDetailLogContext() : poly(0), m_text(0), m_size(0), m_cap(0) { enableTimer(false); }
+	inline ~rcDetailLogContext() { rcFree(m_text); }
+	
+	inline const char* getText(const int offset) const { return &m_text[offset]; }
+	
+	int poly;				// The polygon being built.
+	rcIntArray entries;		// Logged messages, (polygon, category, text offset, length) each.
+	
+protected:
+	virtual void doLog(const rcLogCategory category, const char* msg, const int len)
+	{
+		if (m_size+len+1 > m_cap)
+		{
+			const int cap = rcMax(m_cap*2, m_size+len+1);
+			char* text = (char*)rcAlloc(sizeof(char)*cap, RC_ALLOC_TEMP, RC_MEM_POLYMESH_DETAIL);
+			if (!text)
+				return;
+			if (m_size)
+				memcpy(text, m_text, sizeof(char)*m_size);
+			rcFree(m_text);
+			m_text = text;
+			m_cap = cap;
+		}
+		memcpy(&m_text[m_size], msg, sizeof(char)*len);
+		m_text[m_size+len] = '\0';
+		entries.push(poly);
+		entries.push((int)category);
+		entries.push(m_size);
+		entries.push(len);
+		m_size += len+1;
+	}
+	
+private:
+	char* m_text;
+	int m_size, m_cap;
+};
+
+struct rcDetailLogEntry
+{
+	int poly;
+	int worker;
+	int index;
+};
+
+static int compareDetailLogEntries(const void* va, const void* vb)
+{
+	const rcDetailLogEntry* a = (const rcDetailLogEntry*)va;
+	const rcDetailLogEntry* b = (const rcDetailLogEntry*)vb;
+	if (a->poly != b->poly)
+		return a->poly < b->poly ? -1 : 1;
+	if (a->index != b->index)
+		return a->index < b->index ? -1 : 1;
+	return 0;
+}
+
+// Per worker buffers used while building the detail meshes.
+struct rcDetailScratch
+{
+	inline rcDetailScratch() : poly(0), verts(0), nverts(0), vcap(0), error(0), errorPoly(-1) {}
+	inline ~rcDetailScratch() { rcFree(poly); rcFree(verts); }
+	
+	rcDetailLogContext log;
+	rcHeightPatch hp;
+	rcIntArray adj;
+	rcIntArray stack;
+	rcIntArray tris;
+	rcIntArray arr;
+	rcIntArray samples;
+	float* poly;
+	float* verts;		// Detail vertices of the polygons built by the worker.
+	int nverts, vcap;
+	rcIntArray dtris;	// Detail triangles of the polygons built by the worker, (a, b, c, flags) each.
+	const char* error;	// Why the worker stopped, or null.
+	int errorPoly;		// The polygon the worker stopped at.
+};
+
+static void freeDetailScratch(rcDetailScratch* scratch, const int n)
+{
+	for (int i = 0; i < n; ++i)
+		scratch[i].~rcDetailScratch();
+}
+
+struct rcDetailTask : public rcParallelTask
+{
+	const rcPolyMesh* mesh;
+	const rcCompactHeightfield* chf;
+	const int* bounds;
+	float sampleDist;
+	float sampleMaxError;
+	int heightSearchRadius;
+	rcDetailScratch* scratch;
+	int* results;		// Per polygon (worker, first vertex, vertex count, first triangle, triangle count).
+	
+	virtual void run(const int i, const int worker)
+	{
+		rcDetailScratch& ds = scratch[worker];
+		int* res = &results[i*5];
+		res[0] = worker;
+		res[1] = ds.nverts;
+		res[2] = 0;
+		res[3] = ds.dtris.size()/4;
+		res[4] = 0;
+		if (ds.error)
+			return;
+		
+		const int nvp = mesh->nvp;
+		const float cs = mesh->cs;
+		const float ch = mesh->ch;
+		const float* orig = mesh->bmin;
+		const unsigned short* p = &mesh->polys[i*nvp*2];
+		float* poly = ds.poly;
+		float verts[256*3];
+		
+		// Store polygon vertices for processing.
+		int npoly = 0;
+		for (int j = 0; j < nvp; ++j)
+		{
+			if(p[j] == RC_MESH_NULL_IDX) break;
+			const unsigned short* v = &mesh->verts[p[j]*3];
+			poly[j*3+0] = v[0]*cs;
+			poly[j*3+1] = v[1]*ch;
+			poly[j*3+2] = v[2]*cs;
+			npoly++;
+		}
+		
+		ds.log.poly = i;
+		
+		// Get the height data from the area of the polygon.
+		rcHeightPatch& hp = ds.hp;
+		hp.xmin = bounds[i*4+0];
+		hp.ymin = bounds[i*4+2];
+		hp.width = bounds[i*4+1]-bounds[i*4+0];
+		hp.height = bounds[i*4+3]-bounds[i*4+2];
+		getHeightData(&ds.log, *chf, p, npoly, mesh->verts, mesh->borderSize, hp, ds.arr, mesh->regs[i]);
+		
+		// Build detail mesh.
+		int nverts = 0;
+		if (!buildPolyDetail(&ds.log, poly, npoly,
+							 sampleDist, sampleMaxError,
+							 heightSearchRadius, *chf, hp,
+							 verts, nverts, ds.tris,
+							 ds.adj, ds.stack, ds.samples))
+		{
+			ds.error = "Could not build the detail mesh";
+			ds.errorPoly = i;
+			return;
+		}
+		
+		// Move detail verts to world space.
+		for (int j = 0; j < nverts; ++j)
+		{
+			verts[j*3+0] += orig[0];
+			verts[j*3+1] += orig[1] + chf->ch; // Is this offset necessary?
+			verts[j*3+2] += orig[2];
+		}
+		// Offset poly too, will be used to flag checking.
+		for (int j = 0; j < npoly; ++j)
+		{
+			poly[j*3+0] += orig[0];
+			poly[j*3+1] += orig[1];
+			poly[j*3+2] += orig[2];
+		}
+		
+		// Store vertices, allocate more memory if necessary.
+		if (ds.nverts+nverts > ds.vcap)
+		{
+			const int vcap = rcMax(ds.vcap*2, ds.nverts+nverts+256);
+			float* newv = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_TEMP, RC_MEM_POLYMESH_DETAIL);
+			if (!newv)
+			{
+				ds.error = "Out of memory 'verts' building the detail mesh";
+				ds.errorPoly = i;
+				return;
+			}
+			if (ds.nverts)
+				memcpy(newv, ds.verts, sizeof(float)*3*ds.nverts);
+			rcFree(ds.verts);
+			ds.verts = newv;
+			ds.vcap = vcap;
+		}
+		memcpy(&ds.verts[ds.nverts*3], verts, sizeof(float)*3*nverts);
+		ds.nverts += nverts;
+		
+		// Store triangles.
+		const int ntris = ds.tris.size()/4;
+		for (int j = 0; j < ntris; ++j)
+		{
+			const int* t = &ds.tris[j*4];
+			ds.dtris.push(t[0]);
+			ds.dtris.push(t[1]);
+			ds.dtris.push(t[2]);
+			ds.dtris.push(getTriFlags(&verts[t[0]*3], &verts[t[1]*3], &verts[t[2]*3], poly, npoly));
+		}
+		
+		res[2] = nverts;
+		res[4] = ntris;
+	}
+};
+
 /// @par
 ///
+/// The detail mesh of each polygon is built as an independent work item through 
+/// rcContext::runParallel.  Each worker keeps its own scratch buffers and output, 
+/// which are concatenated in polygon order once all polygons are done.  Messages 
+/// logged while building a polygon are passed on to the context afterwards, also 
+/// in polygon order.
+///
 /// See the #rcConfig documentation for more information on the configuration parameters.
 ///
 /// @see rcAllocPolyMeshDetail, rcPolyMesh, rcCompactHeightfield, rcPolyMeshDetail, rcConfig
@@ -1178,31 +1492,20 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		return true;
 	
 	const int nvp = mesh.nvp;
-	const float cs = mesh.cs;
-	const float ch = mesh.ch;
-	const float* orig = mesh.bmin;
-	const int borderSize = mesh.borderSize;
 	const int heightSearchRadius = rcMax(1, (int)ceilf(mesh.maxEdgeError));
 	
-	rcIntArray edges(64);
-	rcIntArray tris(512);
-	rcIntArray arr(512);
-	rcIntArray samples(512);
-	float verts[256*3];
-	rcHeightPatch hp;
-	int nPolyVerts = 0;
 	int maxhw = 0, maxhh = 0;
 	
-	rcScopedDelete<int> bounds((int*)rcAlloc(sizeof(int)*mesh.npolys*4, RC_ALLOC_TEMP));
+	rcScopedDelete<int> bounds((int*)rcAlloc(sizeof(int)*mesh.npolys*4, RC_ALLOC_TEMP, RC_MEM_POLYMESH_DETAIL));
 	if (!bounds)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'bounds' (%d).", mesh.npolys*4);
 		return false;
 	}
-	rcScopedDelete<float> poly((float*)rcAlloc(sizeof(float)*nvp*3, RC_ALLOC_TEMP));
-	if (!poly)
+	rcScopedDelete<int> results((int*)rcAlloc(sizeof(int)*mesh.npolys*5, RC_ALLOC_TEMP, RC_MEM_POLYMESH_DETAIL));
+	if (!results)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'poly' (%d).", nvp*3);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'results' (%d).", mesh.npolys*5);
 		return false;
 	}
 	
@@ -1226,7 +1529,6 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 			xmax = rcMax(xmax, (int)v[0]);
 			ymin = rcMin(ymin, (int)v[2]);
 			ymax = rcMax(ymax, (int)v[2]);
-			nPolyVerts++;
 		}
 		xmin = rcMax(0,xmin-1);
 		xmax = rcMin(chf.width,xmax+1);
@@ -1237,150 +1539,147 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		maxhh = rcMax(maxhh, ymax-ymin);
 	}
 	
-	hp.data = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxhw*maxhh, RC_ALLOC_TEMP);
-	if (!hp.data)
+	const int nworkers = ctx->getWorkerCount();
+	rcScopedDelete<rcDetailScratch> scratch((rcDetailScratch*)rcAlloc(sizeof(rcDetailScratch)*nworkers, RC_ALLOC_TEMP, RC_MEM_POLYMESH_DETAIL));
+	if (!scratch)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'hp.data' (%d).", maxhw*maxhh);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'scratch' (%d).", nworkers);
 		return false;
 	}
+	for (int i = 0; i < nworkers; ++i)
+		new(&scratch[i]) rcDetailScratch;
+	for (int i = 0; i < nworkers; ++i)
+	{
+		rcDetailScratch* ds = &scratch[i];
+		ds->hp.data = (unsigned short*)rcAlloc(sizeof(unsigned short)*rcMax(maxhw*maxhh, 1), RC_ALLOC_TEMP, RC_MEM_POLYMESH_DETAIL);
+		if (!ds->hp.data)
+		{
+			freeDetailScratch(scratch, nworkers);
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'hp.data' (%d).", maxhw*maxhh);
+			return false;
+		}
+		ds->poly = (float*)rcAlloc(sizeof(float)*nvp*3, RC_ALLOC_TEMP, RC_MEM_POLYMESH_DETAIL);
+		if (!ds->poly)
+		{
+			freeDetailScratch(scratch, nworkers);
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'poly' (%d).", nvp*3);
+			return false;
+		}
+	}
+	
+	// Build the detail meshes of the polygons.
+	rcDetailTask task;
+	task.mesh = &mesh;
+	task.chf = &chf;
+	task.bounds = bounds;
+	task.sampleDist = sampleDist;
+	task.sampleMaxError = sampleMaxError;
+	task.heightSearchRadius = heightSearchRadius;
+	task.scratch = scratch;
+	task.results = results;
+	ctx->runParallel(task, mesh.npolys);
+	
+	// Pass on the messages logged by the workers in polygon order.
+	// Report the failure of the first polygon, like a serial build would.
+	int nentries = 0;
+	const rcDetailScratch* failed = 0;
+	for (int i = 0; i < nworkers; ++i)
+	{
+		nentries += scratch[i].log.entries.size()/4;
+		if (scratch[i].error && (!failed || scratch[i].errorPoly < failed->errorPoly))
+			failed = &scratch[i];
+	}
+	if (nentries > 0)
+	{
+		rcScopedDelete<rcDetailLogEntry> entries((rcDetailLogEntry*)rcAlloc(sizeof(rcDetailLogEntry)*nentries, RC_ALLOC_TEMP, RC_MEM_POLYMESH_DETAIL));
+		if (entries)
+		{
+			for (int i = 0, n = 0; i < nworkers; ++i)
+			{
+				for (int j = 0, nj = scratch[i].log.entries.size()/4; j < nj; ++j, ++n)
+				{
+					entries[n].poly = scratch[i].log.entries[j*4+0];
+					entries[n].worker = i;
+					entries[n].index = j;
+				}
+			}
+			qsort(entries, nentries, sizeof(rcDetailLogEntry), compareDetailLogEntries);
+			for (int i = 0; i < nentries; ++i)
+			{
+				const rcDetailLogContext& log = scratch[entries[i].worker].log;
+				const int* e = &log.entries[entries[i].index*4];
+				ctx->log((rcLogCategory)e[1], "%s", log.getText(e[2]));
+			}
+		}
+	}
+	if (failed)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: %s of polygon %d.", failed->error, failed->errorPoly);
+		freeDetailScratch(scratch, nworkers);
+		return false;
+	}
+	
+	// Concatenate the detail meshes.
+	int nverts = 0;
+	int ntris = 0;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		nverts += results[i*5+2];
+		ntris += results[i*5+4];
+	}
 	
 	dmesh.nmeshes = mesh.npolys;
 	dmesh.nverts = 0;
 	dmesh.ntris = 0;
-	dmesh.meshes = (unsigned int*)rcAlloc(sizeof(unsigned int)*dmesh.nmeshes*4, RC_ALLOC_PERM);
+	dmesh.meshes = (unsigned int*)rcAlloc(sizeof(unsigned int)*dmesh.nmeshes*4, RC_ALLOC_PERM, RC_MEM_POLYMESH_DETAIL);
 	if (!dmesh.meshes)
 	{
+		freeDetailScratch(scratch, nworkers);
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.meshes' (%d).", dmesh.nmeshes*4);
 		return false;
 	}
-	
-	int vcap = nPolyVerts+nPolyVerts/2;
-	int tcap = vcap*2;
-	
-	dmesh.nverts = 0;
-	dmesh.verts = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
+	dmesh.verts = (float*)rcAlloc(sizeof(float)*rcMax(nverts, 1)*3, RC_ALLOC_PERM, RC_MEM_POLYMESH_DETAIL);
 	if (!dmesh.verts)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", vcap*3);
+		freeDetailScratch(scratch, nworkers);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", nverts*3);
 		return false;
 	}
-	dmesh.ntris = 0;
-	dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
+	dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*rcMax(ntris, 1)*4, RC_ALLOC_PERM, RC_MEM_POLYMESH_DETAIL);
 	if (!dmesh.tris)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", tcap*4);
+		freeDetailScratch(scratch, nworkers);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", ntris*4);
 		return false;
 	}
 	
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		const unsigned short* p = &mesh.polys[i*nvp*2];
-		
-		// Store polygon vertices for processing.
-		int npoly = 0;
-		for (int j = 0; j < nvp; ++j)
-		{
-			if(p[j] == RC_MESH_NULL_IDX) break;
-			const unsigned short* v = &mesh.verts[p[j]*3];
-			poly[j*3+0] = v[0]*cs;
-			poly[j*3+1] = v[1]*ch;
-			poly[j*3+2] = v[2]*cs;
-			npoly++;
-		}
-		
-		// Get the height data from the area of the polygon.
-		hp.xmin = bounds[i*4+0];
-		hp.ymin = bounds[i*4+2];
-		hp.width = bounds[i*4+1]-bounds[i*4+0];
-		hp.height = bounds[i*4+3]-bounds[i*4+2];
-		getHeightData(ctx, chf, p, npoly, mesh.verts, borderSize, hp, arr, mesh.regs[i]);
-		
-		// Build detail mesh.
-		int nverts = 0;
-		if (!buildPolyDetail(ctx, poly, npoly,
-							 sampleDist, sampleMaxError,
-							 heightSearchRadius, chf, hp,
-							 verts, nverts, tris,
-							 edges, samples))
-		{
-			return false;
-		}
-		
-		// Move detail verts to world space.
-		for (int j = 0; j < nverts; ++j)
-		{
-			verts[j*3+0] += orig[0];
-			verts[j*3+1] += orig[1] + chf.ch; // Is this offset necessary?
-			verts[j*3+2] += orig[2];
-		}
-		// Offset poly too, will be used to flag checking.
-		for (int j = 0; j < npoly; ++j)
-		{
-			poly[j*3+0] += orig[0];
-			poly[j*3+1] += orig[1];
-			poly[j*3+2] += orig[2];
-		}
-		
-		// Store detail submesh.
-		const int ntris = tris.size()/4;
+		const int* res = &results[i*5];
+		const rcDetailScratch& ds = scratch[res[0]];
 		
 		dmesh.meshes[i*4+0] = (unsigned int)dmesh.nverts;
-		dmesh.meshes[i*4+1] = (unsigned int)nverts;
+		dmesh.meshes[i*4+1] = (unsigned int)res[2];
 		dmesh.meshes[i*4+2] = (unsigned int)dmesh.ntris;
-		dmesh.meshes[i*4+3] = (unsigned int)ntris;
+		dmesh.meshes[i*4+3] = (unsigned int)res[4];
 		
-		// Store vertices, allocate more memory if necessary.
-		if (dmesh.nverts+nverts > vcap)
-		{
-			while (dmesh.nverts+nverts > vcap)
-				vcap += 256;
-			
-			float* newv = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
-			if (!newv)
-			{
-				ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'newv' (%d).", vcap*3);
-				return false;
-			}
-			if (dmesh.nverts)
-				memcpy(newv, dmesh.verts, sizeof(float)*3*dmesh.nverts);
-			rcFree(dmesh.verts);
-			dmesh.verts = newv;
-		}
-		for (int j = 0; j < nverts; ++j)
-		{
-			dmesh.verts[dmesh.nverts*3+0] = verts[j*3+0];
-			dmesh.verts[dmesh.nverts*3+1] = verts[j*3+1];
-			dmesh.verts[dmesh.nverts*3+2] = verts[j*3+2];
-			dmesh.nverts++;
-		}
+		if (res[2])
+			memcpy(&dmesh.verts[dmesh.nverts*3], &ds.verts[res[1]*3], sizeof(float)*3*res[2]);
+		dmesh.nverts += res[2];
 		
-		// Store triangles, allocate more memory if necessary.
-		if (dmesh.ntris+ntris > tcap)
-		{
-			while (dmesh.ntris+ntris > tcap)
-				tcap += 256;
-			unsigned char* newt = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
-			if (!newt)
-			{
-				ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'newt' (%d).", tcap*4);
-				return false;
-			}
-			if (dmesh.ntris)
-				memcpy(newt, dmesh.tris, sizeof(unsigned char)*4*dmesh.ntris);
-			rcFree(dmesh.tris);
-			dmesh.tris = newt;
-		}
-		for (int j = 0; j < ntris; ++j)
+		for (int j = 0; j < res[4]; ++j)
 		{
-			const int* t = &tris[j*4];
+			const int* t = &ds.dtris[(res[3]+j)*4];
 			dmesh.tris[dmesh.ntris*4+0] = (unsigned char)t[0];
 			dmesh.tris[dmesh.ntris*4+1] = (unsigned char)t[1];
 			dmesh.tris[dmesh.ntris*4+2] = (unsigned char)t[2];
-			dmesh.tris[dmesh.ntris*4+3] = getTriFlags(&verts[t[0]*3], &verts[t[1]*3], &verts[t[2]*3], poly, npoly);
+			dmesh.tris[dmesh.ntris*4+3] = (unsigned char)t[3];
 			dmesh.ntris++;
 		}
 	}
 	
+	freeDetailScratch(scratch, nworkers);
+	
 	return true;
 }
 
@@ -1404,7 +1703,7 @@ bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int
 	}
 	
 	mesh.nmeshes = 0;
-	mesh.meshes = (unsigned int*)rcAlloc(sizeof(unsigned int)*maxMeshes*4, RC_ALLOC_PERM);
+	mesh.meshes = (unsigned int*)rcAlloc(sizeof(unsigned int)*maxMeshes*4, RC_ALLOC_PERM, RC_MEM_POLYMESH_DETAIL);
 	if (!mesh.meshes)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'pmdtl.meshes' (%d).", maxMeshes*4);
@@ -1412,7 +1711,7 @@ bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int
 	}
 	
 	mesh.ntris = 0;
-	mesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris*4, RC_ALLOC_PERM);
+	mesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris*4, RC_ALLOC_PERM, RC_MEM_POLYMESH_DETAIL);
 	if (!mesh.tris)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", maxTris*4);
@@ -1420,7 +1719,7 @@ bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int
 	}
 	
 	mesh.nverts = 0;
-	mesh.verts = (float*)rcAlloc(sizeof(float)*maxVerts*3, RC_ALLOC_PERM);
+	mesh.verts = (float*)rcAlloc(sizeof(float)*maxVerts*3, RC_ALLOC_PERM, RC_MEM_POLYMESH_DETAIL);
 	if (!mesh.verts)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", maxVerts*3);
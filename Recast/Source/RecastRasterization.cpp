@@ -17,8 +17,10 @@
 //
 
 #define _USE_MATH_DEFINES
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
@@ -48,7 +50,7 @@ static rcSpan* allocSpan(rcHeightfield& hf)
 	{
 		// Create new page.
 		// Allocate memory for the new pool.
-		rcSpanPool* pool = (rcSpanPool*)rcAlloc(sizeof(rcSpanPool), RC_ALLOC_PERM);
+		rcSpanPool* pool = (rcSpanPool*)rcAlloc(sizeof(rcSpanPool), RC_ALLOC_PERM, RC_MEM_HEIGHTFIELD);
 		if (!pool) return 0;
 
 		// Add the pool into the list of pools.
@@ -82,14 +84,47 @@ static void freeSpan(rcHeightfield& hf, rcSpan* ptr)
 	hf.freelist = ptr;
 }
 
-static bool addSpan(rcHeightfield& hf, const int x, const int y,
-					const unsigned short smin, const unsigned short smax,
-					const unsigned char area, const int flagMergeThr)
+// Takes a span from the reserved spans, or from the heightfield if there are no reserved spans.
+inline rcSpan* takeSpan(rcHeightfield& hf, rcReservedSpans* reserved)
+{
+	if (!reserved)
+		return allocSpan(hf);
+	if (reserved->freelist)
+	{
+		rcSpan* s = reserved->freelist;
+		reserved->freelist = s->next;
+		return s;
+	}
+	if (reserved->pool && reserved->used == RC_SPANS_PER_POOL)
+	{
+		reserved->npools--;
+		reserved->pool = reserved->npools > 0 ? reserved->pool->next : 0;
+		reserved->used = 0;
+	}
+	if (!reserved->pool)
+		return 0;
+	return &reserved->pool->items[reserved->used++];
+}
+
+inline void returnSpan(rcHeightfield& hf, rcReservedSpans* reserved, rcSpan* ptr)
+{
+	if (!reserved)
+	{
+		freeSpan(hf, ptr);
+		return;
+	}
+	ptr->next = reserved->freelist;
+	reserved->freelist = ptr;
+}
+
+static bool insertSpan(rcHeightfield& hf, rcReservedSpans* reserved, const int x, const int y,
+					   const unsigned short smin, const unsigned short smax,
+					   const unsigned char area, const int flagMergeThr)
 {
 	
 	int idx = x + y*hf.width;
 	
-	rcSpan* s = allocSpan(hf);
+	rcSpan* s = takeSpan(hf, reserved);
 	if (!s)
 		return false;
 	s->smin = smin;
@@ -134,7 +169,7 @@ static bool addSpan(rcHeightfield& hf, const int x, const int y,
 			
 			// Remove current span.
 			rcSpan* next = cur->next;
-			freeSpan(hf, cur);
+			returnSpan(hf, reserved, cur);
 			if (prev)
 				prev->next = next;
 			else
@@ -158,6 +193,13 @@ static bool addSpan(rcHeightfield& hf, const int x, const int y,
 	return true;
 }
 
+inline bool addSpan(rcHeightfield& hf, const int x, const int y,
+					const unsigned short smin, const unsigned short smax,
+					const unsigned char area, const int flagMergeThr)
+{
+	return insertSpan(hf, 0, x, y, smin, smax, area, flagMergeThr);
+}
+
 /// @par
 ///
 /// The span addition can be set to favor flags. If the span is merged to
@@ -180,6 +222,167 @@ bool rcAddSpan(rcContext* ctx, rcHeightfield& hf, const int x, const int y,
 	return true;
 }
 
+static bool addSpanColumn(rcHeightfield& hf, rcReservedSpans* reserved, const int x, const int y,
+						  const unsigned short* smin, const unsigned short* smax,
+						  const unsigned char* areas, const int count, const int flagMergeThr)
+{
+	const int idx = x + y*hf.width;
+	int i = 0;
+
+	// Sorted spans can only merge with the top span of the column,
+	// append them to an empty column without walking the span list.
+	if (!hf.spans[idx])
+	{
+		rcSpan* top = 0;
+		for (; i < count; ++i)
+		{
+			// Compare the heights as stored in the span.
+			const unsigned int lo = smin[i] & RC_SPAN_MAX_HEIGHT;
+			const unsigned int hi = smax[i] & RC_SPAN_MAX_HEIGHT;
+			if (lo > hi || (top && lo < top->smin))
+			{
+				// Not sorted, add the rest of the spans one by one.
+				break;
+			}
+
+			if (top && lo <= top->smax)
+			{
+				// Merge spans.
+				const unsigned int merged = rcMax(hi, (unsigned int)top->smax);
+				unsigned char area = areas[i];
+				if (rcAbs((int)merged - (int)top->smax) <= flagMergeThr)
+					area = rcMax(area, (unsigned char)top->area);
+				top->smax = merged;
+				top->area = area;
+				continue;
+			}
+
+			rcSpan* s = takeSpan(hf, reserved);
+			if (!s)
+				return false;
+			s->smin = lo;
+			s->smax = hi;
+			s->area = areas[i];
+			s->next = 0;
+			if (top)
+				top->next = s;
+			else
+				hf.spans[idx] = s;
+			top = s;
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		if (!insertSpan(hf, reserved, x, y, smin[i], smax[i], areas[i], flagMergeThr))
+			return false;
+	}
+
+	return true;
+}
+
+/// @par
+///
+/// Spans that touch or overlap the span below them are merged the same way
+/// as in #rcAddSpan. When the column already contains spans, or the spans are
+/// not sorted by their minimum height, the spans are added one by one.
+///
+/// @see rcAddSpan, rcAddReservedSpanColumn, rcHeightfield, rcSpan.
+bool rcAddSpanColumn(rcContext* ctx, rcHeightfield& hf, const int x, const int y,
+					 const unsigned short* smin, const unsigned short* smax,
+					 const unsigned char* areas, const int count, const int flagMergeThr)
+{
+	rcAssert(ctx);
+
+	if (!addSpanColumn(hf, 0, x, y, smin, smax, areas, count, flagMergeThr))
+	{
+		ctx->log(RC_LOG_ERROR, "rcAddSpanColumn: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+/// @par
+///
+/// The free spans of the heightfield are reserved first, the rest are reserved
+/// as whole span pools. The spans of the new pools are not touched until they
+/// are used, so that the threads adding the columns initialize their own spans.
+///
+/// @see rcReleaseSpans, rcAddReservedSpanColumn
+bool rcReserveSpans(rcContext* ctx, rcHeightfield& hf, const int count, rcReservedSpans& spans)
+{
+	rcAssert(ctx);
+
+	memset(&spans, 0, sizeof(spans));
+
+	// Take the spans of the free list.
+	int n = 0;
+	rcSpan** tail = &spans.freelist;
+	while (n < count && hf.freelist)
+	{
+		*tail = hf.freelist;
+		tail = &hf.freelist->next;
+		hf.freelist = hf.freelist->next;
+		n++;
+	}
+	*tail = 0;
+
+	// Reserve new pools for the rest.
+	for (; n < count; n += RC_SPANS_PER_POOL)
+	{
+		rcSpanPool* pool = (rcSpanPool*)rcAlloc(sizeof(rcSpanPool), RC_ALLOC_PERM, RC_MEM_HEIGHTFIELD);
+		if (!pool)
+		{
+			rcReleaseSpans(hf, spans);
+			ctx->log(RC_LOG_ERROR, "rcReserveSpans: Out of memory (%d).", count);
+			return false;
+		}
+		pool->next = hf.pools;
+		hf.pools = pool;
+		spans.pool = pool;
+		spans.npools++;
+	}
+
+	return true;
+}
+
+void rcReleaseSpans(rcHeightfield& hf, rcReservedSpans& spans)
+{
+	// Return the unused spans of the pools to the free list.
+	rcSpanPool* pool = spans.pool;
+	for (int i = 0; i < spans.npools && pool; ++i, pool = pool->next)
+	{
+		const int first = i == 0 ? spans.used : 0;
+		for (int j = RC_SPANS_PER_POOL-1; j >= first; --j)
+			freeSpan(hf, &pool->items[j]);
+	}
+
+	while (spans.freelist)
+	{
+		rcSpan* next = spans.freelist->next;
+		freeSpan(hf, spans.freelist);
+		spans.freelist = next;
+	}
+
+	memset(&spans, 0, sizeof(spans));
+}
+
+/// @par
+///
+/// The spans are taken from, and merged spans returned to, the reserved spans
+/// instead of the free list of the heightfield. Columns can be added to the
+/// same heightfield from several threads, as long as each thread adds
+/// distinct columns using its own reserved spans.
+///
+/// @see rcAddSpanColumn, rcReserveSpans
+bool rcAddReservedSpanColumn(rcHeightfield& hf, rcReservedSpans& spans, const int x, const int y,
+							 const unsigned short* smin, const unsigned short* smax,
+							 const unsigned char* areas, const int count, const int flagMergeThr)
+{
+	return addSpanColumn(hf, &spans, x, y, smin, smax, areas, count, flagMergeThr);
+}
+
 // divides a convex polygons into two convex polygons on both sides of a line
 static void dividePoly(const float* in, int nin,
 					  float* out1, int* nout1,
@@ -238,14 +441,18 @@ static void dividePoly(const float* in, int nin,
 
 
 
+// Rasterizes the triangle into the columns within the clip rectangle [(minx, miny, maxx, maxy)].
+// The triangle is clipped row by row from its first row regardless of the clip rectangle,
+// so the spans are bit-exact with the ones of an unclipped rasterization.
+// The grid has h rows, the heightfield may hold only the rows starting at row yoff.
 static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 						 const unsigned char area, rcHeightfield& hf,
 						 const float* bmin, const float* bmax,
 						 const float cs, const float ics, const float ich,
-						 const int flagMergeThr)
+						 const int flagMergeThr, const int* clip,
+						 const int h, const int yoff)
 {
 	const int w = hf.width;
-	const int h = hf.height;
 	float tmin[3], tmax[3];
 	const float by = bmax[1] - bmin[1];
 	
@@ -266,6 +473,8 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 	int y1 = (int)((tmax[2] - bmin[2])*ics);
 	y0 = rcClamp(y0, 0, h-1);
 	y1 = rcClamp(y1, 0, h-1);
+	if (clip)
+		y1 = rcMin(y1, clip[3]);
 	
 	// Clip the triangle into all grid cells it touches.
 	float buf[7*3*4];
@@ -283,6 +492,7 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 		dividePoly(in, nvIn, inrow, &nvrow, p1, &nvIn, cz+cs, 2);
 		rcSwap(in, p1);
 		if (nvrow < 3) continue;
+		if (clip && y < clip[1]) continue;
 		
 		// find the horizontal bounds in the row
 		float minX = inrow[0], maxX = inrow[0];
@@ -295,6 +505,8 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 		int x1 = (int)((maxX - bmin[0])*ics);
 		x0 = rcClamp(x0, 0, w-1);
 		x1 = rcClamp(x1, 0, w-1);
+		if (clip)
+			x1 = rcMin(x1, clip[2]);
 
 		int nv, nv2 = nvrow;
 
@@ -305,6 +517,7 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 			dividePoly(inrow, nv2, p1, &nv, p2, &nv2, cx+cs, 0);
 			rcSwap(inrow, p2);
 			if (nv < 3) continue;
+			if (clip && x < clip[0]) continue;
 			
 			// Calculate min and max of the span.
 			float smin = p1[1], smax = p1[1];
@@ -326,7 +539,7 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 			unsigned short ismin = (unsigned short)rcClamp((int)floorf(smin * ich), 0, RC_SPAN_MAX_HEIGHT);
 			unsigned short ismax = (unsigned short)rcClamp((int)ceilf(smax * ich), (int)ismin+1, RC_SPAN_MAX_HEIGHT);
 			
-			if (!addSpan(hf, x, y, ismin, ismax, area, flagMergeThr))
+			if (!addSpan(hf, x, y-yoff, ismin, ismax, area, flagMergeThr))
 				return false;
 		}
 	}
@@ -349,7 +562,7 @@ bool rcRasterizeTriangle(rcContext* ctx, const float* v0, const float* v1, const
 
 	const float ics = 1.0f/solid.cs;
 	const float ich = 1.0f/solid.ch;
-	if (!rasterizeTri(v0, v1, v2, area, solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr))
+	if (!rasterizeTri(v0, v1, v2, area, solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr, 0, solid.height, 0))
 	{
 		ctx->log(RC_LOG_ERROR, "rcRasterizeTriangle: Out of memory.");
 		return false;
@@ -380,7 +593,7 @@ bool rcRasterizeTriangles(rcContext* ctx, const float* verts, const int /*nv*/,
 		const float* v1 = &verts[tris[i*3+1]*3];
 		const float* v2 = &verts[tris[i*3+2]*3];
 		// Rasterize.
-		if (!rasterizeTri(v0, v1, v2, areas[i], solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr))
+		if (!rasterizeTri(v0, v1, v2, areas[i], solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr, 0, solid.height, 0))
 		{
 			ctx->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
 			return false;
@@ -412,7 +625,7 @@ bool rcRasterizeTriangles(rcContext* ctx, const float* verts, const int /*nv*/,
 		const float* v1 = &verts[tris[i*3+1]*3];
 		const float* v2 = &verts[tris[i*3+2]*3];
 		// Rasterize.
-		if (!rasterizeTri(v0, v1, v2, areas[i], solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr))
+		if (!rasterizeTri(v0, v1, v2, areas[i], solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr, 0, solid.height, 0))
 		{
 			ctx->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
 			return false;
@@ -443,7 +656,7 @@ bool rcRasterizeTriangles(rcContext* ctx, const float* verts, const unsigned cha
 		const float* v1 = &verts[(i*3+1)*3];
 		const float* v2 = &verts[(i*3+2)*3];
 		// Rasterize.
-		if (!rasterizeTri(v0, v1, v2, areas[i], solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr))
+		if (!rasterizeTri(v0, v1, v2, areas[i], solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr, 0, solid.height, 0))
 		{
 			ctx->log(RC_LOG_ERROR, "rcRasterizeTriangles: Out of memory.");
 			return false;
@@ -452,3 +665,783 @@ bool rcRasterizeTriangles(rcContext* ctx, const float* verts, const unsigned cha
 
 	return true;
 }
+
+// Calculates the columns a triangle may add spans to, widened by one column to cover
+// the rounding of the clipped vertices. Returns an empty rectangle (minx > maxx) for
+// triangles outside of the heightfield.
+static void calcTriColumns(const float* v0, const float* v1, const float* v2,
+						   const rcHeightfield& hf, const float ics, int* rect)
+{
+	float tmin[3], tmax[3];
+	rcVcopy(tmin, v0);
+	rcVcopy(tmax, v0);
+	rcVmin(tmin, v1);
+	rcVmin(tmin, v2);
+	rcVmax(tmax, v1);
+	rcVmax(tmax, v2);
+
+	if (!overlapBounds(hf.bmin, hf.bmax, tmin, tmax))
+	{
+		rect[0] = rect[1] = 0;
+		rect[2] = rect[3] = -1;
+		return;
+	}
+
+	rect[0] = rcClamp((int)((tmin[0] - hf.bmin[0])*ics) - 1, 0, hf.width-1);
+	rect[1] = rcClamp((int)((tmin[2] - hf.bmin[2])*ics) - 1, 0, hf.height-1);
+	rect[2] = rcClamp((int)((tmax[0] - hf.bmin[0])*ics) + 1, 0, hf.width-1);
+	rect[3] = rcClamp((int)((tmax[2] - hf.bmin[2])*ics) + 1, 0, hf.height-1);
+}
+
+static void mergeRect(int* dst, const int* src)
+{
+	if (src[0] > src[2])
+		return;
+	if (dst[0] > dst[2])
+	{
+		dst[0] = src[0]; dst[1] = src[1];
+		dst[2] = src[2]; dst[3] = src[3];
+		return;
+	}
+	dst[0] = rcMin(dst[0], src[0]);
+	dst[1] = rcMin(dst[1], src[1]);
+	dst[2] = rcMax(dst[2], src[2]);
+	dst[3] = rcMax(dst[3], src[3]);
+}
+
+inline bool overlapRect(const int* a, const int* b)
+{
+	return a[0] <= a[2] && a[0] <= b[2] && a[2] >= b[0] && a[1] <= b[3] && a[3] >= b[1];
+}
+
+static bool reserveSources(rcHeightfieldSources& sources, const int nt)
+{
+	if (nt <= sources.maxTris)
+		return true;
+	int* bounds = (int*)rcAlloc(sizeof(int)*4*nt, RC_ALLOC_PERM, RC_MEM_HEIGHTFIELD);
+	if (!bounds)
+		return false;
+	if (sources.ntris)
+		memcpy(bounds, sources.bounds, sizeof(int)*4*sources.ntris);
+	rcFree(sources.bounds);
+	sources.bounds = bounds;
+	sources.maxTris = nt;
+	return true;
+}
+
+/// @par
+///
+/// Rasterizes the triangles like #rcRasterizeTriangles, and records the columns
+/// each of them touches in @p sources, replacing any previously tracked triangles.
+/// Triangles whose first vertex index is negative are empty slots and are skipped.
+///
+/// @see rcHeightfield, rcHeightfieldSources, rcUpdateRasterizedTriangles
+bool rcRasterizeTrianglesTracked(rcContext* ctx, const float* verts, const int /*nv*/,
+								 const int* tris, const unsigned char* areas, const int nt,
+								 rcHeightfield& solid, rcHeightfieldSources& sources,
+								 const int flagMergeThr)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	sources.ntris = 0;
+	if (!reserveSources(sources, nt))
+	{
+		ctx->log(RC_LOG_ERROR, "rcRasterizeTrianglesTracked: Out of memory 'bounds' (%d).", nt);
+		return false;
+	}
+
+	const float ics = 1.0f/solid.cs;
+	const float ich = 1.0f/solid.ch;
+	for (int i = 0; i < nt; ++i)
+	{
+		int* rect = &sources.bounds[i*4];
+		if (tris[i*3+0] < 0)
+		{
+			rect[0] = rect[1] = 0;
+			rect[2] = rect[3] = -1;
+			continue;
+		}
+		const float* v0 = &verts[tris[i*3+0]*3];
+		const float* v1 = &verts[tris[i*3+1]*3];
+		const float* v2 = &verts[tris[i*3+2]*3];
+		calcTriColumns(v0, v1, v2, solid, ics, rect);
+		if (!rasterizeTri(v0, v1, v2, areas[i], solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr, 0, solid.height, 0))
+		{
+			ctx->log(RC_LOG_ERROR, "rcRasterizeTrianglesTracked: Out of memory.");
+			return false;
+		}
+	}
+	sources.ntris = nt;
+
+	return true;
+}
+
+/// @par
+///
+/// The triangles are identified by their index, so a triangle keeps its index when
+/// the mesh is edited. Triangles with an index past the previously tracked count are
+/// added, and the triangles past @p nt are removed. A triangle can also be removed without
+/// renumbering the others by setting its first vertex index to -1 and listing it as changed.
+///
+/// All the spans of the columns the changed triangles touched before or touch after
+/// the change are discarded, and the columns are rasterized again from all the triangles
+/// overlapping them, in index order. The result is identical to a rasterization of the
+/// whole mesh with #rcRasterizeTrianglesTracked, as long as the heightfield only contains
+/// spans of the tracked triangles.
+///
+/// The filters are not idempotent, so they must be run again on the returned rectangle
+/// only, using the rectangle overloads of #rcFilterLowHangingWalkableObstacles,
+/// #rcFilterLedgeSpans and #rcFilterWalkableLowHeightSpans. The rectangle includes a
+/// one column halo around the changed columns, since the ledge filter of a column
+/// depends on its neighbours. The later build stages should be rerun for the area of the
+/// rectangle, plus the halo they need, e.g. by rebuilding the tiles it overlaps.
+///
+/// @see rcHeightfield, rcHeightfieldSources, rcRasterizeTrianglesTracked
+bool rcUpdateRasterizedTriangles(rcContext* ctx, const float* verts, const int /*nv*/,
+								 const int* tris, const unsigned char* areas, const int nt,
+								 const int* changed, const int nchanged,
+								 rcHeightfield& solid, rcHeightfieldSources& sources,
+								 int* dirty, const int flagMergeThr)
+{
+	rcAssert(ctx);
+	rcAssert(dirty);
+
+	rcScopedTimer timer(ctx, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const int w = solid.width;
+	const int h = solid.height;
+	const float ics = 1.0f/solid.cs;
+	const float ich = 1.0f/solid.ch;
+	const int oldCount = sources.ntris;
+
+	dirty[0] = dirty[1] = 0;
+	dirty[2] = dirty[3] = -1;
+
+	if (!reserveSources(sources, nt))
+	{
+		ctx->log(RC_LOG_ERROR, "rcUpdateRasterizedTriangles: Out of memory 'bounds' (%d).", nt);
+		return false;
+	}
+
+	// Collect the columns of the removed triangles.
+	for (int i = nt; i < oldCount; ++i)
+		mergeRect(dirty, &sources.bounds[i*4]);
+
+	// Collect the old and new columns of the changed and added triangles.
+	for (int i = 0; i < nchanged + rcMax(0, nt - oldCount); ++i)
+	{
+		const int j = i < nchanged ? changed[i] : oldCount + (i - nchanged);
+		if (j < 0 || j >= nt)
+			continue;
+		int* rect = &sources.bounds[j*4];
+		if (j < oldCount)
+			mergeRect(dirty, rect);
+		if (tris[j*3+0] < 0)
+		{
+			rect[0] = rect[1] = 0;
+			rect[2] = rect[3] = -1;
+			continue;
+		}
+		calcTriColumns(&verts[tris[j*3+0]*3], &verts[tris[j*3+1]*3], &verts[tris[j*3+2]*3], solid, ics, rect);
+		mergeRect(dirty, rect);
+	}
+	sources.ntris = nt;
+
+	if (dirty[0] > dirty[2])
+		return true;
+
+	// Add the halo needed by the ledge filter.
+	dirty[0] = rcMax(dirty[0] - 1, 0);
+	dirty[1] = rcMax(dirty[1] - 1, 0);
+	dirty[2] = rcMin(dirty[2] + 1, w-1);
+	dirty[3] = rcMin(dirty[3] + 1, h-1);
+
+	// Discard the spans of the dirty columns.
+	for (int y = dirty[1]; y <= dirty[3]; ++y)
+	{
+		for (int x = dirty[0]; x <= dirty[2]; ++x)
+		{
+			rcSpan* s = solid.spans[x + y*w];
+			while (s)
+			{
+				rcSpan* next = s->next;
+				freeSpan(solid, s);
+				s = next;
+			}
+			solid.spans[x + y*w] = 0;
+		}
+	}
+
+	// Rasterize the dirty columns again.
+	for (int i = 0; i < nt; ++i)
+	{
+		if (tris[i*3+0] < 0 || !overlapRect(&sources.bounds[i*4], dirty))
+			continue;
+		const float* v0 = &verts[tris[i*3+0]*3];
+		const float* v1 = &verts[tris[i*3+1]*3];
+		const float* v2 = &verts[tris[i*3+2]*3];
+		if (!rasterizeTri(v0, v1, v2, areas[i], solid, solid.bmin, solid.bmax, solid.cs, ics, ich, flagMergeThr, dirty, solid.height, 0))
+		{
+			ctx->log(RC_LOG_ERROR, "rcUpdateRasterizedTriangles: Out of memory.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Calculates the rows of the grid a triangle may add spans to. Returns false if the
+// triangle is outside of the bounds.
+static bool calcTriRows(const float* v0, const float* v1, const float* v2,
+						const float* bmin, const float* bmax, const float ics, const int h,
+						int& y0, int& y1)
+{
+	float tmin[3], tmax[3];
+	rcVcopy(tmin, v0);
+	rcVcopy(tmax, v0);
+	rcVmin(tmin, v1);
+	rcVmin(tmin, v2);
+	rcVmax(tmax, v1);
+	rcVmax(tmax, v2);
+	if (!overlapBounds(bmin, bmax, tmin, tmax))
+		return false;
+	y0 = rcClamp((int)((tmin[2] - bmin[2])*ics), 0, h-1);
+	y1 = rcClamp((int)((tmax[2] - bmin[2])*ics), 0, h-1);
+	return true;
+}
+
+// Resizes the span storage of a compact heightfield to hold count spans, keeping the spans
+// it already has. The storage grows by half of its size at least.
+static bool reserveCompactSpans(rcCompactHeightfield& chf, int& capacity, const int count, const bool exact)
+{
+	if (exact ? count == capacity : count <= capacity)
+		return true;
+	const int newCapacity = exact ? count : rcMax(count, capacity + capacity/2);
+	rcCompactSpan* spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan)*newCapacity, RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+	unsigned char* areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*newCapacity, RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+	if (!spans || !areas)
+	{
+		rcFree(spans);
+		rcFree(areas);
+		return false;
+	}
+	if (chf.spanCount)
+	{
+		memcpy(spans, chf.spans, sizeof(rcCompactSpan)*chf.spanCount);
+		memcpy(areas, chf.areas, sizeof(unsigned char)*chf.spanCount);
+	}
+	rcFree(chf.spans);
+	rcFree(chf.areas);
+	chf.spans = spans;
+	chf.areas = areas;
+	capacity = newCapacity;
+	return true;
+}
+
+// Rasterizes, filters and compacts the strips of rows of the grid one after the other,
+// appending the spans of each strip to the compact heightfield.
+static bool rasterizeStrips(rcContext* ctx, const rcConfig& cfg, const float* verts,
+							const int* tris, const unsigned char* areas, const int stripRows,
+							const int* stripFirst, const int* stripTris,
+							rcCompactHeightfield& chf, int& capacity)
+{
+	const int w = cfg.width;
+	const int h = cfg.height;
+	const float ics = 1.0f/cfg.cs;
+	const float ich = 1.0f/cfg.ch;
+	const int nstrips = (h + stripRows-1) / stripRows;
+	
+	// The strip heightfield holds the rows of a strip and its extra rows.
+	rcHeightfield strip;
+	if (!rcCreateHeightfield(ctx, strip, w, stripRows+2, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfieldStreamed: Out of memory 'strip' (%d).", w*(stripRows+2));
+		return false;
+	}
+	
+	const int MAX_HEIGHT = 0xffff;
+	
+	for (int s = 0; s < nstrips; ++s)
+	{
+		const int sy0 = s*stripRows;
+		const int sy1 = rcMin(sy0 + stripRows, h) - 1;
+		const int hy0 = rcMax(sy0-1, 0);
+		const int hy1 = rcMin(sy1+1, h-1);
+		strip.height = hy1 - hy0 + 1;
+		
+		ctx->startTimer(RC_TIMER_RASTERIZE_TRIANGLES);
+		const int clip[4] = { 0, hy0, w-1, hy1 };
+		for (int j = stripFirst[s]; j < stripFirst[s+1]; ++j)
+		{
+			const int i = stripTris[j];
+			const float* v0 = &verts[tris[i*3+0]*3];
+			const float* v1 = &verts[tris[i*3+1]*3];
+			const float* v2 = &verts[tris[i*3+2]*3];
+			if (!rasterizeTri(v0, v1, v2, areas[i], strip, cfg.bmin, cfg.bmax, cfg.cs, ics, ich, cfg.walkableClimb, clip, h, hy0))
+			{
+				ctx->stopTimer(RC_TIMER_RASTERIZE_TRIANGLES);
+				ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfieldStreamed: Out of memory.");
+				return false;
+			}
+		}
+		ctx->stopTimer(RC_TIMER_RASTERIZE_TRIANGLES);
+		
+		// The extra rows are not filtered, the ledge filter only needs their spans.
+		const int rect[4] = { 0, sy0-hy0, w-1, sy1-hy0 };
+		rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, strip, rect);
+		rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, strip, rect);
+		rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, strip, rect);
+		
+		ctx->startTimer(RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+		
+		// Append the walkable spans of the strip rows.
+		int count = chf.spanCount;
+		for (int y = rect[1]; y <= rect[3]; ++y)
+		{
+			for (int x = 0; x < w; ++x)
+			{
+				for (const rcSpan* span = strip.spans[x + y*w]; span; span = span->next)
+				{
+					if (span->area != RC_NULL_AREA)
+						count++;
+				}
+			}
+		}
+		if (!reserveCompactSpans(chf, capacity, count, false))
+		{
+			ctx->stopTimer(RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+			ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfieldStreamed: Out of memory 'chf.spans' (%d)", count);
+			return false;
+		}
+		
+		if (count > chf.spanCount)
+			memset(&chf.spans[chf.spanCount], 0, sizeof(rcCompactSpan)*(count - chf.spanCount));
+		
+		int idx = chf.spanCount;
+		for (int y = rect[1]; y <= rect[3]; ++y)
+		{
+			for (int x = 0; x < w; ++x)
+			{
+				const rcSpan* span = strip.spans[x + y*w];
+				// If there are no spans at this cell, just leave the data to index=0, count=0.
+				if (!span) continue;
+				rcCompactCell& c = chf.cells[x + (hy0+y)*w];
+				c.index = idx;
+				c.count = 0;
+				for (; span; span = span->next)
+				{
+					if (span->area != RC_NULL_AREA)
+					{
+						const int bot = (int)span->smax;
+						const int top = span->next ? (int)span->next->smin : MAX_HEIGHT;
+						chf.spans[idx].y = (unsigned short)rcClamp(bot, 0, 0xffff);
+						chf.spans[idx].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
+						chf.areas[idx] = span->area;
+						idx++;
+						c.count++;
+					}
+				}
+			}
+		}
+		chf.spanCount = idx;
+		
+		ctx->stopTimer(RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+		
+		// Release the spans of the strip for the next one.
+		for (int i = 0; i < w*strip.height; ++i)
+		{
+			rcSpan* span = strip.spans[i];
+			while (span)
+			{
+				rcSpan* next = span->next;
+				freeSpan(strip, span);
+				span = next;
+			}
+			strip.spans[i] = 0;
+		}
+	}
+	
+	return true;
+}
+
+/// @par
+///
+/// Produces the same compact heightfield as rasterizing the triangles with #rcRasterizeTriangles,
+/// applying #rcFilterLowHangingWalkableObstacles, #rcFilterLedgeSpans and #rcFilterWalkableLowHeightSpans,
+/// and compacting the result with #rcBuildCompactHeightfield. The walkable climb is used as the
+/// span merge threshold.
+///
+/// Each strip is rasterized with one extra row on both sides for the ledge filter, its rows are
+/// filtered and appended to the compact heightfield, and its spans are then reused for the next 
+/// strip. The peak memory of the solid heightfield is bounded by the spans of a strip instead of 
+/// the spans of the whole grid, at the cost of clipping the triangles spanning several strips 
+/// again for each strip.
+///
+/// @see rcAllocCompactHeightfield, rcCompactHeightfield, rcConfig
+bool rcBuildCompactHeightfieldStreamed(rcContext* ctx, const rcConfig& cfg,
+									   const float* verts, const int /*nv*/,
+									   const int* tris, const unsigned char* areas, const int nt,
+									   const int stripSize, rcCompactHeightfield& chf)
+{
+	rcAssert(ctx);
+	rcAssert(stripSize > 0);
+	
+	const int w = cfg.width;
+	const int h = cfg.height;
+	const float ics = 1.0f/cfg.cs;
+	const int stripRows = rcMin(stripSize, rcMax(h, 1));
+	const int nstrips = (h + stripRows-1) / stripRows;
+	
+	// Bucket the triangles by the strips they touch, including the extra rows of the strips.
+	// The triangles stay in order within a strip so that the spans merge the same way.
+	rcScopedDelete<int> stripFirst((int*)rcAlloc(sizeof(int)*(nstrips+1), RC_ALLOC_TEMP, RC_MEM_HEIGHTFIELD));
+	if (!stripFirst)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfieldStreamed: Out of memory 'stripFirst' (%d).", nstrips+1);
+		return false;
+	}
+	memset(stripFirst, 0, sizeof(int)*(nstrips+1));
+	for (int i = 0; i < nt; ++i)
+	{
+		int y0, y1;
+		if (!calcTriRows(&verts[tris[i*3+0]*3], &verts[tris[i*3+1]*3], &verts[tris[i*3+2]*3], cfg.bmin, cfg.bmax, ics, h, y0, y1))
+			continue;
+		const int s0 = rcMax(y0-1, 0) / stripRows;
+		const int s1 = rcMin((y1+1) / stripRows, nstrips-1);
+		for (int s = s0; s <= s1; ++s)
+			stripFirst[s+1]++;
+	}
+	for (int s = 0; s < nstrips; ++s)
+		stripFirst[s+1] += stripFirst[s];
+	
+	const int nitems = stripFirst[nstrips];
+	rcScopedDelete<int> stripTris((int*)rcAlloc(sizeof(int)*rcMax(nitems, 1), RC_ALLOC_TEMP, RC_MEM_HEIGHTFIELD));
+	if (!stripTris)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfieldStreamed: Out of memory 'stripTris' (%d).", nitems);
+		return false;
+	}
+	for (int i = 0; i < nt; ++i)
+	{
+		int y0, y1;
+		if (!calcTriRows(&verts[tris[i*3+0]*3], &verts[tris[i*3+1]*3], &verts[tris[i*3+2]*3], cfg.bmin, cfg.bmax, ics, h, y0, y1))
+			continue;
+		const int s0 = rcMax(y0-1, 0) / stripRows;
+		const int s1 = rcMin((y1+1) / stripRows, nstrips-1);
+		for (int s = s0; s <= s1; ++s)
+			stripTris[stripFirst[s]++] = i;
+	}
+	// Shift the offsets back to the first triangle of each strip.
+	for (int s = nstrips; s > 0; --s)
+		stripFirst[s] = stripFirst[s-1];
+	stripFirst[0] = 0;
+	
+	// Fill in header.
+	chf.width = w;
+	chf.height = h;
+	chf.spanCount = 0;
+	chf.walkableHeight = cfg.walkableHeight;
+	chf.walkableClimb = cfg.walkableClimb;
+	chf.maxRegions = 0;
+	rcVcopy(chf.bmin, cfg.bmin);
+	rcVcopy(chf.bmax, cfg.bmax);
+	chf.bmax[1] += cfg.walkableHeight*cfg.ch;
+	chf.cs = cfg.cs;
+	chf.ch = cfg.ch;
+	chf.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell)*w*h, RC_ALLOC_PERM, RC_MEM_COMPACT_HEIGHTFIELD);
+	if (!chf.cells)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfieldStreamed: Out of memory 'chf.cells' (%d)", w*h);
+		return false;
+	}
+	memset(chf.cells, 0, sizeof(rcCompactCell)*w*h);
+	int capacity = 0;
+	
+	if (!rasterizeStrips(ctx, cfg, verts, tris, areas, stripRows, stripFirst, stripTris, chf, capacity))
+		return false;
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+	
+	// Trim the storage of the spans.
+	if (chf.spanCount > 0 && !reserveCompactSpans(chf, capacity, chf.spanCount, true))
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildCompactHeightfieldStreamed: Out of memory 'chf.spans' (%d)", chf.spanCount);
+		return false;
+	}
+	
+	return rcBuildCompactHeightfieldConnections(ctx, chf);
+}
+
+// Evaluates the height of a heightmap cell at the local coordinates (u, v), [Limits: 0 <= value <= 1].
+// The cell is split into the triangles (a, b, c) and (a, c, d) along its diagonal from a to c.
+inline float evalHeightmapCell(const float ha, const float hb, const float hc, const float hd,
+							   const float u, const float v)
+{
+	if (u >= v)
+		return ha + (hb - ha)*u + (hc - hb)*v;
+	return ha + (hc - hd)*u + (hd - ha)*v;
+}
+
+// Calculates the height range of the part of a heightmap cell within the local rectangle
+// [u0,u1]x[v0,v1]. The surface is planar on both sides of the diagonal, so the extremes are
+// at the corners of the rectangle or where the diagonal crosses its border.
+static void calcHeightmapCellRange(const float ha, const float hb, const float hc, const float hd,
+								   const float u0, const float v0, const float u1, const float v1,
+								   float& hmin, float& hmax)
+{
+	float h = evalHeightmapCell(ha, hb, hc, hd, u0, v0);
+	hmin = hmax = h;
+	h = evalHeightmapCell(ha, hb, hc, hd, u1, v0);
+	hmin = rcMin(hmin, h); hmax = rcMax(hmax, h);
+	h = evalHeightmapCell(ha, hb, hc, hd, u1, v1);
+	hmin = rcMin(hmin, h); hmax = rcMax(hmax, h);
+	h = evalHeightmapCell(ha, hb, hc, hd, u0, v1);
+	hmin = rcMin(hmin, h); hmax = rcMax(hmax, h);
+	const float t0 = rcMax(u0, v0);
+	const float t1 = rcMin(u1, v1);
+	if (t0 <= t1)
+	{
+		h = evalHeightmapCell(ha, hb, hc, hd, t0, t0);
+		hmin = rcMin(hmin, h); hmax = rcMax(hmax, h);
+		h = evalHeightmapCell(ha, hb, hc, hd, t1, t1);
+		hmin = rcMin(hmin, h); hmax = rcMax(hmax, h);
+	}
+}
+
+// Calculates the span of each column of one heightfield row covered by a heightmap.
+// Each row writes only its own columns, so the rows can be processed in parallel.
+struct rcHeightmapRowTask : public rcParallelTask
+{
+	const rcHeightfield* hf;
+	const float* heights;
+	const unsigned char* holes;
+	const unsigned char* areas;
+	int hw, hh;
+	float orig[3];
+	float spacing;
+	unsigned char area;
+	int flagMergeThr;
+	// True if the heightmap samples are at the corners of the heightfield columns.
+	bool aligned;
+	// The heightmap cell of the first heightfield column when aligned.
+	int alignX, alignZ;
+	unsigned short* smin;		// [Size: hf->width*hf->height]
+	unsigned short* smax;		// Zero if the column is not covered. [Size: hf->width*hf->height]
+	unsigned char* sarea;		// [Size: hf->width*hf->height]
+
+	inline bool isHole(const int i, const int j) const
+	{
+		return holes && holes[i + j*(hw-1)];
+	}
+
+	inline unsigned char cellArea(const int i, const int j) const
+	{
+		return areas ? areas[i + j*(hw-1)] : area;
+	}
+
+	// Snaps a height range to the heightfield height grid, returns false if outside of the heightfield.
+	inline bool snapSpan(float fmin, float fmax, unsigned short& ismin, unsigned short& ismax) const
+	{
+		const float by = hf->bmax[1] - hf->bmin[1];
+		const float ich = 1.0f/hf->ch;
+		fmin -= hf->bmin[1];
+		fmax -= hf->bmin[1];
+		if (fmax < 0.0f || fmin > by)
+			return false;
+		if (fmin < 0.0f) fmin = 0;
+		if (fmax > by) fmax = by;
+		ismin = (unsigned short)rcClamp((int)floorf(fmin * ich), 0, RC_SPAN_MAX_HEIGHT);
+		ismax = (unsigned short)rcClamp((int)ceilf(fmax * ich), (int)ismin+1, RC_SPAN_MAX_HEIGHT);
+		return true;
+	}
+
+	void runAligned(const int y)
+	{
+		const int w = hf->width;
+		const int j = y + alignZ;
+		if (j < 0 || j >= hh-1)
+			return;
+		const int x0 = rcMax(0, -alignX);
+		const int x1 = rcMin(w, hw-1 - alignX);
+		const float* row0 = &heights[j*hw];
+		const float* row1 = row0 + hw;
+		for (int x = x0; x < x1; ++x)
+		{
+			const int i = x + alignX;
+			if (isHole(i, j))
+				continue;
+			// The grids match, so the column covers the whole cell and the extremes are at its corners.
+			const float fmin = rcMin(rcMin(row0[i], row0[i+1]), rcMin(row1[i], row1[i+1])) + orig[1];
+			const float fmax = rcMax(rcMax(row0[i], row0[i+1]), rcMax(row1[i], row1[i+1])) + orig[1];
+			const int idx = x + y*w;
+			if (snapSpan(fmin, fmax, smin[idx], smax[idx]))
+				sarea[idx] = cellArea(i, j);
+		}
+	}
+
+	virtual void run(const int y, const int /*worker*/)
+	{
+		if (aligned)
+		{
+			runAligned(y);
+			return;
+		}
+
+		const int w = hf->width;
+		const float cs = hf->cs;
+		const float is = 1.0f/spacing;
+
+		// The heightmap cells overlapping the row, in heightmap units.
+		const float gz0 = (hf->bmin[2] + y*cs - orig[2])*is;
+		const float gz1 = (hf->bmin[2] + (y+1)*cs - orig[2])*is;
+		const int j0 = rcMax(0, (int)floorf(gz0));
+		const int j1 = rcMin(hh-2, (int)ceilf(gz1) - 1);
+		if (j0 > j1)
+			return;
+
+		for (int x = 0; x < w; ++x)
+		{
+			const float gx0 = (hf->bmin[0] + x*cs - orig[0])*is;
+			const float gx1 = (hf->bmin[0] + (x+1)*cs - orig[0])*is;
+			const int i0 = rcMax(0, (int)floorf(gx0));
+			const int i1 = rcMin(hw-2, (int)ceilf(gx1) - 1);
+			if (i0 > i1)
+				continue;
+
+			float fmin = FLT_MAX, fmax = -FLT_MAX;
+			bool mixed = false;
+			unsigned char carea = 0;
+			int ncells = 0;
+			for (int j = j0; j <= j1; ++j)
+			{
+				for (int i = i0; i <= i1; ++i)
+				{
+					if (isHole(i, j))
+						continue;
+					float hmin, hmax;
+					calcHeightmapCellRange(heights[i + j*hw], heights[i+1 + j*hw], heights[i+1 + (j+1)*hw], heights[i + (j+1)*hw],
+										   rcMax(gx0 - i, 0.0f), rcMax(gz0 - j, 0.0f), rcMin(gx1 - i, 1.0f), rcMin(gz1 - j, 1.0f),
+										   hmin, hmax);
+					fmin = rcMin(fmin, hmin);
+					fmax = rcMax(fmax, hmax);
+					if (ncells > 0 && cellArea(i, j) != carea)
+						mixed = true;
+					carea = cellArea(i, j);
+					ncells++;
+				}
+			}
+			if (!ncells)
+				continue;
+
+			const int idx = x + y*w;
+			if (!snapSpan(fmin + orig[1], fmax + orig[1], smin[idx], smax[idx]))
+				continue;
+
+			if (mixed)
+			{
+				// Like merged spans, favor the largest area of the cells whose top is
+				// within the merge threshold of the top of the column.
+				carea = 0;
+				for (int j = j0; j <= j1; ++j)
+				{
+					for (int i = i0; i <= i1; ++i)
+					{
+						if (isHole(i, j))
+							continue;
+						float hmin, hmax;
+						calcHeightmapCellRange(heights[i + j*hw], heights[i+1 + j*hw], heights[i+1 + (j+1)*hw], heights[i + (j+1)*hw],
+											   rcMax(gx0 - i, 0.0f), rcMax(gz0 - j, 0.0f), rcMin(gx1 - i, 1.0f), rcMin(gz1 - j, 1.0f),
+											   hmin, hmax);
+						unsigned short cmin, cmax;
+						if (snapSpan(hmin + orig[1], hmax + orig[1], cmin, cmax) &&
+							(int)smax[idx] - (int)cmax <= flagMergeThr)
+							carea = rcMax(carea, cellArea(i, j));
+					}
+				}
+			}
+			sarea[idx] = carea;
+		}
+	}
+};
+
+/// @par
+///
+/// The heightmap sample (i, j) is at (orig[0] + i * spacing, orig[1] + heights[i + j * hw], orig[2] + j * spacing),
+/// and each cell between four samples is split into two triangles along the diagonal from sample (i, j) to
+/// sample (i+1, j+1). The spans are the same as rasterizing the triangulated heightmap with #rcRasterizeTriangles,
+/// without the cost of clipping the triangles: each column gets a single span from the minimum to the maximum
+/// height of the surface within the column. Holes narrower than a column do not split its span.
+///
+/// When the heightmap samples are at the corners of the heightfield columns, each column is computed from the
+/// four corner samples only. The rows of the heightfield are processed with rcContext::runParallel.
+///
+/// @see rcHeightfield, rcRasterizeTriangles
+bool rcRasterizeHeightmap(rcContext* ctx, const float* heights, const int hw, const int hh,
+						  const float* orig, const float spacing,
+						  const unsigned char* holes, const unsigned char* areas, const unsigned char area,
+						  rcHeightfield& solid, const int flagMergeThr)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	if (hw < 2 || hh < 2)
+		return true;
+
+	const int w = solid.width;
+	const int h = solid.height;
+
+	rcScopedDelete<unsigned short> smin((unsigned short*)rcAlloc(sizeof(unsigned short)*w*h*2, RC_ALLOC_TEMP, RC_MEM_HEIGHTFIELD));
+	rcScopedDelete<unsigned char> sarea((unsigned char*)rcAlloc(sizeof(unsigned char)*w*h, RC_ALLOC_TEMP, RC_MEM_HEIGHTFIELD));
+	if (!smin || !sarea)
+	{
+		ctx->log(RC_LOG_ERROR, "rcRasterizeHeightmap: Out of memory 'columns' (%d).", w*h);
+		return false;
+	}
+	unsigned short* smax = smin + w*h;
+	memset(smax, 0, sizeof(unsigned short)*w*h);
+
+	rcHeightmapRowTask task;
+	task.hf = &solid;
+	task.heights = heights;
+	task.holes = holes;
+	task.areas = areas;
+	task.hw = hw;
+	task.hh = hh;
+	rcVcopy(task.orig, orig);
+	task.spacing = spacing;
+	task.area = area;
+	task.flagMergeThr = flagMergeThr;
+	task.smin = smin;
+	task.smax = smax;
+	task.sarea = sarea;
+
+	// Use the corner samples directly if the heightmap is on the heightfield grid.
+	const float ox = (solid.bmin[0] - orig[0])/solid.cs;
+	const float oz = (solid.bmin[2] - orig[2])/solid.cs;
+	task.alignX = (int)floorf(ox + 0.5f);
+	task.alignZ = (int)floorf(oz + 0.5f);
+	const float eps = 1e-4f;
+	task.aligned = rcAbs(spacing - solid.cs) <= eps*solid.cs && rcAbs(ox - task.alignX) <= eps && rcAbs(oz - task.alignZ) <= eps;
+
+	ctx->runParallel(task, h);
+
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const int idx = x + y*w;
+			if (!smax[idx])
+				continue;
+			if (!addSpan(solid, x, y, smin[idx], smax[idx], sarea[idx], flagMergeThr))
+			{
+				ctx->log(RC_LOG_ERROR, "rcRasterizeHeightmap: Out of memory.");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -343,68 +343,35 @@ static bool floodRegion(int x, int y, int i,
 	return count > 0;
 }
 
-static unsigned short* expandRegions(int maxIter, unsigned short level,
-									 rcCompactHeightfield& chf,
-									 unsigned short* srcReg, unsigned short* srcDist,
-									 unsigned short* dstReg, unsigned short* dstDist, 
-									 rcIntArray& stack,
-									 bool fillStack)
+// Marks a candidate span while its round is evaluated. The border bit keeps
+// the marked span from being taken as a neighbouring region.
+static const unsigned short RC_PENDING_REG = 0xffff;
+
+static void expandRegions(int maxIter, unsigned short level,
+						  rcCompactHeightfield& chf,
+						  unsigned short* srcReg, unsigned short* srcDist,
+						  rcIntArray& cands, rcIntArray& next, rcIntArray& pending)
 {
 	const int w = chf.width;
-	const int h = chf.height;
-
-	if (fillStack)
-	{
-		// Find cells revealed by the raised level.
-		stack.resize(0);
-		for (int y = 0; y < h; ++y)
-		{
-			for (int x = 0; x < w; ++x)
-			{
-				const rcCompactCell& c = chf.cells[x+y*w];
-				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
-				{
-					if (chf.dist[i] >= level && srcReg[i] == 0 && chf.areas[i] != RC_NULL_AREA)
-					{
-						stack.push(x);
-						stack.push(y);
-						stack.push(i);
-					}
-				}
-			}
-		}
-	}
-	else // use cells in the input stack
-	{
-		// mark all cells which already have a region
-		for (int j=0; j<stack.size(); j+=3)
-		{
-			int i = stack[j+2];
-			if (srcReg[i] != 0)
-				stack[j+2] = -1;
-		}
-	}
 
+	rcIntArray* cur = &cands;
+	rcIntArray* nxt = &next;
+	
 	int iter = 0;
-	while (stack.size() > 0)
+	while (cur->size() > 0)
 	{
-		int failed = 0;
+		int assigned = 0;
 		
-		memcpy(dstReg, srcReg, sizeof(unsigned short)*chf.spanCount);
-		memcpy(dstDist, srcDist, sizeof(unsigned short)*chf.spanCount);
-		
-		for (int j = 0; j < stack.size(); j += 3)
+		pending.resize(0);
+		for (int j = 0; j < cur->size(); j += 3)
 		{
-			int x = stack[j+0];
-			int y = stack[j+1];
-			int i = stack[j+2];
-			if (i < 0)
-			{
-				failed++;
+			const int x = (*cur)[j+0];
+			const int y = (*cur)[j+1];
+			const int i = (*cur)[j+2];
+			if (srcReg[i] != 0)
 				continue;
-			}
 			
-			unsigned short r = srcReg[i];
+			unsigned short r = 0;
 			unsigned short d2 = 0xffff;
 			const unsigned char area = chf.areas[i];
 			const rcCompactSpan& s = chf.spans[i];
@@ -424,23 +391,27 @@ static unsigned short* expandRegions(int maxIter, unsigned short level,
 					}
 				}
 			}
+			
+			srcReg[i] = RC_PENDING_REG;
+			pending.push(x);
+			pending.push(y);
+			pending.push(i);
+			pending.push(r);
+			pending.push(d2);
 			if (r)
-			{
-				stack[j+2] = -1; // mark as used
-				dstReg[i] = r;
-				dstDist[i] = d2;
-			}
-			else
-			{
-				failed++;
-			}
+				assigned++;
 		}
 		
-		// rcSwap source and dest.
-		rcSwap(srcReg, dstReg);
-		rcSwap(srcDist, dstDist);
+		// Commit the round, all spans of a round see the regions as they were before it.
+		for (int j = 0; j < pending.size(); j += 5)
+		{
+			const int i = pending[j+2];
+			srcReg[i] = (unsigned short)pending[j+3];
+			if (pending[j+3])
+				srcDist[i] = (unsigned short)pending[j+4];
+		}
 		
-		if (failed*3 == stack.size())
+		if (!assigned)
 			break;
 		
 		if (level > 0)
@@ -449,66 +420,266 @@ static unsigned short* expandRegions(int maxIter, unsigned short level,
 			if (iter >= maxIter)
 				break;
 		}
+		
+		// Only the neighbours of the spans assigned this round can be reached next.
+		nxt->resize(0);
+		for (int j = 0; j < pending.size(); j += 5)
+		{
+			if (!pending[j+3])
+				continue;
+			const int x = pending[j+0];
+			const int y = pending[j+1];
+			const int i = pending[j+2];
+			const unsigned char area = chf.areas[i];
+			const rcCompactSpan& s = chf.spans[i];
+			for (int dir = 0; dir < 4; ++dir)
+			{
+				if (rcGetCon(s, dir) == RC_NOT_CONNECTED) continue;
+				const int ax = x + rcGetDirOffsetX(dir);
+				const int ay = y + rcGetDirOffsetY(dir);
+				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
+				if (chf.areas[ai] != area) continue;
+				if (srcReg[ai] == 0 && chf.dist[ai] >= level)
+				{
+					nxt->push(ax);
+					nxt->push(ay);
+					nxt->push(ai);
+				}
+			}
+		}
+		rcSwap(cur, nxt);
 	}
-	
-	return srcReg;
 }
 
+// The watershed only grows regions across neighbours of the same area type,
+// so the walkable surface splits into basins that can be flooded on their own.
+// Within a basin the spans are bucketed by level once and each level is
+// processed like a level stack of the classic implementation.  The level
+// stacks were rebuilt in span order every NB_STACKS levels, left overs were
+// appended to the following stacks otherwise.  Each span of a stack remembers
+// the level step it entered the stacks at, which reproduces the stack order
+// and lets regions seeded in different basins be numbered like before.
+static const int RC_WATERSHED_LOG_NB_STACKS = 3;
+static const int RC_WATERSHED_NB_STACKS = 1 << RC_WATERSHED_LOG_NB_STACKS;
+
+struct rcWatershedScratch
+{
+	rcIntArray sorted;		// Spans of the basin by descending level (x,y,i).
+	rcIntArray count;		// Span count per level.
+	rcIntArray stack;		// Spans of the current level (x,y,i,entry step).
+	rcIntArray carried;		// Spans left over from the previous level (x,y,i,entry step).
+	rcIntArray cands;		// Expansion frontier.
+	rcIntArray next;		// Next expansion frontier.
+	rcIntArray pending;		// Expansion round results.
+	rcIntArray flood;		// Flood fill stack.
+	rcIntArray seeds;		// Regions seeded by the worker (basin,step,entry step,span).
+};
 
-
-static void sortCellsByLevel(unsigned short startLevel,
-							  rcCompactHeightfield& chf,
-							  unsigned short* srcReg,
-							  unsigned int nbStacks, rcIntArray* stacks,
-							  unsigned short loglevelsPerStack) // the levels per stack (2 in our case) as a bit shift
+struct rcWatershedSeed
 {
-	const int w = chf.width;
-	const int h = chf.height;
-	startLevel = startLevel >> loglevelsPerStack;
+	int step;		// Level step the region was seeded at.
+	int entry;		// Level step the seed span entered the stacks at.
+	int span;		// Seed span.
+	int slot;		// Index to the remap table.
+};
 
-	for (unsigned int j=0; j<nbStacks; ++j)
-		stacks[j].resize(0);
+static int compareWatershedSeeds(const void* va, const void* vb)
+{
+	const rcWatershedSeed* a = (const rcWatershedSeed*)va;
+	const rcWatershedSeed* b = (const rcWatershedSeed*)vb;
+	if (a->step != b->step)
+		return a->step < b->step ? -1 : 1;
+	if (a->entry != b->entry)
+		return a->entry > b->entry ? -1 : 1;
+	if (a->span != b->span)
+		return a->span < b->span ? -1 : 1;
+	return 0;
+}
 
-	// put all cells in the level range into the appropriate stacks
-	for (int y = 0; y < h; ++y)
+// Merges the span ordered level spans in 'stack' with the left overs.
+static void mergeStacks(rcIntArray& stack, rcIntArray& carried, rcIntArray& tmp, const int entry)
+{
+	// The left overs are few, insertion sort them into span order.
+	for (int j = 4; j < carried.size(); j += 4)
 	{
-		for (int x = 0; x < w; ++x)
+		const int x = carried[j+0], y = carried[j+1], i = carried[j+2];
+		int k = j;
+		for (; k > 0 && carried[k-4+2] > i; k -= 4)
 		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
-			{
-				if (chf.areas[i] == RC_NULL_AREA || srcReg[i] != 0)
-					continue;
-
-				int level = chf.dist[i] >> loglevelsPerStack;
-				int sId = startLevel - level;
-				if (sId >= (int)nbStacks)
-					continue;
-				if (sId < 0)
-					sId = 0;
-
-				stacks[sId].push(x);
-				stacks[sId].push(y);
-				stacks[sId].push(i);
-			}
+			carried[k+0] = carried[k-4+0];
+			carried[k+1] = carried[k-4+1];
+			carried[k+2] = carried[k-4+2];
 		}
+		carried[k+0] = x;
+		carried[k+1] = y;
+		carried[k+2] = i;
 	}
+	
+	tmp.resize(0);
+	int a = 0, b = 0;
+	while (a < stack.size() || b < carried.size())
+	{
+		rcIntArray& src = (b >= carried.size() || (a < stack.size() && stack[a+2] < carried[b+2])) ? stack : carried;
+		int& j = (&src == &stack) ? a : b;
+		tmp.push(src[j+0]);
+		tmp.push(src[j+1]);
+		tmp.push(src[j+2]);
+		tmp.push(entry);
+		j += 4;
+	}
+	
+	stack.resize(tmp.size());
+	if (tmp.size())
+		memcpy(&stack[0], &tmp[0], sizeof(int)*tmp.size());
 }
 
-
-static void appendStacks(rcIntArray& srcStack, rcIntArray& dstStack,
-						 unsigned short* srcReg)
+struct rcWatershedTask : public rcParallelTask
 {
-	for (int j=0; j<srcStack.size(); j+=3)
+	rcCompactHeightfield* chf;
+	unsigned short* srcReg;
+	unsigned short* srcDist;
+	const int* basinSpans;		// Spans of the basins in span order (x,y,i).
+	const int* basinFirst;		// Index of the first span of each basin.
+	int* basinRegCount;			// Number of regions seeded per basin, -1 on overflow.
+	rcWatershedScratch* scratch;
+	int topLevel;
+	int expandIters;
+
+	virtual void run(const int basin, const int worker)
 	{
-		int i = srcStack[j+2];
-		if ((i < 0) || (srcReg[i] != 0))
-			continue;
-		dstStack.push(srcStack[j]);
-		dstStack.push(srcStack[j+1]);
-		dstStack.push(srcStack[j+2]);
+		rcCompactHeightfield& cf = *chf;
+		rcWatershedScratch& ws = scratch[worker];
+		const int* spans = &basinSpans[basinFirst[basin]*3];
+		const int nspans = basinFirst[basin+1] - basinFirst[basin];
+		
+		// Bucket the spans by level, highest first, keeping them in span order.
+		int maxLevel = 0;
+		for (int j = 0; j < nspans; ++j)
+			maxLevel = rcMax(maxLevel, (int)(cf.dist[spans[j*3+2]] >> 1));
+		ws.count.resize(maxLevel+1);
+		memset(&ws.count[0], 0, sizeof(int)*(maxLevel+1));
+		for (int j = 0; j < nspans; ++j)
+			ws.count[maxLevel - (cf.dist[spans[j*3+2]] >> 1)]++;
+		for (int k = 0, n = 0; k <= maxLevel; ++k)
+		{
+			const int c = ws.count[k];
+			ws.count[k] = n;
+			n += c;
+		}
+		ws.sorted.resize(nspans*3);
+		for (int j = 0; j < nspans; ++j)
+		{
+			const int k = ws.count[maxLevel - (cf.dist[spans[j*3+2]] >> 1)]++;
+			ws.sorted[k*3+0] = spans[j*3+0];
+			ws.sorted[k*3+1] = spans[j*3+1];
+			ws.sorted[k*3+2] = spans[j*3+2];
+		}
+		
+		unsigned short regionId = 1;
+		int head = 0;
+		ws.carried.resize(0);
+		
+		const int nsteps = topLevel/2;
+		for (int step = 0; step < nsteps; ++step)
+		{
+			const unsigned short level = (unsigned short)(topLevel - (step+1)*2);
+			
+			// Skip the levels above the basin.
+			if (ws.carried.size() == 0)
+			{
+				if (head >= nspans)
+					break;
+				const int top = cf.dist[ws.sorted[head*3+2]] >> 1;
+				if (top < (level >> 1))
+				{
+					step = nsteps-1 - top - 1;
+					continue;
+				}
+			}
+			
+			// Collect the spans revealed at this level.
+			ws.stack.resize(0);
+			for (; head < nspans && (cf.dist[ws.sorted[head*3+2]] >> 1) >= (level >> 1); ++head)
+			{
+				const int i = ws.sorted[head*3+2];
+				if (srcReg[i] != 0)
+					continue;
+				ws.stack.push(ws.sorted[head*3+0]);
+				ws.stack.push(ws.sorted[head*3+1]);
+				ws.stack.push(i);
+				ws.stack.push(step);
+			}
+			
+			if ((step & (RC_WATERSHED_NB_STACKS-1)) == 0)
+			{
+				if (ws.carried.size() > 0)
+					mergeStacks(ws.stack, ws.carried, ws.cands, step);
+			}
+			else
+			{
+				for (int j = 0; j < ws.carried.size(); ++j)
+					ws.stack.push(ws.carried[j]);
+			}
+			
+			// Expand current regions until no empty connected cells found.
+			ws.cands.resize(0);
+			for (int j = 0; j < ws.stack.size(); j += 4)
+			{
+				ws.cands.push(ws.stack[j+0]);
+				ws.cands.push(ws.stack[j+1]);
+				ws.cands.push(ws.stack[j+2]);
+			}
+			expandRegions(expandIters, level, cf, srcReg, srcDist, ws.cands, ws.next, ws.pending);
+			
+			// Mark new regions with IDs.
+			for (int j = 0; j < ws.stack.size(); j += 4)
+			{
+				const int x = ws.stack[j+0];
+				const int y = ws.stack[j+1];
+				const int i = ws.stack[j+2];
+				if (srcReg[i] != 0)
+					continue;
+				if (floodRegion(x, y, i, level, regionId, cf, srcReg, srcDist, ws.flood))
+				{
+					if (regionId == 0xFFFF)
+					{
+						basinRegCount[basin] = -1;
+						return;
+					}
+					ws.seeds.push(basin);
+					ws.seeds.push(step);
+					ws.seeds.push(ws.stack[j+3]);
+					ws.seeds.push(i);
+					regionId++;
+				}
+			}
+			
+			// Carry the left overs over to the next level.
+			ws.carried.resize(0);
+			for (int j = 0; j < ws.stack.size(); j += 4)
+			{
+				if (srcReg[ws.stack[j+2]] != 0)
+					continue;
+				for (int k = 0; k < 4; ++k)
+					ws.carried.push(ws.stack[j+k]);
+			}
+		}
+		
+		// Expand current regions until no empty connected cells found.
+		ws.cands.resize(0);
+		for (int j = 0; j < nspans; ++j)
+		{
+			if (srcReg[spans[j*3+2]] != 0)
+				continue;
+			ws.cands.push(spans[j*3+0]);
+			ws.cands.push(spans[j*3+1]);
+			ws.cands.push(spans[j*3+2]);
+		}
+		expandRegions(expandIters*8, 0, cf, srcReg, srcDist, ws.cands, ws.next, ws.pending);
+		
+		basinRegCount[basin] = regionId-1;
 	}
-}
+};
 
 struct rcRegion
 {
@@ -786,7 +957,7 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 	const int h = chf.height;
 	
 	const int nreg = maxRegionId+1;
-	rcRegion* regions = (rcRegion*)rcAlloc(sizeof(rcRegion)*nreg, RC_ALLOC_TEMP);
+	rcRegion* regions = (rcRegion*)rcAlloc(sizeof(rcRegion)*nreg, RC_ALLOC_TEMP, RC_MEM_REGIONS);
 	if (!regions)
 	{
 		ctx->log(RC_LOG_ERROR, "mergeAndFilterRegions: Out of memory 'regions' (%d).", nreg);
@@ -1047,7 +1218,7 @@ static bool mergeAndFilterLayerRegions(rcContext* ctx, int minRegionArea,
 	const int h = chf.height;
 	
 	const int nreg = maxRegionId+1;
-	rcRegion* regions = (rcRegion*)rcAlloc(sizeof(rcRegion)*nreg, RC_ALLOC_TEMP);
+	rcRegion* regions = (rcRegion*)rcAlloc(sizeof(rcRegion)*nreg, RC_ALLOC_TEMP, RC_MEM_REGIONS);
 	if (!regions)
 	{
 		ctx->log(RC_LOG_ERROR, "mergeAndFilterLayerRegions: Out of memory 'regions' (%d).", nreg);
@@ -1265,13 +1436,13 @@ bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf)
 		chf.dist = 0;
 	}
 	
-	unsigned short* src = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP);
+	unsigned short* src = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP, RC_MEM_REGIONS);
 	if (!src)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildDistanceField: Out of memory 'src' (%d).", chf.spanCount);
 		return false;
 	}
-	unsigned short* dst = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP);
+	unsigned short* dst = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP, RC_MEM_REGIONS);
 	if (!dst)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildDistanceField: Out of memory 'dst' (%d).", chf.spanCount);
@@ -1363,7 +1534,7 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 	const int h = chf.height;
 	unsigned short id = 1;
 	
-	rcScopedDelete<unsigned short> srcReg((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> srcReg((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP, RC_MEM_REGIONS));
 	if (!srcReg)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'src' (%d).", chf.spanCount);
@@ -1372,7 +1543,7 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 	memset(srcReg,0,sizeof(unsigned short)*chf.spanCount);
 
 	const int nsweeps = rcMax(chf.width,chf.height);
-	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP));
+	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP, RC_MEM_REGIONS));
 	if (!sweeps)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'sweeps' (%d).", nsweeps);
@@ -1517,6 +1688,10 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 /// Watershed partitioning can result in smaller than necessary regions, especially in diagonal corridors. 
 /// @p mergeRegionArea helps reduce unecessarily small regions.
 /// 
+/// The spans connected through neighbours of the same area type form independent basins, which
+/// are flooded with rcContext::runParallel.  The regions are numbered the same regardless of the
+/// number of workers.
+/// 
 /// See the #rcConfig documentation for more information on the configuration parameters.
 /// 
 /// The region data will be available via the rcCompactHeightfield::maxRegions
@@ -1535,34 +1710,35 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	const int w = chf.width;
 	const int h = chf.height;
 	
-	rcScopedDelete<unsigned short> buf((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount*4, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> buf((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount*2, RC_ALLOC_TEMP, RC_MEM_REGIONS));
 	if (!buf)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'tmp' (%d).", chf.spanCount*4);
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'tmp' (%d).", chf.spanCount*2);
+		return false;
+	}
+	rcScopedDelete<int> spanBasin((int*)rcAlloc(sizeof(int)*chf.spanCount, RC_ALLOC_TEMP, RC_MEM_REGIONS));
+	if (!spanBasin)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'spanBasin' (%d).", chf.spanCount);
+		return false;
+	}
+	rcScopedDelete<int> basinSpans((int*)rcAlloc(sizeof(int)*chf.spanCount*3, RC_ALLOC_TEMP, RC_MEM_REGIONS));
+	if (!basinSpans)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'basinSpans' (%d).", chf.spanCount*3);
 		return false;
 	}
 	
 	ctx->startTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
 
-	const int LOG_NB_STACKS = 3;
-	const int NB_STACKS = 1 << LOG_NB_STACKS;
-	rcIntArray lvlStacks[NB_STACKS];
-	for (int i=0; i<NB_STACKS; ++i)
-		lvlStacks[i].resize(1024);
-
-	rcIntArray stack(1024);
-	rcIntArray visited(1024);
-	
 	unsigned short* srcReg = buf;
 	unsigned short* srcDist = buf+chf.spanCount;
-	unsigned short* dstReg = buf+chf.spanCount*2;
-	unsigned short* dstDist = buf+chf.spanCount*3;
 	
 	memset(srcReg, 0, sizeof(unsigned short)*chf.spanCount);
 	memset(srcDist, 0, sizeof(unsigned short)*chf.spanCount);
 	
 	unsigned short regionId = 1;
-	unsigned short level = (chf.maxDistance+1) & ~1;
+	const int topLevel = (chf.maxDistance+1) & ~1;
 
 	// TODO: Figure better formula, expandIters defines how much the 
 	// watershed "overflows" and simplifies the regions. Tying it to
@@ -1585,63 +1761,199 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 		chf.borderSize = borderSize;
 	}
 	
-	int sId = -1;
-	while (level > 0)
+	// Find the basins.
+	rcIntArray basinFirst(256);
+	basinFirst.resize(0);
 	{
-		level = level >= 2 ? level-2 : 0;
-		sId = (sId+1) & (NB_STACKS-1);
-
-//		ctx->startTimer(RC_TIMER_DIVIDE_TO_LEVELS);
-
-		if (sId == 0)
-			sortCellsByLevel(level, chf, srcReg, NB_STACKS, lvlStacks, 1);
-		else 
-			appendStacks(lvlStacks[sId-1], lvlStacks[sId], srcReg); // copy left overs from last level
-
-//		ctx->stopTimer(RC_TIMER_DIVIDE_TO_LEVELS);
-
-		{
-			rcScopedTimer timerExpand(ctx, RC_TIMER_BUILD_REGIONS_EXPAND);
-
-			// Expand current regions until no empty connected cells found.
-			if (expandRegions(expandIters, level, chf, srcReg, srcDist, dstReg, dstDist, lvlStacks[sId], false) != srcReg)
-			{
-				rcSwap(srcReg, dstReg);
-				rcSwap(srcDist, dstDist);
-			}
-		}
+		rcScopedTimer timerFlood(ctx, RC_TIMER_BUILD_REGIONS_FLOOD);
+		
+		for (int i = 0; i < chf.spanCount; ++i)
+			spanBasin[i] = -1;
 		
+		rcIntArray stack(1024);
+		for (int y = 0; y < h; ++y)
 		{
-			rcScopedTimer timerFloor(ctx, RC_TIMER_BUILD_REGIONS_FLOOD);
-
-			// Mark new regions with IDs.
-			for (int j = 0; j<lvlStacks[sId].size(); j += 3)
+			for (int x = 0; x < w; ++x)
 			{
-				int x = lvlStacks[sId][j];
-				int y = lvlStacks[sId][j+1];
-				int i = lvlStacks[sId][j+2];
-				if (i >= 0 && srcReg[i] == 0)
+				const rcCompactCell& c = chf.cells[x+y*w];
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 				{
-					if (floodRegion(x, y, i, level, regionId, chf, srcReg, srcDist, stack))
+					if (chf.areas[i] == RC_NULL_AREA || srcReg[i] != 0 || spanBasin[i] != -1)
+						continue;
+					
+					const int basin = basinFirst.size();
+					const unsigned char area = chf.areas[i];
+					int count = 0;
+					
+					spanBasin[i] = basin;
+					stack.resize(0);
+					stack.push(x);
+					stack.push(y);
+					stack.push(i);
+					while (stack.size() > 0)
 					{
-						if (regionId == 0xFFFF)
+						const int ci = stack.pop();
+						const int cy = stack.pop();
+						const int cx = stack.pop();
+						count++;
+						
+						const rcCompactSpan& cs = chf.spans[ci];
+						for (int dir = 0; dir < 4; ++dir)
 						{
-							ctx->log(RC_LOG_ERROR, "rcBuildRegions: Region ID overflow");
-							return false;
+							if (rcGetCon(cs, dir) == RC_NOT_CONNECTED)
+								continue;
+							const int ax = cx + rcGetDirOffsetX(dir);
+							const int ay = cy + rcGetDirOffsetY(dir);
+							const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(cs, dir);
+							if (chf.areas[ai] != area || srcReg[ai] != 0 || spanBasin[ai] != -1)
+								continue;
+							spanBasin[ai] = basin;
+							stack.push(ax);
+							stack.push(ay);
+							stack.push(ai);
 						}
-						
-						regionId++;
 					}
+					
+					basinFirst.push(count);
 				}
 			}
 		}
 	}
 	
-	// Expand current regions until no empty connected cells found.
-	if (expandRegions(expandIters*8, 0, chf, srcReg, srcDist, dstReg, dstDist, stack, true) != srcReg)
+	const int nbasins = basinFirst.size();
+	
+	// Lay out the spans of each basin in span order.
+	basinFirst.push(0);
+	for (int b = 0, n = 0; b <= nbasins; ++b)
 	{
-		rcSwap(srcReg, dstReg);
-		rcSwap(srcDist, dstDist);
+		const int count = basinFirst[b];
+		basinFirst[b] = n;
+		n += count;
+	}
+	{
+		rcIntArray cursor(nbasins+1);
+		memcpy(&cursor[0], &basinFirst[0], sizeof(int)*(nbasins+1));
+		for (int y = 0; y < h; ++y)
+		{
+			for (int x = 0; x < w; ++x)
+			{
+				const rcCompactCell& c = chf.cells[x+y*w];
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+				{
+					if (spanBasin[i] == -1)
+						continue;
+					const int j = cursor[spanBasin[i]]++;
+					basinSpans[j*3+0] = x;
+					basinSpans[j*3+1] = y;
+					basinSpans[j*3+2] = i;
+				}
+			}
+		}
+	}
+	
+	// Flood the basins.
+	const int nworkers = ctx->getWorkerCount();
+	rcScopedDelete<rcWatershedScratch> scratch((rcWatershedScratch*)rcAlloc(sizeof(rcWatershedScratch)*nworkers, RC_ALLOC_TEMP, RC_MEM_REGIONS));
+	if (!scratch)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'scratch' (%d).", nworkers);
+		return false;
+	}
+	for (int i = 0; i < nworkers; ++i)
+		new(&scratch[i]) rcWatershedScratch;
+	
+	rcIntArray basinRegCount(nbasins);
+	bool overflow = false;
+	int nseeds = 0;
+	{
+		rcScopedTimer timerExpand(ctx, RC_TIMER_BUILD_REGIONS_EXPAND);
+		
+		rcWatershedTask task;
+		task.chf = &chf;
+		task.srcReg = srcReg;
+		task.srcDist = srcDist;
+		task.basinSpans = basinSpans;
+		task.basinFirst = &basinFirst[0];
+		task.basinRegCount = nbasins ? &basinRegCount[0] : 0;
+		task.scratch = scratch;
+		task.topLevel = topLevel;
+		task.expandIters = expandIters;
+		ctx->runParallel(task, nbasins);
+		
+		for (int b = 0; b < nbasins; ++b)
+		{
+			if (basinRegCount[b] < 0)
+				overflow = true;
+			else
+				nseeds += basinRegCount[b];
+		}
+	}
+	
+	// Number the regions in the order the level stacks would have seeded them.
+	if (!overflow && (int)regionId + nseeds <= 0xFFFF)
+	{
+		rcScopedDelete<rcWatershedSeed> seeds((rcWatershedSeed*)rcAlloc(sizeof(rcWatershedSeed)*rcMax(nseeds, 1), RC_ALLOC_TEMP, RC_MEM_REGIONS));
+		rcIntArray remap(rcMax(nseeds, 1));
+		rcIntArray basinRegFirst(nbasins);
+		if (!seeds)
+		{
+			for (int i = 0; i < nworkers; ++i)
+				scratch[i].~rcWatershedScratch();
+			ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'seeds' (%d).", nseeds);
+			return false;
+		}
+		
+		for (int b = 0, n = 0; b < nbasins; ++b)
+		{
+			basinRegFirst[b] = n;
+			n += basinRegCount[b];
+		}
+		
+		int n = 0;
+		for (int k = 0; k < nworkers; ++k)
+		{
+			const rcIntArray& ws = scratch[k].seeds;
+			int prevBasin = -1, local = 0;
+			for (int j = 0; j < ws.size(); j += 4)
+			{
+				if (ws[j] != prevBasin)
+				{
+					prevBasin = ws[j];
+					local = 0;
+				}
+				rcWatershedSeed& seed = seeds[n++];
+				seed.step = ws[j+1];
+				seed.entry = ws[j+2];
+				seed.span = ws[j+3];
+				seed.slot = basinRegFirst[prevBasin] + local++;
+			}
+		}
+		rcAssert(n == nseeds);
+		
+		qsort(seeds, nseeds, sizeof(rcWatershedSeed), compareWatershedSeeds);
+		for (int j = 0; j < nseeds; ++j)
+			remap[seeds[j].slot] = regionId + j;
+		regionId = (unsigned short)(regionId + nseeds);
+		
+		for (int i = 0; i < chf.spanCount; ++i)
+		{
+			if (spanBasin[i] == -1 || srcReg[i] == 0)
+				continue;
+			srcReg[i] = (unsigned short)remap[basinRegFirst[spanBasin[i]] + srcReg[i]-1];
+		}
+	}
+	else
+	{
+		overflow = true;
+	}
+	
+	for (int i = 0; i < nworkers; ++i)
+		scratch[i].~rcWatershedScratch();
+	
+	if (overflow)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Region ID overflow");
+		return false;
 	}
 	
 	ctx->stopTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
@@ -1681,7 +1993,7 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	const int h = chf.height;
 	unsigned short id = 1;
 	
-	rcScopedDelete<unsigned short> srcReg((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> srcReg((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP, RC_MEM_REGIONS));
 	if (!srcReg)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'src' (%d).", chf.spanCount);
@@ -1690,7 +2002,7 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	memset(srcReg,0,sizeof(unsigned short)*chf.spanCount);
 	
 	const int nsweeps = rcMax(chf.width,chf.height);
-	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP));
+	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP, RC_MEM_REGIONS));
 	if (!sweeps)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'sweeps' (%d).", nsweeps);
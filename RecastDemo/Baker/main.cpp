@@ -0,0 +1,1447 @@
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "Recast.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+#include "InputGeom.h"
+#include "Sample.h"
+#include "SampleInterfaces.h"
+#include "Scene.h"
+#include "StageStats.h"
+#include "TileCacheHelpers.h"
+#include "VoxelTileBuilder.h"
+
+// Bakes the tiled navmesh or tile cache of a mesh or of a voxel scene without a window:
+//
+//   Baker <settings file> [key=value ...]
+//
+// The settings file holds one key=value pair per line, the pairs of the command line override it.
+// The tiles are built on all cores, and the tiles whose input and settings are the same as in the
+// previous bake are copied from the build cache instead of being built again.
+
+#ifdef WIN32
+#	define snprintf _snprintf
+#endif
+
+// This value specifies how many layers (or "floors") each tile cache tile is expected to have.
+static const int EXPECTED_LAYERS_PER_TILE = 4;
+
+// The outputs use the navmesh set format of Sample_TileMesh and the tile cache set format of Sample_TempObstacles.
+static const int NAVMESHSET_MAGIC = 'M'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'MSET';
+static const int NAVMESHSET_VERSION = 1;
+static const int TILECACHESET_MAGIC = 'T'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'TSET';
+static const int TILECACHESET_VERSION = 1;
+
+struct NavMeshSetHeader
+{
+	int magic;
+	int version;
+	int numTiles;
+	dtNavMeshParams params;
+};
+
+struct NavMeshTileHeader
+{
+	dtTileRef tileRef;
+	int dataSize;
+};
+
+struct TileCacheSetHeader
+{
+	int magic;
+	int version;
+	int numTiles;
+	dtNavMeshParams meshParams;
+	dtTileCacheParams cacheParams;
+};
+
+struct TileCacheTileHeader
+{
+	dtCompressedTileRef tileRef;
+	int dataSize;
+};
+
+// The build cache keeps the data of each tile with the hash of its input, see hashMeshTile and hashSceneTile.
+static const int BAKECACHE_MAGIC = 'B'<<24 | 'C'<<16 | 'H'<<8 | 'E'; //'BCHE';
+static const int BAKECACHE_VERSION = 1;
+
+struct BakeCacheHeader
+{
+	int magic;
+	int version;
+	int tileWidth;
+	int tileHeight;
+	int numTiles;
+};
+
+struct BakeCacheTileHeader
+{
+	uint64_t hash;
+	int tileIndex;
+	int numData;	// The sizes of the data follow the header, then the data.
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct BakeSettings
+{
+	std::string input;
+	std::string output;
+	std::string cachePath;		// Empty to bake without the build cache.
+	std::string reportPath;		// Empty to skip the report.
+	bool tileCache;
+	int threads;				// 0 to use all cores.
+	BuildSettings build;		// The tile size is only used by meshes.
+	int tileRegions;			// The size of the tiles of the voxel scenes, in regions.
+	bool streamRegions;			// Load only the regions of the voxel scene under the tiles being built.
+	int streamWindowTiles;
+};
+
+static void resetBakeSettings(BakeSettings& s)
+{
+	s.output = "navmesh.bin";
+	s.cachePath = "navmesh.bin.cache";
+	s.reportPath = "navmesh.bin.csv";
+	s.tileCache = false;
+	s.threads = 0;
+
+	// The settings of the samples.
+	memset(&s.build, 0, sizeof(s.build));
+	s.build.cellSize = 0.3f;
+	s.build.cellHeight = 0.2f;
+	s.build.agentHeight = 2.0f;
+	s.build.agentRadius = 0.6f;
+	s.build.agentMaxClimb = 0.9f;
+	s.build.agentMaxSlope = 45.0f;
+	s.build.regionMinSize = 8;
+	s.build.regionMergeSize = 20;
+	s.build.edgeMaxLen = 12.0f;
+	s.build.edgeMaxError = 1.3f;
+	s.build.vertsPerPoly = 6.0f;
+	s.build.detailSampleDist = 6.0f;
+	s.build.detailSampleMaxError = 1.0f;
+	s.build.partitionType = SAMPLE_PARTITION_WATERSHED;
+	s.build.tileSize = 32;
+
+	s.tileRegions = 1;
+	s.streamRegions = false;
+	s.streamWindowTiles = 8;
+}
+
+struct BakeSetting
+{
+	std::string key;
+	std::string value;
+};
+
+static std::string trim(const std::string& s)
+{
+	const size_t start = s.find_first_not_of(" \t\r\n");
+	if (start == std::string::npos)
+		return "";
+	const size_t end = s.find_last_not_of(" \t\r\n");
+	return s.substr(start, end - start + 1);
+}
+
+static bool parseSetting(const std::string& line, BakeSetting& setting)
+{
+	const size_t eq = line.find('=');
+	if (eq == std::string::npos)
+		return false;
+	setting.key = trim(line.substr(0, eq));
+	setting.value = trim(line.substr(eq + 1));
+	return !setting.key.empty();
+}
+
+// Reads the key=value pairs of a settings file. Empty lines and lines starting with # are skipped.
+static bool readSettingsFile(rcContext* ctx, const char* path, std::vector<BakeSetting>& settings)
+{
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+	{
+		ctx->log(RC_LOG_ERROR, "Could not open settings '%s'.", path);
+		return false;
+	}
+
+	char buf[1024];
+	int lineNumber = 0;
+	bool ok = true;
+	while (fgets(buf, sizeof(buf), fp))
+	{
+		lineNumber++;
+		const std::string line = trim(buf);
+		if (line.empty() || line[0] == '#')
+			continue;
+		BakeSetting setting;
+		if (!parseSetting(line, setting))
+		{
+			ctx->log(RC_LOG_ERROR, "%s:%d: Expected key=value.", path, lineNumber);
+			ok = false;
+			continue;
+		}
+		settings.push_back(setting);
+	}
+	fclose(fp);
+	return ok;
+}
+
+static bool applySetting(rcContext* ctx, const BakeSetting& setting, BakeSettings& s)
+{
+	const char* key = setting.key.c_str();
+	const char* value = setting.value.c_str();
+
+	struct FloatSetting { const char* key; float* value; };
+	const FloatSetting floats[] =
+	{
+		{ "cellSize", &s.build.cellSize },
+		{ "cellHeight", &s.build.cellHeight },
+		{ "agentHeight", &s.build.agentHeight },
+		{ "agentRadius", &s.build.agentRadius },
+		{ "agentMaxClimb", &s.build.agentMaxClimb },
+		{ "agentMaxSlope", &s.build.agentMaxSlope },
+		{ "regionMinSize", &s.build.regionMinSize },
+		{ "regionMergeSize", &s.build.regionMergeSize },
+		{ "edgeMaxLen", &s.build.edgeMaxLen },
+		{ "edgeMaxError", &s.build.edgeMaxError },
+		{ "vertsPerPoly", &s.build.vertsPerPoly },
+		{ "detailSampleDist", &s.build.detailSampleDist },
+		{ "detailSampleMaxError", &s.build.detailSampleMaxError },
+		{ "tileSize", &s.build.tileSize },
+	};
+	for (size_t i = 0; i < sizeof(floats)/sizeof(floats[0]); ++i)
+	{
+		if (strcmp(key, floats[i].key) == 0)
+		{
+			*floats[i].value = (float)atof(value);
+			return true;
+		}
+	}
+
+	if (strcmp(key, "input") == 0)
+		s.input = setting.value;
+	else if (strcmp(key, "output") == 0)
+	{
+		// The cache and the report follow the output unless they are set after it.
+		s.output = setting.value;
+		s.cachePath = s.output + ".cache";
+		s.reportPath = s.output + ".csv";
+	}
+	else if (strcmp(key, "cache") == 0)
+		s.cachePath = setting.value;
+	else if (strcmp(key, "report") == 0)
+		s.reportPath = setting.value;
+	else if (strcmp(key, "mode") == 0 && (strcmp(value, "navmesh") == 0 || strcmp(value, "tilecache") == 0))
+		s.tileCache = strcmp(value, "tilecache") == 0;
+	else if (strcmp(key, "threads") == 0)
+		s.threads = atoi(value);
+	else if (strcmp(key, "partitionType") == 0 && strcmp(value, "watershed") == 0)
+		s.build.partitionType = SAMPLE_PARTITION_WATERSHED;
+	else if (strcmp(key, "partitionType") == 0 && strcmp(value, "monotone") == 0)
+		s.build.partitionType = SAMPLE_PARTITION_MONOTONE;
+	else if (strcmp(key, "partitionType") == 0 && strcmp(value, "layers") == 0)
+		s.build.partitionType = SAMPLE_PARTITION_LAYERS;
+	else if (strcmp(key, "tileRegions") == 0)
+		s.tileRegions = atoi(value);
+	else if (strcmp(key, "streamRegions") == 0)
+		s.streamRegions = atoi(value) != 0;
+	else if (strcmp(key, "streamWindow") == 0)
+		s.streamWindowTiles = atoi(value);
+	else
+	{
+		ctx->log(RC_LOG_ERROR, "Invalid setting '%s=%s'.", key, value);
+		return false;
+	}
+	return true;
+}
+
+static bool isVoxelScene(const std::string& path)
+{
+	return path.size() > 4 && path.compare(path.size() - 4, 4, ".cfg") == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct BakeData
+{
+	unsigned char* data;
+	int dataSize;
+};
+
+// The navmesh data of a tile, or the compressed layers of a tile cache tile.
+struct BakeTile
+{
+	BakeData data[VOXEL_MAX_LAYERS];
+	int ndata;
+	uint64_t hash;
+	const char* error;		// Why the tile could not be built, or null.
+	bool cached;			// The data comes from the build cache.
+	bool built;
+};
+
+static void freeBakeTile(BakeTile& tile)
+{
+	for (int i = 0; i < tile.ndata; ++i)
+		dtFree(tile.data[i].data);
+	tile.ndata = 0;
+}
+
+// Everything the workers need to build the tiles.
+struct BakeJob
+{
+	const BakeSettings* settings;
+	int tileWidth;
+	int tileHeight;
+	uint64_t settingsHash;
+
+	// Mesh input.
+	InputGeom* geom;
+	const rcAreaVolumeSet* vset;
+	rcConfig cfg;			// The size of a tile with its border, and the bounds of the whole mesh.
+
+	// Voxel input.
+	Scene* scene;
+	VoxelTileSettings voxelSettings;
+
+	BakeTile* cache;		// The previous bake of the tiles being built, or null.
+};
+
+// The intermediate results of a mesh tile.
+struct MeshTileContext
+{
+	rcHeightfield* solid = nullptr;
+	unsigned char* triareas = nullptr;
+	rcCompactHeightfield* chf = nullptr;
+	rcHeightfieldLayerSet* lset = nullptr;
+
+	~MeshTileContext()
+	{
+		rcFreeHeightField(solid);
+		delete [] triareas;
+		rcFreeCompactHeightfield(chf);
+		rcFreeHeightfieldLayerSet(lset);
+	}
+};
+
+// Returns the config of the tile (tx,ty), bounded by the tile and its border.
+static void getMeshTileConfig(const BakeJob& job, const int tx, const int ty, rcConfig& cfg)
+{
+	cfg = job.cfg;
+	const float tcs = cfg.tileSize*cfg.cs;
+	cfg.bmin[0] = job.cfg.bmin[0] + tx*tcs - cfg.borderSize*cfg.cs;
+	cfg.bmin[2] = job.cfg.bmin[2] + ty*tcs - cfg.borderSize*cfg.cs;
+	cfg.bmax[0] = job.cfg.bmin[0] + (tx+1)*tcs + cfg.borderSize*cfg.cs;
+	cfg.bmax[2] = job.cfg.bmin[2] + (ty+1)*tcs + cfg.borderSize*cfg.cs;
+}
+
+// Hashes the fields of a convex volume, its vertices past nverts are not initialized.
+static uint64_t hashConvexVolume(const ConvexVolume& vol, uint64_t hash)
+{
+	hash = HashBytes(vol.verts, sizeof(float)*3*vol.nverts, hash);
+	hash = HashBytes(&vol.hmin, sizeof(vol.hmin), hash);
+	hash = HashBytes(&vol.hmax, sizeof(vol.hmax), hash);
+	hash = HashBytes(&vol.nverts, sizeof(vol.nverts), hash);
+	return HashBytes(&vol.area, sizeof(vol.area), hash);
+}
+
+// The hash of the settings and of the triangles, convex volumes and off-mesh connections
+// the tile (tx,ty) and its border overlap.
+static uint64_t hashMeshTile(const BakeJob& job, const int tx, const int ty)
+{
+	rcConfig cfg;
+	getMeshTileConfig(job, tx, ty, cfg);
+
+	const rcMeshLoaderObj* mesh = job.geom->getMesh();
+	const float* verts = mesh->getVerts();
+	const rcChunkyTriMesh* chunkyMesh = job.geom->getChunkyMesh();
+
+	float tbmin[2], tbmax[2];
+	tbmin[0] = cfg.bmin[0];
+	tbmin[1] = cfg.bmin[2];
+	tbmax[0] = cfg.bmax[0];
+	tbmax[1] = cfg.bmax[2];
+	int cid[512];
+	const int ncid = rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, cid, 512);
+
+	uint64_t hash = job.settingsHash;
+	for (int i = 0; i < ncid; ++i)
+	{
+		const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
+		const int* tris = &chunkyMesh->tris[node.i*3];
+		for (int j = 0; j < node.n; ++j)
+		{
+			const float* v0 = &verts[tris[j*3+0]*3];
+			const float* v1 = &verts[tris[j*3+1]*3];
+			const float* v2 = &verts[tris[j*3+2]*3];
+			if (rcMax(v0[0], rcMax(v1[0], v2[0])) < tbmin[0] || rcMin(v0[0], rcMin(v1[0], v2[0])) > tbmax[0] ||
+				rcMax(v0[2], rcMax(v1[2], v2[2])) < tbmin[1] || rcMin(v0[2], rcMin(v1[2], v2[2])) > tbmax[1])
+				continue;
+			hash = HashBytes(v0, sizeof(float)*3, hash);
+			hash = HashBytes(v1, sizeof(float)*3, hash);
+			hash = HashBytes(v2, sizeof(float)*3, hash);
+		}
+	}
+
+	// The convex volumes overlapping the tile, in the order they are marked.
+	const rcAreaVolumeSet& vset = *job.vset;
+	if (vset.nvolumes > 0 && tbmax[0] >= vset.bmin[0] && tbmax[1] >= vset.bmin[1])
+	{
+		const float ics = 1.0f/vset.cs;
+		const int cx0 = rcMax((int)floorf((tbmin[0] - vset.bmin[0])*ics), 0);
+		const int cz0 = rcMax((int)floorf((tbmin[1] - vset.bmin[1])*ics), 0);
+		const int cx1 = rcMin((int)((tbmax[0] - vset.bmin[0])*ics), vset.width-1);
+		const int cz1 = rcMin((int)((tbmax[1] - vset.bmin[1])*ics), vset.height-1);
+		std::vector<unsigned char> visit(vset.nvolumes, 0);
+		for (int z = cz0; z <= cz1; ++z)
+		{
+			for (int x = cx0; x <= cx1; ++x)
+			{
+				const int c = x + z*vset.width;
+				for (int i = vset.cellFirst[c]; i < vset.cellFirst[c+1]; ++i)
+					visit[vset.cellItems[i]] = 1;
+			}
+		}
+		const ConvexVolume* volumes = job.geom->getConvexVolumes();
+		for (int i = 0; i < vset.nvolumes; ++i)
+		{
+			const float* bmin = &vset.bounds[i*6];
+			const float* bmax = &vset.bounds[i*6+3];
+			if (!visit[i] || bmax[0] < tbmin[0] || bmin[0] > tbmax[0] || bmax[2] < tbmin[1] || bmin[2] > tbmax[1])
+				continue;
+			hash = hashConvexVolume(volumes[i], hash);
+		}
+	}
+
+	// The off-mesh connections starting or ending in the tile.
+	const float* conVerts = job.geom->getOffMeshConnectionVerts();
+	for (int i = 0; i < job.geom->getOffMeshConnectionCount(); ++i)
+	{
+		const float* v = &conVerts[i*6];
+		bool inside = false;
+		for (int j = 0; j < 2; ++j)
+		{
+			if (v[j*3+0] >= tbmin[0] && v[j*3+0] <= tbmax[0] && v[j*3+2] >= tbmin[1] && v[j*3+2] <= tbmax[1])
+				inside = true;
+		}
+		if (!inside)
+			continue;
+		hash = HashBytes(v, sizeof(float)*6, hash);
+		hash = HashBytes(&job.geom->getOffMeshConnectionRads()[i], sizeof(float), hash);
+		hash = HashBytes(&job.geom->getOffMeshConnectionDirs()[i], 1, hash);
+		hash = HashBytes(&job.geom->getOffMeshConnectionAreas()[i], 1, hash);
+		hash = HashBytes(&job.geom->getOffMeshConnectionFlags()[i], sizeof(unsigned short), hash);
+		hash = HashBytes(&job.geom->getOffMeshConnectionId()[i], sizeof(unsigned int), hash);
+	}
+	return hash;
+}
+
+// Rasterizes the triangles the tile (tx,ty) and its border overlap, and builds the eroded compact
+// heightfield of the tile with its areas marked. Leaves the heightfield null if the tile has no triangles.
+// Returns why the tile could not be built, or null.
+static const char* rasterizeMeshTile(rcContext* ctx, const BakeJob& job, const int tx, const int ty,
+									 rcConfig& cfg, MeshTileContext& tc)
+{
+	getMeshTileConfig(job, tx, ty, cfg);
+
+	const rcMeshLoaderObj* mesh = job.geom->getMesh();
+	const float* verts = mesh->getVerts();
+	const int nverts = mesh->getVertCount();
+	const rcChunkyTriMesh* chunkyMesh = job.geom->getChunkyMesh();
+
+	float tbmin[2], tbmax[2];
+	tbmin[0] = cfg.bmin[0];
+	tbmin[1] = cfg.bmin[2];
+	tbmax[0] = cfg.bmax[0];
+	tbmax[1] = cfg.bmax[2];
+	int cid[512];
+	const int ncid = rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, cid, 512);
+	if (!ncid)
+		return nullptr;
+
+	tc.solid = rcAllocHeightfield();
+	if (!tc.solid || !rcCreateHeightfield(ctx, *tc.solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+		return "Could not create solid heightfield.";
+
+	tc.triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
+	for (int i = 0; i < ncid; ++i)
+	{
+		const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
+		const int* tris = &chunkyMesh->tris[node.i*3];
+		const int ntris = node.n;
+
+		memset(tc.triareas, 0, ntris*sizeof(unsigned char));
+		rcMarkWalkableTriangles(ctx, cfg.walkableSlopeAngle, verts, nverts, tris, ntris, tc.triareas);
+		if (!rcRasterizeTriangles(ctx, verts, nverts, tris, tc.triareas, ntris, *tc.solid, cfg.walkableClimb))
+			return "Could not rasterize triangles.";
+	}
+	delete [] tc.triareas;
+	tc.triareas = nullptr;
+
+	rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, *tc.solid);
+	rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, *tc.solid);
+	rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, *tc.solid);
+
+	tc.chf = rcAllocCompactHeightfield();
+	if (!tc.chf || !rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *tc.solid, *tc.chf))
+		return "Could not build compact data.";
+	rcFreeHeightField(tc.solid);
+	tc.solid = nullptr;
+
+	if (!rcErodeWalkableArea(ctx, cfg.walkableRadius, *tc.chf))
+		return "Could not erode.";
+
+	if (!rcMarkAreaVolumes(ctx, *job.vset, *tc.chf))
+		return "Could not mark areas.";
+
+	return nullptr;
+}
+
+// Gives the compressed layers of a tile cache tile to the tile.
+static void takeCacheTile(VoxelCacheTile& cacheTile, BakeTile& tile)
+{
+	for (int i = 0; i < cacheTile.nlayers; ++i)
+	{
+		tile.data[i].data = cacheTile.layers[i].data;
+		tile.data[i].dataSize = cacheTile.layers[i].dataSize;
+	}
+	tile.ndata = cacheTile.nlayers;
+	tile.error = cacheTile.error;
+}
+
+// Builds the navmesh data of the mesh tile (tx,ty) like Sample_TileMesh.
+static void buildMeshTile(rcContext* ctx, const BakeJob& job, const int tx, const int ty, BakeTile& tile)
+{
+	rcConfig cfg;
+	MeshTileContext tc;
+	tile.error = rasterizeMeshTile(ctx, job, tx, ty, cfg, tc);
+	if (tile.error || !tc.chf)
+		return;
+
+	// Sets the flags of the polygons and passes in the off-mesh connections, like Sample_TempObstacles.
+	MeshProcess proc;
+	proc.init(job.geom);
+
+	const BuildSettings& build = job.settings->build;
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.walkableHeight = build.agentHeight;
+	params.walkableRadius = build.agentRadius;
+	params.walkableClimb = build.agentMaxClimb;
+	params.tileX = tx;
+	params.tileY = ty;
+	params.tileLayer = 0;
+	BakeData& data = tile.data[0];
+	tile.error = buildTileFromCompact(ctx, *tc.chf, cfg, build.partitionType, &proc, params, &data.data, &data.dataSize);
+	tile.ndata = data.data ? 1 : 0;
+}
+
+// Builds the compressed tile cache layers of the mesh tile (tx,ty) like Sample_TempObstacles.
+// If any of the layers fails, none of the layers of the tile are kept.
+static void buildMeshTileLayers(rcContext* ctx, const BakeJob& job, const int tx, const int ty, BakeTile& tile)
+{
+	rcConfig cfg;
+	MeshTileContext tc;
+	tile.error = rasterizeMeshTile(ctx, job, tx, ty, cfg, tc);
+	if (tile.error || !tc.chf)
+		return;
+
+	tc.lset = rcAllocHeightfieldLayerSet();
+	if (!tc.lset || !rcBuildHeightfieldLayers(ctx, *tc.chf, cfg.borderSize, cfg.walkableHeight, *tc.lset))
+	{
+		tile.error = "Could not build heightfield layers.";
+		return;
+	}
+
+	VoxelCacheTile cacheTile;
+	memset(&cacheTile, 0, sizeof(cacheTile));
+	compressTileLayers(*tc.lset, tx, ty, cacheTile);
+	takeCacheTile(cacheTile, tile);
+}
+
+// Builds the tiles, or takes them from the build cache when their hash has not changed.
+struct BakeTilesTask : public rcParallelTask
+{
+	const BakeJob* job;
+	BakeTile* tiles;			// The tiles being built, in the order of tileIndices.
+	const int* tileIndices;
+	StageContext* contexts;		// The context of each worker.
+
+	virtual void run(const int index, const int worker)
+	{
+		const int tileIndex = tileIndices[index];
+		const int tx = tileIndex % job->tileWidth;
+		const int ty = tileIndex / job->tileWidth;
+		BakeTile& tile = tiles[index];
+
+		tile.hash = job->scene ? HashBytes(&job->settingsHash, sizeof(job->settingsHash),
+										   hashVoxelTileRegions(job->scene, job->voxelSettings, tx, ty))
+							   : hashMeshTile(*job, tx, ty);
+
+		BakeTile* cached = job->cache ? &job->cache[index] : nullptr;
+		if (cached && cached->cached && cached->hash == tile.hash)
+		{
+			// The cache gives its data to the tile.
+			memcpy(tile.data, cached->data, sizeof(tile.data));
+			tile.ndata = cached->ndata;
+			tile.cached = true;
+			cached->ndata = 0;
+			cached->cached = false;
+			return;
+		}
+
+		StageContext* ctx = &contexts[worker];
+		ctx->startTimer(RC_TIMER_TOTAL);
+		if (job->scene && job->settings->tileCache)
+		{
+			VoxelCacheTile cacheTile;
+			memset(&cacheTile, 0, sizeof(cacheTile));
+			buildVoxelTileLayers(ctx, job->scene, job->voxelSettings, tx, ty, cacheTile);
+			takeCacheTile(cacheTile, tile);
+		}
+		else if (job->scene)
+		{
+			VoxelTile voxelTile;
+			memset(&voxelTile, 0, sizeof(voxelTile));
+			buildVoxelTile(ctx, job->scene, job->voxelSettings, tx, ty, voxelTile);
+			tile.data[0].data = voxelTile.data;
+			tile.data[0].dataSize = voxelTile.dataSize;
+			tile.ndata = voxelTile.data ? 1 : 0;
+			tile.error = voxelTile.error;
+		}
+		else if (job->settings->tileCache)
+		{
+			buildMeshTileLayers(ctx, *job, tx, ty, tile);
+		}
+		else
+		{
+			buildMeshTile(ctx, *job, tx, ty, tile);
+		}
+		ctx->stopTimer(RC_TIMER_TOTAL);
+		tile.built = true;
+	}
+};
+
+// Logs the tiles that failed and counts the tiles.
+static void countBakeTiles(rcContext* ctx, const BakeTile* tiles, const int* tileIndices, const int count,
+						   const int tileWidth, int& builtCount, int& cachedCount, int& failedCount)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		const BakeTile& tile = tiles[i];
+		if (tile.error)
+		{
+			ctx->log(RC_LOG_ERROR, "Tile (%d,%d): %s", tileIndices[i] % tileWidth, tileIndices[i] / tileWidth, tile.error);
+			failedCount++;
+		}
+		builtCount += tile.built;
+		cachedCount += tile.cached;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Where the tiles of the previous bake are in its cache file. The data of the tiles is read
+// when they are about to be built, so a streamed bake does not hold the whole cache.
+struct BakeCacheEntry
+{
+	uint64_t hash;
+	long offset;	// The offset of the sizes of the data, or -1 if the tile is not in the cache.
+	int numData;
+};
+
+struct BakeCacheReader
+{
+	FILE* fp = nullptr;
+	std::vector<BakeCacheEntry> entries;	// One per tile.
+};
+
+// Reads the tile headers of the previous bake. The tiles of a cache with another tile grid are all rebuilt.
+static bool openBakeCache(BakeCacheReader& reader, const char* path, const int tileWidth, const int tileHeight)
+{
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+
+	BakeCacheHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		header.magic != BAKECACHE_MAGIC || header.version != BAKECACHE_VERSION ||
+		header.tileWidth != tileWidth || header.tileHeight != tileHeight)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	const int tileCount = tileWidth*tileHeight;
+	BakeCacheEntry empty;
+	memset(&empty, 0, sizeof(empty));
+	empty.offset = -1;
+	reader.entries.assign(tileCount, empty);
+	for (int i = 0; i < header.numTiles; ++i)
+	{
+		BakeCacheTileHeader tileHeader;
+		if (fread(&tileHeader, sizeof(tileHeader), 1, fp) != 1 ||
+			tileHeader.tileIndex < 0 || tileHeader.tileIndex >= tileCount ||
+			tileHeader.numData < 0 || tileHeader.numData > VOXEL_MAX_LAYERS)
+			break;
+
+		const long offset = ftell(fp);
+		int sizes[VOXEL_MAX_LAYERS];
+		if (tileHeader.numData > 0 && fread(sizes, sizeof(int), tileHeader.numData, fp) != (size_t)tileHeader.numData)
+			break;
+		long dataSize = 0;
+		bool ok = true;
+		for (int j = 0; j < tileHeader.numData && ok; ++j)
+		{
+			ok = sizes[j] > 0;
+			dataSize += sizes[j];
+		}
+		if (!ok || fseek(fp, dataSize, SEEK_CUR) != 0)
+			break;
+
+		BakeCacheEntry& entry = reader.entries[tileHeader.tileIndex];
+		entry.hash = tileHeader.hash;
+		entry.offset = offset;
+		entry.numData = tileHeader.numData;
+	}
+
+	reader.fp = fp;
+	return true;
+}
+
+// Reads the cached data of the tiles, the tiles that are not in the cache or cannot be read are left empty.
+static void readBakeCacheTiles(BakeCacheReader& reader, const int* tileIndices, const int count, BakeTile* cache)
+{
+	memset(cache, 0, sizeof(BakeTile)*count);
+	if (!reader.fp)
+		return;
+
+	for (int i = 0; i < count; ++i)
+	{
+		const BakeCacheEntry& entry = reader.entries[tileIndices[i]];
+		if (entry.offset < 0)
+			continue;
+
+		BakeTile& tile = cache[i];
+		int sizes[VOXEL_MAX_LAYERS];
+		bool ok = fseek(reader.fp, entry.offset, SEEK_SET) == 0 &&
+				  (entry.numData == 0 || fread(sizes, sizeof(int), entry.numData, reader.fp) == (size_t)entry.numData);
+		for (int j = 0; j < entry.numData && ok; ++j)
+		{
+			BakeData& data = tile.data[tile.ndata];
+			data.dataSize = sizes[j];
+			data.data = (unsigned char*)dtAlloc(sizes[j], DT_ALLOC_PERM);
+			ok = data.data && fread(data.data, sizes[j], 1, reader.fp) == 1;
+			if (data.data)
+				tile.ndata++;
+		}
+		if (!ok)
+		{
+			freeBakeTile(tile);
+			continue;
+		}
+		tile.hash = entry.hash;
+		tile.cached = true;
+	}
+}
+
+static void closeBakeCache(BakeCacheReader& reader)
+{
+	if (reader.fp)
+		fclose(reader.fp);
+	reader.fp = nullptr;
+	reader.entries.clear();
+}
+
+// Writes the build cache as the tiles are built. The cache is written next to the previous one, which
+// is still being read, and replaces it when it is complete. The number of tiles is written last.
+struct BakeCacheWriter
+{
+	FILE* fp = nullptr;
+	std::string path;
+	std::string tmpPath;
+	BakeCacheHeader header;
+};
+
+static bool beginBakeCache(BakeCacheWriter& writer, const char* path, const int tileWidth, const int tileHeight)
+{
+	writer.path = path;
+	writer.tmpPath = writer.path + ".tmp";
+	writer.header.magic = BAKECACHE_MAGIC;
+	writer.header.version = BAKECACHE_VERSION;
+	writer.header.tileWidth = tileWidth;
+	writer.header.tileHeight = tileHeight;
+	writer.header.numTiles = 0;
+	writer.fp = fopen(writer.tmpPath.c_str(), "wb");
+	return writer.fp && fwrite(&writer.header, sizeof(writer.header), 1, writer.fp) == 1;
+}
+
+// Writes the tiles that were built or taken from the cache. The tiles that failed are left out.
+static bool writeBakeCacheTiles(BakeCacheWriter& writer, const BakeTile* tiles, const int* tileIndices, const int count)
+{
+	bool ok = true;
+	for (int i = 0; i < count && ok; ++i)
+	{
+		const BakeTile& tile = tiles[i];
+		if ((!tile.built && !tile.cached) || tile.error)
+			continue;
+
+		BakeCacheTileHeader tileHeader;
+		memset(&tileHeader, 0, sizeof(tileHeader));
+		tileHeader.hash = tile.hash;
+		tileHeader.tileIndex = tileIndices[i];
+		tileHeader.numData = tile.ndata;
+		int sizes[VOXEL_MAX_LAYERS];
+		for (int j = 0; j < tile.ndata; ++j)
+			sizes[j] = tile.data[j].dataSize;
+		ok = fwrite(&tileHeader, sizeof(tileHeader), 1, writer.fp) == 1 &&
+			 (tile.ndata == 0 || fwrite(sizes, sizeof(int), tile.ndata, writer.fp) == (size_t)tile.ndata);
+		for (int j = 0; j < tile.ndata && ok; ++j)
+			ok = fwrite(tile.data[j].data, tile.data[j].dataSize, 1, writer.fp) == 1;
+		writer.header.numTiles++;
+	}
+	return ok;
+}
+
+// Writes the number of tiles and replaces the previous cache, or drops the new cache if it is not complete.
+static bool endBakeCache(BakeCacheWriter& writer, bool ok)
+{
+	if (!writer.fp)
+		return false;
+	ok = ok && fseek(writer.fp, 0, SEEK_SET) == 0 && fwrite(&writer.header, sizeof(writer.header), 1, writer.fp) == 1;
+	ok = fclose(writer.fp) == 0 && ok;
+	writer.fp = nullptr;
+	if (ok)
+	{
+		remove(writer.path.c_str());
+		ok = rename(writer.tmpPath.c_str(), writer.path.c_str()) == 0;
+	}
+	if (!ok)
+		remove(writer.tmpPath.c_str());
+	return ok;
+}
+
+// Writes the tiles in the navmesh set format. The tiles are added to a navmesh to get their references.
+static bool saveNavMeshSet(rcContext* ctx, const char* path, const dtNavMeshParams& params,
+						   const BakeTile* tiles, const int tileCount, int& polyCount)
+{
+	dtNavMesh* mesh = dtAllocNavMesh();
+	if (!mesh || dtStatusFailed(mesh->init(&params)))
+	{
+		dtFreeNavMesh(mesh);
+		ctx->log(RC_LOG_ERROR, "saveNavMeshSet: Could not init navmesh.");
+		return false;
+	}
+
+	std::vector<dtTileRef> refs(tileCount, 0);
+	NavMeshSetHeader header;
+	header.magic = NAVMESHSET_MAGIC;
+	header.version = NAVMESHSET_VERSION;
+	header.numTiles = 0;
+	memcpy(&header.params, &params, sizeof(params));
+	polyCount = 0;
+	for (int i = 0; i < tileCount; ++i)
+	{
+		const BakeTile& tile = tiles[i];
+		if (tile.ndata == 0)
+			continue;
+		// The navmesh does not own the data of the tiles.
+		if (dtStatusFailed(mesh->addTile(tile.data[0].data, tile.data[0].dataSize, 0, 0, &refs[i])))
+		{
+			ctx->log(RC_LOG_ERROR, "saveNavMeshSet: Could not add tile (%d).", i);
+			continue;
+		}
+		header.numTiles++;
+		polyCount += ((const dtMeshHeader*)tile.data[0].data)->polyCount;
+	}
+	dtFreeNavMesh(mesh);
+
+	FILE* fp = fopen(path, "wb");
+	bool ok = fp && fwrite(&header, sizeof(header), 1, fp) == 1;
+	for (int i = 0; i < tileCount && ok; ++i)
+	{
+		if (!refs[i])
+			continue;
+		NavMeshTileHeader tileHeader;
+		tileHeader.tileRef = refs[i];
+		tileHeader.dataSize = tiles[i].data[0].dataSize;
+		ok = fwrite(&tileHeader, sizeof(tileHeader), 1, fp) == 1 &&
+			 fwrite(tiles[i].data[0].data, tileHeader.dataSize, 1, fp) == 1;
+	}
+	if (fp)
+		fclose(fp);
+	if (!ok)
+		ctx->log(RC_LOG_ERROR, "saveNavMeshSet: Could not write '%s'.", path);
+	return ok;
+}
+
+// Writes the navmesh set as the tiles are built, like the streamed build of Sample_Voxels. The tiles are
+// written without references, they get the same references when they are added to the navmesh in order.
+struct NavMeshSetWriter
+{
+	FILE* fp = nullptr;
+	NavMeshSetHeader header;
+	int polyCount = 0;
+};
+
+static bool beginNavMeshSet(rcContext* ctx, NavMeshSetWriter& writer, const char* path, const dtNavMeshParams& params)
+{
+	writer.header.magic = NAVMESHSET_MAGIC;
+	writer.header.version = NAVMESHSET_VERSION;
+	writer.header.numTiles = 0;
+	memcpy(&writer.header.params, &params, sizeof(params));
+	writer.fp = fopen(path, "wb");
+	if (!writer.fp || fwrite(&writer.header, sizeof(writer.header), 1, writer.fp) != 1)
+	{
+		ctx->log(RC_LOG_ERROR, "beginNavMeshSet: Could not write '%s'.", path);
+		return false;
+	}
+	return true;
+}
+
+static bool writeNavMeshSetTiles(rcContext* ctx, NavMeshSetWriter& writer, const char* path, const BakeTile* tiles, const int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		const BakeTile& tile = tiles[i];
+		if (tile.ndata == 0)
+			continue;
+		NavMeshTileHeader tileHeader;
+		tileHeader.tileRef = 0;
+		tileHeader.dataSize = tile.data[0].dataSize;
+		if (fwrite(&tileHeader, sizeof(tileHeader), 1, writer.fp) != 1 ||
+			fwrite(tile.data[0].data, tileHeader.dataSize, 1, writer.fp) != 1)
+		{
+			ctx->log(RC_LOG_ERROR, "writeNavMeshSetTiles: Could not write '%s'.", path);
+			return false;
+		}
+		writer.header.numTiles++;
+		writer.polyCount += ((const dtMeshHeader*)tile.data[0].data)->polyCount;
+	}
+	return true;
+}
+
+// The number of tiles is known once they are all written.
+static bool endNavMeshSet(rcContext* ctx, NavMeshSetWriter& writer, const char* path, bool ok)
+{
+	if (!writer.fp)
+		return false;
+	if (ok && (fseek(writer.fp, 0, SEEK_SET) != 0 || fwrite(&writer.header, sizeof(writer.header), 1, writer.fp) != 1))
+	{
+		ctx->log(RC_LOG_ERROR, "endNavMeshSet: Could not write '%s'.", path);
+		ok = false;
+	}
+	fclose(writer.fp);
+	writer.fp = nullptr;
+	return ok;
+}
+
+// Writes the layers in the tile cache set format. The layers are added to a tile cache to get their references.
+static bool saveTileCacheSet(rcContext* ctx, const char* path, const dtNavMeshParams& meshParams,
+							 const dtTileCacheParams& cacheParams, const BakeTile* tiles, const int tileCount,
+							 int& layerCount)
+{
+	dtTileCacheAlloc talloc;
+	FastLZCompressor tcomp;
+	dtTileCache* tileCache = dtAllocTileCache();
+	if (!tileCache || dtStatusFailed(tileCache->init(&cacheParams, &talloc, &tcomp, 0)))
+	{
+		dtFreeTileCache(tileCache);
+		ctx->log(RC_LOG_ERROR, "saveTileCacheSet: Could not init tile cache.");
+		return false;
+	}
+
+	std::vector<dtCompressedTileRef> refs;
+	std::vector<const BakeData*> layers;
+	for (int i = 0; i < tileCount; ++i)
+	{
+		for (int j = 0; j < tiles[i].ndata; ++j)
+		{
+			// The tile cache does not own the data of the layers.
+			const BakeData& data = tiles[i].data[j];
+			dtCompressedTileRef ref = 0;
+			if (dtStatusFailed(tileCache->addTile(data.data, data.dataSize, 0, &ref)))
+			{
+				ctx->log(RC_LOG_ERROR, "saveTileCacheSet: Could not add layer %d of tile (%d).", j, i);
+				continue;
+			}
+			refs.push_back(ref);
+			layers.push_back(&data);
+		}
+	}
+	dtFreeTileCache(tileCache);
+	layerCount = (int)layers.size();
+
+	TileCacheSetHeader header;
+	header.magic = TILECACHESET_MAGIC;
+	header.version = TILECACHESET_VERSION;
+	header.numTiles = layerCount;
+	memcpy(&header.meshParams, &meshParams, sizeof(meshParams));
+	memcpy(&header.cacheParams, &cacheParams, sizeof(cacheParams));
+
+	FILE* fp = fopen(path, "wb");
+	bool ok = fp && fwrite(&header, sizeof(header), 1, fp) == 1;
+	for (int i = 0; i < layerCount && ok; ++i)
+	{
+		TileCacheTileHeader tileHeader;
+		tileHeader.tileRef = refs[i];
+		tileHeader.dataSize = layers[i]->dataSize;
+		ok = fwrite(&tileHeader, sizeof(tileHeader), 1, fp) == 1 &&
+			 fwrite(layers[i]->data, tileHeader.dataSize, 1, fp) == 1;
+	}
+	if (fp)
+		fclose(fp);
+	if (!ok)
+		ctx->log(RC_LOG_ERROR, "saveTileCacheSet: Could not write '%s'.", path);
+	return ok;
+}
+
+// Writes the stages of the tile builds as comma separated values, one stage per row. The times
+// and the allocations are summed over the workers, the peak memory is the largest of any tile.
+static bool saveReport(const char* path, const StageContext* contexts, const int ncontexts)
+{
+	FILE* fp = fopen(path, "w");
+	if (!fp)
+		return false;
+	fprintf(fp, "stage,calls,total_ms,max_ms,peak_kb,allocs\n");
+	for (int i = 0; i < MAX_STAGES; ++i)
+	{
+		StageContext::Stage sum;
+		memset(&sum, 0, sizeof(sum));
+		for (int j = 0; j < ncontexts; ++j)
+		{
+			const StageContext::Stage& stage = contexts[j].getStage(i);
+			sum.calls += stage.calls;
+			sum.time += stage.time;
+			sum.maxTime = rcMax(sum.maxTime, stage.maxTime);
+			sum.peak = rcMax(sum.peak, stage.peak);
+			sum.allocs += stage.allocs;
+		}
+		if (sum.calls == 0)
+			continue;
+		fprintf(fp, "%s,%d,%.3f,%.3f,%.1f,%lld\n", getStageName(i), sum.calls,
+				sum.time/1000.0, sum.maxTime/1000.0, sum.peak/1024.0, sum.allocs);
+	}
+	const bool ok = ferror(fp) == 0;
+	fclose(fp);
+	return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t hashBuildSettings(const BakeSettings& s, const rcConfig& cfg)
+{
+	uint64_t hash = HashBytes(&cfg, sizeof(cfg));
+	hash = HashBytes(&s.tileCache, sizeof(s.tileCache), hash);
+	hash = HashBytes(&s.build.partitionType, sizeof(s.build.partitionType), hash);
+	hash = HashBytes(&s.build.agentHeight, sizeof(s.build.agentHeight), hash);
+	hash = HashBytes(&s.build.agentRadius, sizeof(s.build.agentRadius), hash);
+	return HashBytes(&s.build.agentMaxClimb, sizeof(s.build.agentMaxClimb), hash);
+}
+
+// Sets up the tiles of a mesh, the convex volumes and off-mesh connections are part of every tile.
+static bool initMeshJob(rcContext* ctx, BakeJob& job)
+{
+	const BakeSettings& s = *job.settings;
+	InputGeom* geom = job.geom;
+	const float* bmin = geom->getNavMeshBoundsMin();
+	const float* bmax = geom->getNavMeshBoundsMax();
+
+	rcConfig& cfg = job.cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = s.build.cellSize;
+	cfg.ch = s.build.cellHeight;
+	cfg.walkableSlopeAngle = s.build.agentMaxSlope;
+	cfg.walkableHeight = (int)ceilf(s.build.agentHeight / cfg.ch);
+	cfg.walkableClimb = (int)floorf(s.build.agentMaxClimb / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(s.build.agentRadius / cfg.cs);
+	cfg.maxEdgeLen = (int)(s.build.edgeMaxLen / cfg.cs);
+	cfg.maxSimplificationError = s.build.edgeMaxError;
+	cfg.minRegionArea = (int)rcSqr(s.build.regionMinSize);		// Note: area = size*size
+	cfg.mergeRegionArea = (int)rcSqr(s.build.regionMergeSize);	// Note: area = size*size
+	cfg.maxVertsPerPoly = (int)s.build.vertsPerPoly;
+	cfg.tileSize = (int)s.build.tileSize;
+	cfg.borderSize = cfg.walkableRadius + 3; // Reserve enough padding.
+	cfg.width = cfg.tileSize + cfg.borderSize*2;
+	cfg.height = cfg.tileSize + cfg.borderSize*2;
+	cfg.detailSampleDist = s.build.detailSampleDist < 0.9f ? 0 : cfg.cs * s.build.detailSampleDist;
+	cfg.detailSampleMaxError = cfg.ch * s.build.detailSampleMaxError;
+	rcVcopy(cfg.bmin, bmin);
+	rcVcopy(cfg.bmax, bmax);
+
+	if (cfg.tileSize <= 0)
+	{
+		ctx->log(RC_LOG_ERROR, "Invalid tile size %d.", cfg.tileSize);
+		return false;
+	}
+
+	int gw = 0, gh = 0;
+	rcCalcGridSize(bmin, bmax, cfg.cs, &gw, &gh);
+	job.tileWidth = (gw + cfg.tileSize-1) / cfg.tileSize;
+	job.tileHeight = (gh + cfg.tileSize-1) / cfg.tileSize;
+
+	// The volumes are indexed by tile, so each tile only visits the volumes overlapping it.
+	job.vset = geom->getAreaVolumeSet(ctx, cfg.tileSize*cfg.cs);
+	if (!job.vset)
+		return false;
+
+	// The convex volumes and off-mesh connections are hashed by the tiles they touch.
+	job.settingsHash = hashBuildSettings(s, cfg);
+	return true;
+}
+
+// Sets up the tiles of a voxel scene like Sample_Voxels, the tiles are aligned to the regions of the scene.
+static bool initSceneJob(rcContext* ctx, BakeJob& job, const CellAreaTable& areaTable)
+{
+	const BakeSettings& s = *job.settings;
+	Scene* scene = job.scene;
+
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	scene->SetConfig(&cfg);
+	scene->SetAreaTable(areaTable);
+	cfg.walkableSlopeAngle = s.build.agentMaxSlope;
+	cfg.walkableHeight = (int)ceilf(s.build.agentHeight / cfg.ch);
+	cfg.walkableClimb = (int)floorf(s.build.agentMaxClimb / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(s.build.agentRadius / cfg.cs);
+	cfg.maxEdgeLen = (int)(s.build.edgeMaxLen / cfg.cs);
+	cfg.maxSimplificationError = s.build.edgeMaxError;
+	cfg.minRegionArea = (int)rcSqr(s.build.regionMinSize);		// Note: area = size*size
+	cfg.mergeRegionArea = (int)rcSqr(s.build.regionMergeSize);	// Note: area = size*size
+	cfg.maxVertsPerPoly = (int)s.build.vertsPerPoly;
+	cfg.detailSampleDist = s.build.detailSampleDist < 0.9f ? 0 : cfg.cs * s.build.detailSampleDist;
+	cfg.detailSampleMaxError = cfg.ch * s.build.detailSampleMaxError;
+
+	if (s.tileRegions <= 0)
+	{
+		ctx->log(RC_LOG_ERROR, "Invalid tile size %d regions.", s.tileRegions);
+		return false;
+	}
+
+	VoxelTileSettings& settings = job.voxelSettings;
+	settings.cfg = cfg;
+	settings.cfg.tileSize = s.tileRegions * scene->GetRegionSize();
+	settings.cfg.borderSize = cfg.walkableRadius + 3; // Reserve enough padding.
+	settings.cfg.width = settings.cfg.tileSize + settings.cfg.borderSize*2;
+	settings.cfg.height = settings.cfg.tileSize + settings.cfg.borderSize*2;
+	settings.tileWidth = (cfg.width + settings.cfg.tileSize-1) / settings.cfg.tileSize;
+	settings.skipDynamic = s.tileCache;
+	settings.areaTable = &areaTable;
+	settings.partitionType = s.build.partitionType;
+	settings.agentHeight = s.build.agentHeight;
+	settings.agentRadius = s.build.agentRadius;
+	settings.agentMaxClimb = s.build.agentMaxClimb;
+
+	job.cfg = settings.cfg;
+	job.tileWidth = settings.tileWidth;
+	job.tileHeight = (cfg.height + settings.cfg.tileSize-1) / settings.cfg.tileSize;
+	job.settingsHash = HashBytes(&s.tileCache, sizeof(s.tileCache), hashVoxelTileSettings(settings));
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <settings file> [key=value ...]\n", argv[0]);
+		return 1;
+	}
+
+	// Count the allocations before anything is allocated.
+	installAllocCounter();
+
+	BuildContext ctx;
+	const TimeVal startTime = getPerfTime();
+
+	std::vector<BakeSetting> pairs;
+	bool ok = readSettingsFile(&ctx, argv[1], pairs);
+	for (int i = 2; i < argc && ok; ++i)
+	{
+		BakeSetting setting;
+		if (!parseSetting(argv[i], setting))
+		{
+			ctx.log(RC_LOG_ERROR, "Expected key=value, got '%s'.", argv[i]);
+			ok = false;
+			break;
+		}
+		pairs.push_back(setting);
+	}
+
+	// The build settings of a geometry set are the defaults of the settings that are not given.
+	BakeSettings settings;
+	resetBakeSettings(settings);
+	for (size_t i = 0; i < pairs.size() && ok; ++i)
+	{
+		if (pairs[i].key == "input")
+			settings.input = pairs[i].value;
+	}
+
+	InputGeom* geom = nullptr;
+	Scene* scene = nullptr;
+	CellAreaTable areaTable;
+	setDefaultVoxelAreaTable(areaTable);
+	if (ok && settings.input.empty())
+	{
+		ctx.log(RC_LOG_ERROR, "No input.");
+		ok = false;
+	}
+	else if (ok && isVoxelScene(settings.input))
+	{
+		scene = new Scene;
+		for (size_t i = 0; i < pairs.size() && ok; ++i)
+			ok = applySetting(&ctx, pairs[i], settings);
+		if (ok && settings.streamRegions && settings.tileCache)
+		{
+			ctx.log(RC_LOG_ERROR, "The tile cache of a scene cannot be built from streamed regions.");
+			ok = false;
+		}
+		if (ok)
+			ok = settings.streamRegions ? scene->Open(&ctx, settings.input.c_str()) : scene->Load(&ctx, settings.input.c_str());
+	}
+	else if (ok)
+	{
+		geom = new InputGeom;
+		ok = geom->load(&ctx, settings.input);
+		if (ok && geom->getBuildSettings())
+		{
+			const BuildSettings* build = geom->getBuildSettings();
+			settings.build = *build;
+			if (build->tileSize <= 0)
+				settings.build.tileSize = 32;
+		}
+		for (size_t i = 0; i < pairs.size() && ok; ++i)
+			ok = applySetting(&ctx, pairs[i], settings);
+	}
+
+	if (ok && settings.build.vertsPerPoly > DT_VERTS_PER_POLYGON)
+	{
+		ctx.log(RC_LOG_ERROR, "Too many vertices per polygon %d (max: %d).", (int)settings.build.vertsPerPoly, DT_VERTS_PER_POLYGON);
+		ok = false;
+	}
+	if (ok && settings.threads > 0)
+		ctx.setWorkerCount(settings.threads);
+
+	BakeJob job;
+	memset(&job, 0, sizeof(job));
+	job.settings = &settings;
+	job.geom = geom;
+	job.scene = scene;
+	if (ok)
+		ok = scene ? initSceneJob(&ctx, job, areaTable) : initMeshJob(&ctx, job);
+
+	const int tw = job.tileWidth;
+	const int th = job.tileHeight;
+	const int ts = job.cfg.tileSize;
+	if (ok && settings.tileCache && job.cfg.width > 255)
+	{
+		// The layers of the tile cache store their size in bytes.
+		ctx.log(RC_LOG_ERROR, "Tile too large for the tile cache %d (max: %d).", job.cfg.width, 255);
+		ok = false;
+	}
+
+	const int tileCount = tw*th;
+	const int maxTiles = settings.tileCache ? tileCount*EXPECTED_LAYERS_PER_TILE : tileCount;
+	const int tileBits = rcMin((int)dtIlog2(dtNextPow2(maxTiles)), 14);
+	const int polyBits = 22 - tileBits;
+	if (ok && maxTiles > (1 << tileBits))
+	{
+		ctx.log(RC_LOG_ERROR, "Too many tiles %d (max: %d).", maxTiles, 1 << tileBits);
+		ok = false;
+	}
+
+	const TimeVal loadTime = getPerfTime();
+
+	dtNavMeshParams meshParams;
+	memset(&meshParams, 0, sizeof(meshParams));
+	rcVcopy(meshParams.orig, job.cfg.bmin);
+	meshParams.tileWidth = ts*job.cfg.cs;
+	meshParams.tileHeight = ts*job.cfg.cs;
+	meshParams.maxTiles = 1 << tileBits;
+	meshParams.maxPolys = 1 << polyBits;
+
+	const bool streamed = scene && settings.streamRegions;
+	BakeTile* tiles = nullptr;
+	BakeTile* cacheTiles = nullptr;
+	BakeCacheReader cacheReader;
+	BakeCacheWriter cacheWriter;
+	bool writeCache = false;
+	NavMeshSetWriter meshWriter;
+	const int workerCount = ctx.getWorkerCount();
+	StageContext* contexts = new StageContext[workerCount];
+	int maxLoadedRegions = 0;
+	int builtCount = 0;
+	int cachedCount = 0;
+	int failedCount = 0;
+	std::vector<int> tileIndices;
+	if (ok)
+	{
+		if (!settings.cachePath.empty())
+		{
+			openBakeCache(cacheReader, settings.cachePath.c_str(), tw, th);
+			writeCache = beginBakeCache(cacheWriter, settings.cachePath.c_str(), tw, th);
+			if (!writeCache)
+				ctx.log(RC_LOG_WARNING, "Could not write the build cache '%s'.", settings.cachePath.c_str());
+		}
+
+		ctx.log(RC_LOG_PROGRESS, "Baking %s of '%s':", settings.tileCache ? "tile cache" : "navmesh", settings.input.c_str());
+		ctx.log(RC_LOG_PROGRESS, " - %d x %d tiles of %d x %d cells, %d workers", tw, th, ts, ts, workerCount);
+
+		BakeTilesTask task;
+		task.job = &job;
+		task.contexts = contexts;
+		if (streamed)
+		{
+			// The window spans a few tiles along x, and slides along y through the world one band of
+			// tiles at a time, like the streamed build of Sample_Voxels. The tiles of a window are
+			// written out and freed before the next window is built.
+			VoxelTileWindow window;
+			initVoxelTileWindow(window, tw, th, settings.streamWindowTiles);
+			tiles = new BakeTile[window.windowTiles];
+			cacheTiles = new BakeTile[window.windowTiles];
+			memset(tiles, 0, sizeof(BakeTile)*window.windowTiles);
+			memset(cacheTiles, 0, sizeof(BakeTile)*window.windowTiles);
+			task.tiles = tiles;
+			job.cache = cacheReader.fp ? cacheTiles : nullptr;
+
+			ok = beginNavMeshSet(&ctx, meshWriter, settings.output.c_str(), meshParams);
+			while (ok && nextVoxelTileWindow(window))
+			{
+				const int bw = window.bw;
+				if (!loadVoxelTileWindow(&ctx, scene, job.voxelSettings, window))
+				{
+					ctx.log(RC_LOG_ERROR, "Could not load the regions of tiles (%d..%d,%d).", window.bx, window.bx+bw-1, window.ty);
+					ok = false;
+					break;
+				}
+
+				tileIndices.clear();
+				for (int tx = window.bx; tx < window.bx+bw; ++tx)
+					tileIndices.push_back(window.ty*tw + tx);
+				readBakeCacheTiles(cacheReader, tileIndices.data(), bw, cacheTiles);
+				task.tileIndices = tileIndices.data();
+				ctx.runParallel(task, bw);
+
+				countBakeTiles(&ctx, tiles, tileIndices.data(), bw, tw, builtCount, cachedCount, failedCount);
+				ok = writeNavMeshSetTiles(&ctx, meshWriter, settings.output.c_str(), tiles, bw);
+				if (ok && writeCache && !writeBakeCacheTiles(cacheWriter, tiles, tileIndices.data(), bw))
+				{
+					ctx.log(RC_LOG_WARNING, "Could not write the build cache '%s'.", settings.cachePath.c_str());
+					endBakeCache(cacheWriter, false);
+					writeCache = false;
+				}
+				for (int i = 0; i < bw; ++i)
+				{
+					freeBakeTile(tiles[i]);
+					freeBakeTile(cacheTiles[i]);
+				}
+				memset(tiles, 0, sizeof(BakeTile)*bw);
+			}
+			ok = endNavMeshSet(&ctx, meshWriter, settings.output.c_str(), ok) && ok;
+			maxLoadedRegions = window.maxLoadedRegions;
+		}
+		else
+		{
+			tiles = new BakeTile[tileCount];
+			cacheTiles = new BakeTile[tileCount];
+			memset(tiles, 0, sizeof(BakeTile)*tileCount);
+			for (int i = 0; i < tileCount; ++i)
+				tileIndices.push_back(i);
+			readBakeCacheTiles(cacheReader, tileIndices.data(), tileCount, cacheTiles);
+			task.tiles = tiles;
+			task.tileIndices = tileIndices.data();
+			job.cache = cacheReader.fp ? cacheTiles : nullptr;
+			ctx.runParallel(task, tileCount);
+			countBakeTiles(&ctx, tiles, tileIndices.data(), tileCount, tw, builtCount, cachedCount, failedCount);
+		}
+		closeBakeCache(cacheReader);
+	}
+
+	const TimeVal buildTime = getPerfTime();
+
+	if (ok && !streamed)
+	{
+		if (settings.tileCache)
+		{
+			dtTileCacheParams cacheParams;
+			memset(&cacheParams, 0, sizeof(cacheParams));
+			rcVcopy(cacheParams.orig, job.cfg.bmin);
+			cacheParams.cs = job.cfg.cs;
+			cacheParams.ch = job.cfg.ch;
+			cacheParams.width = ts;
+			cacheParams.height = ts;
+			cacheParams.walkableHeight = settings.build.agentHeight;
+			cacheParams.walkableRadius = settings.build.agentRadius;
+			cacheParams.walkableClimb = settings.build.agentMaxClimb;
+			cacheParams.maxSimplificationError = settings.build.edgeMaxError;
+			cacheParams.maxTiles = tileCount*EXPECTED_LAYERS_PER_TILE;
+			// Leave room for an obstacle per dynamic object of a scene, opened and closed again.
+			cacheParams.maxObstacles = scene ? rcMax(scene->GetDynamicObjectCount()*2, 1) : 128;
+
+			int layerCount = 0;
+			ok = saveTileCacheSet(&ctx, settings.output.c_str(), meshParams, cacheParams, tiles, tileCount, layerCount);
+			if (ok)
+				ctx.log(RC_LOG_PROGRESS, ">> Tile cache: %d layers, written to '%s'", layerCount, settings.output.c_str());
+		}
+		else
+		{
+			int polyCount = 0;
+			ok = saveNavMeshSet(&ctx, settings.output.c_str(), meshParams, tiles, tileCount, polyCount);
+			if (ok)
+				ctx.log(RC_LOG_PROGRESS, ">> Navmesh: %d polygons, written to '%s'", polyCount, settings.output.c_str());
+		}
+
+		if (ok && writeCache && !writeBakeCacheTiles(cacheWriter, tiles, tileIndices.data(), tileCount))
+		{
+			ctx.log(RC_LOG_WARNING, "Could not write the build cache '%s'.", settings.cachePath.c_str());
+			endBakeCache(cacheWriter, false);
+			writeCache = false;
+		}
+	}
+	else if (ok)
+	{
+		ctx.log(RC_LOG_PROGRESS, ">> Navmesh: %d polygons, written to '%s'", meshWriter.polyCount, settings.output.c_str());
+	}
+
+	// The cache of a bake that could not be written is dropped, the previous cache is kept.
+	if (writeCache && !endBakeCache(cacheWriter, ok) && ok)
+		ctx.log(RC_LOG_WARNING, "Could not write the build cache '%s'.", settings.cachePath.c_str());
+	if (ok && !settings.reportPath.empty() && !saveReport(settings.reportPath.c_str(), contexts, workerCount))
+		ctx.log(RC_LOG_WARNING, "Could not write the report '%s'.", settings.reportPath.c_str());
+
+	const TimeVal endTime = getPerfTime();
+
+	if (tiles)
+	{
+		ctx.log(RC_LOG_PROGRESS, ">> %d tiles built, %d from the cache, %d failed", builtCount, cachedCount, failedCount);
+		if (streamed)
+			ctx.log(RC_LOG_PROGRESS, ">> At most %d of %d regions loaded", maxLoadedRegions, scene->GetRegionWidth()*scene->GetRegionHeight());
+		ctx.log(RC_LOG_PROGRESS, ">> Load %.1fms, build %.1fms, write %.1fms",
+				getPerfTimeUsec(loadTime - startTime)/1000.0f, getPerfTimeUsec(buildTime - loadTime)/1000.0f,
+				getPerfTimeUsec(endTime - buildTime)/1000.0f);
+		// The cells of the scene are allocated with new, only the Recast and Detour allocations are counted.
+		ctx.log(RC_LOG_PROGRESS, ">> Peak Recast/Detour memory %.1fKB", getAllocPeak()/1024.0f);
+	}
+
+	// The tiles of a streamed bake were freed window by window.
+	const int tilesLeft = streamed ? 0 : tileCount;
+	for (int i = 0; tiles && i < tilesLeft; ++i)
+	{
+		freeBakeTile(tiles[i]);
+		freeBakeTile(cacheTiles[i]);
+	}
+	delete [] tiles;
+	delete [] cacheTiles;
+	delete [] contexts;
+	delete scene;
+	delete geom;
+
+	ctx.dumpLog("Baker:");
+	return ok && failedCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,685 @@
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Recast.h"
+#include "DetourAlloc.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "MeshLoaderObj.h"
+#include "SampleInterfaces.h"
+#include "StageStats.h"
+
+// Builds the navmesh of a fixed set of meshes stage by stage, and reports the time, the peak memory
+// and the allocations of each stage as JSON:
+//
+//   Bench [key=value ...]
+//
+// The meshes are the demo meshes and generated meshes that stress the pipeline: dense stairs,
+// a building with many floors and a huge flat plane. The stages are built on a single thread, so
+// that their time is stable, and the median time of several builds is reported.
+//
+// Given the results of a previous run as baseline, the stages that got slower or use more memory
+// than the tolerances allow are logged, and the benchmark fails.
+
+#ifdef WIN32
+#	define snprintf _snprintf
+#endif
+
+static const int BENCH_VERSION = 1;
+
+struct BenchSettings
+{
+	std::vector<std::string> meshPaths;
+	bool synthetic;				// Include the generated meshes.
+	std::string filter;			// Only the meshes whose name contains it, or all if empty.
+	std::string output;
+	std::string baseline;		// Empty to skip the comparison.
+	int iterations;
+	float timeTolerance;		// How much slower a stage may get, 0.25 for 25%. Negative to skip the times.
+	float minTimeMs;			// The stages may get this much slower regardless of the tolerance.
+	float memoryTolerance;		// How much the peak memory and the allocations of a stage may grow.
+};
+
+static void resetBenchSettings(BenchSettings& s)
+{
+	s.meshPaths.clear();
+	s.meshPaths.push_back("Meshes/dungeon.obj");
+	s.meshPaths.push_back("Meshes/nav_test.obj");
+	s.synthetic = true;
+	s.filter = "";
+	s.output = "bench.json";
+	s.baseline = "";
+	s.iterations = 5;
+	s.timeTolerance = 0.25f;
+	s.minTimeMs = 0.5f;
+	s.memoryTolerance = 0.05f;
+}
+
+static bool applySetting(rcContext* ctx, const char* arg, BenchSettings& s)
+{
+	const char* eq = strchr(arg, '=');
+	if (!eq)
+	{
+		ctx->log(RC_LOG_ERROR, "Expected key=value, got '%s'.", arg);
+		return false;
+	}
+	const std::string key(arg, eq - arg);
+	const char* value = eq + 1;
+
+	if (key == "meshes")
+	{
+		// A comma separated list of .obj files.
+		s.meshPaths.clear();
+		std::string paths(value);
+		size_t start = 0;
+		while (start <= paths.size())
+		{
+			size_t end = paths.find(',', start);
+			if (end == std::string::npos)
+				end = paths.size();
+			if (end > start)
+				s.meshPaths.push_back(paths.substr(start, end - start));
+			start = end + 1;
+		}
+	}
+	else if (key == "synthetic")
+		s.synthetic = atoi(value) != 0;
+	else if (key == "filter")
+		s.filter = value;
+	else if (key == "output")
+		s.output = value;
+	else if (key == "baseline")
+		s.baseline = value;
+	else if (key == "iterations")
+		s.iterations = rcMax(atoi(value), 1);
+	else if (key == "timeTolerance")
+		s.timeTolerance = (float)atof(value);
+	else if (key == "minTime")
+		s.minTimeMs = (float)atof(value);
+	else if (key == "memoryTolerance")
+		s.memoryTolerance = (float)atof(value);
+	else
+	{
+		ctx->log(RC_LOG_ERROR, "Invalid setting '%s'.", arg);
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct BenchMesh
+{
+	std::string name;
+	std::vector<float> verts;
+	std::vector<int> tris;
+};
+
+static bool loadObjMesh(const std::string& path, BenchMesh& mesh)
+{
+	rcMeshLoaderObj loader;
+	if (!loader.load(path))
+		return false;
+
+	// The name of the file without its folder and extension.
+	size_t start = path.find_last_of("/\\");
+	start = start == std::string::npos ? 0 : start + 1;
+	const size_t end = path.find_last_of('.');
+	mesh.name = path.substr(start, end == std::string::npos || end < start ? std::string::npos : end - start);
+	mesh.verts.assign(loader.getVerts(), loader.getVerts() + loader.getVertCount()*3);
+	mesh.tris.assign(loader.getTris(), loader.getTris() + loader.getTriCount()*3);
+	return true;
+}
+
+static void addVertex(BenchMesh& mesh, const float x, const float y, const float z)
+{
+	mesh.verts.push_back(x);
+	mesh.verts.push_back(y);
+	mesh.verts.push_back(z);
+}
+
+// Adds the quad a,b,c,d as two triangles. The quad faces up when it turns clockwise seen from above.
+static void addQuad(BenchMesh& mesh, const float* a, const float* b, const float* c, const float* d)
+{
+	const int v = (int)mesh.verts.size() / 3;
+	addVertex(mesh, a[0], a[1], a[2]);
+	addVertex(mesh, b[0], b[1], b[2]);
+	addVertex(mesh, c[0], c[1], c[2]);
+	addVertex(mesh, d[0], d[1], d[2]);
+	const int tris[6] = { v, v+1, v+2, v, v+2, v+3 };
+	mesh.tris.insert(mesh.tris.end(), tris, tris + 6);
+}
+
+// Adds the top and the sides of a box, the bottom cannot be walked on.
+static void addBox(BenchMesh& mesh, const float x0, const float y0, const float z0,
+				   const float x1, const float y1, const float z1)
+{
+	const float v[8][3] =
+	{
+		{ x0, y1, z0 }, { x0, y1, z1 }, { x1, y1, z1 }, { x1, y1, z0 },
+		{ x0, y0, z0 }, { x0, y0, z1 }, { x1, y0, z1 }, { x1, y0, z0 },
+	};
+	addQuad(mesh, v[0], v[1], v[2], v[3]);
+	addQuad(mesh, v[4], v[0], v[3], v[7]);
+	addQuad(mesh, v[7], v[3], v[2], v[6]);
+	addQuad(mesh, v[6], v[2], v[1], v[5]);
+	addQuad(mesh, v[5], v[1], v[0], v[4]);
+}
+
+// Rows of staircases going up and down again, with steps as deep as a cell.
+static void buildStairs(BenchMesh& mesh)
+{
+	mesh.name = "stairs";
+	const int columns = 4;
+	const int rows = 8;
+	const int steps = 64;
+	const float run = 0.3f;
+	const float rise = 0.15f;
+	const float width = 3.0f;
+	const float landing = 2.0f;
+	const float length = steps*run*2 + landing;
+	const float spacingX = length + 4.0f;
+	const float spacingZ = width + 1.0f;
+
+	addBox(mesh, -2.0f, -0.5f, -2.0f, columns*spacingX, 0.0f, rows*spacingZ + 1.0f);
+	for (int row = 0; row < rows; ++row)
+	{
+		for (int col = 0; col < columns; ++col)
+		{
+			const float x = col*spacingX;
+			const float z0 = row*spacingZ;
+			const float z1 = z0 + width;
+			for (int i = 0; i < steps; ++i)
+			{
+				const float h = (i+1)*rise;
+				addBox(mesh, x + i*run, 0.0f, z0, x + (i+1)*run, h, z1);
+				addBox(mesh, x + length - (i+1)*run, 0.0f, z0, x + length - i*run, h, z1);
+			}
+			addBox(mesh, x + steps*run, 0.0f, z0, x + steps*run + landing, steps*rise, z1);
+		}
+	}
+}
+
+// Floors connected by ramps, each floor divided into rooms by walls with doors.
+static void buildBuilding(BenchMesh& mesh)
+{
+	mesh.name = "building";
+	const int floors = 8;
+	const float floorHeight = 4.0f;
+	const float slab = 0.3f;
+	const float sizeX = 68.0f;
+	const float sizeZ = 40.0f;
+	// The ramps go up along x between rampX0 and rampX1, on alternating sides of the building.
+	const float rampX0 = 52.0f;
+	const float rampX1 = 60.0f;
+	const float rampZ[2][2] = { { 0.5f, 4.5f }, { 35.5f, 39.5f } };
+
+	for (int i = 0; i < floors; ++i)
+	{
+		const float y = i*floorHeight;
+		if (i == 0)
+		{
+			addBox(mesh, 0.0f, y - slab, 0.0f, sizeX, y, sizeZ);
+		}
+		else
+		{
+			// Leave a hole for the ramp coming up from the floor below.
+			const float* hole = rampZ[(i-1) & 1];
+			addBox(mesh, 0.0f, y - slab, 0.0f, sizeX, y, hole[0]);
+			addBox(mesh, 0.0f, y - slab, hole[1], sizeX, y, sizeZ);
+			addBox(mesh, 0.0f, y - slab, hole[0], rampX0, y, hole[1]);
+			addBox(mesh, rampX1, y - slab, hole[0], sizeX, y, hole[1]);
+		}
+
+		if (i+1 < floors)
+		{
+			const float* ramp = rampZ[i & 1];
+			const float a[3] = { rampX0, y, ramp[0] };
+			const float b[3] = { rampX0, y, ramp[1] };
+			const float c[3] = { rampX1, y + floorHeight, ramp[1] };
+			const float d[3] = { rampX1, y + floorHeight, ramp[0] };
+			addQuad(mesh, a, b, c, d);
+		}
+
+		for (float x = 8.0f; x < rampX0; x += 8.0f)
+		{
+			addBox(mesh, x - 0.1f, y, 6.0f, x + 0.1f, y + 3.0f, 19.0f);
+			addBox(mesh, x - 0.1f, y, 21.0f, x + 0.1f, y + 3.0f, 34.0f);
+		}
+	}
+}
+
+// A flat plane much larger than the other meshes.
+static void buildPlane(BenchMesh& mesh)
+{
+	mesh.name = "plane";
+	const int n = 40;
+	const float size = 400.0f;
+	const float s = size / n;
+	for (int z = 0; z < n; ++z)
+	{
+		for (int x = 0; x < n; ++x)
+		{
+			const float a[3] = { x*s, 0.0f, z*s };
+			const float b[3] = { x*s, 0.0f, (z+1)*s };
+			const float c[3] = { (x+1)*s, 0.0f, (z+1)*s };
+			const float d[3] = { (x+1)*s, 0.0f, z*s };
+			addQuad(mesh, a, b, c, d);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The intermediate results of a build.
+struct PipelineContext
+{
+	unsigned char* triareas = nullptr;
+	rcHeightfield* solid = nullptr;
+	rcCompactHeightfield* chf = nullptr;
+	rcContourSet* cset = nullptr;
+	rcPolyMesh* pmesh = nullptr;
+	rcPolyMeshDetail* dmesh = nullptr;
+	unsigned char* navData = nullptr;
+
+	~PipelineContext()
+	{
+		delete [] triareas;
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(chf);
+		rcFreeContourSet(cset);
+		rcFreePolyMesh(pmesh);
+		rcFreePolyMeshDetail(dmesh);
+		dtFree(navData);
+	}
+};
+
+// Builds the navmesh of the whole mesh like Sample_SoloMesh, with the settings of the samples.
+// Returns why the navmesh could not be built, or null.
+static const char* buildNavMesh(StageContext* ctx, const BenchMesh& mesh, int& polyCount)
+{
+	const float* verts = mesh.verts.data();
+	const int nverts = (int)mesh.verts.size() / 3;
+	const int* tris = mesh.tris.data();
+	const int ntris = (int)mesh.tris.size() / 3;
+
+	const float cellSize = 0.3f;
+	const float cellHeight = 0.2f;
+	const float agentHeight = 2.0f;
+	const float agentRadius = 0.6f;
+	const float agentMaxClimb = 0.9f;
+
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = cellSize;
+	cfg.ch = cellHeight;
+	cfg.walkableSlopeAngle = 45.0f;
+	cfg.walkableHeight = (int)ceilf(agentHeight / cfg.ch);
+	cfg.walkableClimb = (int)floorf(agentMaxClimb / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(agentRadius / cfg.cs);
+	cfg.maxEdgeLen = (int)(12.0f / cellSize);
+	cfg.maxSimplificationError = 1.3f;
+	cfg.minRegionArea = (int)rcSqr(8);		// Note: area = size*size
+	cfg.mergeRegionArea = (int)rcSqr(20);	// Note: area = size*size
+	cfg.maxVertsPerPoly = 6;
+	cfg.detailSampleDist = cellSize * 6.0f;
+	cfg.detailSampleMaxError = cellHeight * 1.0f;
+	rcCalcBounds(verts, nverts, cfg.bmin, cfg.bmax);
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+
+	PipelineContext pc;
+	pc.solid = rcAllocHeightfield();
+	if (!pc.solid || !rcCreateHeightfield(ctx, *pc.solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+		return "Could not create solid heightfield.";
+
+	pc.triareas = new unsigned char[ntris];
+	memset(pc.triareas, 0, ntris*sizeof(unsigned char));
+	rcMarkWalkableTriangles(ctx, cfg.walkableSlopeAngle, verts, nverts, tris, ntris, pc.triareas);
+	if (!rcRasterizeTriangles(ctx, verts, nverts, tris, pc.triareas, ntris, *pc.solid, cfg.walkableClimb))
+		return "Could not rasterize triangles.";
+	delete [] pc.triareas;
+	pc.triareas = nullptr;
+
+	rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, *pc.solid);
+	rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, *pc.solid);
+	rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, *pc.solid);
+
+	pc.chf = rcAllocCompactHeightfield();
+	if (!pc.chf || !rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *pc.solid, *pc.chf))
+		return "Could not build compact data.";
+	rcFreeHeightField(pc.solid);
+	pc.solid = nullptr;
+
+	if (!rcErodeWalkableArea(ctx, cfg.walkableRadius, *pc.chf))
+		return "Could not erode.";
+
+	if (!rcBuildDistanceField(ctx, *pc.chf))
+		return "Could not build distance field.";
+	if (!rcBuildRegions(ctx, *pc.chf, 0, cfg.minRegionArea, cfg.mergeRegionArea))
+		return "Could not build watershed regions.";
+
+	pc.cset = rcAllocContourSet();
+	if (!pc.cset || !rcBuildContours(ctx, *pc.chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *pc.cset))
+		return "Could not create contours.";
+
+	pc.pmesh = rcAllocPolyMesh();
+	if (!pc.pmesh || !rcBuildPolyMesh(ctx, *pc.cset, cfg.maxVertsPerPoly, *pc.pmesh))
+		return "Could not triangulate contours.";
+
+	pc.dmesh = rcAllocPolyMeshDetail();
+	if (!pc.dmesh || !rcBuildPolyMeshDetail(ctx, *pc.pmesh, *pc.chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *pc.dmesh))
+		return "Could not build detail mesh.";
+
+	rcPolyMesh& pmesh = *pc.pmesh;
+	if (pmesh.nverts >= 0xffff)
+		return "Too many vertices per navmesh.";
+	for (int i = 0; i < pmesh.npolys; ++i)
+		pmesh.flags[i] = 1;
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = pmesh.verts;
+	params.vertCount = pmesh.nverts;
+	params.polys = pmesh.polys;
+	params.polyAreas = pmesh.areas;
+	params.polyFlags = pmesh.flags;
+	params.polyCount = pmesh.npolys;
+	params.nvp = pmesh.nvp;
+	params.detailMeshes = pc.dmesh->meshes;
+	params.detailVerts = pc.dmesh->verts;
+	params.detailVertsCount = pc.dmesh->nverts;
+	params.detailTris = pc.dmesh->tris;
+	params.detailTriCount = pc.dmesh->ntris;
+	params.walkableHeight = agentHeight;
+	params.walkableRadius = agentRadius;
+	params.walkableClimb = agentMaxClimb;
+	rcVcopy(params.bmin, pmesh.bmin);
+	rcVcopy(params.bmax, pmesh.bmax);
+	params.cs = cfg.cs;
+	params.ch = cfg.ch;
+	params.buildBvTree = true;
+
+	int navDataSize = 0;
+	ctx->startStage(STAGE_CREATE_NAVMESH_DATA);
+	const bool created = dtCreateNavMeshData(&params, &pc.navData, &navDataSize);
+	ctx->stopStage(STAGE_CREATE_NAVMESH_DATA);
+	if (!created)
+		return "Could not build Detour navmesh.";
+
+	polyCount = pmesh.npolys;
+	return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The result of a stage of a mesh over all the builds.
+struct StageResult
+{
+	std::string mesh;
+	std::string stage;
+	int calls;
+	float timeMs;		// The median time of the builds.
+	float peakKb;
+	long long allocs;
+};
+
+struct MeshResult
+{
+	std::string name;
+	int triCount;
+	int polyCount;
+	const char* error;
+};
+
+// Builds the mesh several times and adds the stages it went through to the results.
+static void benchMesh(const BenchMesh& mesh, const int iterations, MeshResult& meshResult, std::vector<StageResult>& results)
+{
+	meshResult.name = mesh.name;
+	meshResult.triCount = (int)mesh.tris.size() / 3;
+	meshResult.polyCount = 0;
+	meshResult.error = nullptr;
+
+	std::vector<StageContext::Stage> stages(iterations*MAX_STAGES);
+	StageContext ctx;
+	for (int i = 0; i < iterations && !meshResult.error; ++i)
+	{
+		ctx.resetTimers();
+		ctx.startTimer(RC_TIMER_TOTAL);
+		meshResult.error = buildNavMesh(&ctx, mesh, meshResult.polyCount);
+		ctx.stopTimer(RC_TIMER_TOTAL);
+		for (int j = 0; j < MAX_STAGES; ++j)
+			stages[i*MAX_STAGES + j] = ctx.getStage(j);
+	}
+	if (meshResult.error)
+		return;
+
+	std::vector<long long> times(iterations);
+	for (int j = 0; j < MAX_STAGES; ++j)
+	{
+		StageResult result;
+		result.mesh = mesh.name;
+		result.stage = getStageName(j);
+		result.calls = 0;
+		result.peakKb = 0;
+		result.allocs = 0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			const StageContext::Stage& stage = stages[i*MAX_STAGES + j];
+			result.calls = rcMax(result.calls, stage.calls);
+			result.peakKb = rcMax(result.peakKb, stage.peak/1024.0f);
+			result.allocs = rcMax(result.allocs, stage.allocs);
+			times[i] = stage.time;
+		}
+		if (result.calls == 0)
+			continue;
+		std::sort(times.begin(), times.end());
+		result.timeMs = times[iterations/2] / 1000.0f;
+		results.push_back(result);
+	}
+}
+
+// Writes the results with one stage per line, so that they can be read back by loadBaseline.
+static bool saveResults(const char* path, const int iterations, const std::vector<MeshResult>& meshes,
+						const std::vector<StageResult>& results)
+{
+	FILE* fp = fopen(path, "w");
+	if (!fp)
+		return false;
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\"version\": %d,\n", BENCH_VERSION);
+	fprintf(fp, "\t\"iterations\": %d,\n", iterations);
+	fprintf(fp, "\t\"meshes\": [\n");
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const MeshResult& m = meshes[i];
+		fprintf(fp, "\t\t{ \"mesh\": \"%s\", \"triangles\": %d, \"polygons\": %d, \"error\": %s%s%s }%s\n",
+				m.name.c_str(), m.triCount, m.polyCount, m.error ? "\"" : "", m.error ? m.error : "null", m.error ? "\"" : "",
+				i+1 < meshes.size() ? "," : "");
+	}
+	fprintf(fp, "\t],\n");
+	fprintf(fp, "\t\"stages\": [\n");
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const StageResult& r = results[i];
+		fprintf(fp, "\t\t{ \"mesh\": \"%s\", \"stage\": \"%s\", \"calls\": %d, \"time_ms\": %.3f, \"peak_kb\": %.1f, \"allocs\": %lld }%s\n",
+				r.mesh.c_str(), r.stage.c_str(), r.calls, r.timeMs, r.peakKb, r.allocs, i+1 < results.size() ? "," : "");
+	}
+	fprintf(fp, "\t]\n");
+	fprintf(fp, "}\n");
+	const bool ok = ferror(fp) == 0;
+	fclose(fp);
+	return ok;
+}
+
+// Returns the value of a key of the JSON object on the line, without the quotes of a string.
+static bool findValue(const char* line, const char* key, std::string& value)
+{
+	char pattern[64];
+	snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+	const char* p = strstr(line, pattern);
+	if (!p)
+		return false;
+	p += strlen(pattern);
+	while (*p == ' ' || *p == '\t')
+		p++;
+	const char* end;
+	if (*p == '"')
+	{
+		p++;
+		end = strchr(p, '"');
+		if (!end)
+			return false;
+	}
+	else
+	{
+		end = p + strcspn(p, ",} \t\r\n");
+	}
+	value.assign(p, end - p);
+	return true;
+}
+
+// Reads the stages of the results written by saveResults.
+static bool loadBaseline(const char* path, std::vector<StageResult>& results)
+{
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+		return false;
+	char line[1024];
+	while (fgets(line, sizeof(line), fp))
+	{
+		StageResult r;
+		std::string calls, time, peak, allocs;
+		if (!findValue(line, "mesh", r.mesh) || !findValue(line, "stage", r.stage) ||
+			!findValue(line, "calls", calls) || !findValue(line, "time_ms", time) ||
+			!findValue(line, "peak_kb", peak) || !findValue(line, "allocs", allocs))
+			continue;
+		r.calls = atoi(calls.c_str());
+		r.timeMs = (float)atof(time.c_str());
+		r.peakKb = (float)atof(peak.c_str());
+		r.allocs = atoll(allocs.c_str());
+		results.push_back(r);
+	}
+	fclose(fp);
+	return true;
+}
+
+// Logs the stages that regressed compared to the baseline, and returns their number.
+// The stages missing from the baseline are new, and are not compared.
+static int compareResults(rcContext* ctx, const BenchSettings& s, const std::vector<StageResult>& results,
+						  const std::vector<StageResult>& baseline)
+{
+	int regressions = 0;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const StageResult& r = results[i];
+		const StageResult* base = nullptr;
+		for (size_t j = 0; j < baseline.size() && !base; ++j)
+		{
+			if (baseline[j].mesh == r.mesh && baseline[j].stage == r.stage)
+				base = &baseline[j];
+		}
+		if (!base)
+			continue;
+
+		if (s.timeTolerance >= 0.0f && r.timeMs > base->timeMs*(1.0f + s.timeTolerance) && r.timeMs - base->timeMs > s.minTimeMs)
+		{
+			ctx->log(RC_LOG_ERROR, "%s, %s: time %.2fms, was %.2fms", r.mesh.c_str(), r.stage.c_str(), r.timeMs, base->timeMs);
+			regressions++;
+		}
+		if (r.peakKb > base->peakKb*(1.0f + s.memoryTolerance) && r.peakKb - base->peakKb >= 1.0f)
+		{
+			ctx->log(RC_LOG_ERROR, "%s, %s: peak %.1fKB, was %.1fKB", r.mesh.c_str(), r.stage.c_str(), r.peakKb, base->peakKb);
+			regressions++;
+		}
+		if (r.allocs > base->allocs*(1.0f + s.memoryTolerance))
+		{
+			ctx->log(RC_LOG_ERROR, "%s, %s: %lld allocations, was %lld", r.mesh.c_str(), r.stage.c_str(), r.allocs, base->allocs);
+			regressions++;
+		}
+	}
+	return regressions;
+}
+
+int main(int argc, char** argv)
+{
+	// Count the allocations before anything is allocated.
+	installAllocCounter();
+
+	BuildContext ctx;
+	BenchSettings settings;
+	resetBenchSettings(settings);
+	bool ok = true;
+	for (int i = 1; i < argc && ok; ++i)
+		ok = applySetting(&ctx, argv[i], settings);
+
+	std::vector<BenchMesh> meshes;
+	for (size_t i = 0; i < settings.meshPaths.size() && ok; ++i)
+	{
+		meshes.push_back(BenchMesh());
+		if (!loadObjMesh(settings.meshPaths[i], meshes.back()))
+		{
+			ctx.log(RC_LOG_ERROR, "Could not load mesh '%s'.", settings.meshPaths[i].c_str());
+			ok = false;
+		}
+	}
+	if (ok && settings.synthetic)
+	{
+		meshes.resize(meshes.size() + 3);
+		buildStairs(meshes[meshes.size()-3]);
+		buildBuilding(meshes[meshes.size()-2]);
+		buildPlane(meshes[meshes.size()-1]);
+	}
+
+	std::vector<MeshResult> meshResults;
+	std::vector<StageResult> results;
+	for (size_t i = 0; i < meshes.size() && ok; ++i)
+	{
+		const BenchMesh& mesh = meshes[i];
+		if (!settings.filter.empty() && mesh.name.find(settings.filter) == std::string::npos)
+			continue;
+
+		MeshResult meshResult;
+		const size_t first = results.size();
+		benchMesh(mesh, settings.iterations, meshResult, results);
+		meshResults.push_back(meshResult);
+		if (meshResult.error)
+		{
+			ctx.log(RC_LOG_ERROR, "%s: %s", mesh.name.c_str(), meshResult.error);
+			ok = false;
+			continue;
+		}
+		const StageResult& total = results[first];
+		ctx.log(RC_LOG_PROGRESS, "%s: %d triangles, %d polygons, %.2fms, peak %.1fKB, %lld allocations",
+				mesh.name.c_str(), meshResult.triCount, meshResult.polyCount, total.timeMs, total.peakKb, total.allocs);
+	}
+
+	if (!meshResults.empty() && !saveResults(settings.output.c_str(), settings.iterations, meshResults, results))
+	{
+		ctx.log(RC_LOG_ERROR, "Could not write the results '%s'.", settings.output.c_str());
+		ok = false;
+	}
+
+	if (ok && !settings.baseline.empty())
+	{
+		std::vector<StageResult> baseline;
+		if (!loadBaseline(settings.baseline.c_str(), baseline))
+		{
+			ctx.log(RC_LOG_ERROR, "Could not read the baseline '%s'.", settings.baseline.c_str());
+			ok = false;
+		}
+		else
+		{
+			const int regressions = compareResults(&ctx, settings, results, baseline);
+			ctx.log(regressions ? RC_LOG_ERROR : RC_LOG_PROGRESS, ">> %d regressions compared to '%s'", regressions, settings.baseline.c_str());
+			ok = regressions == 0;
+		}
+	}
+
+	ctx.dumpLog("Bench:");
+	return ok ? 0 : 1;
+}
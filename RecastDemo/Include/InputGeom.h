@@ -94,6 +94,9 @@ class InputGeom
 	static const int MAX_VOLUMES = 256;
 	ConvexVolume m_volumes[MAX_VOLUMES];
 	int m_volumeCount;
+	struct rcAreaVolumeSet* m_volumeSet;
+	float m_volumeSetCellSize;
+	bool m_volumeSetDirty;
 	///@}
 	
 	bool loadMesh(class rcContext* ctx, const std::string& filepath);
@@ -139,6 +142,9 @@ public:
 						 const float minh, const float maxh, unsigned char area);
 	void deleteConvexVolume(int i);
 	void drawConvexVolumes(struct duDebugDraw* dd, bool hilight = false);
+	/// Returns the convex volumes indexed for rcMarkAreaVolumes, rebuilt when the volumes
+	/// or the index cell size have changed.
+	const struct rcAreaVolumeSet* getAreaVolumeSet(class rcContext* ctx, const float cellSize);
 	///@}
 	
 private:
@@ -22,10 +22,17 @@
 #include "DebugDraw.h"
 #include "Recast.h"
 #include "RecastDump.h"
+#include "RecastProfile.h"
 #include "PerfTimer.h"
 
 // These are example implementations of various interfaces used in Recast and Detour.
 
+class TempArena;
+
+/// Installs the Recast allocator that serves RC_ALLOC_TEMP allocations from the temp
+/// arenas of the build contexts. Must be called before any Recast memory is allocated.
+void installTempArenaAllocator();
+
 /// Recast build context.
 class BuildContext : public rcContext
 {
@@ -39,8 +46,52 @@ class BuildContext : public rcContext
 	char m_textPool[TEXT_POOL_SIZE];
 	int m_textPoolSize;
 	
+	int m_workerCount;
+	
+	duBuildProfiler m_buildProfiler;
+	
+	static const int MAX_TEMP_SCOPES = 32;
+	struct TempScope
+	{
+		rcTimerLabel label;
+		size_t base;
+		size_t peak;
+	};
+	TempArena* m_tempArenas;
+	int m_tempArenaCount;
+	bool m_tempArenaEnabled;
+	TempScope m_tempScopes[MAX_TEMP_SCOPES];
+	int m_tempScopeCount;
+	size_t m_tempPeak[RC_MAX_TIMERS];
+	
 public:
 	BuildContext();
+	virtual ~BuildContext();
+	
+	/// Sets the number of threads used to run parallel build tasks.
+	void setWorkerCount(const int count);
+	
+	/// Enables or disables recording the build profile. Enabling clears the previous profile.
+	void enableProfiling(bool state);
+	/// Returns true if the build profile is being recorded.
+	bool isProfiling() const { return m_profiler != 0; }
+	/// Returns the recorded build profile.
+	duBuildProfiler& getBuildProfiler() { return m_buildProfiler; }
+	/// Writes the recorded build profile as a Chrome trace and as comma separated values.
+	bool saveProfile(const char* tracePath, const char* csvPath);
+	
+	/// Enables or disables serving the temp allocations of the builds from per-thread arenas.
+	void enableTempArena(bool state);
+	/// Returns true if the temp allocations are served from the arenas.
+	bool isTempArenaEnabled() const { return m_tempArenaEnabled; }
+	/// Binds the build arena to the calling thread and reclaims the arenas. Call before building a tile.
+	void resetTempArenas();
+	/// Clears the peak temp memory usage of the build stages.
+	void resetTempUsage();
+	/// Returns the peak temp memory used by a build stage, including the workers of its parallel tasks.
+	size_t getTempPeak(const rcTimerLabel label) const { return m_tempPeak[label]; }
+	/// Logs the peak temp memory usage of the build stages.
+	void logTempUsage();
 	
 	/// Dumps the log to stdout.
 	void dumpLog(const char* format, ...);
@@ -58,6 +109,8 @@ protected:
 	virtual void doStartTimer(const rcTimerLabel label);
 	virtual void doStopTimer(const rcTimerLabel label);
 	virtual int doGetAccumulatedTime(const rcTimerLabel label) const;
+	virtual int doGetWorkerCount() const;
+	virtual void doRunParallel(rcParallelTask& task, const int count);
 	///@}
 };
 
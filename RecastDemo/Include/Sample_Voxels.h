@@ -1,7 +1,9 @@
 #pragma once
 
+#include <vector>
 #include "Sample.h"
 #include "DetourNavMesh.h"
+#include "DetourTileCache.h"
 #include "Recast.h"
 #include "Scene.h"
 
@@ -10,9 +12,34 @@ class Sample_Voxels : public Sample
 protected:
     Scene* m_scene = nullptr;
     std::string m_voxelsName;
+    std::string m_voxelsPath;
     bool m_showScenes = false;
     
 	bool m_keepInterResults = true;
+	CellAreaTable m_areaTable;
+	bool m_buildTiles = false;
+	float m_tileRegions = 1;
+	bool m_useTileCache = false;
+	bool m_streamRegions = false;
+	float m_streamWindowTiles = 8;
+	
+	struct LinearAllocator* m_talloc = nullptr;
+	struct FastLZCompressor* m_tcomp = nullptr;
+	struct MeshProcess* m_tmproc = nullptr;
+	class dtTileCache* m_tileCache = nullptr;
+	bool m_tileCacheUpToDate = true;
+	std::vector<dtObstacleRef> m_obstacleRefs;		// The obstacle of each closed dynamic object.
+	std::vector<unsigned char> m_objectOpen;
+	float m_selectedObject = 0;
+	
+	// The manifest of the tiled navmesh: the hash of the settings, of each region and of the regions
+	// each tile overlaps, so that only the tiles overlapping changed regions are built again.
+	uint64_t m_settingsHash = 0;
+	int m_manifestTileWidth = 0;
+	int m_manifestTileHeight = 0;
+	std::vector<uint64_t> m_regionHashes;
+	std::vector<uint64_t> m_tileHashes;
+	
 	float m_totalBuildTimeMs = 0;
 	rcHeightfield* m_solid = nullptr;
 	rcCompactHeightfield* m_chf = nullptr;
@@ -48,6 +75,15 @@ protected:
 	void cleanup();
     void selectVoxelFile();
     void handleVoxelFile(const std::string& filePath);
+	bool loadScene();
+	void initConfig(Scene* scene);
+	void initTileSettings(const Scene* scene, struct VoxelTileSettings& settings, const bool skipDynamic);
+	void updateManifest(const struct VoxelTileSettings& settings, const int tw, const int th);
+	bool buildTiles();
+	bool rebuildChangedTiles();
+	bool buildStreamedTiles();
+	bool buildTileCache();
+	void updateDynamicObjects();
 		
 public:
 	Sample_Voxels();
@@ -61,6 +97,7 @@ public:
 	virtual void handleRenderOverlay(double* proj, double* model, int* view);
 	virtual void handleMeshChanged(class InputGeom* geom);
 	virtual bool handleBuild();
+	virtual void handleUpdate(const float dt);
 
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
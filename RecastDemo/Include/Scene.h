@@ -1,21 +1,136 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include "Recast.h"
 
+// The reasons a scene fails to load.
+enum class SceneError
+{
+    None,
+    InvalidConfig,          // The cfg file is missing or has an invalid region count.
+    OpenFailed,             // A region file could not be opened or mapped.
+    Truncated,              // A region file ends before the end of its data.
+    RegionMismatch,         // The header of a region file belongs to another region.
+    UnsupportedVersion,     // A region file has an unknown version.
+    InvalidCell,            // A cell is outside of its region or overlaps the cells below it.
+    TrailingData,           // A region file has data after the end of its cells.
+};
+
+const char* GetSceneErrorString(SceneError error);
+
+// A 64-bit content hash, chained through hash to cover several blocks of data.
+uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+
+// The fields of CellBaseInfo the area rules can test.
+enum class CellField
+{
+    CellType,
+    Indoor,
+    PassWidth,
+    AdvancedObstacle,
+    GradientDirection,
+    GradientDegree,
+    BarrierDirection,
+    FaceUp,
+    Dynamic,
+    NoObstacleRange,
+    ScriptIndex,
+    PutObj,
+    Rest,
+    Sprint,
+    RideHorse,
+    BlockCharacter,
+};
+
+// Gives the area to the cells whose field has the value.
+struct CellAreaRule
+{
+    CellField Field;
+    uint32_t Value;
+    uint8_t Area;
+};
+
+// Maps the cells to the areas of their spans as they are rasterized, and the areas to the
+// flags of the polygons as the navmesh is built, so the navmesh needs no fix-up once loaded.
+struct CellAreaTable
+{
+    std::vector<CellAreaRule> Rules;                // Tried in order, the first rule matching a cell gives its area.
+    uint8_t DefaultArea = RC_WALKABLE_AREA;         // The area of the cells no rule matches.
+    uint16_t AreaFlags[RC_WALKABLE_AREA + 1] = {};  // The poly flags of each area.
+};
+
+// A rule of the area table, turned into a mask of the bits of CellBaseInfo.
+struct CellAreaMask
+{
+    uint32_t Mask;
+    uint32_t Value;
+    uint8_t Area;
+};
+
+// A group of dynamic cells touching each other, such as a door.
+struct DynamicObject
+{
+    float BoundsMin[3];
+    float BoundsMax[3];
+    int CellCount;
+};
+
+struct Cell;
 struct Region;
 class Scene
 {
 public:
     ~Scene();
-    bool Load(const char* filePath);
+    bool Load(rcContext* ctx, const char* filePath);
+    // Opens the scene without loading any region, the regions are then streamed in with LoadWindow.
+    bool Open(rcContext* ctx, const char* filePath);
+    // Loads the regions in [xRegionMin, xRegionMax) x [yRegionMin, yRegionMax) of an opened scene,
+    // and unloads the regions outside of it.
+    bool LoadWindow(rcContext* ctx, int xRegionMin, int yRegionMin, int xRegionMax, int yRegionMax);
+    int GetLoadedRegionCount() const;
+    // Parses again the regions whose files changed since they were loaded, and keeps the other regions.
+    // changed gets a flag per region, at y * width + x. On failure the scene is left as it was.
+    bool ReloadChangedRegions(rcContext* ctx, const char* filePath, std::vector<uint8_t>& changed);
+    // The areas the cells are rasterized with, all of them are RC_WALKABLE_AREA by default.
+    void SetAreaTable(const CellAreaTable& table);
+    // The height of the bounds is the highest cell of the regions loaded so far.
     bool SetConfig(rcConfig* hf);
     bool RasterizeScene(rcContext* ctx, rcHeightfield* hf, const int flagMergeThr);
+    // Adds the cells in [minX, minX + hf->width) x [minY, minY + hf->height) to the heightfield of a tile,
+    // the cell (minX, minY) of the scene goes to the cell (0, 0) of the heightfield.
+    // The dynamic cells can be left out, to be added as obstacles of the dynamic objects instead.
+    bool RasterizeTile(rcContext* ctx, rcHeightfield* hf, const int minX, const int minY, const bool skipDynamic, const int flagMergeThr);
+    // The number of cells along the side of a region.
+    int GetRegionSize() const;
+    int GetRegionWidth() const { return m_regionWidth; }
+    int GetRegionHeight() const { return m_regionHeight; }
+    // The hash of the content of the file of a region.
+    uint64_t GetRegionHash(int xRegion, int yRegion) const;
+    SceneError GetError() const { return m_error; }
+    int GetDynamicObjectCount() const { return (int)m_dynamicObjects.size(); }
+    const DynamicObject* GetDynamicObjects() const { return m_dynamicObjects.data(); }
  
 private:
-    bool LoadRegion(Region* region, const char* filePath);
     int GetSceneHeight();
+    void AllocateCells();
+    void UnloadRegion(Region* region);
+    SceneError LogErrors(rcContext* ctx, const char* function, const SceneError* errors) const;
+    void FindDynamicObjects();
     
 private:
     int m_regionWidth = 0;
     int m_regionHeight = 0;
     Region* m_regions = nullptr;
+    Cell* m_cells = nullptr;
+    size_t m_cellCount = 0;
+    uint16_t* m_columnCounts = nullptr;
+    std::vector<CellAreaMask> m_areaMasks;
+    uint8_t m_defaultArea = RC_WALKABLE_AREA;
+    int m_maxLayer = 0;
+    bool m_streaming = false;
+    std::string m_filePath;
+    SceneError m_error = SceneError::None;
+    std::vector<DynamicObject> m_dynamicObjects;
 };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Recast.h"
+#include "PerfTimer.h"
+
+// The time, peak memory and allocations of the build stages, shared by the command line baker and the benchmark.
+
+// The stages that are not timed by Recast itself.
+enum StageLabel
+{
+	STAGE_CREATE_NAVMESH_DATA = RC_MAX_TIMERS,	// dtCreateNavMeshData
+	MAX_STAGES
+};
+
+// Returns the name of a Recast timer or of one of the stages above.
+const char* getStageName(const int stage);
+
+// Installs the Recast and Detour allocators that count the allocations of each thread.
+// Must be called before any Recast or Detour memory is allocated.
+void installAllocCounter();
+
+// Returns the largest amount of Recast and Detour memory allocated at once by all the threads. [Units: bytes]
+long long getAllocPeak();
+
+// A build context that does not log, and accumulates the time, the peak memory and the
+// allocations of the stages it builds. The stages include their nested stages.
+// The allocations are counted on the calling thread, give each worker its own context.
+class StageContext : public rcContext
+{
+public:
+	struct Stage
+	{
+		int calls;
+		long long time;		// [Units: usec]
+		long long maxTime;	// [Units: usec]
+		long long peak;		// [Units: bytes]
+		long long allocs;
+	};
+
+	StageContext();
+
+	// Starts and stops a stage that is not timed by Recast, see StageLabel.
+	void startStage(const int stage);
+	void stopStage(const int stage);
+
+	const Stage& getStage(const int stage) const { return m_stages[stage]; }
+
+protected:
+	virtual void doResetTimers();
+	virtual void doStartTimer(const rcTimerLabel label) { startStage(label); }
+	virtual void doStopTimer(const rcTimerLabel label) { stopStage(label); }
+	virtual int doGetAccumulatedTime(const rcTimerLabel label) const { return (int)m_stages[label].time; }
+
+private:
+	static const int MAX_DEPTH = 32;
+	struct Scope
+	{
+		int stage;
+		TimeVal start;
+		long long base;
+		long long peak;
+		long long count;
+	};
+	Scope m_scopes[MAX_DEPTH];
+	int m_depth;
+	Stage m_stages[MAX_STAGES];
+};
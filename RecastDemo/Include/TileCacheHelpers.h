@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include "Recast.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+
+// The tile cache allocator, compressor and mesh process shared by the samples and the baker.
+
+// Sets the poly flags of the sample areas. areaFlags has an entry per area up to RC_WALKABLE_AREA.
+void setSampleAreaFlags(unsigned short* areaFlags);
+
+// Sets the flags of the polygons from the flags of their areas. The walkable area is shown as
+// ground, which cannot be rasterized as SAMPLE_POLYAREA_GROUND is RC_NULL_AREA.
+void updatePolyFlags(const unsigned short* areaFlags, unsigned char* polyAreas, unsigned short* polyFlags, const int polyCount);
+
+struct LinearAllocator : public dtTileCacheAlloc
+{
+	unsigned char* buffer;
+	size_t capacity;
+	size_t top;
+	size_t high;
+	
+	LinearAllocator(const size_t cap);
+	~LinearAllocator();
+	
+	void resize(const size_t cap);
+	virtual void reset();
+	virtual void* alloc(const size_t size);
+	virtual void free(void* ptr);
+};
+
+struct FastLZCompressor : public dtTileCacheCompressor
+{
+	virtual int maxCompressedSize(const int bufferSize);
+	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
+							  unsigned char* compressed, const int maxCompressedSize, int* compressedSize);
+	virtual dtStatus decompress(const unsigned char* compressed, const int compressedSize,
+								unsigned char* buffer, const int maxBufferSize, int* bufferSize);
+};
+
+// Sets the flags of the polygons from their areas, and passes in the off-mesh connections of the
+// input geometry if there is one.
+struct MeshProcess : public dtTileCacheMeshProcess
+{
+	const class InputGeom* m_geom;
+	unsigned short m_areaFlags[RC_WALKABLE_AREA+1];	// The poly flags of each area, the sample areas by default.
+
+	MeshProcess();
+	
+	void init(const class InputGeom* geom);
+	void setAreaFlags(const unsigned short* areaFlags);
+	
+	virtual void process(struct dtNavMeshCreateParams* params,
+						 unsigned char* polyAreas, unsigned short* polyFlags);
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include "Recast.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+#include "Scene.h"
+
+// The tile pipeline of the voxel scenes, shared by Sample_Voxels and the command line baker.
+// The steps after the compact heightfield are shared with the mesh tiles of the baker.
+// The tiles are built without logging, so that they can be built by the workers of a parallel task.
+
+// The maximum number of tile cache layers of a tile.
+static const int VOXEL_MAX_LAYERS = 32;
+
+// The settings shared by the tiles of a scene.
+struct VoxelTileSettings
+{
+	rcConfig cfg;			// The size of a tile with its border, and the bounds of the whole scene.
+	int tileWidth;			// The number of tiles along x.
+	bool skipDynamic;		// Leave out the dynamic cells, they are added as tile cache obstacles.
+	const CellAreaTable* areaTable;
+	int partitionType;
+	float agentHeight;
+	float agentRadius;
+	float agentMaxClimb;
+};
+
+struct VoxelTile
+{
+	unsigned char* data;
+	int dataSize;
+	const char* error;		// Why the tile could not be built, or null.
+};
+
+struct VoxelCacheLayer
+{
+	unsigned char* data;
+	int dataSize;
+};
+
+// The compressed layers of a tile cache tile.
+struct VoxelCacheTile
+{
+	VoxelCacheLayer layers[VOXEL_MAX_LAYERS];
+	int nlayers;
+	const char* error;		// Why the tile could not be built, or null.
+};
+
+// Sets the area rules and poly flags of the samples: the cells blocking the characters are not
+// walkable, and the dynamic cells are doors.
+void setDefaultVoxelAreaTable(CellAreaTable& areaTable);
+
+// Builds the navmesh data of a tile from its compact heightfield: partitions it, traces the contours,
+// builds the polygon and detail meshes and creates the Detour data. The caller fills the agent and
+// tile fields of params, proc sets the flags of the polygons and may add the off-mesh connections.
+// Leaves the data null if the tile has no walkable area. Returns why the tile could not be built, or null.
+const char* buildTileFromCompact(rcContext* ctx, rcCompactHeightfield& chf, const rcConfig& cfg, const int partitionType,
+								 dtTileCacheMeshProcess* proc, struct dtNavMeshCreateParams& params,
+								 unsigned char** outData, int* outDataSize);
+
+// Compresses the heightfield layers of the tile (tx,ty) into tile cache layers. If any of the layers
+// fails, none of the layers of the tile are kept.
+void compressTileLayers(const rcHeightfieldLayerSet& lset, const int tx, const int ty, VoxelCacheTile& tile);
+
+// Builds the navmesh data of the tile (tx,ty) from the cells it overlaps plus its border.
+// Leaves the data null if the tile has no walkable area.
+void buildVoxelTile(rcContext* ctx, Scene* scene, const VoxelTileSettings& settings, const int tx, const int ty, VoxelTile& tile);
+
+// Builds the compressed tile cache layers of the tile (tx,ty). If any of the layers fails,
+// none of the layers of the tile are kept.
+void buildVoxelTileLayers(rcContext* ctx, Scene* scene, const VoxelTileSettings& settings, const int tx, const int ty, VoxelCacheTile& tile);
+
+// The tiles of a streamed scene built at once. The window spans a few tiles along x, and slides
+// along y through the world one band of tiles at a time.
+struct VoxelTileWindow
+{
+	int tileWidth;			// The number of tiles along x.
+	int tileHeight;			// The number of tiles along z.
+	int windowTiles;		// The number of tiles of a window along x.
+	int bx, bw, ty;			// The window spans the tiles (bx..bx+bw-1,ty).
+	int maxLoadedRegions;	// The most regions loaded at once so far.
+};
+
+// Places the window before the first tiles of the scene, see nextVoxelTileWindow.
+void initVoxelTileWindow(VoxelTileWindow& window, const int tileWidth, const int tileHeight, const int windowTiles);
+
+// Moves the window to its next tiles. Returns false once all the tiles were visited.
+bool nextVoxelTileWindow(VoxelTileWindow& window);
+
+// Loads the regions the tiles of the window and their borders overlap and drops the others, then
+// bounds the height of the tiles by the regions loaded so far.
+bool loadVoxelTileWindow(rcContext* ctx, Scene* scene, VoxelTileSettings& settings, VoxelTileWindow& window);
+
+// The hash of the settings the tiles are built with. The height of the scene is left out,
+// it only extends the bounds of the tiles, the tiles built before it changed stay valid.
+uint64_t hashVoxelTileSettings(const VoxelTileSettings& settings);
+
+// The hash of the content of the regions the tile (tx,ty) and its border overlap.
+uint64_t hashVoxelTileRegions(const Scene* scene, const VoxelTileSettings& settings, const int tx, const int ty);
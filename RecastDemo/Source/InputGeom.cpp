@@ -110,7 +110,10 @@ InputGeom::InputGeom() :
 	m_mesh(0),
 	m_hasBuildSettings(false),
 	m_offMeshConCount(0),
-	m_volumeCount(0)
+	m_volumeCount(0),
+	m_volumeSet(0),
+	m_volumeSetCellSize(0),
+	m_volumeSetDirty(true)
 {
 }
 
@@ -118,6 +121,7 @@ InputGeom::~InputGeom()
 {
 	delete m_chunkyMesh;
 	delete m_mesh;
+	rcFreeAreaVolumeSet(m_volumeSet);
 }
 		
 bool InputGeom::loadMesh(rcContext* ctx, const std::string& filepath)
@@ -131,6 +135,7 @@ bool InputGeom::loadMesh(rcContext* ctx, const std::string& filepath)
 	}
 	m_offMeshConCount = 0;
 	m_volumeCount = 0;
+	m_volumeSetDirty = true;
 	
 	m_mesh = new rcMeshLoaderObj;
 	if (!m_mesh)
@@ -202,6 +207,7 @@ bool InputGeom::loadGeomSet(rcContext* ctx, const std::string& filepath)
 	
 	m_offMeshConCount = 0;
 	m_volumeCount = 0;
+	m_volumeSetDirty = true;
 	delete m_mesh;
 	m_mesh = 0;
 
@@ -538,12 +544,52 @@ void InputGeom::addConvexVolume(const float* verts, const int nverts,
 	vol->hmax = maxh;
 	vol->nverts = nverts;
 	vol->area = area;
+	m_volumeSetDirty = true;
 }
 
 void InputGeom::deleteConvexVolume(int i)
 {
 	m_volumeCount--;
 	m_volumes[i] = m_volumes[m_volumeCount];
+	m_volumeSetDirty = true;
+}
+
+const rcAreaVolumeSet* InputGeom::getAreaVolumeSet(rcContext* ctx, const float cellSize)
+{
+	if (m_volumeSet && !m_volumeSetDirty && m_volumeSetCellSize == cellSize)
+		return m_volumeSet;
+
+	if (!m_volumeSet)
+	{
+		m_volumeSet = rcAllocAreaVolumeSet();
+		if (!m_volumeSet)
+		{
+			ctx->log(RC_LOG_ERROR, "getAreaVolumeSet: Out of memory 'm_volumeSet'.");
+			return 0;
+		}
+	}
+
+	float verts[MAX_VOLUMES*MAX_CONVEXVOL_PTS*3];
+	int nverts[MAX_VOLUMES];
+	float hmin[MAX_VOLUMES], hmax[MAX_VOLUMES];
+	unsigned char areas[MAX_VOLUMES];
+	int nv = 0;
+	for (int i = 0; i < m_volumeCount; ++i)
+	{
+		const ConvexVolume* vol = &m_volumes[i];
+		memcpy(&verts[nv*3], vol->verts, sizeof(float)*3*vol->nverts);
+		nv += vol->nverts;
+		nverts[i] = vol->nverts;
+		hmin[i] = vol->hmin;
+		hmax[i] = vol->hmax;
+		areas[i] = (unsigned char)vol->area;
+	}
+	if (!rcBuildAreaVolumeSet(ctx, verts, nverts, hmin, hmax, areas, m_volumeCount, cellSize, *m_volumeSet))
+		return 0;
+
+	m_volumeSetCellSize = cellSize;
+	m_volumeSetDirty = false;
+	return m_volumeSet;
 }
 
 void InputGeom::drawConvexVolumes(struct duDebugDraw* dd, bool /*hilight*/)
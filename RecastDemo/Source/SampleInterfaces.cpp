@@ -2,13 +2,18 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 #include "SampleInterfaces.h"
 #include "Recast.h"
+#include "RecastAlloc.h"
 #include "RecastDebugDraw.h"
 #include "DetourDebugDraw.h"
 #include "PerfTimer.h"
-#include "SDL.h"
-#include "SDL_opengl.h"
 
 #ifdef WIN32
 #	define snprintf _snprintf
@@ -16,13 +21,212 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/// Serves the RC_ALLOC_TEMP allocations of a single thread from one block of memory.
+/// Only the thread the arena is bound to allocates from it, any thread may free.
+class TempArena
+{
+public:
+	TempArena() : block(0), capacity(0), top(0), peak(0), overflow(0), live(0) {}
+	~TempArena() { free(block); }
+	
+	/// Returns the bytes in use, including the allocations that did not fit the block.
+	size_t used() const { return top + overflow; }
+	
+	unsigned char* block;
+	size_t capacity;
+	size_t top;
+	size_t peak;
+	std::atomic<size_t> overflow;
+	std::atomic<int> live;
+};
+
+// Each allocation is prefixed with a header telling how to release it.
+// The lowest bit of the size is set when the memory came from the heap.
+struct TempHeader
+{
+	TempArena* arena;
+	size_t size;
+};
+
+static const size_t TEMP_ALIGN = 16;
+static const size_t TEMP_MIN_CAPACITY = 256*1024;
+
+static thread_local TempArena* t_tempArena = 0;
+
+static void* tempArenaAlloc(size_t size, rcAllocHint hint)
+{
+	TempArena* arena = hint == RC_ALLOC_TEMP ? t_tempArena : 0;
+	const size_t total = (sizeof(TempHeader) + size + TEMP_ALIGN-1) & ~(TEMP_ALIGN-1);
+	TempHeader* header = 0;
+	if (arena && arena->top + total <= arena->capacity)
+	{
+		header = (TempHeader*)(arena->block + arena->top);
+		header->size = total;
+		arena->top += total;
+	}
+	else
+	{
+		header = (TempHeader*)malloc(total);
+		if (!header)
+			return 0;
+		header->size = total | 1;
+		if (arena)
+			arena->overflow += total;
+	}
+	header->arena = arena;
+	if (arena)
+	{
+		arena->live++;
+		arena->peak = rcMax(arena->peak, arena->used());
+	}
+	return header + 1;
+}
+
+static void tempArenaFree(void* ptr)
+{
+	TempHeader* header = (TempHeader*)ptr - 1;
+	TempArena* arena = header->arena;
+	const size_t total = header->size & ~(size_t)1;
+	if (header->size & 1)
+	{
+		free(header);
+		if (arena)
+			arena->overflow -= total;
+	}
+	else if (arena == t_tempArena && (unsigned char*)header + total == arena->block + arena->top)
+	{
+		// The latest allocation of the bound arena can be reused right away,
+		// anything else is reclaimed once the arena is empty.
+		arena->top -= total;
+	}
+	if (arena && --arena->live == 0 && arena == t_tempArena)
+		arena->top = 0;
+}
+
+void installTempArenaAllocator()
+{
+	rcAllocSetCustom(tempArenaAlloc, tempArenaFree);
+}
+
+static long long getProfileTime()
+{
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
 BuildContext::BuildContext() :
 	m_messageCount(0),
-	m_textPoolSize(0)
+	m_textPoolSize(0),
+	m_workerCount(1),
+	m_tempArenas(0),
+	m_tempArenaCount(0),
+	m_tempArenaEnabled(false),
+	m_tempScopeCount(0)
 {
 	memset(m_messages, 0, sizeof(char*) * MAX_MESSAGES);
+	memset(m_tempPeak, 0, sizeof(m_tempPeak));
 
 	resetTimers();
+	setWorkerCount((int)std::thread::hardware_concurrency());
+}
+
+BuildContext::~BuildContext()
+{
+	if (t_tempArena && t_tempArena >= m_tempArenas && t_tempArena < m_tempArenas + m_tempArenaCount)
+		t_tempArena = 0;
+	delete [] m_tempArenas;
+}
+
+void BuildContext::setWorkerCount(const int count)
+{
+	m_workerCount = rcMax(1, count);
+	if (m_profiler)
+		m_buildProfiler.init(getProfileTime, 0, m_workerCount);
+}
+
+void BuildContext::enableProfiling(bool state)
+{
+	if (state && m_buildProfiler.init(getProfileTime, 0, m_workerCount))
+		setProfiler(&m_buildProfiler);
+	else
+		setProfiler(0);
+}
+
+bool BuildContext::saveProfile(const char* tracePath, const char* csvPath)
+{
+	const duBuildProfiler* profilers[] = { &m_buildProfiler };
+	FileIO trace;
+	if (!trace.openForWrite(tracePath) || !duExportProfileTrace(profilers, 1, &trace))
+		return false;
+	FileIO csv;
+	if (!csv.openForWrite(csvPath) || !duExportProfileCsv(profilers, 1, &csv))
+		return false;
+	return true;
+}
+
+void BuildContext::enableTempArena(bool state)
+{
+	m_tempArenaEnabled = state;
+	if (!state)
+	{
+		// Allocations still in use keep their arena, the arenas live as long as the context.
+		if (m_tempArenas && t_tempArena == &m_tempArenas[0])
+			t_tempArena = 0;
+		return;
+	}
+	if (!m_tempArenas)
+	{
+		// One arena for the build thread and one for each of the other workers.
+		m_tempArenaCount = m_workerCount;
+		m_tempArenas = new TempArena[m_tempArenaCount];
+	}
+	resetTempUsage();
+}
+
+void BuildContext::resetTempArenas()
+{
+	if (!m_tempArenaEnabled)
+		return;
+	
+	for (int i = 0; i < m_tempArenaCount; ++i)
+	{
+		TempArena& arena = m_tempArenas[i];
+		if (arena.live != 0)
+			continue;
+		arena.top = 0;
+		// Grow the block to fit the largest use so far, the next builds will not spill to the heap.
+		if (arena.peak > arena.capacity)
+		{
+			const size_t capacity = rcMax(TEMP_MIN_CAPACITY, arena.peak + arena.peak/4);
+			unsigned char* block = (unsigned char*)malloc(capacity);
+			if (block)
+			{
+				free(arena.block);
+				arena.block = block;
+				arena.capacity = capacity;
+			}
+		}
+		arena.peak = arena.used();
+	}
+	t_tempArena = &m_tempArenas[0];
+	m_tempScopeCount = 0;
+}
+
+void BuildContext::resetTempUsage()
+{
+	memset(m_tempPeak, 0, sizeof(m_tempPeak));
+}
+
+void BuildContext::logTempUsage()
+{
+	log(RC_LOG_PROGRESS, "Temp Memory Peaks");
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+	{
+		if (m_tempPeak[i])
+			log(RC_LOG_PROGRESS, "- %s:\t%.1fKB", duGetTimerLabelName(i), m_tempPeak[i]/1024.0f);
+	}
+	for (int i = 0; i < m_tempArenaCount; ++i)
+		log(RC_LOG_PROGRESS, "Arena %d:\t%.1fKB", i, m_tempArenas[i].capacity/1024.0f);
 }
 
 // Virtual functions for custom implementations.
@@ -63,10 +267,30 @@ void BuildContext::doResetTimers()
 void BuildContext::doStartTimer(const rcTimerLabel label)
 {
 	m_startTime[label] = getPerfTime();
+	
+	// Track the temp memory peak of each stage of the build thread.
+	TempArena* arena = t_tempArena;
+	if (m_tempArenaEnabled && arena == m_tempArenas && m_tempScopeCount < MAX_TEMP_SCOPES)
+	{
+		TempScope& scope = m_tempScopes[m_tempScopeCount++];
+		scope.label = label;
+		scope.base = arena->used();
+		scope.peak = arena->peak;
+		arena->peak = scope.base;
+	}
 }
 
 void BuildContext::doStopTimer(const rcTimerLabel label)
 {
+	TempArena* arena = t_tempArena;
+	if (m_tempArenaEnabled && arena == m_tempArenas && m_tempScopeCount > 0 &&
+		m_tempScopes[m_tempScopeCount-1].label == label)
+	{
+		const TempScope& scope = m_tempScopes[--m_tempScopeCount];
+		m_tempPeak[label] = rcMax(m_tempPeak[label], arena->peak - scope.base);
+		arena->peak = rcMax(arena->peak, scope.peak);
+	}
+	
 	const TimeVal endTime = getPerfTime();
 	const int deltaTime = (int)(endTime - m_startTime[label]);
 	if (m_accTime[label] == -1)
@@ -80,6 +304,73 @@ int BuildContext::doGetAccumulatedTime(const rcTimerLabel label) const
 	return getPerfTimeUsec(m_accTime[label]);
 }
 
+int BuildContext::doGetWorkerCount() const
+{
+	return m_workerCount;
+}
+
+void BuildContext::doRunParallel(rcParallelTask& task, const int count)
+{
+	const int nthreads = rcMin(m_workerCount, count);
+	if (nthreads <= 1)
+	{
+		for (int i = 0; i < count; ++i)
+			task.run(i, 0);
+		return;
+	}
+	
+	// The other workers allocate from their own arenas, worker 0 runs on the build thread.
+	TempArena* arenas = 0;
+	int narenas = 0;
+	std::vector<size_t> bases;
+	size_t buildPeak = 0;
+	if (m_tempArenaEnabled && t_tempArena == m_tempArenas)
+	{
+		arenas = m_tempArenas;
+		narenas = rcMin(m_tempArenaCount, nthreads);
+		bases.resize(narenas);
+		for (int i = 0; i < narenas; ++i)
+		{
+			// No worker runs now, empty arenas can be reused from the start.
+			if (i > 0 && arenas[i].live == 0)
+				arenas[i].top = 0;
+			bases[i] = arenas[i].used();
+		}
+		buildPeak = arenas[0].peak;
+		for (int i = 0; i < narenas; ++i)
+			arenas[i].peak = bases[i];
+	}
+	
+	// Workers pull the next work item until all of them are taken.
+	std::atomic<int> next(0);
+	rcProfiler* profiler = m_profiler;
+	auto work = [&task, &next, count, profiler, arenas, narenas](int worker)
+	{
+		if (worker > 0 && worker < narenas)
+			t_tempArena = &arenas[worker];
+		if (profiler) profiler->beginWork(worker);
+		for (int i = next++; i < count; i = next++)
+			task.run(i, worker);
+		if (profiler) profiler->endWork(worker);
+	};
+	
+	std::vector<std::thread> threads;
+	for (int i = 1; i < nthreads; ++i)
+		threads.push_back(std::thread(work, i));
+	work(0);
+	for (auto& thread : threads)
+		thread.join();
+	
+	// Account the memory of the other workers to the stage running the task.
+	if (arenas)
+	{
+		size_t taskPeak = arenas[0].peak;
+		for (int i = 1; i < narenas; ++i)
+			taskPeak += arenas[i].peak - bases[i];
+		arenas[0].peak = rcMax(buildPeak, taskPeak);
+	}
+}
+
 void BuildContext::dumpLog(const char* format, ...)
 {
 	// Print header.
@@ -137,130 +428,6 @@ const char* BuildContext::getLogText(const int i) const
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-class GLCheckerTexture
-{
-	unsigned int m_texId;
-public:
-	GLCheckerTexture() : m_texId(0)
-	{
-	}
-	
-	~GLCheckerTexture()
-	{
-		if (m_texId != 0)
-			glDeleteTextures(1, &m_texId);
-	}
-	void bind()
-	{
-		if (m_texId == 0)
-		{
-			// Create checker pattern.
-			const unsigned int col0 = duRGBA(215,215,215,255);
-			const unsigned int col1 = duRGBA(255,255,255,255);
-			static const int TSIZE = 64;
-			unsigned int data[TSIZE*TSIZE];
-			
-			glGenTextures(1, &m_texId);
-			glBindTexture(GL_TEXTURE_2D, m_texId);
-
-			int level = 0;
-			int size = TSIZE;
-			while (size > 0)
-			{
-				for (int y = 0; y < size; ++y)
-					for (int x = 0; x < size; ++x)
-						data[x+y*size] = (x==0 || y==0) ? col0 : col1;
-				glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, size,size, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-				size /= 2;
-				level++;
-			}
-			
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		}
-		else
-		{
-			glBindTexture(GL_TEXTURE_2D, m_texId);
-		}
-	}
-};
-GLCheckerTexture g_tex;
-
-
-void DebugDrawGL::depthMask(bool state)
-{
-	glDepthMask(state ? GL_TRUE : GL_FALSE);
-}
-
-void DebugDrawGL::texture(bool state)
-{
-	if (state)
-	{
-		glEnable(GL_TEXTURE_2D);
-		g_tex.bind();
-	}
-	else
-	{
-		glDisable(GL_TEXTURE_2D);
-	}
-}
-
-void DebugDrawGL::begin(duDebugDrawPrimitives prim, float size)
-{
-	switch (prim)
-	{
-		case DU_DRAW_POINTS:
-			glPointSize(size);
-			glBegin(GL_POINTS);
-			break;
-		case DU_DRAW_LINES:
-			glLineWidth(size);
-			glBegin(GL_LINES);
-			break;
-		case DU_DRAW_TRIS:
-			glBegin(GL_TRIANGLES);
-			break;
-		case DU_DRAW_QUADS:
-			glBegin(GL_QUADS);
-			break;
-	};
-}
-
-void DebugDrawGL::vertex(const float* pos, unsigned int color)
-{
-	glColor4ubv((GLubyte*)&color);
-	glVertex3fv(pos);
-}
-
-void DebugDrawGL::vertex(const float x, const float y, const float z, unsigned int color)
-{
-	glColor4ubv((GLubyte*)&color);
-	glVertex3f(x,y,z);
-}
-
-void DebugDrawGL::vertex(const float* pos, unsigned int color, const float* uv)
-{
-	glColor4ubv((GLubyte*)&color);
-	glTexCoord2fv(uv);
-	glVertex3fv(pos);
-}
-
-void DebugDrawGL::vertex(const float x, const float y, const float z, unsigned int color, const float u, const float v)
-{
-	glColor4ubv((GLubyte*)&color);
-	glTexCoord2f(u,v);
-	glVertex3f(x,y,z);
-}
-
-void DebugDrawGL::end()
-{
-	glEnd();
-	glLineWidth(1.0f);
-	glPointSize(1.0f);
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
 FileIO::FileIO() :
 	m_fp(0),
 	m_mode(-1)
@@ -42,6 +42,9 @@
 #	define snprintf _snprintf
 #endif
 
+// The number of rows of the heightfield rasterized at a time when the intermediate results are not kept.
+static const int STREAM_STRIP_SIZE = 64;
+
 
 Sample_SoloMesh::Sample_SoloMesh() :
 	m_keepInterResults(true),
@@ -410,19 +413,6 @@ bool Sample_SoloMesh::handleBuild()
 	// Step 2. Rasterize input polygon soup.
 	//
 	
-	// Allocate voxel heightfield where we rasterize our input data to.
-	m_solid = rcAllocHeightfield();
-	if (!m_solid)
-	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
-		return false;
-	}
-	if (!rcCreateHeightfield(m_ctx, *m_solid, m_cfg.width, m_cfg.height, m_cfg.bmin, m_cfg.bmax, m_cfg.cs, m_cfg.ch))
-	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
-		return false;
-	}
-	
 	// Allocate array that can hold triangle area types.
 	// If you have multiple meshes you need to process, allocate
 	// and array which can hold the max number of triangles you need to process.
@@ -438,55 +428,81 @@ bool Sample_SoloMesh::handleBuild()
 	// the are type for each of the meshes and rasterize them.
 	memset(m_triareas, 0, ntris*sizeof(unsigned char));
 	rcMarkWalkableTriangles(m_ctx, m_cfg.walkableSlopeAngle, verts, nverts, tris, ntris, m_triareas);
-	if (!rcRasterizeTriangles(m_ctx, verts, nverts, tris, m_triareas, ntris, *m_solid, m_cfg.walkableClimb))
-	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not rasterize triangles.");
-		return false;
-	}
 
 	if (!m_keepInterResults)
 	{
+		// The solid heightfield is not kept, so rasterize, filter and compact it in strips
+		// of rows. Only the spans of one strip exist at a time, which bounds the peak memory
+		// of large meshes.
+		m_chf = rcAllocCompactHeightfield();
+		if (!m_chf)
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
+			return false;
+		}
+		if (!rcBuildCompactHeightfieldStreamed(m_ctx, m_cfg, verts, nverts, tris, m_triareas, ntris, STREAM_STRIP_SIZE, *m_chf))
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+			return false;
+		}
+		
 		delete [] m_triareas;
 		m_triareas = 0;
 	}
+	else
+	{
+		// Allocate voxel heightfield where we rasterize our input data to.
+		m_solid = rcAllocHeightfield();
+		if (!m_solid)
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
+			return false;
+		}
+		if (!rcCreateHeightfield(m_ctx, *m_solid, m_cfg.width, m_cfg.height, m_cfg.bmin, m_cfg.bmax, m_cfg.cs, m_cfg.ch))
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
+			return false;
+		}
 	
-	//
-	// Step 3. Filter walkables surfaces.
-	//
+		if (!rcRasterizeTriangles(m_ctx, verts, nverts, tris, m_triareas, ntris, *m_solid, m_cfg.walkableClimb))
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not rasterize triangles.");
+			return false;
+		}
+
 	
-	// Once all geoemtry is rasterized, we do initial pass of filtering to
-	// remove unwanted overhangs caused by the conservative rasterization
-	// as well as filter spans where the character cannot possibly stand.
-	rcFilterLowHangingWalkableObstacles(m_ctx, m_cfg.walkableClimb, *m_solid);
-	rcFilterLedgeSpans(m_ctx, m_cfg.walkableHeight, m_cfg.walkableClimb, *m_solid);
-	rcFilterWalkableLowHeightSpans(m_ctx, m_cfg.walkableHeight, *m_solid);
+		//
+		// Step 3. Filter walkables surfaces.
+		//
+	
+		// Once all geoemtry is rasterized, we do initial pass of filtering to
+		// remove unwanted overhangs caused by the conservative rasterization
+		// as well as filter spans where the character cannot possibly stand.
+		rcFilterLowHangingWalkableObstacles(m_ctx, m_cfg.walkableClimb, *m_solid);
+		rcFilterLedgeSpans(m_ctx, m_cfg.walkableHeight, m_cfg.walkableClimb, *m_solid);
+		rcFilterWalkableLowHeightSpans(m_ctx, m_cfg.walkableHeight, *m_solid);
 
 
-	//
-	// Step 4. Partition walkable surface to simple regions.
-	//
+		//
+		// Step 4. Partition walkable surface to simple regions.
+		//
 
-	// Compact the heightfield so that it is faster to handle from now on.
-	// This will result more cache coherent data as well as the neighbours
-	// between walkable cells will be calculated.
-	m_chf = rcAllocCompactHeightfield();
-	if (!m_chf)
-	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
-		return false;
-	}
-	if (!rcBuildCompactHeightfield(m_ctx, m_cfg.walkableHeight, m_cfg.walkableClimb, *m_solid, *m_chf))
-	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
-		return false;
+		// Compact the heightfield so that it is faster to handle from now on.
+		// This will result more cache coherent data as well as the neighbours
+		// between walkable cells will be calculated.
+		m_chf = rcAllocCompactHeightfield();
+		if (!m_chf)
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
+			return false;
+		}
+		if (!rcBuildCompactHeightfield(m_ctx, m_cfg.walkableHeight, m_cfg.walkableClimb, *m_solid, *m_chf))
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+			return false;
+		}
 	}
 	
-	if (!m_keepInterResults)
-	{
-		rcFreeHeightField(m_solid);
-		m_solid = 0;
-	}
-		
 	// Erode the walkable area by agent radius.
 	if (!rcErodeWalkableArea(m_ctx, m_cfg.walkableRadius, *m_chf))
 	{
@@ -47,7 +47,7 @@
 #include "CrowdTool.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
-#include "fastlz.h"
+#include "TileCacheHelpers.h"
 
 #ifdef WIN32
 #	define snprintf _snprintf
@@ -107,130 +107,6 @@ static int calcLayerBufferSize(const int gridWidth, const int gridHeight)
 
 
 
-struct FastLZCompressor : public dtTileCacheCompressor
-{
-	virtual int maxCompressedSize(const int bufferSize)
-	{
-		return (int)(bufferSize* 1.05f);
-	}
-	
-	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
-							  unsigned char* compressed, const int /*maxCompressedSize*/, int* compressedSize)
-	{
-		*compressedSize = fastlz_compress((const void *const)buffer, bufferSize, compressed);
-		return DT_SUCCESS;
-	}
-	
-	virtual dtStatus decompress(const unsigned char* compressed, const int compressedSize,
-								unsigned char* buffer, const int maxBufferSize, int* bufferSize)
-	{
-		*bufferSize = fastlz_decompress(compressed, compressedSize, buffer, maxBufferSize);
-		return *bufferSize < 0 ? DT_FAILURE : DT_SUCCESS;
-	}
-};
-
-struct LinearAllocator : public dtTileCacheAlloc
-{
-	unsigned char* buffer;
-	size_t capacity;
-	size_t top;
-	size_t high;
-	
-	LinearAllocator(const size_t cap) : buffer(0), capacity(0), top(0), high(0)
-	{
-		resize(cap);
-	}
-	
-	~LinearAllocator()
-	{
-		dtFree(buffer);
-	}
-
-	void resize(const size_t cap)
-	{
-		if (buffer) dtFree(buffer);
-		buffer = (unsigned char*)dtAlloc(cap, DT_ALLOC_PERM);
-		capacity = cap;
-	}
-	
-	virtual void reset()
-	{
-		high = dtMax(high, top);
-		top = 0;
-	}
-	
-	virtual void* alloc(const size_t size)
-	{
-		if (!buffer)
-			return 0;
-		if (top+size > capacity)
-			return 0;
-		unsigned char* mem = &buffer[top];
-		top += size;
-		return mem;
-	}
-	
-	virtual void free(void* /*ptr*/)
-	{
-		// Empty
-	}
-};
-
-struct MeshProcess : public dtTileCacheMeshProcess
-{
-	InputGeom* m_geom;
-
-	inline MeshProcess() : m_geom(0)
-	{
-	}
-
-	inline void init(InputGeom* geom)
-	{
-		m_geom = geom;
-	}
-	
-	virtual void process(struct dtNavMeshCreateParams* params,
-						 unsigned char* polyAreas, unsigned short* polyFlags)
-	{
-		// Update poly flags from areas.
-		for (int i = 0; i < params->polyCount; ++i)
-		{
-			if (polyAreas[i] == DT_TILECACHE_WALKABLE_AREA)
-				polyAreas[i] = SAMPLE_POLYAREA_GROUND;
-
-			if (polyAreas[i] == SAMPLE_POLYAREA_GROUND ||
-				polyAreas[i] == SAMPLE_POLYAREA_GRASS ||
-				polyAreas[i] == SAMPLE_POLYAREA_ROAD)
-			{
-				polyFlags[i] = SAMPLE_POLYFLAGS_WALK;
-			}
-			else if (polyAreas[i] == SAMPLE_POLYAREA_WATER)
-			{
-				polyFlags[i] = SAMPLE_POLYFLAGS_SWIM;
-			}
-			else if (polyAreas[i] == SAMPLE_POLYAREA_DOOR)
-			{
-				polyFlags[i] = SAMPLE_POLYFLAGS_WALK | SAMPLE_POLYFLAGS_DOOR;
-			}
-		}
-
-		// Pass in off-mesh connections.
-		if (m_geom)
-		{
-			params->offMeshConVerts = m_geom->getOffMeshConnectionVerts();
-			params->offMeshConRad = m_geom->getOffMeshConnectionRads();
-			params->offMeshConDir = m_geom->getOffMeshConnectionDirs();
-			params->offMeshConAreas = m_geom->getOffMeshConnectionAreas();
-			params->offMeshConFlags = m_geom->getOffMeshConnectionFlags();
-			params->offMeshConUserID = m_geom->getOffMeshConnectionId();
-			params->offMeshConCount = m_geom->getOffMeshConnectionCount();	
-		}
-	}
-};
-
-
-
-
 static const int MAX_LAYERS = 32;
 
 struct TileCacheData
@@ -246,22 +122,35 @@ struct RasterizationContext
 		triareas(0),
 		lset(0),
 		chf(0),
-		ntiles(0)
+		ntiles(0),
+		tx(0),
+		ty(0)
 	{
 		memset(tiles, 0, sizeof(TileCacheData)*MAX_LAYERS);
 	}
 	
 	~RasterizationContext()
+	{
+		clear();
+	}
+	
+	void clear()
 	{
 		rcFreeHeightField(solid);
+		solid = 0;
 		delete [] triareas;
+		triareas = 0;
 		rcFreeHeightfieldLayerSet(lset);
+		lset = 0;
 		rcFreeCompactHeightfield(chf);
+		chf = 0;
 		for (int i = 0; i < MAX_LAYERS; ++i)
 		{
 			dtFree(tiles[i].data);
 			tiles[i].data = 0;
+			tiles[i].dataSize = 0;
 		}
+		ntiles = 0;
 	}
 	
 	rcHeightfield* solid;
@@ -270,22 +159,23 @@ struct RasterizationContext
 	rcCompactHeightfield* chf;
 	TileCacheData tiles[MAX_LAYERS];
 	int ntiles;
+	int tx, ty;
 };
 
-static int rasterizeTileLayers(BuildContext* ctx, InputGeom* geom,
-							   const int tx, const int ty,
-							   const rcConfig& cfg,
-							   TileCacheData* tiles,
-							   const int maxTiles)
+// Rasterizes the geometry of a tile into a compact heightfield, ready for building its layers.
+static bool rasterizeTileCompact(BuildContext* ctx, InputGeom* geom,
+								 const int tx, const int ty,
+								 const rcConfig& cfg,
+								 RasterizationContext& rc)
 {
 	if (!geom || !geom->getMesh() || !geom->getChunkyMesh())
 	{
 		ctx->log(RC_LOG_ERROR, "buildTile: Input mesh is not specified.");
-		return 0;
+		return false;
 	}
 	
-	FastLZCompressor comp;
-	RasterizationContext rc;
+	rc.tx = tx;
+	rc.ty = ty;
 	
 	const float* verts = geom->getMesh()->getVerts();
 	const int nverts = geom->getMesh()->getVertCount();
@@ -313,12 +203,12 @@ static int rasterizeTileLayers(BuildContext* ctx, InputGeom* geom,
 	if (!rc.solid)
 	{
 		ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
-		return 0;
+		return false;
 	}
 	if (!rcCreateHeightfield(ctx, *rc.solid, tcfg.width, tcfg.height, tcfg.bmin, tcfg.bmax, tcfg.cs, tcfg.ch))
 	{
 		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
-		return 0;
+		return false;
 	}
 	
 	// Allocate array that can hold triangle flags.
@@ -328,7 +218,7 @@ static int rasterizeTileLayers(BuildContext* ctx, InputGeom* geom,
 	if (!rc.triareas)
 	{
 		ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", chunkyMesh->maxTrisPerChunk);
-		return 0;
+		return false;
 	}
 	
 	float tbmin[2], tbmax[2];
@@ -340,7 +230,7 @@ static int rasterizeTileLayers(BuildContext* ctx, InputGeom* geom,
 	const int ncid = rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, cid, 512);
 	if (!ncid)
 	{
-		return 0; // empty
+		return false; // empty
 	}
 	
 	for (int i = 0; i < ncid; ++i)
@@ -354,7 +244,7 @@ static int rasterizeTileLayers(BuildContext* ctx, InputGeom* geom,
 								verts, nverts, tris, ntris, rc.triareas);
 		
 		if (!rcRasterizeTriangles(ctx, verts, nverts, tris, rc.triareas, ntris, *rc.solid, tcfg.walkableClimb))
-			return 0;
+			return false;
 	}
 	
 	// Once all geometry is rasterized, we do initial pass of filtering to
@@ -369,19 +259,19 @@ static int rasterizeTileLayers(BuildContext* ctx, InputGeom* geom,
 	if (!rc.chf)
 	{
 		ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
-		return 0;
+		return false;
 	}
 	if (!rcBuildCompactHeightfield(ctx, tcfg.walkableHeight, tcfg.walkableClimb, *rc.solid, *rc.chf))
 	{
 		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
-		return 0;
+		return false;
 	}
 	
 	// Erode the walkable area by agent radius.
 	if (!rcErodeWalkableArea(ctx, tcfg.walkableRadius, *rc.chf))
 	{
 		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
-		return 0;
+		return false;
 	}
 	
 	// (Optional) Mark areas.
@@ -393,18 +283,30 @@ static int rasterizeTileLayers(BuildContext* ctx, InputGeom* geom,
 							 (unsigned char)vols[i].area, *rc.chf);
 	}
 	
+	// The heightfield is not needed anymore, free it while the rest of the batch is rasterized.
+	rcFreeHeightField(rc.solid);
+	rc.solid = 0;
+	delete [] rc.triareas;
+	rc.triareas = 0;
+	
 	rc.lset = rcAllocHeightfieldLayerSet();
 	if (!rc.lset)
 	{
 		ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'lset'.");
-		return 0;
-	}
-	if (!rcBuildHeightfieldLayers(ctx, *rc.chf, tcfg.borderSize, tcfg.walkableHeight, *rc.lset))
-	{
-		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build heighfield layers.");
-		return 0;
+		return false;
 	}
 	
+	return true;
+}
+
+// Compresses the layers of a tile into tile cache data. If any of the layers fails, none
+// of the layers of the tile are kept.
+static bool compressTileLayers(RasterizationContext& rc)
+{
+	FastLZCompressor comp;
+	const int tx = rc.tx;
+	const int ty = rc.ty;
+	
 	rc.ntiles = 0;
 	for (int i = 0; i < rcMin(rc.lset->nlayers, MAX_LAYERS); ++i)
 	{
@@ -437,21 +339,32 @@ static int rasterizeTileLayers(BuildContext* ctx, InputGeom* geom,
 												&tile->data, &tile->dataSize);
 		if (dtStatusFailed(status))
 		{
-			return 0;
+			return false;
 		}
 	}
 
-	// Transfer ownsership of tile data from build context to the caller.
-	int n = 0;
-	for (int i = 0; i < rcMin(rc.ntiles, maxTiles); ++i)
+	return true;
+}
+
+// Compresses the layers of the tiles of a batch in parallel.
+struct CompressTileLayersTask : public rcParallelTask
+{
+	RasterizationContext* tiles;
+	
+	virtual void run(const int index, const int /*worker*/)
 	{
-		tiles[n++] = rc.tiles[i];
-		rc.tiles[i].data = 0;
-		rc.tiles[i].dataSize = 0;
+		RasterizationContext& rc = tiles[index];
+		if (!compressTileLayers(rc))
+		{
+			for (int i = 0; i < rc.ntiles; ++i)
+			{
+				dtFree(rc.tiles[i].data);
+				rc.tiles[i].data = 0;
+			}
+			rc.ntiles = 0;
+		}
 	}
-	
-	return n;
-}
+};
 
 
 void drawTiles(duDebugDraw* dd, dtTileCache* tc)
@@ -1305,31 +1218,67 @@ bool Sample_TempObstacles::handleBuild()
 	m_cacheCompressedSize = 0;
 	m_cacheRawSize = 0;
 	
-	for (int y = 0; y < th; ++y)
-	{
-		for (int x = 0; x < tw; ++x)
+	// The tiles are processed in batches. The tiles of a batch are rasterized one after the
+	// other, then their layers are built and compressed in parallel, and finally added to the
+	// tile cache in tile order, so that the cache is the same regardless of the worker count.
+	const int batchSize = m_ctx->getWorkerCount()*4;
+	RasterizationContext* batch = new RasterizationContext[batchSize];
+	const rcCompactHeightfield** chfs = new const rcCompactHeightfield*[batchSize];
+	rcHeightfieldLayerSet** lsets = new rcHeightfieldLayerSet*[batchSize];
+	int nbatch = 0;
+	
+	for (int i = 0; i < tw*th; ++i)
+	{
+		const int x = i % tw;
+		const int y = i / tw;
+		if (rasterizeTileCompact(m_ctx, m_geom, x, y, cfg, batch[nbatch]))
+			nbatch++;
+		else
+			batch[nbatch].clear();
+		
+		if (nbatch < batchSize && i+1 < tw*th)
+			continue;
+		
+		// Build and compress the layers.
+		for (int j = 0; j < nbatch; ++j)
 		{
-			TileCacheData tiles[MAX_LAYERS];
-			memset(tiles, 0, sizeof(tiles));
-			int ntiles = rasterizeTileLayers(m_ctx, m_geom, x, y, cfg, tiles, MAX_LAYERS);
-
-			for (int i = 0; i < ntiles; ++i)
+			chfs[j] = batch[j].chf;
+			lsets[j] = batch[j].lset;
+		}
+		// The errors are logged, tiles whose layers could not be built are left empty.
+		rcBuildHeightfieldLayersBatch(m_ctx, chfs, nbatch, cfg.borderSize, cfg.walkableHeight, lsets);
+		
+		CompressTileLayersTask task;
+		task.tiles = batch;
+		m_ctx->runParallel(task, nbatch);
+		
+		// Add the layers to the tile cache in order.
+		for (int j = 0; j < nbatch; ++j)
+		{
+			RasterizationContext& rc = batch[j];
+			for (int k = 0; k < rc.ntiles; ++k)
 			{
-				TileCacheData* tile = &tiles[i];
+				TileCacheData* tile = &rc.tiles[k];
 				status = m_tileCache->addTile(tile->data, tile->dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0);
 				if (dtStatusFailed(status))
-				{
-					dtFree(tile->data);
-					tile->data = 0;
 					continue;
-				}
 				
 				m_cacheLayerCount++;
 				m_cacheCompressedSize += tile->dataSize;
 				m_cacheRawSize += calcLayerBufferSize(tcparams.width, tcparams.height);
+				
+				// The tile cache owns the data now.
+				tile->data = 0;
+				tile->dataSize = 0;
 			}
+			rc.clear();
 		}
+		nbatch = 0;
 	}
+	
+	delete [] lsets;
+	delete [] chfs;
+	delete [] batch;
 
 	// Build initial meshes
 	m_ctx->startTimer(RC_TIMER_TOTAL);
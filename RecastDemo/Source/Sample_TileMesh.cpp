@@ -33,6 +33,7 @@
 #include "Sample_TileMesh.h"
 #include "Recast.h"
 #include "RecastDebugDraw.h"
+#include "DetourCommon.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshBuilder.h"
 #include "DetourDebugDraw.h"
@@ -47,31 +48,6 @@
 #	define snprintf _snprintf
 #endif
 
-
-inline unsigned int nextPow2(unsigned int v)
-{
-	v--;
-	v |= v >> 1;
-	v |= v >> 2;
-	v |= v >> 4;
-	v |= v >> 8;
-	v |= v >> 16;
-	v++;
-	return v;
-}
-
-inline unsigned int ilog2(unsigned int v)
-{
-	unsigned int r;
-	unsigned int shift;
-	r = (v > 0xffff) << 4; v >>= r;
-	shift = (v > 0xff) << 3; v >>= shift; r |= shift;
-	shift = (v > 0xf) << 2; v >>= shift; r |= shift;
-	shift = (v > 0x3) << 1; v >>= shift; r |= shift;
-	r |= (v >> 1);
-	return r;
-}
-
 class NavMeshTileTool : public SampleTool
 {
 	Sample_TileMesh* m_sample;
@@ -359,6 +335,12 @@ void Sample_TileMesh::handleSettings()
 
 	if (imguiCheck("Build All Tiles", m_buildAll))
 		m_buildAll = !m_buildAll;
+
+	if (imguiCheck("Profile Build", m_ctx->isProfiling()))
+		m_ctx->enableProfiling(!m_ctx->isProfiling());
+
+	if (imguiCheck("Temp Arena", m_ctx->isTempArenaEnabled()))
+		m_ctx->enableTempArena(!m_ctx->isTempArenaEnabled());
 	
 	imguiLabel("Tiling");
 	imguiSlider("TileSize", &m_tileSize, 16.0f, 1024.0f, 16.0f);
@@ -378,7 +360,7 @@ void Sample_TileMesh::handleSettings()
 
 		// Max tiles and max polys affect how the tile IDs are caculated.
 		// There are 22 bits available for identifying a tile and a polygon.
-		int tileBits = rcMin((int)ilog2(nextPow2(tw*th)), 14);
+		int tileBits = rcMin((int)dtIlog2(dtNextPow2(tw*th)), 14);
 		if (tileBits > 14) tileBits = 14;
 		int polyBits = 22 - tileBits;
 		m_maxTiles = 1 << tileBits;
@@ -411,6 +393,12 @@ void Sample_TileMesh::handleSettings()
 		m_navQuery->init(m_navMesh, 2048);
 	}
 
+	if (imguiButton("Save Profile", m_ctx->isProfiling()))
+	{
+		if (!m_ctx->saveProfile("build_profile.json", "build_profile.csv"))
+			m_ctx->log(RC_LOG_ERROR, "Could not save the build profile.");
+	}
+
 	imguiUnindent();
 	imguiUnindent();
 	
@@ -865,6 +853,12 @@ void Sample_TileMesh::buildAllTiles()
 	const float tcs = m_tileSize*m_cellSize;
 
 	
+	// Profile only the latest build of all tiles.
+	if (m_ctx->isProfiling())
+		m_ctx->getBuildProfiler().reset();
+	if (m_ctx->isTempArenaEnabled())
+		m_ctx->resetTempUsage();
+	
 	// Start the build process.
 	m_ctx->startTimer(RC_TIMER_TEMP);
 
@@ -899,6 +893,14 @@ void Sample_TileMesh::buildAllTiles()
 
 	m_totalBuildTimeMs = m_ctx->getAccumulatedTime(RC_TIMER_TEMP)/1000.0f;
 	
+	if (m_ctx->isProfiling())
+	{
+		const duBuildProfiler* profiler = &m_ctx->getBuildProfiler();
+		duLogProfileStats(*m_ctx, &profiler, 1);
+	}
+	if (m_ctx->isTempArenaEnabled())
+		m_ctx->logTempUsage();
+	
 }
 
 void Sample_TileMesh::removeAllTiles()
@@ -988,6 +990,8 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	
 	// Reset build times gathering.
 	m_ctx->resetTimers();
+	m_ctx->getBuildProfiler().setTile(tx, ty);
+	m_ctx->resetTempArenas();
 	
 	// Start the build process.
 	m_ctx->startTimer(RC_TIMER_TOTAL);
@@ -1089,9 +1093,13 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	}
 
 	// (Optional) Mark areas.
-	const ConvexVolume* vols = m_geom->getConvexVolumes();
-	for (int i  = 0; i < m_geom->getConvexVolumeCount(); ++i)
-		rcMarkConvexPolyArea(m_ctx, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *m_chf);
+	// The volumes are indexed by tile, so each tile only visits the volumes overlapping it.
+	const rcAreaVolumeSet* vset = m_geom->getAreaVolumeSet(m_ctx, m_tileSize*m_cellSize);
+	if (!vset || !rcMarkAreaVolumes(m_ctx, *vset, *m_chf))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not mark areas.");
+		return 0;
+	}
 	
 	
 	// Partition the heightfield so that we can use simple algorithm later to triangulate the walkable areas.
@@ -9,27 +9,141 @@
 #include "InputGeom.h"
 #include "Sample.h"
 #include "Sample_Voxels.h"
+#include "VoxelTileBuilder.h"
+#include "TileCacheHelpers.h"
 #include "Recast.h"
 #include "RecastDebugDraw.h"
 #include "RecastDump.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshBuilder.h"
 #include "DetourDebugDraw.h"
+#include "DetourCommon.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
 #include "NavMeshTesterTool.h"
 #include "NavMeshPruneTool.h"
 #include "OffMeshConnectionTool.h"
 #include "ConvexVolumeTool.h"
 #include "CrowdTool.h"
 #include "Filelist.h"
-#include "imgui.h"
 
 #ifdef WIN32
 #	define snprintf _snprintf
 #endif
 
+// This value specifies how many layers (or "floors") each tile cache tile is expected to have.
+static const int EXPECTED_LAYERS_PER_TILE = 4;
+
+// The streamed build writes its tiles in the navmesh set format of Sample_TileMesh.
+static const char* VOXEL_NAVMESH_SET_PATH = "voxel_tiles_navmesh.bin";
+static const int NAVMESHSET_MAGIC = 'M'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'MSET';
+static const int NAVMESHSET_VERSION = 1;
+
+struct VoxelNavMeshSetHeader
+{
+	int magic;
+	int version;
+	int numTiles;
+	dtNavMeshParams params;
+};
+
+struct VoxelNavMeshTileHeader
+{
+	dtTileRef tileRef;
+	int dataSize;
+};
+
+// The number of dynamic objects changed at a time. Each obstacle touches up to DT_MAX_TOUCHED_TILES
+// tiles, and the tile cache drops the tiles that do not fit its update queue of 64 tiles.
+static const int DYNAMIC_OBJECT_BATCH = 64 / DT_MAX_TOUCHED_TILES;
+
+// Builds the tiles in parallel. The workers must not log, so each tile is built with
+// a context of its own that neither logs nor times, and the errors are reported afterwards.
+struct BuildVoxelTilesTask : public rcParallelTask
+{
+	Scene* scene;
+	const VoxelTileSettings* settings;
+	VoxelTile* tiles;
+	const int* tileIndices;		// The indices of the tiles to build, or null to build all of them.
+	
+	virtual void run(const int index, const int /*worker*/)
+	{
+		rcContext ctx(false);
+		const int tileIndex = tileIndices ? tileIndices[index] : index;
+		const int tx = tileIndex % settings->tileWidth;
+		const int ty = tileIndex / settings->tileWidth;
+		buildVoxelTile(&ctx, scene, *settings, tx, ty, tiles[index]);
+	}
+};
+
+// Builds the tile cache layers of the tiles in parallel, like BuildVoxelTilesTask.
+struct BuildVoxelTileLayersTask : public rcParallelTask
+{
+	Scene* scene;
+	const VoxelTileSettings* settings;
+	VoxelCacheTile* tiles;
+	
+	virtual void run(const int index, const int /*worker*/)
+	{
+		rcContext ctx(false);
+		const int tx = index % settings->tileWidth;
+		const int ty = index / settings->tileWidth;
+		buildVoxelTileLayers(&ctx, scene, *settings, tx, ty, tiles[index]);
+	}
+};
+
+// Loads a navmesh set written by the streamed build.
+static dtNavMesh* loadVoxelNavMeshSet(const char* path)
+{
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return 0;
+	
+	VoxelNavMeshSetHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		header.magic != NAVMESHSET_MAGIC || header.version != NAVMESHSET_VERSION)
+	{
+		fclose(fp);
+		return 0;
+	}
+	
+	dtNavMesh* mesh = dtAllocNavMesh();
+	if (!mesh || dtStatusFailed(mesh->init(&header.params)))
+	{
+		dtFreeNavMesh(mesh);
+		fclose(fp);
+		return 0;
+	}
+	
+	for (int i = 0; i < header.numTiles; ++i)
+	{
+		VoxelNavMeshTileHeader tileHeader;
+		if (fread(&tileHeader, sizeof(tileHeader), 1, fp) != 1 || tileHeader.dataSize <= 0)
+			break;
+		
+		unsigned char* data = (unsigned char*)dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM);
+		if (!data)
+			break;
+		if (fread(data, tileHeader.dataSize, 1, fp) != 1)
+		{
+			dtFree(data);
+			break;
+		}
+		if (dtStatusFailed(mesh->addTile(data, tileHeader.dataSize, DT_TILE_FREE_DATA, tileHeader.tileRef, 0)))
+			dtFree(data);
+	}
+	
+	fclose(fp);
+	return mesh;
+}
 
 Sample_Voxels::Sample_Voxels()
 {
+	m_talloc = new LinearAllocator(32000);
+	m_tcomp = new FastLZCompressor;
+	m_tmproc = new MeshProcess;
+	setDefaultVoxelAreaTable(m_areaTable);
+	
 	setTool(new NavMeshTesterTool);
 }
 		
@@ -39,6 +153,10 @@ Sample_Voxels::~Sample_Voxels()
     m_scene = nullptr;
     
 	cleanup();
+	
+	delete m_talloc;
+	delete m_tcomp;
+	delete m_tmproc;
 }
 	
 void Sample_Voxels::cleanup()
@@ -53,6 +171,12 @@ void Sample_Voxels::cleanup()
 	m_pmesh = 0;
 	rcFreePolyMeshDetail(m_dmesh);
 	m_dmesh = 0;
+	dtFreeTileCache(m_tileCache);
+	m_tileCache = 0;
+	m_obstacleRefs.clear();
+	m_objectOpen.clear();
+	m_regionHashes.clear();
+	m_tileHashes.clear();
 	dtFreeNavMesh(m_navMesh);
 	m_navMesh = 0;
 }
@@ -66,6 +190,55 @@ void Sample_Voxels::handleSettings()
 
 	imguiSeparator();
 	
+	imguiLabel("Tiling");
+	if (imguiCheck("Build Tiles", m_buildTiles))
+		m_buildTiles = !m_buildTiles;
+	if (m_buildTiles)
+	{
+		imguiSlider("Tile Size (Regions)", &m_tileRegions, 1.0f, 8.0f, 1.0f);
+		if (imguiCheck("Dynamic Cells as Obstacles", m_useTileCache))
+			m_useTileCache = !m_useTileCache;
+		if (!m_useTileCache)
+		{
+			if (imguiCheck("Stream Regions", m_streamRegions))
+				m_streamRegions = !m_streamRegions;
+			if (m_streamRegions)
+				imguiSlider("Stream Window (Tiles)", &m_streamWindowTiles, 1.0f, 16.0f, 1.0f);
+		}
+		if (!m_tileHashes.empty() && imguiButton("Rebuild Changed Regions"))
+			rebuildChangedTiles();
+	}
+
+	imguiSeparator();
+	
+	if (m_tileCache && m_scene)
+	{
+		const int objectCount = m_scene->GetDynamicObjectCount();
+		int openCount = 0;
+		for (int i = 0; i < objectCount; ++i)
+			openCount += m_objectOpen[i];
+		
+		imguiLabel("Dynamic Objects");
+		char text[64];
+		snprintf(text, 64, "%d objects, %d open", objectCount, openCount);
+		imguiValue(text);
+		
+		if (objectCount > 0)
+		{
+			if (imguiButton("Open All"))
+				memset(m_objectOpen.data(), 1, objectCount);
+			if (imguiButton("Close All"))
+				memset(m_objectOpen.data(), 0, objectCount);
+			
+			imguiSlider("Object", &m_selectedObject, 0.0f, (float)(objectCount-1), 1.0f);
+			const int selected = rcMin((int)m_selectedObject, objectCount-1);
+			if (imguiButton(m_objectOpen[selected] ? "Close Object" : "Open Object"))
+				m_objectOpen[selected] = !m_objectOpen[selected];
+		}
+		
+		imguiSeparator();
+	}
+	
 	char msg[64];
 	snprintf(msg, 64, "Build Time: %.1fms", m_totalBuildTimeMs);
 	imguiLabel(msg);
@@ -111,16 +284,40 @@ void Sample_Voxels::handleTools()
 
 void Sample_Voxels::handleVoxelFile(const std::string& filePath)
 {
+    // Only the region counts are read here. The regions are loaded by the build, all of them at
+    // once, or a window at a time when the regions are streamed.
+    Scene scene;
+    if (!scene.Open(m_ctx, filePath.c_str()))
+        return;
+    
+    // The navmesh, the tile cache and its obstacles belong to the previous scene.
+    cleanup();
+    if (m_tool)
+    {
+        m_tool->reset();
+        m_tool->init(this);
+    }
+    resetToolStates();
+    initToolStates(this);
+
+    delete m_scene;
+    m_scene = nullptr;
+    m_voxelsPath = filePath;
+}
+
+bool Sample_Voxels::loadScene()
+{
+    if (m_scene)
+        return true;
+    
     auto scene = new Scene;
-    if (!scene->Load(filePath.c_str()))
+    if (!scene->Load(m_ctx, m_voxelsPath.c_str()))
     {
         delete scene;
-        return;
+        return false;
     }
-    
-    if (m_scene)
-        delete m_scene;
     m_scene = scene;
+    return true;
 }
 
 void Sample_Voxels::selectVoxelFile()
@@ -168,7 +365,7 @@ void Sample_Voxels::selectVoxelFile()
 void Sample_Voxels::handleDebugMode()
 {
     selectVoxelFile();
-    if (!m_scene)
+    if (m_voxelsPath.empty())
         return;
 
 	// Check which modes are valid.
@@ -232,7 +429,8 @@ void Sample_Voxels::handleDebugMode()
 
 void Sample_Voxels::handleRender()
 {
-	if (!m_solid)
+	// The tiled build does not keep the heightfield around.
+	if (!m_solid && !m_navMesh)
 		return;
 	
 	DebugDrawGL dd;
@@ -241,8 +439,8 @@ void Sample_Voxels::handleRender()
 	glDepthMask(GL_FALSE);
 
 	// Draw bounds
-	const float* bmin = m_solid->bmin;
-	const float* bmax = m_solid->bmax;
+	const float* bmin = m_cfg.bmin;
+	const float* bmax = m_cfg.bmax;
 	duDebugDrawBoxWire(&dd, bmin[0],bmin[1],bmin[2], bmax[0],bmax[1],bmax[2], duRGBA(255,255,255,128), 1.0f);
 	dd.begin(DU_DRAW_POINTS, 5.0f);
 	dd.vertex(bmin[0],bmin[1],bmin[2],duRGBA(255,255,255,128));
@@ -325,6 +523,21 @@ void Sample_Voxels::handleRender()
 		glDepthMask(GL_TRUE);
 	}
 	
+	if (m_tileCache && m_scene)
+	{
+		// Draw the dynamic objects, the closed ones are obstacles.
+		const DynamicObject* objects = m_scene->GetDynamicObjects();
+		for (int i = 0; i < m_scene->GetDynamicObjectCount(); ++i)
+		{
+			const float* omin = objects[i].BoundsMin;
+			const float* omax = objects[i].BoundsMax;
+			unsigned int col = m_objectOpen[i] ? duRGBA(32,192,32,128) : duRGBA(192,32,32,192);
+			if (i == (int)m_selectedObject)
+				col = duRGBA(255,255,255,192);
+			duDebugDrawBoxWire(&dd, omin[0],omin[1],omin[2], omax[0],omax[1],omax[2], col, 2.0f);
+		}
+	}
+	
 	if (m_tool)
 		m_tool->handleRender();
 	renderToolStates();
@@ -339,6 +552,47 @@ void Sample_Voxels::handleRenderOverlay(double* proj, double* model, int* view)
 	renderOverlayToolStates(proj, model, view);
 }
 
+void Sample_Voxels::handleUpdate(const float dt)
+{
+	Sample::handleUpdate(dt);
+	
+	if (!m_navMesh || !m_tileCache)
+		return;
+	
+	if (m_tileCacheUpToDate)
+		updateDynamicObjects();
+	m_tileCache->update(dt, m_navMesh, &m_tileCacheUpToDate);
+}
+
+void Sample_Voxels::updateDynamicObjects()
+{
+	// Closed objects are box obstacles. The box reaches down by the agent height,
+	// so that the surface below an object is blocked like it would be by its cells.
+	const DynamicObject* objects = m_scene->GetDynamicObjects();
+	int changed = 0;
+	for (int i = 0; i < m_scene->GetDynamicObjectCount() && changed < DYNAMIC_OBJECT_BATCH; ++i)
+	{
+		if (m_objectOpen[i] && m_obstacleRefs[i])
+		{
+			if (dtStatusFailed(m_tileCache->removeObstacle(m_obstacleRefs[i])))
+				break;
+			m_obstacleRefs[i] = 0;
+			changed++;
+		}
+		else if (!m_objectOpen[i] && !m_obstacleRefs[i])
+		{
+			float bmin[3];
+			rcVcopy(bmin, objects[i].BoundsMin);
+			bmin[1] -= m_agentHeight;
+			if (dtStatusFailed(m_tileCache->addBoxObstacle(bmin, objects[i].BoundsMax, &m_obstacleRefs[i])))
+				break;
+			changed++;
+		}
+	}
+	if (changed > 0)
+		m_tileCacheUpToDate = false;
+}
+
 void Sample_Voxels::handleMeshChanged(class InputGeom* geom)
 {
 	Sample::handleMeshChanged(geom);
@@ -356,23 +610,12 @@ void Sample_Voxels::handleMeshChanged(class InputGeom* geom)
 }
 
 
-bool Sample_Voxels::handleBuild()
+void Sample_Voxels::initConfig(Scene* scene)
 {
-	if (!m_scene)
-	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
-		return false;
-	}
-	
-	cleanup();
-    
-    //
-    // Step 1. Initialize build config.
-    //
-    
     // Init build configuration from GUI
     memset(&m_cfg, 0, sizeof(m_cfg));
-    m_scene->SetConfig(&m_cfg);
+    scene->SetConfig(&m_cfg);
+    scene->SetAreaTable(m_areaTable);
     
     m_cfg.walkableSlopeAngle = m_agentMaxSlope;
     m_cfg.walkableHeight = (int)ceilf(m_agentHeight / m_cfg.ch);
@@ -385,6 +628,37 @@ bool Sample_Voxels::handleBuild()
     m_cfg.maxVertsPerPoly = (int)m_vertsPerPoly;
     m_cfg.detailSampleDist = m_detailSampleDist < 0.9f ? 0 : m_cfg.cs * m_detailSampleDist;
     m_cfg.detailSampleMaxError = m_cfg.ch * m_detailSampleMaxError;
+}
+
+bool Sample_Voxels::handleBuild()
+{
+	if (m_voxelsPath.empty())
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
+		return false;
+	}
+	
+	cleanup();
+    
+    // The streamed build opens the scene itself and never loads the whole world.
+    if (m_buildTiles && !m_useTileCache && m_streamRegions)
+        return buildStreamedTiles();
+    
+    if (!loadScene())
+    {
+        m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not load '%s'.", m_voxelsPath.c_str());
+        return false;
+    }
+    
+    //
+    // Step 1. Initialize build config.
+    //
+    
+    initConfig(m_scene);
+    
+    // Large scenes exceed the 16-bit vertex indices of a single navmesh, build them in tiles.
+    if (m_buildTiles)
+        return m_useTileCache ? buildTileCache() : buildTiles();
     
     // Reset build times gathering.
     m_ctx->resetTimers();
@@ -599,27 +873,7 @@ bool Sample_Voxels::handleBuild()
 		int navDataSize = 0;
 
 		// Update poly flags from areas.
-		for (int i = 0; i < m_pmesh->npolys; ++i)
-		{
-			if (m_pmesh->areas[i] == RC_WALKABLE_AREA)
-				m_pmesh->areas[i] = SAMPLE_POLYAREA_GROUND;
-				
-			if (m_pmesh->areas[i] == SAMPLE_POLYAREA_GROUND ||
-				m_pmesh->areas[i] == SAMPLE_POLYAREA_GRASS ||
-				m_pmesh->areas[i] == SAMPLE_POLYAREA_ROAD)
-			{
-				m_pmesh->flags[i] = SAMPLE_POLYFLAGS_WALK;
-			}
-			else if (m_pmesh->areas[i] == SAMPLE_POLYAREA_WATER)
-			{
-				m_pmesh->flags[i] = SAMPLE_POLYFLAGS_SWIM;
-			}
-			else if (m_pmesh->areas[i] == SAMPLE_POLYAREA_DOOR)
-			{
-				m_pmesh->flags[i] = SAMPLE_POLYFLAGS_WALK | SAMPLE_POLYFLAGS_DOOR;
-			}
-		}
-
+		updatePolyFlags(m_areaTable.AreaFlags, m_pmesh->areas, m_pmesh->flags, m_pmesh->npolys);
 
 		dtNavMeshCreateParams params;
 		memset(&params, 0, sizeof(params));
@@ -699,3 +953,558 @@ bool Sample_Voxels::handleBuild()
 
 	return true;
 }
+
+void Sample_Voxels::initTileSettings(const Scene* scene, VoxelTileSettings& settings, const bool skipDynamic)
+{
+	// The tiles are aligned to the regions of the scene.
+	settings.cfg = m_cfg;
+	settings.cfg.tileSize = (int)m_tileRegions * scene->GetRegionSize();
+	settings.cfg.borderSize = m_cfg.walkableRadius + 3; // Reserve enough padding.
+	settings.cfg.width = settings.cfg.tileSize + settings.cfg.borderSize*2;
+	settings.cfg.height = settings.cfg.tileSize + settings.cfg.borderSize*2;
+	settings.tileWidth = (m_cfg.width + settings.cfg.tileSize-1) / settings.cfg.tileSize;
+	settings.skipDynamic = skipDynamic;
+	settings.areaTable = &m_areaTable;
+	settings.partitionType = m_partitionType;
+	settings.agentHeight = m_agentHeight;
+	settings.agentRadius = m_agentRadius;
+	settings.agentMaxClimb = m_agentMaxClimb;
+}
+
+void Sample_Voxels::updateManifest(const VoxelTileSettings& settings, const int tw, const int th)
+{
+	m_settingsHash = hashVoxelTileSettings(settings);
+	m_manifestTileWidth = tw;
+	m_manifestTileHeight = th;
+	
+	const int regionWidth = m_scene->GetRegionWidth();
+	const int regionHeight = m_scene->GetRegionHeight();
+	m_regionHashes.resize(regionWidth*regionHeight);
+	for (int y = 0; y < regionHeight; ++y)
+		for (int x = 0; x < regionWidth; ++x)
+			m_regionHashes[y*regionWidth + x] = m_scene->GetRegionHash(x, y);
+	
+	m_tileHashes.resize(tw*th);
+	for (int i = 0; i < tw*th; ++i)
+		m_tileHashes[i] = hashVoxelTileRegions(m_scene, settings, i % tw, i / tw);
+}
+
+bool Sample_Voxels::buildTiles()
+{
+	// The GUI may allow more max points per polygon than Detour can handle.
+	if (m_cfg.maxVertsPerPoly > DT_VERTS_PER_POLYGON)
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Too many vertices per polygon %d (max: %d).", m_cfg.maxVertsPerPoly, DT_VERTS_PER_POLYGON);
+		return false;
+	}
+	
+	VoxelTileSettings settings;
+	initTileSettings(m_scene, settings, false);
+	
+	const int ts = settings.cfg.tileSize;
+	const int tw = (m_cfg.width + ts-1) / ts;
+	const int th = (m_cfg.height + ts-1) / ts;
+	
+	const int tileBits = rcMin((int)dtIlog2(dtNextPow2(tw*th)), 14);
+	const int polyBits = 22 - tileBits;
+	if (tw*th > (1 << tileBits))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Too many tiles %d (max: %d).", tw*th, 1 << tileBits);
+		return false;
+	}
+	
+	m_navMesh = dtAllocNavMesh();
+	if (!m_navMesh)
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not allocate navmesh.");
+		return false;
+	}
+	
+	dtNavMeshParams params;
+	rcVcopy(params.orig, m_cfg.bmin);
+	params.tileWidth = ts*m_cfg.cs;
+	params.tileHeight = ts*m_cfg.cs;
+	params.maxTiles = 1 << tileBits;
+	params.maxPolys = 1 << polyBits;
+	
+	dtStatus status = m_navMesh->init(&params);
+	if (dtStatusFailed(status))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not init navmesh.");
+		return false;
+	}
+	
+	status = m_navQuery->init(m_navMesh, 2048);
+	if (dtStatusFailed(status))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not init Detour navmesh query");
+		return false;
+	}
+	
+	m_ctx->resetTimers();
+	m_ctx->startTimer(RC_TIMER_TOTAL);
+	
+	m_ctx->log(RC_LOG_PROGRESS, "Building tiled navigation:");
+	m_ctx->log(RC_LOG_PROGRESS, " - %d x %d cells", m_cfg.width, m_cfg.height);
+	m_ctx->log(RC_LOG_PROGRESS, " - %d x %d tiles of %d x %d cells", tw, th, ts, ts);
+	
+	VoxelTile* tiles = new VoxelTile[tw*th];
+	memset(tiles, 0, sizeof(VoxelTile)*tw*th);
+	
+	BuildVoxelTilesTask task;
+	task.scene = m_scene;
+	task.settings = &settings;
+	task.tiles = tiles;
+	task.tileIndices = nullptr;
+	m_ctx->runParallel(task, tw*th);
+	
+	// Add the tiles in tile order, so that the navmesh is the same regardless of the worker count.
+	// The tiles that could not be built are left empty.
+	int tileCount = 0;
+	int polyCount = 0;
+	for (int i = 0; i < tw*th; ++i)
+	{
+		VoxelTile& tile = tiles[i];
+		if (tile.error)
+			m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Tile (%d,%d): %s", i % tw, i / tw, tile.error);
+		if (!tile.data)
+			continue;
+		
+		const int tilePolyCount = ((const dtMeshHeader*)tile.data)->polyCount;
+		status = m_navMesh->addTile(tile.data, tile.dataSize, DT_TILE_FREE_DATA, 0, 0);
+		if (dtStatusFailed(status))
+		{
+			dtFree(tile.data);
+			m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not add tile (%d,%d).", i % tw, i / tw);
+			continue;
+		}
+		tileCount++;
+		polyCount += tilePolyCount;
+	}
+	delete [] tiles;
+	
+	updateManifest(settings, tw, th);
+	
+	m_ctx->stopTimer(RC_TIMER_TOTAL);
+	
+	m_ctx->log(RC_LOG_PROGRESS, ">> Navmesh: %d tiles  %d polygons", tileCount, polyCount);
+	
+	m_totalBuildTimeMs = m_ctx->getAccumulatedTime(RC_TIMER_TOTAL)/1000.0f;
+	
+	if (m_tool)
+		m_tool->init(this);
+	initToolStates(this);
+	
+	return true;
+}
+
+bool Sample_Voxels::rebuildChangedTiles()
+{
+	if (!m_scene || !m_navMesh || m_tileHashes.empty())
+	{
+		m_ctx->log(RC_LOG_ERROR, "rebuildChangedTiles: Build the tiled navmesh first.");
+		return false;
+	}
+	
+	m_ctx->resetTimers();
+	m_ctx->startTimer(RC_TIMER_TOTAL);
+	
+	std::vector<uint8_t> changedRegions;
+	if (!m_scene->ReloadChangedRegions(m_ctx, m_voxelsPath.c_str(), changedRegions))
+	{
+		m_ctx->log(RC_LOG_ERROR, "rebuildChangedTiles: Could not reload the scene.");
+		return false;
+	}
+	
+	initConfig(m_scene);
+	VoxelTileSettings settings;
+	initTileSettings(m_scene, settings, false);
+	
+	// Other settings or another tile grid change every tile, build the navmesh again.
+	const int ts = settings.cfg.tileSize;
+	const int tw = (m_cfg.width + ts-1) / ts;
+	const int th = (m_cfg.height + ts-1) / ts;
+	const int regionWidth = m_scene->GetRegionWidth();
+	const int regionHeight = m_scene->GetRegionHeight();
+	if (hashVoxelTileSettings(settings) != m_settingsHash || tw != m_manifestTileWidth || th != m_manifestTileHeight ||
+		regionWidth*regionHeight != (int)m_regionHashes.size())
+		return handleBuild();
+	
+	int regionCount = 0;
+	for (int i = 0; i < regionWidth*regionHeight; ++i)
+		regionCount += m_scene->GetRegionHash(i % regionWidth, i / regionWidth) != m_regionHashes[i];
+	
+	// The tiles whose border overlaps a changed region are built again, and swapped into the navmesh.
+	std::vector<int> tileIndices;
+	for (int i = 0; i < tw*th; ++i)
+	{
+		if (hashVoxelTileRegions(m_scene, settings, i % tw, i / tw) != m_tileHashes[i])
+			tileIndices.push_back(i);
+	}
+	const int count = (int)tileIndices.size();
+	
+	m_ctx->log(RC_LOG_PROGRESS, "Rebuilding tiled navigation:");
+	m_ctx->log(RC_LOG_PROGRESS, " - %d of %d regions changed", regionCount, regionWidth*regionHeight);
+	m_ctx->log(RC_LOG_PROGRESS, " - %d of %d tiles to rebuild", count, tw*th);
+	
+	VoxelTile* tiles = new VoxelTile[rcMax(count, 1)];
+	memset(tiles, 0, sizeof(VoxelTile)*rcMax(count, 1));
+	
+	BuildVoxelTilesTask task;
+	task.scene = m_scene;
+	task.settings = &settings;
+	task.tiles = tiles;
+	task.tileIndices = tileIndices.data();
+	m_ctx->runParallel(task, count);
+	
+	int polyCount = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		VoxelTile& tile = tiles[i];
+		const int tx = tileIndices[i] % tw;
+		const int ty = tileIndices[i] / tw;
+		
+		// Remove the old tile, a tile that is now empty is left out.
+		m_navMesh->removeTile(m_navMesh->getTileRefAt(tx, ty, 0), 0, 0);
+		
+		if (tile.error)
+			m_ctx->log(RC_LOG_ERROR, "rebuildChangedTiles: Tile (%d,%d): %s", tx, ty, tile.error);
+		if (!tile.data)
+			continue;
+		
+		const int tilePolyCount = ((const dtMeshHeader*)tile.data)->polyCount;
+		dtStatus status = m_navMesh->addTile(tile.data, tile.dataSize, DT_TILE_FREE_DATA, 0, 0);
+		if (dtStatusFailed(status))
+		{
+			dtFree(tile.data);
+			m_ctx->log(RC_LOG_ERROR, "rebuildChangedTiles: Could not add tile (%d,%d).", tx, ty);
+			continue;
+		}
+		polyCount += tilePolyCount;
+	}
+	delete [] tiles;
+	
+	updateManifest(settings, tw, th);
+	
+	m_ctx->stopTimer(RC_TIMER_TOTAL);
+	
+	m_ctx->log(RC_LOG_PROGRESS, ">> Rebuilt %d tiles  %d polygons", count, polyCount);
+	
+	m_totalBuildTimeMs = m_ctx->getAccumulatedTime(RC_TIMER_TOTAL)/1000.0f;
+	
+	if (m_tool)
+		m_tool->init(this);
+	initToolStates(this);
+	
+	return true;
+}
+
+bool Sample_Voxels::buildStreamedTiles()
+{
+	// The streamed scene holds only the regions under the tiles being built, and the tiles
+	// are written out as they are built, so the memory does not grow with the world.
+	// The grid comes from the region counts of the opened scene.
+	Scene scene;
+	if (!scene.Open(m_ctx, m_voxelsPath.c_str()))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Could not open '%s'.", m_voxelsPath.c_str());
+		return false;
+	}
+	initConfig(&scene);
+	
+	// The GUI may allow more max points per polygon than Detour can handle.
+	if (m_cfg.maxVertsPerPoly > DT_VERTS_PER_POLYGON)
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Too many vertices per polygon %d (max: %d).", m_cfg.maxVertsPerPoly, DT_VERTS_PER_POLYGON);
+		return false;
+	}
+	
+	VoxelTileSettings settings;
+	initTileSettings(&scene, settings, false);
+	
+	const int ts = settings.cfg.tileSize;
+	const int tw = (m_cfg.width + ts-1) / ts;
+	const int th = (m_cfg.height + ts-1) / ts;
+	
+	const int tileBits = rcMin((int)dtIlog2(dtNextPow2(tw*th)), 14);
+	const int polyBits = 22 - tileBits;
+	if (tw*th > (1 << tileBits))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Too many tiles %d (max: %d).", tw*th, 1 << tileBits);
+		return false;
+	}
+	
+	VoxelNavMeshSetHeader header;
+	header.magic = NAVMESHSET_MAGIC;
+	header.version = NAVMESHSET_VERSION;
+	header.numTiles = 0;
+	rcVcopy(header.params.orig, m_cfg.bmin);
+	header.params.tileWidth = ts*m_cfg.cs;
+	header.params.tileHeight = ts*m_cfg.cs;
+	header.params.maxTiles = 1 << tileBits;
+	header.params.maxPolys = 1 << polyBits;
+	
+	FILE* fp = fopen(VOXEL_NAVMESH_SET_PATH, "wb");
+	if (!fp || fwrite(&header, sizeof(header), 1, fp) != 1)
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Could not write '%s'.", VOXEL_NAVMESH_SET_PATH);
+		if (fp)
+			fclose(fp);
+		return false;
+	}
+	
+	m_ctx->resetTimers();
+	m_ctx->startTimer(RC_TIMER_TOTAL);
+	
+	// The window spans a few tiles along x, and slides along y through the world one band of tiles at a time.
+	VoxelTileWindow window;
+	initVoxelTileWindow(window, tw, th, (int)m_streamWindowTiles);
+	
+	m_ctx->log(RC_LOG_PROGRESS, "Building streamed navigation:");
+	m_ctx->log(RC_LOG_PROGRESS, " - %d x %d cells", m_cfg.width, m_cfg.height);
+	m_ctx->log(RC_LOG_PROGRESS, " - %d x %d tiles of %d x %d cells, %d at a time", tw, th, ts, ts, window.windowTiles);
+	
+	std::vector<VoxelTile> tiles(window.windowTiles);
+	std::vector<int> tileIndices;
+	int polyCount = 0;
+	bool ok = true;
+	while (ok && nextVoxelTileWindow(window))
+	{
+		const int bx = window.bx;
+		const int bw = window.bw;
+		const int ty = window.ty;
+		if (!loadVoxelTileWindow(m_ctx, &scene, settings, window))
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Could not load the regions of tiles (%d..%d,%d).", bx, bx+bw-1, ty);
+			ok = false;
+			break;
+		}
+		
+		tileIndices.clear();
+		for (int tx = bx; tx < bx+bw; ++tx)
+			tileIndices.push_back(ty*tw + tx);
+		memset(tiles.data(), 0, sizeof(VoxelTile)*bw);
+		
+		BuildVoxelTilesTask task;
+		task.scene = &scene;
+		task.settings = &settings;
+		task.tiles = tiles.data();
+		task.tileIndices = tileIndices.data();
+		m_ctx->runParallel(task, bw);
+		
+		// Write the tiles in order, the tiles that could not be built are left out.
+		for (int i = 0; i < bw; ++i)
+		{
+			VoxelTile& tile = tiles[i];
+			if (tile.error)
+				m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Tile (%d,%d): %s", bx+i, ty, tile.error);
+			if (!tile.data)
+				continue;
+			
+			VoxelNavMeshTileHeader tileHeader;
+			tileHeader.tileRef = 0;
+			tileHeader.dataSize = tile.dataSize;
+			if (ok && (fwrite(&tileHeader, sizeof(tileHeader), 1, fp) != 1 || fwrite(tile.data, tile.dataSize, 1, fp) != 1))
+			{
+				m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Could not write '%s'.", VOXEL_NAVMESH_SET_PATH);
+				ok = false;
+			}
+			header.numTiles++;
+			polyCount += ((const dtMeshHeader*)tile.data)->polyCount;
+			dtFree(tile.data);
+		}
+	}
+	
+	// The number of tiles is known once they are all written.
+	if (ok && (fseek(fp, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, fp) != 1))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Could not write '%s'.", VOXEL_NAVMESH_SET_PATH);
+		ok = false;
+	}
+	fclose(fp);
+	
+	m_ctx->stopTimer(RC_TIMER_TOTAL);
+	
+	if (!ok)
+		return false;
+	
+	// Every region was loaded once, the bounds cover the height of the whole scene now.
+	m_cfg.bmax[1] = settings.cfg.bmax[1];
+	
+	m_ctx->log(RC_LOG_PROGRESS, ">> Navmesh: %d tiles  %d polygons, written to '%s'", header.numTiles, polyCount, VOXEL_NAVMESH_SET_PATH);
+	m_ctx->log(RC_LOG_PROGRESS, ">> At most %d of %d regions loaded", window.maxLoadedRegions, scene.GetRegionWidth()*scene.GetRegionHeight());
+	
+	m_totalBuildTimeMs = m_ctx->getAccumulatedTime(RC_TIMER_TOTAL)/1000.0f;
+	
+	// Load the written tiles to show them.
+	m_navMesh = loadVoxelNavMeshSet(VOXEL_NAVMESH_SET_PATH);
+	if (!m_navMesh)
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Could not load '%s'.", VOXEL_NAVMESH_SET_PATH);
+		return false;
+	}
+	
+	dtStatus status = m_navQuery->init(m_navMesh, 2048);
+	if (dtStatusFailed(status))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildStreamedNavigation: Could not init Detour navmesh query");
+		return false;
+	}
+	
+	if (m_tool)
+		m_tool->init(this);
+	initToolStates(this);
+	
+	return true;
+}
+
+bool Sample_Voxels::buildTileCache()
+{
+	// The layers of the tile cache store their size in bytes.
+	VoxelTileSettings settings;
+	initTileSettings(m_scene, settings, true);
+	if (settings.cfg.width > 255)
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTileCache: Tile too large for the tile cache %d (max: %d).", settings.cfg.width, 255);
+		return false;
+	}
+	
+	const int ts = settings.cfg.tileSize;
+	const int tw = (m_cfg.width + ts-1) / ts;
+	const int th = (m_cfg.height + ts-1) / ts;
+	
+	const int tileBits = rcMin((int)dtIlog2(dtNextPow2(tw*th*EXPECTED_LAYERS_PER_TILE)), 14);
+	const int polyBits = 22 - tileBits;
+	
+	const int objectCount = m_scene->GetDynamicObjectCount();
+	
+	dtTileCacheParams tcparams;
+	memset(&tcparams, 0, sizeof(tcparams));
+	rcVcopy(tcparams.orig, m_cfg.bmin);
+	tcparams.cs = m_cfg.cs;
+	tcparams.ch = m_cfg.ch;
+	tcparams.width = ts;
+	tcparams.height = ts;
+	tcparams.walkableHeight = m_agentHeight;
+	tcparams.walkableRadius = m_agentRadius;
+	tcparams.walkableClimb = m_agentMaxClimb;
+	tcparams.maxSimplificationError = m_edgeMaxError;
+	tcparams.maxTiles = tw*th*EXPECTED_LAYERS_PER_TILE;
+	// Removed obstacles are freed only once their tiles are rebuilt, leave room to close the objects again.
+	tcparams.maxObstacles = rcMax(objectCount*2, 1);
+	
+	// A generous estimate of what the tile cache builder allocates for a layer.
+	m_talloc->resize(settings.cfg.width*settings.cfg.height*32);
+	m_tmproc->setAreaFlags(m_areaTable.AreaFlags);
+	
+	m_tileCache = dtAllocTileCache();
+	if (!m_tileCache)
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTileCache: Could not allocate tile cache.");
+		return false;
+	}
+	dtStatus status = m_tileCache->init(&tcparams, m_talloc, m_tcomp, m_tmproc);
+	if (dtStatusFailed(status))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTileCache: Could not init tile cache.");
+		return false;
+	}
+	
+	m_navMesh = dtAllocNavMesh();
+	if (!m_navMesh)
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTileCache: Could not allocate navmesh.");
+		return false;
+	}
+	
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	rcVcopy(params.orig, m_cfg.bmin);
+	params.tileWidth = ts*m_cfg.cs;
+	params.tileHeight = ts*m_cfg.cs;
+	params.maxTiles = 1 << tileBits;
+	params.maxPolys = 1 << polyBits;
+	
+	status = m_navMesh->init(&params);
+	if (dtStatusFailed(status))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTileCache: Could not init navmesh.");
+		return false;
+	}
+	
+	status = m_navQuery->init(m_navMesh, 2048);
+	if (dtStatusFailed(status))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildTileCache: Could not init Detour navmesh query");
+		return false;
+	}
+	
+	m_ctx->resetTimers();
+	m_ctx->startTimer(RC_TIMER_TOTAL);
+	
+	m_ctx->log(RC_LOG_PROGRESS, "Building tile cache:");
+	m_ctx->log(RC_LOG_PROGRESS, " - %d x %d cells", m_cfg.width, m_cfg.height);
+	m_ctx->log(RC_LOG_PROGRESS, " - %d x %d tiles of %d x %d cells", tw, th, ts, ts);
+	
+	VoxelCacheTile* tiles = new VoxelCacheTile[tw*th];
+	memset(tiles, 0, sizeof(VoxelCacheTile)*tw*th);
+	
+	BuildVoxelTileLayersTask task;
+	task.scene = m_scene;
+	task.settings = &settings;
+	task.tiles = tiles;
+	m_ctx->runParallel(task, tw*th);
+	
+	// Add the layers to the tile cache in tile order, the tiles that could not be built are left empty.
+	int layerCount = 0;
+	for (int i = 0; i < tw*th; ++i)
+	{
+		VoxelCacheTile& tile = tiles[i];
+		if (tile.error)
+			m_ctx->log(RC_LOG_ERROR, "buildTileCache: Tile (%d,%d): %s", i % tw, i / tw, tile.error);
+		
+		for (int j = 0; j < tile.nlayers; ++j)
+		{
+			VoxelCacheLayer& layer = tile.layers[j];
+			status = m_tileCache->addTile(layer.data, layer.dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0);
+			if (dtStatusFailed(status))
+			{
+				dtFree(layer.data);
+				continue;
+			}
+			layerCount++;
+		}
+	}
+	delete [] tiles;
+	
+	for (int y = 0; y < th; ++y)
+		for (int x = 0; x < tw; ++x)
+			m_tileCache->buildNavMeshTilesAt(x, y, m_navMesh);
+	
+	// The dynamic objects start closed, like they were part of the scene.
+	m_obstacleRefs.assign(objectCount, 0);
+	m_objectOpen.assign(objectCount, 0);
+	m_tileCacheUpToDate = true;
+	for (;;)
+	{
+		if (m_tileCacheUpToDate)
+		{
+			updateDynamicObjects();
+			if (m_tileCacheUpToDate)
+				break;
+		}
+		m_tileCache->update(0, m_navMesh, &m_tileCacheUpToDate);
+	}
+	
+	m_ctx->stopTimer(RC_TIMER_TOTAL);
+	
+	m_ctx->log(RC_LOG_PROGRESS, ">> Tile cache: %d layers  %d obstacles", layerCount, objectCount);
+	
+	m_totalBuildTimeMs = m_ctx->getAccumulatedTime(RC_TIMER_TOTAL)/1000.0f;
+	
+	if (m_tool)
+		m_tool->init(this);
+	initToolStates(this);
+	
+	return true;
+}
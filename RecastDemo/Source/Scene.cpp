@@ -2,8 +2,22 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
-#include <cassert>
 #include <algorithm>
+#include <vector>
+#ifdef WIN32
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   ifndef NOMINMAX
+#       define NOMINMAX // std::min and std::max are used below.
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
 
 // #define USE_TEST_SCENE
 #define MAX_SIZE (1 << 6)
@@ -43,33 +57,137 @@ struct RegionHeader
 };
 #pragma pack()
 
+// The cells of a column are stored one after the other, from bottom to top.
 struct Cell
 {
     CellBaseInfo BaseInfo;
     
-    int HighLayer;                  // 上表面高度 （相对场景最低点 单位：Layer）
-    int LowLayer;                   // 下表面高度 （相对场景最低点 单位：Layer）
-    Cell* Next = nullptr;           // 竖直方向向上的下一个Cell (不可交叉重叠)
+    uint16_t HighLayer;             // 上表面高度 （相对场景最低点 单位：Layer）
+    uint16_t LowLayer;              // 下表面高度 （相对场景最低点 单位：Layer）
 };
+static_assert(sizeof(Cell) == 8, "Cell should stay compact.");
 
 struct Region
 {
     int RegionX;
     int RegionY;
-    Cell* Cells = nullptr;
     
-    Cell* NormalCellArray = nullptr;
-    Cell* DynamicCellArray = nullptr;
+    int CellCount = 0;
+    Cell* Cells = nullptr;              // 按列连续存放的Cell, 列按 y * MAX_SIZE + x 排列
+    uint16_t* ColumnCounts = nullptr;   // 每列的Cell数量
+    uint64_t ContentHash = 0;           // 区域文件内容的哈希
+    uint16_t MaxLayer = 0;              // 区域最高的上表面高度
 };
 
-static long GetFileSize(FILE* file)
+// A read-only mapping of a whole file.
+class MappedFile
 {
-    auto offset = ftell(file);
-    fseek(file, 0, SEEK_END);
-    auto size = ftell(file);
-    fseek(file, offset, SEEK_SET);
-    return size;
-}
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    ~MappedFile()
+    {
+#ifdef WIN32
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+#else
+        if (m_data)
+            munmap((void*)m_data, m_size);
+#endif
+    }
+    
+    bool Open(const char* filePath)
+    {
+#ifdef WIN32
+        m_file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+            return false;
+        
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size))
+            return false;
+        m_size = (size_t)size.QuadPart;
+        if (m_size == 0)
+            return true;
+        
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping)
+            return false;
+        m_data = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        return m_data != nullptr;
+#else
+        auto file = open(filePath, O_RDONLY);
+        if (file < 0)
+            return false;
+        
+        struct stat info;
+        if (fstat(file, &info) != 0)
+        {
+            close(file);
+            return false;
+        }
+        
+        m_size = (size_t)info.st_size;
+        if (m_size > 0)
+        {
+            auto data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (data != MAP_FAILED)
+                m_data = (const uint8_t*)data;
+        }
+        
+        // The mapping stays valid after the file is closed.
+        close(file);
+        return m_size == 0 || m_data != nullptr;
+#endif
+    }
+    
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+    
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+};
+
+// Reads the packed fields of a region file, which are not aligned.
+class RegionReader
+{
+public:
+    RegionReader(const uint8_t* data, size_t size) : m_offset(data), m_left(size) {}
+    
+    bool Has(size_t size) const { return m_left >= size; }
+    size_t Left() const { return m_left; }
+    const uint8_t* Data() const { return m_offset; }
+    
+    template <typename T>
+    T Read()
+    {
+        T value;
+        memcpy(&value, m_offset, sizeof(T));
+        Skip(sizeof(T));
+        return value;
+    }
+    
+    void Skip(size_t size)
+    {
+        m_offset += size;
+        m_left -= size;
+    }
+    
+private:
+    const uint8_t* m_offset;
+    size_t m_left;
+};
 
 static void ParseVoxelCfg(const char* filePath, int& x, int& y)
 {
@@ -103,374 +221,350 @@ static void ParseVoxelCfg(const char* filePath, int& x, int& y)
     fclose(file);
 }
 
-static Cell* GetLowestObstacle(Region* pRegion, int nXCell, int nYCell)
+// The sizes of the records of a region file.
+static const size_t BASE_CELL_DATA_SIZE = sizeof(CellBaseInfo) + sizeof(uint16_t);
+static const size_t EXT_CELL_DATA_SIZE = sizeof(uint8_t) * 2 + sizeof(CellBaseInfo) + sizeof(uint16_t) * 2;
+
+// The sections of a region file, validated before the cells are parsed.
+struct RegionLayout
+{
+    const uint8_t* BaseCells = nullptr;
+    const uint8_t* NormalCells = nullptr;
+    const uint8_t* DynamicCells = nullptr;
+    int NormalCellCount = 0;
+    int DynamicCellCount = 0;
+    size_t DynamicCellSize = 0;
+};
+
+static SceneError ReadExtCellCount(RegionReader& reader, size_t uExtCellDataSize, const uint8_t*& pbyCells, int& nCellCount)
 {
-    assert(nXCell >= 0);
-    assert(nXCell < MAX_SIZE);
-    assert(nYCell >= 0);
-    assert(nYCell < MAX_SIZE);
+    if (!reader.Has(sizeof(int32_t)))
+        return SceneError::Truncated;
+    
+    nCellCount = reader.Read<int32_t>();
+    if (nCellCount < 0 || (size_t)nCellCount > reader.Left() / uExtCellDataSize)
+        return SceneError::Truncated;
+    
+    pbyCells = reader.Data();
+    reader.Skip(nCellCount * uExtCellDataSize);
+    return SceneError::None;
+}
+
+static SceneError ReadRegionLayout(const Region* region, const MappedFile& file, RegionLayout& layout)
+{
+    if (file.Size() < sizeof(RegionHeader))
+        return SceneError::Truncated;
+    
+    RegionHeader header;
+    memcpy(&header, file.Data(), sizeof(header));
+    if (header.RegionX != region->RegionX || header.RegionY != region->RegionY)
+        return SceneError::RegionMismatch;
+    
+    if (header.Version != 7 && header.Version != 8)
+        return SceneError::UnsupportedVersion;
+    
+    // Dynamic cells store one more field than normal cells in version 7, and two in version 8.
+    layout.DynamicCellSize = EXT_CELL_DATA_SIZE + sizeof(uint16_t) * (header.Version == 7 ? 1 : 2);
+    
+    RegionReader reader(file.Data() + sizeof(RegionHeader), file.Size() - sizeof(RegionHeader));
+    if (!reader.Has(BASE_CELL_DATA_SIZE * MAX_SIZE * MAX_SIZE))
+        return SceneError::Truncated;
+    layout.BaseCells = reader.Data();
+    reader.Skip(BASE_CELL_DATA_SIZE * MAX_SIZE * MAX_SIZE);
+    
+    auto error = ReadExtCellCount(reader, EXT_CELL_DATA_SIZE, layout.NormalCells, layout.NormalCellCount);
+    if (error != SceneError::None)
+        return error;
+    
+    error = ReadExtCellCount(reader, layout.DynamicCellSize, layout.DynamicCells, layout.DynamicCellCount);
+    if (error != SceneError::None)
+        return error;
+    
+    if (reader.Has(SCRIPT_DATA_SIZE))
+        reader.Skip(SCRIPT_DATA_SIZE);
+    
+    if (reader.Left() != 0)
+        return SceneError::TrailingData;
     
-    return pRegion->Cells + MAX_SIZE * nYCell + nXCell;
+    return SceneError::None;
 }
 
-static bool AddObstacle(Region* pRegion, int nXCell, int nYCell, Cell* pCell)
+static Cell ReadExtCell(const uint8_t* pbyData, bool bDynamic, int& nCellX, int& nCellY)
 {
-    auto bFound = false;
-    assert(pCell);
+    RegionReader reader(pbyData, EXT_CELL_DATA_SIZE);
+    Cell cell;
     
-    auto* pInsertPos = GetLowestObstacle(pRegion, nXCell, nYCell);
-    while (!bFound)
+    nCellX = reader.Read<uint8_t>();
+    nCellY = reader.Read<uint8_t>();
+    cell.BaseInfo = reader.Read<CellBaseInfo>();
+    cell.BaseInfo.dwDynamic = bDynamic ? 1 : 0;
+    cell.HighLayer = reader.Read<uint16_t>();
+    cell.LowLayer = reader.Read<uint16_t>();
+    return cell;
+}
+
+// Inserts a cell into the first gap of the column it fits in, the column has room for one more cell.
+static bool AddObstacle(Cell* pColumn, int nCount, const Cell& cell)
+{
+    auto nInsertPos = 0;
+    for (;;)
     {
-        assert(pCell->LowLayer >= pInsertPos->HighLayer);
+        // Cells may not overlap the cells below them.
+        if (cell.LowLayer < pColumn[nInsertPos].HighLayer)
+            return false;
         
-        if (pInsertPos->Next)
-        {
-            if (pCell->LowLayer >= pInsertPos->HighLayer &&
-                pCell->HighLayer <= pInsertPos->Next->LowLayer)
-            {
-                bFound = true;
-            }
-            else
-            {
-                pInsertPos = pInsertPos->Next;
-            }
-        }
-        else
-        {
-            bFound = true;
-        }
+        if (nInsertPos + 1 >= nCount || cell.HighLayer <= pColumn[nInsertPos + 1].LowLayer)
+            break;
+        
+        nInsertPos++;
     }
     
-    pCell->Next = pInsertPos->Next;
-    pInsertPos->Next = pCell;
-    
+    memmove(pColumn + nInsertPos + 2, pColumn + nInsertPos + 1, (nCount - nInsertPos - 1) * sizeof(Cell));
+    pColumn[nInsertPos + 1] = cell;
     return true;
 }
 
-static bool LoadTerrainBufferV7(Region* pRegion, const uint8_t* pbyData, size_t uDataLen)
+// Counts the cells of the columns of a region, the base cells included.
+static SceneError CountColumnCells(const RegionLayout& layout, uint16_t* pColumnCounts)
 {
-    bool            bResult                 = false;
-    bool            bRetCode                = false;
-    size_t          uLeftBytes              = uDataLen;
-    const uint8_t*  pbyOffset               = pbyData;
-    size_t          uBaseCellInfoSize       = sizeof(CellBaseInfo) + sizeof(uint16_t);
-    Cell*           pAllocNormalCell        = NULL;
-    Cell*           pAllocDynamicCell       = NULL;
-    int             nExtNormalCellCount     = 0;
-    size_t          uExtNormalCellDataSize  = sizeof(uint8_t) * 2 + sizeof(CellBaseInfo) + sizeof(uint16_t) * 2;
-    int             nExtDynamicCellCount    = 0;
-    size_t          uExtDynamicCellDataSize = sizeof(uint8_t) * 2 + sizeof(CellBaseInfo) + sizeof(uint16_t) * 2 + sizeof(uint16_t);
+    for (int i = 0; i < MAX_SIZE * MAX_SIZE; i++)
+        pColumnCounts[i] = 1;
     
-    assert(uLeftBytes >= uBaseCellInfoSize * MAX_SIZE * MAX_SIZE);
-    uLeftBytes -= uBaseCellInfoSize * MAX_SIZE * MAX_SIZE;
-    
-    for (int nCellY = 0; nCellY < MAX_SIZE; nCellY++)
+    for (int nDynamic = 0; nDynamic < 2; nDynamic++)
     {
-        for (int nCellX = 0; nCellX < MAX_SIZE; nCellX++)
+        auto pbyCells = nDynamic ? layout.DynamicCells : layout.NormalCells;
+        auto nCellCount = nDynamic ? layout.DynamicCellCount : layout.NormalCellCount;
+        auto uCellSize = nDynamic ? layout.DynamicCellSize : EXT_CELL_DATA_SIZE;
+        
+        for (int nIndex = 0; nIndex < nCellCount; nIndex++)
         {
-            Cell*              pCell       = GetLowestObstacle(pRegion, nCellX, nCellY);
-            CellBaseInfo*      pBaseInfo   = (CellBaseInfo*)pbyOffset;
-            
-            pCell->BaseInfo             = *pBaseInfo;
-            pCell->BaseInfo.dwDynamic   = 0;
-            pCell->LowLayer             = 0;
-            
-            pbyOffset += sizeof(CellBaseInfo);
+            const uint8_t* pbyCell = pbyCells + nIndex * uCellSize;
+            int nCellX = pbyCell[0];
+            int nCellY = pbyCell[1];
+            if (nCellX >= MAX_SIZE || nCellY >= MAX_SIZE)
+                return SceneError::InvalidCell;
             
-            pCell->HighLayer = *(uint16_t*)pbyOffset;
-            pbyOffset += sizeof(uint16_t);
+            auto& count = pColumnCounts[nCellY * MAX_SIZE + nCellX];
+            if (count == UINT16_MAX)
+                return SceneError::InvalidCell;
+            count++;
         }
     }
     
-    assert(uLeftBytes >= sizeof(int32_t));
-    uLeftBytes -= sizeof(int32_t);
-    
-    nExtNormalCellCount = *(int32_t*)pbyOffset;
-    pbyOffset += sizeof(int32_t);
-    
-    assert(nExtNormalCellCount >= 0);
-    assert(uLeftBytes >= nExtNormalCellCount * uExtNormalCellDataSize);
-    uLeftBytes -= nExtNormalCellCount * uExtNormalCellDataSize;
+    return SceneError::None;
+}
+
+static SceneError LoadRegionCells(Region* pRegion, const RegionLayout& layout)
+{
+    uint32_t    columnStarts[MAX_SIZE * MAX_SIZE];
+    uint16_t    columnFilled[MAX_SIZE * MAX_SIZE];
+    uint32_t    uOffset = 0;
     
-    if (nExtNormalCellCount > 0)
+    // The counts were validated to fit the cells of the region.
+    for (int i = 0; i < MAX_SIZE * MAX_SIZE; i++)
     {
-        assert(pRegion->NormalCellArray == nullptr);
-        pRegion->NormalCellArray = new Cell[nExtNormalCellCount];
-        
+        columnStarts[i] = uOffset;
+        columnFilled[i] = 1;
+        uOffset += pRegion->ColumnCounts[i];
     }
     
-    for (int nIndex = 0; nIndex < nExtNormalCellCount; nIndex++)
+    RegionReader reader(layout.BaseCells, BASE_CELL_DATA_SIZE * MAX_SIZE * MAX_SIZE);
+    for (int i = 0; i < MAX_SIZE * MAX_SIZE; i++)
     {
-        int                 nCellX      = 0;
-        int                 nCellY      = 0;
-        CellBaseInfo*       pBaseInfo   = NULL;
-        
-        pAllocNormalCell = pRegion->NormalCellArray + nIndex;
-        assert(pAllocNormalCell);
-        
-        nCellX = *(uint8_t*)pbyOffset;
-        pbyOffset += sizeof(uint8_t);
-        
-        nCellY = *(uint8_t*)pbyOffset;
-        pbyOffset += sizeof(uint8_t);
+        Cell* pCell = pRegion->Cells + columnStarts[i];
         
-        pBaseInfo = (CellBaseInfo*)pbyOffset;
-        pbyOffset += sizeof(CellBaseInfo);
-        
-        pAllocNormalCell->BaseInfo = *pBaseInfo;
-        pAllocNormalCell->BaseInfo.dwDynamic = 0;
-        
-        pAllocNormalCell->HighLayer = *(uint16_t*)pbyOffset;
-        pbyOffset += sizeof(uint16_t);
-        
-        pAllocNormalCell->LowLayer = *(uint16_t*)pbyOffset;
-        pbyOffset += sizeof(uint16_t);
-        
-        bRetCode = AddObstacle(pRegion, nCellX, nCellY, pAllocNormalCell);
-        assert(bRetCode);
-        
-        pAllocNormalCell = NULL;
+        pCell->BaseInfo             = reader.Read<CellBaseInfo>();
+        pCell->BaseInfo.dwDynamic   = 0;
+        pCell->LowLayer             = 0;
+        pCell->HighLayer            = reader.Read<uint16_t>();
     }
     
-    assert(uLeftBytes >= sizeof(int32_t));
-    uLeftBytes -= sizeof(int32_t);
-    
-    nExtDynamicCellCount = *(int32_t*)pbyOffset;
-    pbyOffset += sizeof(int32_t);
-    
-    assert(nExtDynamicCellCount >= 0);
-    assert(uLeftBytes >= nExtDynamicCellCount * uExtDynamicCellDataSize);
-    uLeftBytes -= nExtDynamicCellCount * uExtDynamicCellDataSize;
-    
-    if (nExtDynamicCellCount > 0)
+    for (int nDynamic = 0; nDynamic < 2; nDynamic++)
     {
-        assert(pRegion->DynamicCellArray == nullptr);
-        pRegion->DynamicCellArray = new Cell[nExtDynamicCellCount];
+        auto pbyCells = nDynamic ? layout.DynamicCells : layout.NormalCells;
+        auto nCellCount = nDynamic ? layout.DynamicCellCount : layout.NormalCellCount;
+        auto uCellSize = nDynamic ? layout.DynamicCellSize : EXT_CELL_DATA_SIZE;
+        
+        for (int nIndex = 0; nIndex < nCellCount; nIndex++)
+        {
+            int nCellX = 0;
+            int nCellY = 0;
+            auto cell = ReadExtCell(pbyCells + nIndex * uCellSize, nDynamic != 0, nCellX, nCellY);
+            auto nColumn = nCellY * MAX_SIZE + nCellX;
+            
+            if (!AddObstacle(pRegion->Cells + columnStarts[nColumn], columnFilled[nColumn], cell))
+                return SceneError::InvalidCell;
+            columnFilled[nColumn]++;
+        }
     }
     
-    for (int nIndex = 0; nIndex < nExtDynamicCellCount; nIndex++)
+    return SceneError::None;
+}
+
+// Maps the file of a region and validates its layout.
+// The arrays are indexed by region, indices picks the regions to map when only some of them are loaded.
+class MapRegionTask : public rcParallelTask
+{
+public:
+    Region* regions = nullptr;
+    const int* indices = nullptr;
+    const char* filePath = nullptr;
+    MappedFile* files = nullptr;
+    RegionLayout* layouts = nullptr;
+    SceneError* errors = nullptr;
+    
+    virtual void run(const int taskIndex, const int /*worker*/)
     {
-        int                 nCellX      = 0;
-        int                 nCellY      = 0;
-        CellBaseInfo*       pBaseInfo   = NULL;
-        
-        pAllocDynamicCell = pRegion->DynamicCellArray + nIndex;
-        assert(pAllocDynamicCell);
-        
-        nCellX = *(uint8_t*)pbyOffset;
-        pbyOffset += sizeof(uint8_t);
-        
-        nCellY = *(uint8_t*)pbyOffset;
-        pbyOffset += sizeof(uint8_t);
-        
-        pBaseInfo = (CellBaseInfo*)pbyOffset;
-        pbyOffset += sizeof(CellBaseInfo);
+        auto index = indices ? indices[taskIndex] : taskIndex;
+        auto region = &regions[index];
         
-        pAllocDynamicCell->BaseInfo = *pBaseInfo;
-        pAllocDynamicCell->BaseInfo.dwDynamic = 1;
+        char regionPath[1024];
+        snprintf(regionPath, sizeof(regionPath), "%s.data/v_%03d/%03d_Region.map", filePath, region->RegionY, region->RegionX);
         
-        pAllocDynamicCell->HighLayer = *(uint16_t*)pbyOffset;
-        pbyOffset += sizeof(uint16_t);
-        
-        pAllocDynamicCell->LowLayer = *(uint16_t*)pbyOffset;
-        pbyOffset += sizeof(uint16_t);
-        
-        pbyOffset += sizeof(uint16_t);
+        if (!files[index].Open(regionPath))
+        {
+            errors[index] = SceneError::OpenFailed;
+            return;
+        }
         
-        bRetCode = AddObstacle(pRegion, nCellX, nCellY, pAllocDynamicCell);
-        assert(bRetCode);
+        region->ContentHash = HashBytes(files[index].Data(), files[index].Size());
         
-        pAllocDynamicCell = NULL;
-    }
-    
-    
-    if (uLeftBytes >= SCRIPT_DATA_SIZE)
-    {
-        pbyOffset  += SCRIPT_DATA_SIZE;
-        uLeftBytes -= SCRIPT_DATA_SIZE;
+        auto& layout = layouts[index];
+        errors[index] = ReadRegionLayout(region, files[index], layout);
+        if (errors[index] == SceneError::None)
+            region->CellCount = MAX_SIZE * MAX_SIZE + layout.NormalCellCount + layout.DynamicCellCount;
     }
-    
-    assert(uLeftBytes == 0);
-    
-    bResult = true;
-    return bResult;
+};
+
+// The highest cell of a region, the height of the scene is found as the regions are parsed.
+static uint16_t FindMaxLayer(const Region* region)
+{
+    uint16_t maxLayer = 0;
+    for (auto i = 0; i < region->CellCount; i++)
+        maxLayer = std::max(maxLayer, region->Cells[i].HighLayer);
+    return maxLayer;
 }
 
-static bool LoadTerrainBufferV8(Region* pRegion, const uint8_t* pbyData, size_t uDataLen)
+// Parses the cells of a mapped region file straight into the cells of the scene, like MapRegionTask.
+// When reloading, the regions that did not change are copied from the old scene instead.
+class ParseRegionTask : public rcParallelTask
 {
-    bool            bResult                 = false;
-    bool            bRetCode                = false;
-    size_t          uLeftBytes              = uDataLen;
-    const uint8_t*  pbyOffset               = pbyData;
-    size_t          uBaseCellInfoSize       = sizeof(CellBaseInfo) + sizeof(uint16_t);
-    Cell*           pAllocNormalCell        = NULL;
-    Cell*           pAllocDynamicCell       = NULL;
-    int             nExtNormalCellCount     = 0;
-    size_t          uExtNormalCellDataSize  = sizeof(uint8_t) * 2 + sizeof(CellBaseInfo) + sizeof(uint16_t) * 2;
-    int             nExtDynamicCellCount    = 0;
-    size_t          uExtDynamicCellDataSize = sizeof(uint8_t) * 2 + sizeof(CellBaseInfo) + sizeof(uint16_t) * 2 + sizeof(uint16_t) * 2;
+public:
+    Region* regions = nullptr;
+    const int* indices = nullptr;
+    const RegionLayout* layouts = nullptr;
+    SceneError* errors = nullptr;
+    const Region* oldRegions = nullptr;
+    const uint8_t* changed = nullptr;
     
-    assert(uLeftBytes >= uBaseCellInfoSize * MAX_SIZE * MAX_SIZE);
-    uLeftBytes -= uBaseCellInfoSize * MAX_SIZE * MAX_SIZE;
-    
-    for (int nCellY = 0; nCellY < MAX_SIZE; nCellY++)
+    virtual void run(const int taskIndex, const int /*worker*/)
     {
-        for (int nCellX = 0; nCellX < MAX_SIZE; nCellX++)
+        auto index = indices ? indices[taskIndex] : taskIndex;
+        auto region = &regions[index];
+        if (oldRegions && !changed[index])
         {
-            Cell*               pCell       = GetLowestObstacle(pRegion, nCellX, nCellY);
-            CellBaseInfo*       pBaseInfo   = (CellBaseInfo*)pbyOffset;
-            
-            pCell->BaseInfo           = *pBaseInfo;
-            pCell->BaseInfo.dwDynamic = 0;
-            pCell->LowLayer           = 0;
-            
-            pbyOffset += sizeof(CellBaseInfo);
-            
-            pCell->HighLayer = *(uint16_t*)pbyOffset;
-            pbyOffset += sizeof(uint16_t);
+            memcpy(region->Cells, oldRegions[index].Cells, region->CellCount * sizeof(Cell));
+            memcpy(region->ColumnCounts, oldRegions[index].ColumnCounts, MAX_SIZE * MAX_SIZE * sizeof(uint16_t));
+            region->MaxLayer = oldRegions[index].MaxLayer;
+            return;
         }
+        
+        errors[index] = CountColumnCells(layouts[index], region->ColumnCounts);
+        if (errors[index] == SceneError::None)
+            errors[index] = LoadRegionCells(region, layouts[index]);
+        if (errors[index] == SceneError::None)
+            region->MaxLayer = FindMaxLayer(region);
     }
-    
-    assert(uLeftBytes >= sizeof(int32_t));
-    uLeftBytes -= sizeof(int32_t);
-    
-    nExtNormalCellCount = *(int32_t*)pbyOffset;
-    pbyOffset += sizeof(int32_t);
-    
-    assert(nExtNormalCellCount >= 0);
-    assert(uLeftBytes >= nExtNormalCellCount * uExtNormalCellDataSize);
-    uLeftBytes -= nExtNormalCellCount * uExtNormalCellDataSize;
-    
-    if (nExtNormalCellCount > 0)
+};
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t hash)
+{
+    // FNV-1a over 8 bytes at a time, with a shift to carry the high bits of a step into the
+    // low bits of the next. The region files are hashed in full on every load.
+    const uint64_t prime = 0x100000001b3ull;
+    auto bytes = (const uint8_t*)data;
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), bytes += sizeof(uint64_t))
     {
-        assert(pRegion->NormalCellArray == nullptr);
-        pRegion->NormalCellArray = new Cell[nExtNormalCellCount];
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
     }
-    
-    for (int nIndex = 0; nIndex < nExtNormalCellCount; nIndex++)
+    for (; size > 0; size--, bytes++)
+        hash = (hash ^ *bytes) * prime;
+    return hash;
+}
+
+const char* GetSceneErrorString(SceneError error)
+{
+    switch (error)
     {
-        int                 nCellX      = 0;
-        int                 nCellY      = 0;
-        CellBaseInfo*       pBaseInfo   = NULL;
-        
-        pAllocNormalCell = pRegion->NormalCellArray + nIndex;
-        
-        nCellX = *(uint8_t*)pbyOffset;
-        pbyOffset += sizeof(uint8_t);
-        
-        nCellY = *(uint8_t*)pbyOffset;
-        pbyOffset += sizeof(uint8_t);
-        
-        pBaseInfo = (CellBaseInfo*)pbyOffset;
-        pbyOffset += sizeof(CellBaseInfo);
-        
-        pAllocNormalCell->BaseInfo = *pBaseInfo;
-        pAllocNormalCell->BaseInfo.dwDynamic = 0;
-        
-        pAllocNormalCell->HighLayer = *(uint16_t*)pbyOffset;
-        pbyOffset += sizeof(uint16_t);
-        
-        pAllocNormalCell->LowLayer = *(uint16_t*)pbyOffset;
-        pbyOffset += sizeof(uint16_t);
-        
-        bRetCode = AddObstacle(pRegion, nCellX, nCellY, pAllocNormalCell);
-        assert(bRetCode);
-        
-        pAllocNormalCell = NULL;
+        case SceneError::None:                  return "no error";
+        case SceneError::InvalidConfig:         return "invalid config";
+        case SceneError::OpenFailed:            return "cannot open file";
+        case SceneError::Truncated:             return "truncated file";
+        case SceneError::RegionMismatch:        return "region mismatch";
+        case SceneError::UnsupportedVersion:    return "unsupported version";
+        case SceneError::InvalidCell:           return "invalid cell";
+        case SceneError::TrailingData:          return "trailing data";
     }
-    
-    assert(uLeftBytes >= sizeof(int32_t));
-    uLeftBytes -= sizeof(int32_t);
-    
-    nExtDynamicCellCount = *(int32_t*)pbyOffset;
-    pbyOffset += sizeof(int32_t);
-    
-    assert(nExtDynamicCellCount >= 0);
-    assert(uLeftBytes >= nExtDynamicCellCount * uExtDynamicCellDataSize);
-    uLeftBytes -= nExtDynamicCellCount * uExtDynamicCellDataSize;
-    
-    if (nExtDynamicCellCount > 0)
+    return "unknown error";
+}
+
+Scene::~Scene()
+{
+    if (m_streaming)
     {
-        assert(pRegion->DynamicCellArray == nullptr);
-        pRegion->DynamicCellArray = new Cell[nExtDynamicCellCount];
+        for (int i = 0; i < m_regionWidth * m_regionHeight; i++)
+            UnloadRegion(&m_regions[i]);
     }
     
-    for (int nIndex = 0; nIndex < nExtDynamicCellCount; nIndex++)
-    {
-        int                 nCellX      = 0;
-        int                 nCellY      = 0;
-        CellBaseInfo*       pBaseInfo   = NULL;
-        
-        pAllocDynamicCell = pRegion->DynamicCellArray + nIndex;
-        assert(pAllocDynamicCell);
-        
-        nCellX = *(uint8_t*)pbyOffset;
-        pbyOffset += sizeof(uint8_t);
-        
-        nCellY = *(uint8_t*)pbyOffset;
-        pbyOffset += sizeof(uint8_t);
-        
-        pBaseInfo = (CellBaseInfo*)pbyOffset;
-        pbyOffset += sizeof(CellBaseInfo);
-        
-        pAllocDynamicCell->BaseInfo = *pBaseInfo;
-        pAllocDynamicCell->BaseInfo.dwDynamic = 1;
-        
-        pAllocDynamicCell->HighLayer = *(uint16_t*)pbyOffset;
-        pbyOffset += sizeof(uint16_t);
-        
-        pAllocDynamicCell->LowLayer = *(uint16_t*)pbyOffset;
-        pbyOffset += sizeof(uint16_t);
-        
-        pbyOffset += sizeof(uint16_t);
-        pbyOffset += sizeof(uint16_t);
-        
-        bRetCode = AddObstacle(pRegion, nCellX, nCellY, pAllocDynamicCell);
-        assert(bRetCode);
-        
-        pAllocDynamicCell = NULL;
-    }
+    delete[] m_cells;
+    delete[] m_columnCounts;
+    delete[] m_regions;
+}
+
+void Scene::AllocateCells()
+{
+    auto regionCount = m_regionWidth * m_regionHeight;
+    
+    m_cellCount = 0;
+    for (int i = 0; i < regionCount; i++)
+        m_cellCount += m_regions[i].CellCount;
     
+    // All cells of the scene live in a single arena.
+    m_cells = new Cell[m_cellCount];
+    m_columnCounts = new uint16_t[regionCount * MAX_SIZE * MAX_SIZE];
     
-    if (uLeftBytes >= SCRIPT_DATA_SIZE)
+    auto cells = m_cells;
+    for (int i = 0; i < regionCount; i++)
     {
-        pbyOffset  += SCRIPT_DATA_SIZE;
-        uLeftBytes -= SCRIPT_DATA_SIZE;
+        m_regions[i].Cells = cells;
+        m_regions[i].ColumnCounts = m_columnCounts + i * MAX_SIZE * MAX_SIZE;
+        cells += m_regions[i].CellCount;
     }
-    
-    assert(uLeftBytes == 0);
-    
-    bResult = true;
-    return bResult;
 }
 
-Scene::~Scene()
+SceneError Scene::LogErrors(rcContext* ctx, const char* function, const SceneError* errors) const
 {
-    for (int y = 0; y < m_regionHeight; y++)
+    auto firstError = SceneError::None;
+    for (int i = 0; i < m_regionWidth * m_regionHeight; i++)
     {
-        for (int x = 0; x < m_regionWidth; x++)
-        {
-            Region* region = &m_regions[y * m_regionWidth + x];
-            
-            if (region->Cells)
-                delete[] region->Cells;
-            
-            if (region->NormalCellArray)
-                delete[] region->NormalCellArray;
-            
-            
-            if (region->DynamicCellArray)
-                delete[] region->DynamicCellArray;
-        }
+        if (errors[i] == SceneError::None)
+            continue;
+        
+        ctx->log(RC_LOG_ERROR, "%s: Region (%d, %d): %s.", function, m_regions[i].RegionX, m_regions[i].RegionY,
+                 GetSceneErrorString(errors[i]));
+        if (firstError == SceneError::None)
+            firstError = errors[i];
     }
     
-    if (m_regions)
-        delete[] m_regions;
+    return firstError;
 }
 
 #ifdef USE_TEST_SCENE
 
-bool Scene::Load(const char* filePath)
+bool Scene::Load(rcContext* ctx, const char* filePath)
 {
     m_regionWidth = 2;
     m_regionHeight = 2;
@@ -481,138 +575,340 @@ bool Scene::Load(const char* filePath)
         for (auto xRegion = 0; xRegion < m_regionWidth; xRegion++)
         {
             auto region = &m_regions[yRegion * m_regionWidth + xRegion];
-            assert(region->Cells == nullptr);
-            
             region->RegionX = xRegion;
             region->RegionY = yRegion;
-            region->Cells = new Cell[MAX_SIZE * MAX_SIZE];
-            
-            for (auto yCell = 0; yCell < MAX_SIZE; yCell++)
-            {
-                for (auto xCell = 0; xCell < MAX_SIZE; xCell++)
-                {
-                    auto cell = GetLowestObstacle(region, xCell, yCell);
-                    cell->HighLayer = 100 - yCell;
-                    cell->LowLayer = 10;
-                }
-            }
+            region->CellCount = MAX_SIZE * MAX_SIZE * (xRegion == 0 && yRegion == 0 ? 2 : 1);
         }
     }
     
-    for (auto yRegion = 0; yRegion < 1; yRegion++)
+    AllocateCells();
+    
+    for (auto i = 0; i < m_regionWidth * m_regionHeight; i++)
     {
-        for (auto xRegion = 0; xRegion < 1; xRegion++)
+        auto region = &m_regions[i];
+        auto cell = region->Cells;
+        for (auto yCell = 0; yCell < MAX_SIZE; yCell++)
         {
-            auto region = &m_regions[yRegion * m_regionWidth + xRegion];
-            region->NormalCellArray = new Cell[MAX_SIZE * MAX_SIZE];
-    
-            for (auto yCell = 0; yCell < MAX_SIZE; yCell++)
+            for (auto xCell = 0; xCell < MAX_SIZE; xCell++)
             {
-                for (auto xCell = 0; xCell < MAX_SIZE; xCell++)
+                region->ColumnCounts[yCell * MAX_SIZE + xCell] = 1;
+                memset(cell, 0, sizeof(Cell));
+                cell->HighLayer = 100 - yCell;
+                cell->LowLayer = 10;
+                cell++;
+                
+                if (i == 0)
                 {
-                    auto cell = &region->NormalCellArray[yCell * MAX_SIZE + xCell];
+                    region->ColumnCounts[yCell * MAX_SIZE + xCell] = 2;
+                    memset(cell, 0, sizeof(Cell));
                     cell->HighLayer = 1200 - yCell;
                     cell->LowLayer = 1000;
-                    
-                    AddObstacle(region, xCell, yCell, cell);
-                    
+                    cell++;
                 }
             }
         }
+        
+        region->MaxLayer = FindMaxLayer(region);
+        m_maxLayer = std::max(m_maxLayer, (int)region->MaxLayer);
     }
     
     return true;
 }
+
+bool Scene::ReloadChangedRegions(rcContext* ctx, const char* filePath, std::vector<uint8_t>& changed)
+{
+    // The test scene never changes.
+    changed.assign(m_regionWidth * m_regionHeight, 0);
+    return true;
+}
 #else
-bool Scene::Load(const char* filePath)
+bool Scene::Load(rcContext* ctx, const char* filePath)
 {
     ParseVoxelCfg(filePath, m_regionWidth, m_regionHeight);
     
-    assert(m_regionWidth > 0 && m_regionWidth <= MAX_SIZE);
-    assert(m_regionHeight > 0 && m_regionHeight <= MAX_SIZE);
+    if (m_regionWidth <= 0 || m_regionWidth > MAX_SIZE || m_regionHeight <= 0 || m_regionHeight > MAX_SIZE)
+    {
+        ctx->log(RC_LOG_ERROR, "Scene::Load: %s: %s (%d x %d regions).", filePath,
+                 GetSceneErrorString(SceneError::InvalidConfig), m_regionWidth, m_regionHeight);
+        m_error = SceneError::InvalidConfig;
+        m_regionWidth = 0;
+        m_regionHeight = 0;
+        return false;
+    }
 
-    m_regions = new Region[m_regionWidth * m_regionHeight];
+    auto regionCount = m_regionWidth * m_regionHeight;
+    m_regions = new Region[regionCount];
     
     for (int y = 0; y < m_regionHeight; y++)
     {
         for (int x = 0; x < m_regionWidth; x++)
         {
             Region* region = &m_regions[y * m_regionWidth + x];
-            
-            assert(region->Cells == nullptr);
-            
             region->RegionX = x;
             region->RegionY = y;
-            region->Cells = new Cell[MAX_SIZE * MAX_SIZE];
-            LoadRegion(region, filePath);
         }
     }
     
+    // Map the region files in parallel to size the cell arena, then parse
+    // the cells in parallel straight into the arena.
+    std::vector<MappedFile> files(regionCount);
+    std::vector<RegionLayout> layouts(regionCount);
+    std::vector<SceneError> errors(regionCount, SceneError::None);
+    
+    MapRegionTask mapTask;
+    mapTask.regions = m_regions;
+    mapTask.filePath = filePath;
+    mapTask.files = files.data();
+    mapTask.layouts = layouts.data();
+    mapTask.errors = errors.data();
+    ctx->runParallel(mapTask, regionCount);
+    
+    m_error = LogErrors(ctx, "Scene::Load", errors.data());
+    if (m_error != SceneError::None)
+        return false;
+    
+    AllocateCells();
+    
+    ParseRegionTask parseTask;
+    parseTask.regions = m_regions;
+    parseTask.layouts = layouts.data();
+    parseTask.errors = errors.data();
+    ctx->runParallel(parseTask, regionCount);
+    
+    m_error = LogErrors(ctx, "Scene::Load", errors.data());
+    if (m_error != SceneError::None)
+        return false;
+    
+    for (int i = 0; i < regionCount; i++)
+        m_maxLayer = std::max(m_maxLayer, (int)m_regions[i].MaxLayer);
+    
+    FindDynamicObjects();
     return true;
 }
-#endif
 
-bool Scene::LoadRegion(Region* region, const char* fileFolder)
+bool Scene::ReloadChangedRegions(rcContext* ctx, const char* filePath, std::vector<uint8_t>& changed)
 {
-    char filePath[1024];
-    snprintf(filePath, sizeof(filePath), "%s.data/v_%03d/%03d_Region.map", fileFolder, region->RegionY, region->RegionX);
+    if (m_streaming)
+    {
+        ctx->log(RC_LOG_ERROR, "Scene::ReloadChangedRegions: The scene is streamed.");
+        return false;
+    }
     
-    auto file = fopen(filePath, "rb");
-    if (!file)
+    auto regionWidth = 0;
+    auto regionHeight = 0;
+    ParseVoxelCfg(filePath, regionWidth, regionHeight);
+    
+    if (regionWidth != m_regionWidth || regionHeight != m_regionHeight)
+    {
+        ctx->log(RC_LOG_ERROR, "Scene::ReloadChangedRegions: %s: The region count changed (%d x %d regions), reload the scene.",
+                 filePath, regionWidth, regionHeight);
         return false;
+    }
     
-    auto fileSize = GetFileSize(file);
-    auto buffer = new uint8_t[fileSize];
-    auto retCode = fread(buffer, fileSize, 1, file);
-    assert(retCode == 1);
-
-    auto header = (RegionHeader*)buffer;
-    assert(header->RegionX == region->RegionX);
-    assert(header->RegionY == region->RegionY);
+    auto regionCount = m_regionWidth * m_regionHeight;
+    auto regions = new Region[regionCount];
+    for (int i = 0; i < regionCount; i++)
+    {
+        regions[i].RegionX = m_regions[i].RegionX;
+        regions[i].RegionY = m_regions[i].RegionY;
+    }
+    
+    // Every region file is mapped and hashed, only the regions whose hash changed are parsed again.
+    std::vector<MappedFile> files(regionCount);
+    std::vector<RegionLayout> layouts(regionCount);
+    std::vector<SceneError> errors(regionCount, SceneError::None);
     
-    switch (header->Version)
+    MapRegionTask mapTask;
+    mapTask.regions = regions;
+    mapTask.filePath = filePath;
+    mapTask.files = files.data();
+    mapTask.layouts = layouts.data();
+    mapTask.errors = errors.data();
+    ctx->runParallel(mapTask, regionCount);
+    
+    if (LogErrors(ctx, "Scene::ReloadChangedRegions", errors.data()) != SceneError::None)
     {
-        case 7:
-            retCode = LoadTerrainBufferV7(region, buffer + sizeof(RegionHeader), fileSize - sizeof(RegionHeader));
-            assert(retCode);
-            break;
-            
-        case 8:
-            retCode = LoadTerrainBufferV8(region, buffer + sizeof(RegionHeader), fileSize - sizeof(RegionHeader));
-            assert(retCode);
-            break;
-            
-        default:
-            assert(false);
-            break;
+        delete[] regions;
+        return false;
     }
     
-    delete[] buffer;
-    fclose(file);
-    return retCode;
+    changed.assign(regionCount, 0);
+    auto changedCount = 0;
+    for (int i = 0; i < regionCount; i++)
+    {
+        changed[i] = regions[i].ContentHash != m_regions[i].ContentHash;
+        changedCount += changed[i];
+    }
+    
+    if (changedCount == 0)
+    {
+        delete[] regions;
+        return true;
+    }
+    
+    // The cells are moved to a new arena, the old scene is kept until the changed regions are parsed.
+    auto oldRegions = m_regions;
+    auto oldCells = m_cells;
+    auto oldColumnCounts = m_columnCounts;
+    auto oldCellCount = m_cellCount;
+    m_regions = regions;
+    AllocateCells();
+    
+    ParseRegionTask parseTask;
+    parseTask.regions = m_regions;
+    parseTask.layouts = layouts.data();
+    parseTask.errors = errors.data();
+    parseTask.oldRegions = oldRegions;
+    parseTask.changed = changed.data();
+    ctx->runParallel(parseTask, regionCount);
+    
+    if (LogErrors(ctx, "Scene::ReloadChangedRegions", errors.data()) != SceneError::None)
+    {
+        delete[] m_cells;
+        delete[] m_columnCounts;
+        delete[] m_regions;
+        m_regions = oldRegions;
+        m_cells = oldCells;
+        m_columnCounts = oldColumnCounts;
+        m_cellCount = oldCellCount;
+        return false;
+    }
+    
+    delete[] oldCells;
+    delete[] oldColumnCounts;
+    delete[] oldRegions;
+    
+    m_maxLayer = 0;
+    for (int i = 0; i < regionCount; i++)
+        m_maxLayer = std::max(m_maxLayer, (int)m_regions[i].MaxLayer);
+    
+    FindDynamicObjects();
+    return true;
 }
+#endif
 
-int Scene::GetSceneHeight()
+bool Scene::Open(rcContext* ctx, const char* filePath)
 {
-    auto height = 0;
-    for (auto y = 0; y < m_regionHeight; y++)
+    ParseVoxelCfg(filePath, m_regionWidth, m_regionHeight);
+    
+    if (m_regionWidth <= 0 || m_regionWidth > MAX_SIZE || m_regionHeight <= 0 || m_regionHeight > MAX_SIZE)
     {
-        for (auto x = 0; x < m_regionWidth; x++)
+        ctx->log(RC_LOG_ERROR, "Scene::Open: %s: %s (%d x %d regions).", filePath,
+                 GetSceneErrorString(SceneError::InvalidConfig), m_regionWidth, m_regionHeight);
+        m_error = SceneError::InvalidConfig;
+        m_regionWidth = 0;
+        m_regionHeight = 0;
+        return false;
+    }
+    
+    m_streaming = true;
+    m_filePath = filePath;
+    m_regions = new Region[m_regionWidth * m_regionHeight];
+    for (int y = 0; y < m_regionHeight; y++)
+    {
+        for (int x = 0; x < m_regionWidth; x++)
         {
             Region* region = &m_regions[y * m_regionWidth + x];
-            for (auto i = 0; i < (MAX_SIZE * MAX_SIZE); ++i)
-            {
-                auto cell = region->Cells + i;
-                while (cell)
-                {
-                    height = std::max(height, cell->HighLayer);
-                    cell = cell->Next;
-                }
-            }
+            region->RegionX = x;
+            region->RegionY = y;
         }
     }
     
-    return height;
+    return true;
+}
+
+void Scene::UnloadRegion(Region* region)
+{
+    delete[] region->Cells;
+    delete[] region->ColumnCounts;
+    region->Cells = nullptr;
+    region->ColumnCounts = nullptr;
+    region->CellCount = 0;
+}
+
+bool Scene::LoadWindow(rcContext* ctx, int xRegionMin, int yRegionMin, int xRegionMax, int yRegionMax)
+{
+    if (!m_streaming)
+    {
+        ctx->log(RC_LOG_ERROR, "Scene::LoadWindow: The scene is not opened for streaming.");
+        return false;
+    }
+    
+    // The regions behind the window are unloaded first, so that at most the regions of the window are in memory.
+    auto regionCount = m_regionWidth * m_regionHeight;
+    std::vector<int> indices;
+    for (int i = 0; i < regionCount; i++)
+    {
+        auto region = &m_regions[i];
+        auto inside = region->RegionX >= xRegionMin && region->RegionX < xRegionMax &&
+                      region->RegionY >= yRegionMin && region->RegionY < yRegionMax;
+        if (!inside)
+            UnloadRegion(region);
+        else if (!region->ColumnCounts)
+            indices.push_back(i);
+    }
+    
+    if (indices.empty())
+        return true;
+    
+    std::vector<MappedFile> files(regionCount);
+    std::vector<RegionLayout> layouts(regionCount);
+    std::vector<SceneError> errors(regionCount, SceneError::None);
+    
+    MapRegionTask mapTask;
+    mapTask.regions = m_regions;
+    mapTask.indices = indices.data();
+    mapTask.filePath = m_filePath.c_str();
+    mapTask.files = files.data();
+    mapTask.layouts = layouts.data();
+    mapTask.errors = errors.data();
+    ctx->runParallel(mapTask, (int)indices.size());
+    
+    auto error = LogErrors(ctx, "Scene::LoadWindow", errors.data());
+    if (error == SceneError::None)
+    {
+        // Each region of a streamed scene has cells of its own, to be freed when it leaves the window.
+        for (auto i : indices)
+        {
+            m_regions[i].Cells = new Cell[m_regions[i].CellCount];
+            m_regions[i].ColumnCounts = new uint16_t[MAX_SIZE * MAX_SIZE];
+        }
+        
+        ParseRegionTask parseTask;
+        parseTask.regions = m_regions;
+        parseTask.indices = indices.data();
+        parseTask.layouts = layouts.data();
+        parseTask.errors = errors.data();
+        ctx->runParallel(parseTask, (int)indices.size());
+        
+        error = LogErrors(ctx, "Scene::LoadWindow", errors.data());
+    }
+    
+    if (error != SceneError::None)
+    {
+        m_error = error;
+        for (auto i : indices)
+            UnloadRegion(&m_regions[i]);
+        return false;
+    }
+    
+    for (auto i : indices)
+        m_maxLayer = std::max(m_maxLayer, (int)m_regions[i].MaxLayer);
+    
+    return true;
+}
+
+int Scene::GetLoadedRegionCount() const
+{
+    auto count = 0;
+    for (int i = 0; i < m_regionWidth * m_regionHeight; i++)
+        count += m_regions[i].ColumnCounts != nullptr;
+    return count;
+}
+
+int Scene::GetSceneHeight()
+{
+    return m_maxLayer;
 }
 
 bool Scene::SetConfig(rcConfig* cfg)
@@ -633,33 +929,258 @@ bool Scene::SetConfig(rcConfig* cfg)
     return true;
 }
 
+int Scene::GetRegionSize() const
+{
+    return MAX_SIZE;
+}
+
+uint64_t Scene::GetRegionHash(int xRegion, int yRegion) const
+{
+    return m_regions[yRegion * m_regionWidth + xRegion].ContentHash;
+}
+
+static void SetCellField(CellBaseInfo& info, CellField field, uint32_t value)
+{
+    switch (field)
+    {
+        case CellField::CellType:           info.dwCellType = value; break;
+        case CellField::Indoor:             info.dwIndoor = value; break;
+        case CellField::PassWidth:          info.dwPassWidth = value; break;
+        case CellField::AdvancedObstacle:   info.dwAdvancedObstacle = value; break;
+        case CellField::GradientDirection:  info.dwGradientDirection = value; break;
+        case CellField::GradientDegree:     info.dwGradientDegree = value; break;
+        case CellField::BarrierDirection:   info.dwBarrierDirection = value; break;
+        case CellField::FaceUp:             info.dwFaceUp = value; break;
+        case CellField::Dynamic:            info.dwDynamic = value; break;
+        case CellField::NoObstacleRange:    info.dwNoObstacleRange = value; break;
+        case CellField::ScriptIndex:        info.dwScriptIndex = value; break;
+        case CellField::PutObj:             info.dwPutObj = value; break;
+        case CellField::Rest:               info.dwRest = value; break;
+        case CellField::Sprint:             info.dwSprint = value; break;
+        case CellField::RideHorse:          info.dwRideHorse = value; break;
+        case CellField::BlockCharacter:     info.dwBlockCharacter = value; break;
+    }
+}
+
+void Scene::SetAreaTable(const CellAreaTable& table)
+{
+    static_assert(sizeof(CellBaseInfo) == sizeof(uint32_t), "The fields of a cell are matched as a single word.");
+    
+    // The fields are set in an empty CellBaseInfo to find their bits, whatever the layout of the bit fields.
+    m_areaMasks.clear();
+    for (auto& rule : table.Rules)
+    {
+        CellBaseInfo mask;
+        CellBaseInfo value;
+        memset(&mask, 0, sizeof(mask));
+        memset(&value, 0, sizeof(value));
+        SetCellField(mask, rule.Field, UINT32_MAX);
+        SetCellField(value, rule.Field, rule.Value);
+        
+        CellAreaMask areaMask;
+        memcpy(&areaMask.Mask, &mask, sizeof(uint32_t));
+        memcpy(&areaMask.Value, &value, sizeof(uint32_t));
+        areaMask.Area = rule.Area;
+        m_areaMasks.push_back(areaMask);
+    }
+    m_defaultArea = table.DefaultArea;
+}
+
+// The cells of a column are sorted from bottom to top, longer columns are added in several parts.
+static const int MAX_COLUMN_PART = 64;
+
+// The area rules of a scene, as the rasterization tasks see them.
+struct AreaRules
+{
+    const CellAreaMask* Masks;
+    int MaskCount;
+    uint8_t DefaultArea;
+};
+
+static uint8_t GetCellArea(const CellBaseInfo& info, const AreaRules& rules)
+{
+    uint32_t bits;
+    memcpy(&bits, &info, sizeof(bits));
+    for (auto i = 0; i < rules.MaskCount; i++)
+    {
+        if ((bits & rules.Masks[i].Mask) == rules.Masks[i].Value)
+            return rules.Masks[i].Area;
+    }
+    return rules.DefaultArea;
+}
+
+// Returns the number of spans copied, the dynamic cells are left out when skipped.
+static int CopyColumnPart(const Cell* pCells, int nCount, bool bSkipDynamic, const AreaRules& rules,
+                          unsigned short* smin, unsigned short* smax, unsigned char* areas)
+{
+    auto nSpans = 0;
+    for (auto i = 0; i < nCount; i++)
+    {
+        if (bSkipDynamic && pCells[i].BaseInfo.dwDynamic)
+            continue;
+        
+        smin[nSpans] = pCells[i].LowLayer;
+        smax[nSpans] = pCells[i].HighLayer;
+        areas[nSpans] = GetCellArea(pCells[i].BaseInfo, rules);
+        nSpans++;
+    }
+    return nSpans;
+}
+
+// Adds the cells of a row of regions to the heightfield, using the spans reserved for the row.
+class RasterizeRegionRowTask : public rcParallelTask
+{
+public:
+    Region* regions = nullptr;
+    int regionWidth = 0;
+    AreaRules rules = {};
+    rcHeightfield* hf = nullptr;
+    int flagMergeThr = 0;
+    rcReservedSpans* spans = nullptr;
+    int* failed = nullptr;
+
+    virtual void run(const int index, const int /*worker*/)
+    {
+        unsigned short smin[MAX_COLUMN_PART];
+        unsigned short smax[MAX_COLUMN_PART];
+        unsigned char areas[MAX_COLUMN_PART];
+        
+        for (auto xRegion = 0; xRegion < regionWidth; xRegion++)
+        {
+            auto region = &regions[index * regionWidth + xRegion];
+            auto cell = region->Cells;
+            auto columnCount = region->ColumnCounts;
+            for (auto yCell = 0; yCell < MAX_SIZE; yCell++)
+            {
+                auto y = index * MAX_SIZE + yCell;
+                for (auto xCell = 0; xCell < MAX_SIZE; xCell++)
+                {
+                    auto x = xRegion * MAX_SIZE + xCell;
+                    auto left = (int)*columnCount++;
+                    while (left > 0)
+                    {
+                        auto count = std::min(left, MAX_COLUMN_PART);
+                        CopyColumnPart(cell, count, false, rules, smin, smax, areas);
+                        cell += count;
+                        left -= count;
+                        
+                        if (!rcAddReservedSpanColumn(*hf, spans[index], x, y, smin, smax, areas, count, flagMergeThr))
+                        {
+                            failed[index] = 1;
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
 bool Scene::RasterizeScene(rcContext* ctx, rcHeightfield* hf, const int flagMergeThr)
 {
+    // Reserve a span for each cell of a region row, so that the rows can be
+    // added to the heightfield in parallel.
+    std::vector<rcReservedSpans> spans(m_regionHeight);
+    std::vector<int> failed(m_regionHeight, 0);
+    auto ok = true;
     
-    for (auto yRegion = 0; yRegion < m_regionHeight; yRegion++)
+    for (int i = 0; i < m_regionWidth * m_regionHeight && ok; i++)
+    {
+        if (!m_regions[i].ColumnCounts)
+        {
+            ctx->log(RC_LOG_ERROR, "RasterizeScene: Region (%d, %d) is not loaded.", m_regions[i].RegionX, m_regions[i].RegionY);
+            ok = false;
+        }
+    }
+    
+    for (auto yRegion = 0; yRegion < m_regionHeight && ok; yRegion++)
     {
+        auto count = 0;
         for (auto xRegion = 0; xRegion < m_regionWidth; xRegion++)
+        {
+            count += m_regions[yRegion * m_regionWidth + xRegion].CellCount;
+        }
+        ok = rcReserveSpans(ctx, *hf, count, spans[yRegion]);
+    }
+    
+    if (ok)
+    {
+        RasterizeRegionRowTask task;
+        task.regions = m_regions;
+        task.regionWidth = m_regionWidth;
+        task.rules = {m_areaMasks.data(), (int)m_areaMasks.size(), m_defaultArea};
+        task.hf = hf;
+        task.flagMergeThr = flagMergeThr;
+        task.spans = spans.data();
+        task.failed = failed.data();
+        ctx->runParallel(task, m_regionHeight);
+        
+        for (auto yRegion = 0; yRegion < m_regionHeight; yRegion++)
+        {
+            if (failed[yRegion])
+            {
+                ctx->log(RC_LOG_ERROR, "RasterizeScene: Out of reserved spans in region row %d.", yRegion);
+                ok = false;
+            }
+        }
+    }
+    
+    for (auto yRegion = 0; yRegion < m_regionHeight; yRegion++)
+        rcReleaseSpans(*hf, spans[yRegion]);
+    
+    return ok;
+}
+
+bool Scene::RasterizeTile(rcContext* ctx, rcHeightfield* hf, const int minX, const int minY, const bool skipDynamic, const int flagMergeThr)
+{
+    unsigned short smin[MAX_COLUMN_PART];
+    unsigned short smax[MAX_COLUMN_PART];
+    unsigned char areas[MAX_COLUMN_PART];
+    const AreaRules rules = {m_areaMasks.data(), (int)m_areaMasks.size(), m_defaultArea};
+    
+    // Only the regions overlapping the tile are visited, the cells outside of the tile are skipped.
+    auto maxX = minX + hf->width;
+    auto maxY = minY + hf->height;
+    auto xRegionMin = std::max(minX, 0) / MAX_SIZE;
+    auto yRegionMin = std::max(minY, 0) / MAX_SIZE;
+    auto xRegionMax = std::min((maxX + MAX_SIZE - 1) / MAX_SIZE, m_regionWidth);
+    auto yRegionMax = std::min((maxY + MAX_SIZE - 1) / MAX_SIZE, m_regionHeight);
+    
+    for (auto yRegion = yRegionMin; yRegion < yRegionMax; yRegion++)
+    {
+        for (auto xRegion = xRegionMin; xRegion < xRegionMax; xRegion++)
         {
             auto region = &m_regions[yRegion * m_regionWidth + xRegion];
+            if (!region->ColumnCounts)
+            {
+                ctx->log(RC_LOG_ERROR, "RasterizeTile: Region (%d, %d) is not loaded.", xRegion, yRegion);
+                return false;
+            }
+            
+            auto cell = region->Cells;
+            auto columnCount = region->ColumnCounts;
             for (auto yCell = 0; yCell < MAX_SIZE; yCell++)
             {
+                auto y = yRegion * MAX_SIZE + yCell;
                 for (auto xCell = 0; xCell < MAX_SIZE; xCell++)
                 {
-                    auto cell = GetLowestObstacle(region, xCell, yCell);
-                    // cell = cell->Next;
+                    auto x = xRegion * MAX_SIZE + xCell;
+                    auto left = (int)*columnCount++;
+                    if (x < minX || x >= maxX || y < minY || y >= maxY)
+                    {
+                        cell += left;
+                        continue;
+                    }
                     
-                    while (cell)
+                    while (left > 0)
                     {
-                        //if (cell->BaseInfo.dwCellType == 0)
-                        {
-                            // unsigned char area = cell->BaseInfo.dwCellType;
-                            unsigned char area = RC_WALKABLE_AREA;
-                            rcAddSpan(ctx, *hf, xRegion * MAX_SIZE + xCell,  yRegion * MAX_SIZE + yCell,
-                                      cell->LowLayer, cell->HighLayer, area, flagMergeThr);
-                        }
-
+                        auto count = std::min(left, MAX_COLUMN_PART);
+                        auto spanCount = CopyColumnPart(cell, count, skipDynamic, rules, smin, smax, areas);
+                        cell += count;
+                        left -= count;
                         
-                        cell = cell->Next;
+                        if (spanCount > 0 && !rcAddSpanColumn(ctx, *hf, x - minX, y - minY, smin, smax, areas, spanCount, flagMergeThr))
+                            return false;
                     }
                 }
             }
@@ -668,3 +1189,112 @@ bool Scene::RasterizeScene(rcContext* ctx, rcHeightfield* hf, const int flagMerg
     
     return true;
 }
+
+// A dynamic cell and the column it is in.
+struct DynamicCell
+{
+    int X;
+    int Y;
+    uint16_t LowLayer;
+    uint16_t HighLayer;
+    
+    bool operator<(const DynamicCell& other) const
+    {
+        if (Y != other.Y)
+            return Y < other.Y;
+        if (X != other.X)
+            return X < other.X;
+        return LowLayer < other.LowLayer;
+    }
+};
+
+void Scene::FindDynamicObjects()
+{
+    m_dynamicObjects.clear();
+    
+    std::vector<DynamicCell> cells;
+    for (auto i = 0; i < m_regionWidth * m_regionHeight; i++)
+    {
+        auto region = &m_regions[i];
+        auto cell = region->Cells;
+        for (auto nColumn = 0; nColumn < MAX_SIZE * MAX_SIZE; nColumn++)
+        {
+            for (auto nCount = region->ColumnCounts[nColumn]; nCount > 0; nCount--, cell++)
+            {
+                if (!cell->BaseInfo.dwDynamic)
+                    continue;
+                
+                DynamicCell dynamicCell;
+                dynamicCell.X = region->RegionX * MAX_SIZE + nColumn % MAX_SIZE;
+                dynamicCell.Y = region->RegionY * MAX_SIZE + nColumn / MAX_SIZE;
+                dynamicCell.LowLayer = cell->LowLayer;
+                dynamicCell.HighLayer = cell->HighLayer;
+                cells.push_back(dynamicCell);
+            }
+        }
+    }
+    
+    // The cells touching each other, in the same column or in the next column along x or y,
+    // belong to the same object. The sorted cells of a column are found with a binary search.
+    std::sort(cells.begin(), cells.end());
+    
+    auto cellCount = (int)cells.size();
+    std::vector<int> parents(cellCount);
+    for (auto i = 0; i < cellCount; i++)
+        parents[i] = i;
+    
+    auto findRoot = [&parents](int i)
+    {
+        while (parents[i] != i)
+            i = parents[i] = parents[parents[i]];
+        return i;
+    };
+    
+    for (auto i = 0; i < cellCount; i++)
+    {
+        const int neighbours[3][2] = {{0, 0}, {1, 0}, {0, 1}};
+        for (auto& offset : neighbours)
+        {
+            DynamicCell key = {cells[i].X + offset[0], cells[i].Y + offset[1], 0, 0};
+            auto j = (int)(std::lower_bound(cells.begin(), cells.end(), key) - cells.begin());
+            for (; j < cellCount && cells[j].X == key.X && cells[j].Y == key.Y; j++)
+            {
+                if (j == i || cells[j].LowLayer > cells[i].HighLayer || cells[i].LowLayer > cells[j].HighLayer)
+                    continue;
+                parents[findRoot(j)] = findRoot(i);
+            }
+        }
+    }
+    
+    const float cs = COOR_ZOOM * CELL_LENGTH;
+    const float ch = COOR_ZOOM;
+    
+    std::vector<int> objects(cellCount, -1);
+    for (auto i = 0; i < cellCount; i++)
+    {
+        auto& cell = cells[i];
+        
+        // The heights of the heightfield spans wrap at RC_SPAN_MAX_HEIGHT,
+        // the bounds are placed where the cell ends up in the heightfield.
+        auto lowLayer = cell.LowLayer & RC_SPAN_MAX_HEIGHT;
+        auto highLayer = lowLayer + (cell.HighLayer - cell.LowLayer);
+        const float bmin[3] = {cs * cell.X, ch * lowLayer, cs * cell.Y};
+        const float bmax[3] = {cs * (cell.X + 1), ch * highLayer, cs * (cell.Y + 1)};
+        
+        auto& index = objects[findRoot(i)];
+        if (index < 0)
+        {
+            index = (int)m_dynamicObjects.size();
+            DynamicObject object;
+            rcVcopy(object.BoundsMin, bmin);
+            rcVcopy(object.BoundsMax, bmax);
+            object.CellCount = 0;
+            m_dynamicObjects.push_back(object);
+        }
+        
+        auto& object = m_dynamicObjects[index];
+        rcVmin(object.BoundsMin, bmin);
+        rcVmax(object.BoundsMax, bmax);
+        object.CellCount++;
+    }
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include "StageStats.h"
+#include "RecastAlloc.h"
+#include "RecastProfile.h"
+#include "DetourAlloc.h"
+
+// The Recast and Detour allocations are counted per thread, so that the stages built by the
+// workers can report their memory use. The allocations of all the threads are counted too.
+struct AllocCounter
+{
+	long long live;
+	long long peak;
+	long long count;
+};
+
+static thread_local AllocCounter t_allocs = { 0, 0, 0 };
+static std::atomic<long long> s_liveBytes(0);
+static std::atomic<long long> s_peakBytes(0);
+
+// The header in front of each allocation keeps its size, and the memory aligned.
+static const size_t ALLOC_HEADER_SIZE = 16;
+
+static void* countAlloc(const size_t size)
+{
+	unsigned char* mem = (unsigned char*)malloc(ALLOC_HEADER_SIZE + size);
+	if (!mem)
+		return 0;
+	*(size_t*)mem = size;
+
+	AllocCounter& counter = t_allocs;
+	counter.live += size;
+	counter.peak = rcMax(counter.peak, counter.live);
+	counter.count++;
+
+	const long long live = s_liveBytes += size;
+	long long peak = s_peakBytes;
+	while (live > peak && !s_peakBytes.compare_exchange_weak(peak, live)) {}
+
+	return mem + ALLOC_HEADER_SIZE;
+}
+
+static void countFree(void* ptr)
+{
+	if (!ptr)
+		return;
+	unsigned char* mem = (unsigned char*)ptr - ALLOC_HEADER_SIZE;
+	const size_t size = *(size_t*)mem;
+	// Memory freed by another thread than the one that allocated it leaves that thread below zero.
+	t_allocs.live -= size;
+	s_liveBytes -= size;
+	free(mem);
+}
+
+static void* countRecastAlloc(size_t size, rcAllocHint /*hint*/)
+{
+	return countAlloc(size);
+}
+
+static void* countDetourAlloc(size_t size, dtAllocHint /*hint*/)
+{
+	return countAlloc(size);
+}
+
+void installAllocCounter()
+{
+	rcAllocSetCustom(countRecastAlloc, countFree);
+	dtAllocSetCustom(countDetourAlloc, countFree);
+}
+
+long long getAllocPeak()
+{
+	return s_peakBytes;
+}
+
+const char* getStageName(const int stage)
+{
+	switch (stage)
+	{
+	case STAGE_CREATE_NAVMESH_DATA: return "Create Navmesh Data";
+	default: return duGetTimerLabelName(stage);
+	}
+}
+
+StageContext::StageContext() : m_depth(0)
+{
+	enableLog(false);
+	memset(m_stages, 0, sizeof(m_stages));
+}
+
+void StageContext::doResetTimers()
+{
+	memset(m_stages, 0, sizeof(m_stages));
+	m_depth = 0;
+}
+
+void StageContext::startStage(const int stage)
+{
+	if (!m_timerEnabled || m_depth >= MAX_DEPTH)
+		return;
+	Scope& scope = m_scopes[m_depth++];
+	scope.stage = stage;
+	scope.start = getPerfTime();
+	scope.base = t_allocs.live;
+	scope.peak = t_allocs.peak;
+	scope.count = t_allocs.count;
+	t_allocs.peak = t_allocs.live;
+}
+
+void StageContext::stopStage(const int stage)
+{
+	if (!m_timerEnabled || m_depth == 0 || m_scopes[m_depth-1].stage != stage)
+		return;
+	const Scope& scope = m_scopes[--m_depth];
+	const long long time = getPerfTimeUsec(getPerfTime() - scope.start);
+
+	Stage& s = m_stages[stage];
+	s.calls++;
+	s.time += time;
+	s.maxTime = rcMax(s.maxTime, time);
+	s.peak = rcMax(s.peak, t_allocs.peak - scope.base);
+	s.allocs += t_allocs.count - scope.count;
+	// The peak of the enclosing stage includes the peak of this one.
+	t_allocs.peak = rcMax(t_allocs.peak, scope.peak);
+}
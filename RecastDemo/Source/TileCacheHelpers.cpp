@@ -0,0 +1,124 @@
+#include <string.h>
+#include "TileCacheHelpers.h"
+#include "InputGeom.h"
+#include "Sample.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMeshBuilder.h"
+#include "fastlz.h"
+
+void setSampleAreaFlags(unsigned short* areaFlags)
+{
+	// The walkable area of the heightfields becomes SAMPLE_POLYAREA_GROUND, see updatePolyFlags.
+	memset(areaFlags, 0, sizeof(unsigned short)*(RC_WALKABLE_AREA+1));
+	areaFlags[RC_WALKABLE_AREA] = SAMPLE_POLYFLAGS_WALK;
+	areaFlags[SAMPLE_POLYAREA_GRASS] = SAMPLE_POLYFLAGS_WALK;
+	areaFlags[SAMPLE_POLYAREA_ROAD] = SAMPLE_POLYFLAGS_WALK;
+	areaFlags[SAMPLE_POLYAREA_WATER] = SAMPLE_POLYFLAGS_SWIM;
+	areaFlags[SAMPLE_POLYAREA_DOOR] = SAMPLE_POLYFLAGS_WALK | SAMPLE_POLYFLAGS_DOOR;
+}
+
+void updatePolyFlags(const unsigned short* areaFlags, unsigned char* polyAreas, unsigned short* polyFlags, const int polyCount)
+{
+	for (int i = 0; i < polyCount; ++i)
+	{
+		polyFlags[i] = polyAreas[i] <= RC_WALKABLE_AREA ? areaFlags[polyAreas[i]] : 0;
+		if (polyAreas[i] == RC_WALKABLE_AREA)
+			polyAreas[i] = SAMPLE_POLYAREA_GROUND;
+	}
+}
+
+LinearAllocator::LinearAllocator(const size_t cap) : buffer(0), capacity(0), top(0), high(0)
+{
+	resize(cap);
+}
+
+LinearAllocator::~LinearAllocator()
+{
+	dtFree(buffer);
+}
+
+void LinearAllocator::resize(const size_t cap)
+{
+	if (buffer) dtFree(buffer);
+	buffer = (unsigned char*)dtAlloc(cap, DT_ALLOC_PERM);
+	capacity = cap;
+	top = 0;
+	high = 0;
+}
+
+void LinearAllocator::reset()
+{
+	high = dtMax(high, top);
+	top = 0;
+}
+
+void* LinearAllocator::alloc(const size_t size)
+{
+	// Keep the allocations aligned for the structs of the tile cache builder.
+	const size_t alignedSize = (size + 15) & ~(size_t)15;
+	if (!buffer)
+		return 0;
+	if (top+alignedSize > capacity)
+		return 0;
+	unsigned char* mem = &buffer[top];
+	top += alignedSize;
+	return mem;
+}
+
+void LinearAllocator::free(void* /*ptr*/)
+{
+	// Empty
+}
+
+int FastLZCompressor::maxCompressedSize(const int bufferSize)
+{
+	return (int)(bufferSize* 1.05f);
+}
+
+dtStatus FastLZCompressor::compress(const unsigned char* buffer, const int bufferSize,
+									unsigned char* compressed, const int /*maxCompressedSize*/, int* compressedSize)
+{
+	*compressedSize = fastlz_compress((const void*)buffer, bufferSize, compressed);
+	return DT_SUCCESS;
+}
+
+dtStatus FastLZCompressor::decompress(const unsigned char* compressed, const int compressedSize,
+									  unsigned char* buffer, const int maxBufferSize, int* bufferSize)
+{
+	*bufferSize = fastlz_decompress(compressed, compressedSize, buffer, maxBufferSize);
+	return *bufferSize < 0 ? DT_FAILURE : DT_SUCCESS;
+}
+
+MeshProcess::MeshProcess() : m_geom(0)
+{
+	setSampleAreaFlags(m_areaFlags);
+}
+
+void MeshProcess::init(const InputGeom* geom)
+{
+	m_geom = geom;
+}
+
+void MeshProcess::setAreaFlags(const unsigned short* areaFlags)
+{
+	memcpy(m_areaFlags, areaFlags, sizeof(m_areaFlags));
+}
+
+void MeshProcess::process(struct dtNavMeshCreateParams* params,
+						  unsigned char* polyAreas, unsigned short* polyFlags)
+{
+	updatePolyFlags(m_areaFlags, polyAreas, polyFlags, params->polyCount);
+
+	// Pass in off-mesh connections.
+	if (m_geom)
+	{
+		params->offMeshConVerts = m_geom->getOffMeshConnectionVerts();
+		params->offMeshConRad = m_geom->getOffMeshConnectionRads();
+		params->offMeshConDir = m_geom->getOffMeshConnectionDirs();
+		params->offMeshConAreas = m_geom->getOffMeshConnectionAreas();
+		params->offMeshConFlags = m_geom->getOffMeshConnectionFlags();
+		params->offMeshConUserID = m_geom->getOffMeshConnectionId();
+		params->offMeshConCount = m_geom->getOffMeshConnectionCount();
+	}
+}
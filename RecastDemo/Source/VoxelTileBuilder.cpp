@@ -0,0 +1,326 @@
+#include <string.h>
+#include "VoxelTileBuilder.h"
+#include "TileCacheHelpers.h"
+#include "Sample.h"
+#include "Recast.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourCommon.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+
+void setDefaultVoxelAreaTable(CellAreaTable& areaTable)
+{
+	// The other fields of the cells are left to the tables of the games.
+	areaTable.Rules.clear();
+	areaTable.Rules.push_back({CellField::BlockCharacter, 1, RC_NULL_AREA});
+	areaTable.Rules.push_back({CellField::Dynamic, 1, SAMPLE_POLYAREA_DOOR});
+	setSampleAreaFlags(areaTable.AreaFlags);
+}
+
+// The intermediate results of a tile, freed once its navmesh data is built.
+struct VoxelTileContext
+{
+	rcHeightfield* solid = nullptr;
+	rcCompactHeightfield* chf = nullptr;
+	rcHeightfieldLayerSet* lset = nullptr;
+	
+	~VoxelTileContext()
+	{
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(chf);
+		rcFreeHeightfieldLayerSet(lset);
+	}
+};
+
+// Rasterizes the cells the tile (tx,ty) overlaps plus its border, and builds the eroded compact
+// heightfield of the tile. Returns why the tile could not be built, or null.
+static const char* rasterizeVoxelTile(rcContext* ctx, Scene* scene, const VoxelTileSettings& settings,
+									  const int tx, const int ty, rcConfig& cfg, VoxelTileContext& tc)
+{
+	cfg = settings.cfg;
+	const int minX = tx*cfg.tileSize - cfg.borderSize;
+	const int minY = ty*cfg.tileSize - cfg.borderSize;
+	cfg.bmin[0] += minX*cfg.cs;
+	cfg.bmin[2] += minY*cfg.cs;
+	cfg.bmax[0] = cfg.bmin[0] + cfg.width*cfg.cs;
+	cfg.bmax[2] = cfg.bmin[2] + cfg.height*cfg.cs;
+	
+	tc.solid = rcAllocHeightfield();
+	if (!tc.solid || !rcCreateHeightfield(ctx, *tc.solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+		return "Could not create solid heightfield.";
+	if (!scene->RasterizeTile(ctx, tc.solid, minX, minY, settings.skipDynamic, cfg.walkableClimb))
+		return "Could not rasterize scene.";
+	
+	rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, *tc.solid);
+	rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, *tc.solid);
+	rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, *tc.solid);
+	
+	tc.chf = rcAllocCompactHeightfield();
+	if (!tc.chf || !rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *tc.solid, *tc.chf))
+		return "Could not build compact data.";
+	rcFreeHeightField(tc.solid);
+	tc.solid = nullptr;
+	
+	if (!rcErodeWalkableArea(ctx, cfg.walkableRadius, *tc.chf))
+		return "Could not erode.";
+	
+	return nullptr;
+}
+
+// The intermediate results of buildTileFromCompact.
+struct CompactTileContext
+{
+	rcContourSet* cset = nullptr;
+	rcPolyMesh* pmesh = nullptr;
+	rcPolyMeshDetail* dmesh = nullptr;
+	
+	~CompactTileContext()
+	{
+		rcFreeContourSet(cset);
+		rcFreePolyMesh(pmesh);
+		rcFreePolyMeshDetail(dmesh);
+	}
+};
+
+const char* buildTileFromCompact(rcContext* ctx, rcCompactHeightfield& chf, const rcConfig& cfg, const int partitionType,
+								 dtTileCacheMeshProcess* proc, dtNavMeshCreateParams& params,
+								 unsigned char** outData, int* outDataSize)
+{
+	if (partitionType == SAMPLE_PARTITION_WATERSHED)
+	{
+		if (!rcBuildDistanceField(ctx, chf) ||
+			!rcBuildRegions(ctx, chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+			return "Could not build watershed regions.";
+	}
+	else if (partitionType == SAMPLE_PARTITION_MONOTONE)
+	{
+		if (!rcBuildRegionsMonotone(ctx, chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+			return "Could not build monotone regions.";
+	}
+	else // SAMPLE_PARTITION_LAYERS
+	{
+		if (!rcBuildLayerRegions(ctx, chf, cfg.borderSize, cfg.minRegionArea))
+			return "Could not build layer regions.";
+	}
+	
+	CompactTileContext tc;
+	tc.cset = rcAllocContourSet();
+	if (!tc.cset || !rcBuildContours(ctx, chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *tc.cset))
+		return "Could not create contours.";
+	if (tc.cset->nconts == 0)
+		return nullptr;
+	
+	tc.pmesh = rcAllocPolyMesh();
+	if (!tc.pmesh || !rcBuildPolyMesh(ctx, *tc.cset, cfg.maxVertsPerPoly, *tc.pmesh))
+		return "Could not triangulate contours.";
+	
+	tc.dmesh = rcAllocPolyMeshDetail();
+	if (!tc.dmesh || !rcBuildPolyMeshDetail(ctx, *tc.pmesh, chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *tc.dmesh))
+		return "Could not build detail mesh.";
+	
+	// The vertex indices are ushorts, and cannot point to more than 0xffff vertices.
+	rcPolyMesh* pmesh = tc.pmesh;
+	if (pmesh->nverts >= 0xffff)
+		return "Too many vertices.";
+	
+	params.verts = pmesh->verts;
+	params.vertCount = pmesh->nverts;
+	params.polys = pmesh->polys;
+	params.polyAreas = pmesh->areas;
+	params.polyFlags = pmesh->flags;
+	params.polyCount = pmesh->npolys;
+	params.nvp = pmesh->nvp;
+	params.detailMeshes = tc.dmesh->meshes;
+	params.detailVerts = tc.dmesh->verts;
+	params.detailVertsCount = tc.dmesh->nverts;
+	params.detailTris = tc.dmesh->tris;
+	params.detailTriCount = tc.dmesh->ntris;
+	rcVcopy(params.bmin, pmesh->bmin);
+	rcVcopy(params.bmax, pmesh->bmax);
+	params.cs = cfg.cs;
+	params.ch = cfg.ch;
+	params.buildBvTree = true;
+	
+	// Update poly flags from areas.
+	proc->process(&params, pmesh->areas, pmesh->flags);
+	
+	if (!dtCreateNavMeshData(&params, outData, outDataSize))
+		return "Could not build Detour navmesh.";
+	return nullptr;
+}
+
+void compressTileLayers(const rcHeightfieldLayerSet& lset, const int tx, const int ty, VoxelCacheTile& tile)
+{
+	FastLZCompressor comp;
+	for (int i = 0; i < rcMin(lset.nlayers, VOXEL_MAX_LAYERS); ++i)
+	{
+		const rcHeightfieldLayer* layer = &lset.layers[i];
+		
+		dtTileCacheLayerHeader header;
+		header.magic = DT_TILECACHE_MAGIC;
+		header.version = DT_TILECACHE_VERSION;
+		header.tx = tx;
+		header.ty = ty;
+		header.tlayer = i;
+		dtVcopy(header.bmin, layer->bmin);
+		dtVcopy(header.bmax, layer->bmax);
+		header.width = (unsigned char)layer->width;
+		header.height = (unsigned char)layer->height;
+		header.minx = (unsigned char)layer->minx;
+		header.maxx = (unsigned char)layer->maxx;
+		header.miny = (unsigned char)layer->miny;
+		header.maxy = (unsigned char)layer->maxy;
+		header.hmin = (unsigned short)layer->hmin;
+		header.hmax = (unsigned short)layer->hmax;
+		
+		VoxelCacheLayer* cacheLayer = &tile.layers[tile.nlayers++];
+		dtStatus status = dtBuildTileCacheLayer(&comp, &header, layer->heights, layer->areas, layer->cons,
+												&cacheLayer->data, &cacheLayer->dataSize);
+		if (dtStatusFailed(status))
+		{
+			for (int j = 0; j < tile.nlayers; ++j)
+			{
+				dtFree(tile.layers[j].data);
+				tile.layers[j].data = 0;
+			}
+			tile.nlayers = 0;
+			tile.error = "Could not compress layers.";
+			return;
+		}
+	}
+}
+
+void buildVoxelTile(rcContext* ctx, Scene* scene, const VoxelTileSettings& settings, const int tx, const int ty, VoxelTile& tile)
+{
+	rcConfig cfg;
+	VoxelTileContext tc;
+	tile.error = rasterizeVoxelTile(ctx, scene, settings, tx, ty, cfg, tc);
+	if (tile.error)
+		return;
+	
+	MeshProcess proc;
+	proc.setAreaFlags(settings.areaTable->AreaFlags);
+	
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.walkableHeight = settings.agentHeight;
+	params.walkableRadius = settings.agentRadius;
+	params.walkableClimb = settings.agentMaxClimb;
+	params.tileX = tx;
+	params.tileY = ty;
+	params.tileLayer = 0;
+	tile.error = buildTileFromCompact(ctx, *tc.chf, cfg, settings.partitionType, &proc, params, &tile.data, &tile.dataSize);
+}
+
+void buildVoxelTileLayers(rcContext* ctx, Scene* scene, const VoxelTileSettings& settings, const int tx, const int ty, VoxelCacheTile& tile)
+{
+	rcConfig cfg;
+	VoxelTileContext tc;
+	tile.error = rasterizeVoxelTile(ctx, scene, settings, tx, ty, cfg, tc);
+	if (tile.error)
+		return;
+	
+	tc.lset = rcAllocHeightfieldLayerSet();
+	if (!tc.lset || !rcBuildHeightfieldLayers(ctx, *tc.chf, cfg.borderSize, cfg.walkableHeight, *tc.lset))
+	{
+		tile.error = "Could not build heightfield layers.";
+		return;
+	}
+	
+	compressTileLayers(*tc.lset, tx, ty, tile);
+}
+
+void initVoxelTileWindow(VoxelTileWindow& window, const int tileWidth, const int tileHeight, const int windowTiles)
+{
+	window.tileWidth = tileWidth;
+	window.tileHeight = tileHeight;
+	window.windowTiles = rcMax(windowTiles, 1);
+	window.bx = 0;
+	window.bw = 0;
+	window.ty = -1;
+	window.maxLoadedRegions = 0;
+}
+
+bool nextVoxelTileWindow(VoxelTileWindow& window)
+{
+	if (window.ty+1 < window.tileHeight)
+	{
+		window.ty++;
+	}
+	else
+	{
+		window.bx += window.windowTiles;
+		window.ty = 0;
+	}
+	if (window.bx >= window.tileWidth || window.tileHeight <= 0)
+		return false;
+	window.bw = rcMin(window.windowTiles, window.tileWidth - window.bx);
+	return true;
+}
+
+bool loadVoxelTileWindow(rcContext* ctx, Scene* scene, VoxelTileSettings& settings, VoxelTileWindow& window)
+{
+	// Load the regions the tiles of the window and their borders overlap, and drop the others.
+	const int ts = settings.cfg.tileSize;
+	const int border = settings.cfg.borderSize;
+	const int rs = scene->GetRegionSize();
+	const int minX = rcMax(window.bx*ts - border, 0);
+	const int minY = rcMax(window.ty*ts - border, 0);
+	const int maxX = (window.bx+window.bw)*ts + border;
+	const int maxY = (window.ty+1)*ts + border;
+	if (!scene->LoadWindow(ctx, minX / rs, minY / rs, (maxX + rs-1) / rs, (maxY + rs-1) / rs))
+		return false;
+	window.maxLoadedRegions = rcMax(window.maxLoadedRegions, scene->GetLoadedRegionCount());
+	
+	// The height of the whole scene is not known yet, the regions loaded so far bound the tiles.
+	rcConfig sceneCfg;
+	scene->SetConfig(&sceneCfg);
+	settings.cfg.bmax[1] = sceneCfg.bmax[1];
+	return true;
+}
+
+uint64_t hashVoxelTileSettings(const VoxelTileSettings& settings)
+{
+	rcConfig cfg = settings.cfg;
+	cfg.bmax[1] = 0;
+	uint64_t hash = HashBytes(&cfg, sizeof(cfg));
+	hash = HashBytes(&settings.tileWidth, sizeof(settings.tileWidth), hash);
+	hash = HashBytes(&settings.skipDynamic, sizeof(settings.skipDynamic), hash);
+	hash = HashBytes(&settings.partitionType, sizeof(settings.partitionType), hash);
+	hash = HashBytes(&settings.agentHeight, sizeof(settings.agentHeight), hash);
+	hash = HashBytes(&settings.agentRadius, sizeof(settings.agentRadius), hash);
+	hash = HashBytes(&settings.agentMaxClimb, sizeof(settings.agentMaxClimb), hash);
+	
+	const CellAreaTable& areaTable = *settings.areaTable;
+	for (size_t i = 0; i < areaTable.Rules.size(); ++i)
+	{
+		const CellAreaRule& rule = areaTable.Rules[i];
+		hash = HashBytes(&rule.Field, sizeof(rule.Field), hash);
+		hash = HashBytes(&rule.Value, sizeof(rule.Value), hash);
+		hash = HashBytes(&rule.Area, sizeof(rule.Area), hash);
+	}
+	hash = HashBytes(&areaTable.DefaultArea, sizeof(areaTable.DefaultArea), hash);
+	return HashBytes(areaTable.AreaFlags, sizeof(areaTable.AreaFlags), hash);
+}
+
+uint64_t hashVoxelTileRegions(const Scene* scene, const VoxelTileSettings& settings, const int tx, const int ty)
+{
+	const rcConfig& cfg = settings.cfg;
+	const int rs = scene->GetRegionSize();
+	const int minX = rcMax(tx*cfg.tileSize - cfg.borderSize, 0);
+	const int minY = rcMax(ty*cfg.tileSize - cfg.borderSize, 0);
+	const int maxX = rcMin((tx*cfg.tileSize - cfg.borderSize + cfg.width + rs-1) / rs, scene->GetRegionWidth());
+	const int maxY = rcMin((ty*cfg.tileSize - cfg.borderSize + cfg.height + rs-1) / rs, scene->GetRegionHeight());
+	
+	uint64_t hash = HashBytes(nullptr, 0);
+	for (int y = minY / rs; y < maxY; ++y)
+	{
+		for (int x = minX / rs; x < maxX; ++x)
+		{
+			const uint64_t regionHash = scene->GetRegionHash(x, y);
+			hash = HashBytes(&regionHash, sizeof(regionHash), hash);
+		}
+	}
+	return hash;
+}
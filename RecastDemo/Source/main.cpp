@@ -76,6 +76,9 @@ static const int g_nsamples = sizeof(g_samples) / sizeof(SampleItem);
 
 int main(int /*argc*/, char** /*argv*/)
 {
+	// Serve the temporary build allocations from the arenas of the build context.
+	installTempArenaAllocator();
+	
 	// Init SDL
 	if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
 	{
@@ -137,12 +137,14 @@ project "RecastDemo"
 		buildoptions { 
 			"`pkg-config --cflags sdl2`",
 			"`pkg-config --cflags gl`",
-			"`pkg-config --cflags glu`" 
+			"`pkg-config --cflags glu`",
+			"-pthread"
 		}
 		linkoptions { 
 			"`pkg-config --libs sdl2`",
 			"`pkg-config --libs gl`",
-			"`pkg-config --libs glu`" 
+			"`pkg-config --libs glu`",
+			"-pthread"
 		}
 
 	-- windows library cflags and libs
@@ -172,6 +174,103 @@ project "RecastDemo"
 			"Cocoa.framework",
 		}
 
+project "Baker"
+	language "C++"
+	kind "ConsoleApp"
+	includedirs {
+		"../RecastDemo/Include",
+		"../RecastDemo/Contrib",
+		"../RecastDemo/Contrib/fastlz",
+		"../DebugUtils/Include",
+		"../Detour/Include",
+		"../DetourCrowd/Include",
+		"../DetourTileCache/Include",
+		"../Recast/Include"
+	}
+	-- only the demo sources that do not need SDL or OpenGL
+	files	{
+		"../RecastDemo/Baker/*.cpp",
+		"../RecastDemo/Source/ChunkyTriMesh.cpp",
+		"../RecastDemo/Source/InputGeom.cpp",
+		"../RecastDemo/Source/MeshLoaderObj.cpp",
+		"../RecastDemo/Source/PerfTimer.cpp",
+		"../RecastDemo/Source/SampleInterfaces.cpp",
+		"../RecastDemo/Source/Scene.cpp",
+		"../RecastDemo/Source/StageStats.cpp",
+		"../RecastDemo/Source/TileCacheHelpers.cpp",
+		"../RecastDemo/Source/VoxelTileBuilder.cpp",
+		"../RecastDemo/Contrib/fastlz/*.h",
+		"../RecastDemo/Contrib/fastlz/*.c"
+	}
+
+	-- project dependencies
+	links {
+		"DebugUtils",
+		"Detour",
+		"DetourCrowd",
+		"DetourTileCache",
+		"Recast"
+	}
+
+	-- distribute executable in RecastDemo/Bin directory
+	targetdir "Bin"
+
+	-- linux library cflags and libs
+	configuration { "linux", "gmake" }
+		buildoptions { "-pthread" }
+		linkoptions { "-pthread" }
+
+	-- windows
+	configuration { "windows" }
+		debugdir "../RecastDemo/Bin/"
+
+	-- mac
+	configuration { "macosx" }
+		buildoptions { "-Wunused-value -Wshadow -Wreorder -Wsign-compare -Wall" }
+
+project "Bench"
+	language "C++"
+	kind "ConsoleApp"
+	includedirs {
+		"../RecastDemo/Include",
+		"../DebugUtils/Include",
+		"../Detour/Include",
+		"../DetourTileCache/Include",
+		"../Recast/Include"
+	}
+	-- only the demo sources that do not need SDL or OpenGL
+	files	{
+		"../RecastDemo/Bench/*.cpp",
+		"../RecastDemo/Source/MeshLoaderObj.cpp",
+		"../RecastDemo/Source/PerfTimer.cpp",
+		"../RecastDemo/Source/SampleInterfaces.cpp",
+		"../RecastDemo/Source/StageStats.cpp"
+	}
+
+	-- project dependencies
+	links {
+		"DebugUtils",
+		"Detour",
+		"DetourTileCache",
+		"Recast"
+	}
+
+	-- distribute executable in RecastDemo/Bin directory
+	targetdir "Bin"
+
+	-- linux library cflags and libs
+	configuration { "linux", "gmake" }
+		buildoptions { "-pthread" }
+		linkoptions { "-pthread" }
+
+	-- windows
+	configuration { "windows" }
+		debugdir "../RecastDemo/Bin/"
+
+	-- mac
+	configuration { "macosx" }
+		buildoptions { "-Wunused-value -Wshadow -Wreorder -Wsign-compare -Wall" }
+
 project "Tests"
 	language "C++"
 	kind "ConsoleApp"
@@ -196,7 +295,11 @@ project "Tests"
 		"../Tests/*.cpp",
 		"../Tests/Recast/*.h",
 		"../Tests/Recast/*.cpp",
+		-- built with the memory accounting, in place of the allocators of the libraries
+		"../Recast/Source/RecastAlloc.cpp",
+		"../Detour/Source/DetourAlloc.cpp",
 	}
+	defines { "RC_MEMORY_STATS", "DT_MEMORY_STATS" }
 
 	-- project dependencies
 	links { 
@@ -1,6 +1,11 @@
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
 #include "catch.hpp"
 
 #include "Recast.h"
+#include "RecastAlloc.h"
 
 TEST_CASE("rcSwap")
 {
@@ -597,6 +602,76 @@ TEST_CASE("rcAddSpan")
 	}
 }
 
+TEST_CASE("rcAddSpanColumn")
+{
+	rcContext ctx(false);
+
+	const float bmin[] = {0, 0, 0};
+	const float bmax[] = {4, 10, 1};
+
+	rcHeightfield expected;
+	rcHeightfield hf;
+	REQUIRE(rcCreateHeightfield(&ctx, expected, 4, 1, bmin, bmax, 1, 1));
+	REQUIRE(rcCreateHeightfield(&ctx, hf, 4, 1, bmin, bmax, 1, 1));
+
+	// Touching, overlapping and separate spans, with mixed areas.
+	const unsigned short smin[] = {0, 2, 5, 6, 20, 22, 40, 41};
+	const unsigned short smax[] = {2, 4, 6, 9, 21, 30, 41, 60};
+	const unsigned char areas[] = {1, 2, 3, 4, 5, 0, 6, 7};
+	const int count = 8;
+	const int flagMergeThr = 2;
+
+	// An unsorted column, and a column with an existing span.
+	const unsigned short unsortedMin[] = {10, 0, 30};
+	const unsigned short unsortedMax[] = {15, 5, 31};
+	const unsigned char unsortedAreas[] = {1, 2, 3};
+
+	REQUIRE(rcAddSpan(&ctx, expected, 3, 0, 4, 8, 9, flagMergeThr));
+	REQUIRE(rcAddSpan(&ctx, hf, 3, 0, 4, 8, 9, flagMergeThr));
+	for (int i = 0; i < count; ++i)
+	{
+		REQUIRE(rcAddSpan(&ctx, expected, 0, 0, smin[i], smax[i], areas[i], flagMergeThr));
+		REQUIRE(rcAddSpan(&ctx, expected, 1, 0, smin[i], smax[i], areas[i], flagMergeThr));
+		REQUIRE(rcAddSpan(&ctx, expected, 3, 0, smin[i], smax[i], areas[i], flagMergeThr));
+	}
+	for (int i = 0; i < 3; ++i)
+		REQUIRE(rcAddSpan(&ctx, expected, 2, 0, unsortedMin[i], unsortedMax[i], unsortedAreas[i], flagMergeThr));
+
+	REQUIRE(rcAddSpanColumn(&ctx, hf, 0, 0, smin, smax, areas, count, flagMergeThr));
+	REQUIRE(rcAddSpanColumn(&ctx, hf, 2, 0, unsortedMin, unsortedMax, unsortedAreas, 3, flagMergeThr));
+	REQUIRE(rcAddSpanColumn(&ctx, hf, 3, 0, smin, smax, areas, count, flagMergeThr));
+
+	// The reserved spans are enough for the column, unused spans are released.
+	rcReservedSpans reserved;
+	REQUIRE(rcReserveSpans(&ctx, hf, count, reserved));
+	REQUIRE(rcAddReservedSpanColumn(hf, reserved, 1, 0, smin, smax, areas, count, flagMergeThr));
+	rcReleaseSpans(hf, reserved);
+	REQUIRE(reserved.freelist == 0);
+	REQUIRE(reserved.pool == 0);
+
+	for (int x = 0; x < 4; ++x)
+	{
+		const rcSpan* a = expected.spans[x];
+		const rcSpan* b = hf.spans[x];
+		for (; a && b; a = a->next, b = b->next)
+		{
+			REQUIRE(a->smin == b->smin);
+			REQUIRE(a->smax == b->smax);
+			REQUIRE(a->area == b->area);
+		}
+		REQUIRE(a == 0);
+		REQUIRE(b == 0);
+	}
+
+	SECTION("Running out of reserved spans fails.")
+	{
+		rcReservedSpans none;
+		REQUIRE(rcReserveSpans(&ctx, hf, 0, none));
+		REQUIRE(!rcAddReservedSpanColumn(hf, none, 0, 0, smin, smax, areas, count, flagMergeThr));
+		rcReleaseSpans(hf, none);
+	}
+}
+
 TEST_CASE("rcRasterizeTriangle")
 {
 	rcContext ctx;
@@ -828,3 +903,874 @@ TEST_CASE("rcRasterizeTriangles")
 		REQUIRE(!solid.spans[1 + 2 * width]->next);
 	}
 }
+
+TEST_CASE("rcRasterizeHeightmap")
+{
+	rcContext ctx;
+	const float heights[] = {
+		0, 0, 0,
+		0, 1, 0,
+		0, 0, 0
+	};
+	const float orig[] = { 0, 0, 0 };
+	const float bmin[] = { 0, 0, 0 };
+	const float bmax[] = { 2, 2, 2 };
+
+	SECTION("Samples on the heightfield grid")
+	{
+		const unsigned char holes[] = { 0, 0, 0, 1 };
+		const unsigned char areas[] = { 1, 2, 3, 4 };
+		rcHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, 2, 2, bmin, bmax, 1.0f, 0.5f));
+		REQUIRE(rcRasterizeHeightmap(&ctx, heights, 3, 3, orig, 1.0f, holes, areas, 0, solid));
+
+		for (int i = 0; i < 3; ++i)
+		{
+			REQUIRE(solid.spans[i]);
+			REQUIRE(solid.spans[i]->smin == 0);
+			REQUIRE(solid.spans[i]->smax == 2);
+			REQUIRE(solid.spans[i]->area == areas[i]);
+			REQUIRE(!solid.spans[i]->next);
+		}
+		REQUIRE(!solid.spans[3]);
+	}
+
+	SECTION("Columns smaller than the samples")
+	{
+		rcHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, 4, 4, bmin, bmax, 0.5f, 0.5f));
+		REQUIRE(rcRasterizeHeightmap(&ctx, heights, 3, 3, orig, 1.0f, 0, 0, RC_WALKABLE_AREA, solid));
+
+		// The lowest point of the column next to the peak is halfway up the slope.
+		REQUIRE(solid.spans[1 + 1 * 4]->smin == 1);
+		REQUIRE(solid.spans[1 + 1 * 4]->smax == 2);
+		REQUIRE(solid.spans[0]->smin == 0);
+		REQUIRE(solid.spans[0]->smax == 1);
+		REQUIRE(solid.spans[0]->area == RC_WALKABLE_AREA);
+	}
+}
+
+TEST_CASE("rcBuildCompactHeightfieldStreamed")
+{
+	rcContext ctx;
+
+	// A floor, a ramp and a platform above the floor.
+	const float verts[] = {
+		0, 0, 0,	20, 0, 0,	20, 0, 20,	0, 0, 20,
+		2, 0, 2,	8, 3, 2,	8, 3, 9,	2, 0, 9,
+		10, 4, 10,	18, 4, 10,	18, 4, 18,	10, 4, 18,
+	};
+	const int tris[] = {
+		0, 2, 1,	0, 3, 2,
+		4, 6, 5,	4, 7, 6,
+		8, 10, 9,	8, 11, 10,
+	};
+	const unsigned char areas[] = { RC_WALKABLE_AREA, RC_WALKABLE_AREA, 2, 2, 3, 3 };
+	const int nv = 12;
+	const int nt = 6;
+
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = 0.5f;
+	cfg.ch = 0.2f;
+	cfg.walkableHeight = 10;
+	cfg.walkableClimb = 4;
+	rcCalcBounds(verts, nv, cfg.bmin, cfg.bmax);
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&ctx, solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+	REQUIRE(rcRasterizeTriangles(&ctx, verts, nv, tris, areas, nt, solid, cfg.walkableClimb));
+	rcFilterLowHangingWalkableObstacles(&ctx, cfg.walkableClimb, solid);
+	rcFilterLedgeSpans(&ctx, cfg.walkableHeight, cfg.walkableClimb, solid);
+	rcFilterWalkableLowHeightSpans(&ctx, cfg.walkableHeight, solid);
+	rcCompactHeightfield* expected = rcAllocCompactHeightfield();
+	REQUIRE(expected);
+	REQUIRE(rcBuildCompactHeightfield(&ctx, cfg.walkableHeight, cfg.walkableClimb, solid, *expected));
+
+	const int stripSizes[] = { 1, 3, 16, 1000 };
+	for (int i = 0; i < 4; ++i)
+	{
+		rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+		REQUIRE(chf);
+		REQUIRE(rcBuildCompactHeightfieldStreamed(&ctx, cfg, verts, nv, tris, areas, nt, stripSizes[i], *chf));
+
+		REQUIRE(chf->width == expected->width);
+		REQUIRE(chf->height == expected->height);
+		REQUIRE(chf->spanCount == expected->spanCount);
+		REQUIRE(chf->bmax[1] == expected->bmax[1]);
+		REQUIRE(memcmp(chf->cells, expected->cells, sizeof(rcCompactCell)*chf->width*chf->height) == 0);
+		REQUIRE(memcmp(chf->spans, expected->spans, sizeof(rcCompactSpan)*chf->spanCount) == 0);
+		REQUIRE(memcmp(chf->areas, expected->areas, chf->spanCount) == 0);
+
+		rcFreeCompactHeightfield(chf);
+	}
+
+	rcFreeCompactHeightfield(expected);
+}
+
+TEST_CASE("rcUpdateRasterizedTriangles")
+{
+	rcContext ctx;
+	float verts[] = {
+		0, 0, 0,
+		4, 0, 0,
+		4, 0, 4,
+		0, 0, 4,
+		1, 0.5f, 1,
+		2, 0.5f, 1,
+		2, 0.5f, 2,
+		1, 0.5f, 2
+	};
+	int tris[] = {
+		0, 2, 1,
+		0, 3, 2,
+		4, 6, 5,
+		4, 7, 6
+	};
+	unsigned char areas[] = { RC_WALKABLE_AREA, RC_WALKABLE_AREA, RC_WALKABLE_AREA, RC_WALKABLE_AREA };
+	const float bmin[] = { 0, -1, 0 };
+	const float bmax[] = { 4, 2, 4 };
+	const int size = 16;
+	const int walkableHeight = 3;
+	const int walkableClimb = 1;
+
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&ctx, solid, size, size, bmin, bmax, 0.25f, 0.1f));
+	rcHeightfieldSources* sources = rcAllocHeightfieldSources();
+	REQUIRE(sources);
+	REQUIRE(rcRasterizeTrianglesTracked(&ctx, verts, 8, tris, areas, 4, solid, *sources));
+	REQUIRE(sources->ntris == 4);
+	rcFilterLowHangingWalkableObstacles(&ctx, walkableClimb, solid);
+	rcFilterLedgeSpans(&ctx, walkableHeight, walkableClimb, solid);
+	rcFilterWalkableLowHeightSpans(&ctx, walkableHeight, solid);
+
+	int changed[] = { 2, 3 };
+	int nchanged = 2;
+
+	SECTION("Move triangles")
+	{
+		for (int i = 4; i < 8; ++i)
+			verts[i*3+0] += 1.0f;
+	}
+
+	SECTION("Remove triangles")
+	{
+		tris[2*3+0] = -1;
+		tris[3*3+0] = -1;
+	}
+
+	SECTION("Change area")
+	{
+		areas[2] = RC_NULL_AREA;
+		nchanged = 1;
+	}
+
+	int dirty[4];
+	REQUIRE(rcUpdateRasterizedTriangles(&ctx, verts, 8, tris, areas, 4, changed, nchanged, solid, *sources, dirty));
+	REQUIRE(dirty[0] <= dirty[2]);
+	REQUIRE(dirty[0] > 0);
+	REQUIRE(dirty[2] < size-1);
+	rcFilterLowHangingWalkableObstacles(&ctx, walkableClimb, solid, dirty);
+	rcFilterLedgeSpans(&ctx, walkableHeight, walkableClimb, solid, dirty);
+	rcFilterWalkableLowHeightSpans(&ctx, walkableHeight, solid, dirty);
+
+	// The update matches a full rebuild of the edited mesh.
+	rcHeightfield expected;
+	REQUIRE(rcCreateHeightfield(&ctx, expected, size, size, bmin, bmax, 0.25f, 0.1f));
+	rcHeightfieldSources* expectedSources = rcAllocHeightfieldSources();
+	REQUIRE(expectedSources);
+	REQUIRE(rcRasterizeTrianglesTracked(&ctx, verts, 8, tris, areas, 4, expected, *expectedSources));
+	rcFilterLowHangingWalkableObstacles(&ctx, walkableClimb, expected);
+	rcFilterLedgeSpans(&ctx, walkableHeight, walkableClimb, expected);
+	rcFilterWalkableLowHeightSpans(&ctx, walkableHeight, expected);
+
+	int mismatches = 0;
+	for (int i = 0; i < size*size; ++i)
+	{
+		const rcSpan* a = solid.spans[i];
+		const rcSpan* b = expected.spans[i];
+		for (; a && b; a = a->next, b = b->next)
+		{
+			if (a->smin != b->smin || a->smax != b->smax || a->area != b->area)
+				mismatches++;
+		}
+		if (a || b)
+			mismatches++;
+	}
+	REQUIRE(mismatches == 0);
+	REQUIRE(memcmp(sources->bounds, expectedSources->bounds, sizeof(int)*4*4) == 0);
+
+	rcFreeHeightfieldSources(expectedSources);
+	rcFreeHeightfieldSources(sources);
+}
+
+TEST_CASE("rcMarkAreaVolumes")
+{
+	rcContext ctx;
+	const float bmin[] = { 0, 0, 0 };
+	const float bmax[] = { 10, 10, 10 };
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&ctx, solid, 20, 20, bmin, bmax, 0.5f, 0.5f));
+	for (int y = 0; y < 20; ++y)
+		for (int x = 0; x < 20; ++x)
+			rcAddSpan(&ctx, solid, x, y, 0, 2, RC_WALKABLE_AREA, 1);
+	rcCompactHeightfield* compact = rcAllocCompactHeightfield();
+	REQUIRE(compact);
+	rcCompactHeightfield& chf = *compact;
+	REQUIRE(rcBuildCompactHeightfield(&ctx, 2, 1, solid, chf));
+
+	const float verts[] = {
+		1, 0, 1,
+		6, 0, 2,
+		4, 0, 7,
+		3, 0, 3,
+		9, 0, 3,
+		9, 0, 9,
+		3, 0, 9,
+		20, 0, 20,
+		21, 0, 20,
+		21, 0, 21
+	};
+	const int nverts[] = { 3, 4, 3 };
+	const float hmin[] = { -1, -1, -1 };
+	const float hmax[] = { 5, 5, 5 };
+	const unsigned char areas[] = { 1, 2, 3 };
+
+	unsigned char* expected = (unsigned char*)rcAlloc(chf.spanCount, RC_ALLOC_TEMP);
+	for (int i = 0, first = 0; i < 3; first += nverts[i], ++i)
+		rcMarkConvexPolyArea(&ctx, &verts[first*3], nverts[i], hmin[i], hmax[i], areas[i], chf);
+	memcpy(expected, chf.areas, chf.spanCount);
+	memset(chf.areas, RC_WALKABLE_AREA, chf.spanCount);
+
+	rcAreaVolumeSet* vset = rcAllocAreaVolumeSet();
+	REQUIRE(vset);
+	REQUIRE(rcBuildAreaVolumeSet(&ctx, verts, nverts, hmin, hmax, areas, 3, 2.0f, *vset));
+	REQUIRE(vset->nvolumes == 3);
+	REQUIRE(rcMarkAreaVolumes(&ctx, *vset, chf));
+
+	// The volumes are applied in order, the later volume overrides the overlap.
+	REQUIRE(memcmp(chf.areas, expected, chf.spanCount) == 0);
+	REQUIRE(chf.areas[chf.cells[4 + 4*20].index] == 1);
+	REQUIRE(chf.areas[chf.cells[10 + 10*20].index] == 2);
+	REQUIRE(chf.areas[chf.cells[0].index] == RC_WALKABLE_AREA);
+
+	rcFreeAreaVolumeSet(vset);
+	rcFree(expected);
+	rcFreeCompactHeightfield(compact);
+}
+
+static void* allocZeroed(size_t size, rcAllocHint)
+{
+	return calloc(1, size);
+}
+
+TEST_CASE("rcErodeWalkableAreaExact")
+{
+	rcContext ctx;
+	const int size = 21;
+	const float bmin[] = { 0, 0, 0 };
+	const float bmax[] = { 21, 10, 21 };
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&ctx, solid, size, size, bmin, bmax, 1.0f, 0.5f));
+	for (int y = 0; y < size; ++y)
+		for (int x = 0; x < size; ++x)
+			rcAddSpan(&ctx, solid, x, y, 0, 2, (x == 10 && y == 10) ? RC_NULL_AREA : RC_WALKABLE_AREA, 1);
+
+	rcCompactHeightfield* compact = rcAllocCompactHeightfield();
+	REQUIRE(compact);
+	rcCompactHeightfield& chf = *compact;
+	REQUIRE(rcBuildCompactHeightfield(&ctx, 2, 1, solid, chf));
+	REQUIRE(chf.spanCount == size*size - 1);
+
+	SECTION("Spans closer than the radius are eroded")
+	{
+		REQUIRE(rcErodeWalkableAreaExact(&ctx, 3, chf));
+
+		// Straight distances match rcErodeWalkableArea.
+		REQUIRE(chf.areas[chf.cells[2 + 10*size].index] == RC_NULL_AREA);
+		REQUIRE(chf.areas[chf.cells[3 + 10*size].index] == RC_WALKABLE_AREA);
+		REQUIRE(chf.areas[chf.cells[10 + 13*size].index] == RC_NULL_AREA);
+		REQUIRE(chf.areas[chf.cells[10 + 14*size].index] == RC_WALKABLE_AREA);
+		// Diagonal distances are exact, sqrt(8) from the boundary span next to the hole is within the radius.
+		REQUIRE(chf.areas[chf.cells[13 + 12*size].index] == RC_NULL_AREA);
+		REQUIRE(chf.areas[chf.cells[14 + 12*size].index] == RC_WALKABLE_AREA);
+	}
+
+	SECTION("Chamfer distance keeps the diagonal")
+	{
+		REQUIRE(rcErodeWalkableArea(&ctx, 3, chf));
+		REQUIRE(chf.areas[chf.cells[13 + 12*size].index] == RC_WALKABLE_AREA);
+	}
+
+	SECTION("Spans not reached from their -x neighbour are eroded")
+	{
+		// The links are not symmetric: (5,4) links to (4,4) on -x, (4,4) does not link back.
+		const int ai = chf.cells[4 + 4*size].index;
+		const int bi = chf.cells[5 + 4*size].index;
+		REQUIRE(rcGetCon(chf.spans[bi], 0) != RC_NOT_CONNECTED);
+		rcSetCon(chf.spans[ai], 2, RC_NOT_CONNECTED);
+
+		// The distances of the spans no chain visits would read zeroed memory.
+		rcAllocSetCustom(allocZeroed, 0);
+		const bool ok = rcErodeWalkableAreaExact(&ctx, 3, chf);
+		rcAllocSetCustom(0, 0);
+		REQUIRE(ok);
+
+		// (4,4) lost a link and is a boundary span, the spans after it follow its distance.
+		REQUIRE(chf.areas[ai] == RC_NULL_AREA);
+		REQUIRE(chf.areas[bi] == RC_NULL_AREA);
+		REQUIRE(chf.areas[chf.cells[6 + 4*size].index] == RC_NULL_AREA);
+		REQUIRE(chf.areas[chf.cells[7 + 4*size].index] == RC_WALKABLE_AREA);
+	}
+
+	rcFreeCompactHeightfield(compact);
+}
+
+TEST_CASE("rcMedianFilterWalkableArea")
+{
+	rcContext ctx;
+	const int size = 8;
+	const float bmin[] = { 0, 0, 0 };
+	const float bmax[] = { 8, 10, 8 };
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&ctx, solid, size, size, bmin, bmax, 1.0f, 0.5f));
+	for (int y = 0; y < size; ++y)
+		for (int x = 0; x < size; ++x)
+			rcAddSpan(&ctx, solid, x, y, 0, 2, (x == 3 && y == 3) ? 7 : (x < 5 ? RC_WALKABLE_AREA : 5), 1);
+
+	rcCompactHeightfield* compact = rcAllocCompactHeightfield();
+	REQUIRE(compact);
+	rcCompactHeightfield& chf = *compact;
+	REQUIRE(rcBuildCompactHeightfield(&ctx, 2, 1, solid, chf));
+
+	SECTION("Isolated areas are removed")
+	{
+		REQUIRE(rcMedianFilterWalkableArea(&ctx, chf));
+		REQUIRE(chf.areas[chf.cells[3 + 3*size].index] == RC_WALKABLE_AREA);
+		REQUIRE(chf.areas[chf.cells[1 + 1*size].index] == RC_WALKABLE_AREA);
+		REQUIRE(chf.areas[chf.cells[6 + 1*size].index] == 5);
+	}
+
+	SECTION("Filtering with a scratch buffer matches")
+	{
+		rcCompactHeightfield* other = rcAllocCompactHeightfield();
+		REQUIRE(other);
+		REQUIRE(rcBuildCompactHeightfield(&ctx, 2, 1, solid, *other));
+		REQUIRE(rcMedianFilterWalkableArea(&ctx, *other));
+
+		unsigned char scratch[size*size];
+		REQUIRE(rcMedianFilterWalkableArea(&ctx, chf, scratch));
+		REQUIRE(memcmp(chf.areas, other->areas, chf.spanCount) == 0);
+
+		rcFreeCompactHeightfield(other);
+	}
+
+	rcFreeCompactHeightfield(compact);
+}
+
+// Runs the items of parallel tasks in reverse order, spread over several workers.
+class ReverseWorkerContext : public rcContext
+{
+protected:
+	virtual int doGetWorkerCount() const { return 3; }
+	virtual void doRunParallel(rcParallelTask& task, const int count)
+	{
+		for (int i = count-1; i >= 0; --i)
+			task.run(i, i % 3);
+	}
+};
+
+TEST_CASE("rcBuildHeightfieldLayersBatch")
+{
+	rcContext ctx;
+	const int size = 16;
+	const int borderSize = 2;
+	const float bmin[] = { 0, 0, 0 };
+	const float bmax[] = { 16, 40, 16 };
+
+	rcCompactHeightfield* chfs[2];
+	for (int n = 0; n < 2; ++n)
+	{
+		rcHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, size, size, bmin, bmax, 1.0f, 0.5f));
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				rcAddSpan(&ctx, solid, x, y, 0, 2, RC_WALKABLE_AREA, 1);
+				// The second heightfield has a bridge over the middle.
+				if (n == 1 && x >= 6 && x < 10)
+					rcAddSpan(&ctx, solid, x, y, 20, 22, RC_WALKABLE_AREA, 1);
+			}
+		}
+		chfs[n] = rcAllocCompactHeightfield();
+		REQUIRE(chfs[n]);
+		REQUIRE(rcBuildCompactHeightfield(&ctx, 4, 1, solid, *chfs[n]));
+	}
+
+	rcHeightfieldLayerSet* lsets[2];
+	rcHeightfieldLayerSet* expected[2];
+	for (int n = 0; n < 2; ++n)
+	{
+		lsets[n] = rcAllocHeightfieldLayerSet();
+		expected[n] = rcAllocHeightfieldLayerSet();
+		REQUIRE(rcBuildHeightfieldLayers(&ctx, *chfs[n], borderSize, 4, *expected[n]));
+	}
+
+	ReverseWorkerContext parallelCtx;
+	const rcCompactHeightfield* const batch[] = { chfs[0], chfs[1] };
+	REQUIRE(rcBuildHeightfieldLayersBatch(&parallelCtx, batch, 2, borderSize, 4, lsets));
+
+	REQUIRE(lsets[0]->nlayers == 1);
+	REQUIRE(lsets[1]->nlayers == 2);
+	for (int n = 0; n < 2; ++n)
+	{
+		REQUIRE(lsets[n]->nlayers == expected[n]->nlayers);
+		for (int i = 0; i < lsets[n]->nlayers; ++i)
+		{
+			const rcHeightfieldLayer& layer = lsets[n]->layers[i];
+			const rcHeightfieldLayer& other = expected[n]->layers[i];
+			const int gridSize = layer.width*layer.height;
+			REQUIRE(layer.width == size - borderSize*2);
+			REQUIRE(layer.hmin == other.hmin);
+			REQUIRE(layer.hmax == other.hmax);
+			REQUIRE(memcmp(layer.heights, other.heights, gridSize) == 0);
+			REQUIRE(memcmp(layer.areas, other.areas, gridSize) == 0);
+			REQUIRE(memcmp(layer.cons, other.cons, gridSize) == 0);
+		}
+	}
+
+	for (int n = 0; n < 2; ++n)
+	{
+		rcFreeHeightfieldLayerSet(lsets[n]);
+		rcFreeHeightfieldLayerSet(expected[n]);
+		rcFreeCompactHeightfield(chfs[n]);
+	}
+}
+
+// Rooms joined by narrow doors and a room with a pillar. A null area column and a second
+// area type split the spans into four basins.
+static void buildRoomsHeightfield(rcContext* ctx, rcCompactHeightfield& chf)
+{
+	const int size = 24;
+	const float bmin[] = { 0, 0, 0 };
+	const float bmax[] = { 24, 10, 24 };
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(ctx, solid, size, size, bmin, bmax, 1.0f, 0.5f));
+	for (int y = 0; y < size; ++y)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			if ((x == 7 || x == 15) && y < 12 && y != 5)
+				continue;
+			if (y == 12 && x < 16)
+				continue;
+			if (x >= 5 && x <= 7 && y >= 17 && y <= 19)
+				continue;
+			unsigned char area = RC_WALKABLE_AREA;
+			if (x == 16)
+				area = RC_NULL_AREA;
+			else if (x > 16 && y < 8)
+				area = 2;
+			REQUIRE(rcAddSpan(ctx, solid, x, y, 0, 2, area, 1));
+		}
+	}
+	REQUIRE(rcBuildCompactHeightfield(ctx, 2, 1, solid, chf));
+}
+
+TEST_CASE("rcBuildRegions")
+{
+	// The regions of the level stack implementation the basins replaced.
+	static const unsigned short expected[24*24] = {
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 4, 4, 4, 4, 4, 4, 4,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 4, 4, 4, 4, 4, 4, 4,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 4, 4, 4, 4, 4, 4, 4,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 4, 4, 4, 4, 4, 4, 4,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 4, 4, 4, 4, 4, 4, 4,
+		2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 0, 4, 4, 4, 4, 4, 4, 4,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 4, 4, 4, 4, 4, 4, 4,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 4, 4, 4, 4, 4, 4, 4,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 5, 5, 5, 5, 5, 5, 5,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 5, 5, 5, 5, 5, 5, 5,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 5, 5, 5, 5, 5, 5, 5,
+		2, 2, 2, 2, 2, 2, 2, 0, 3, 3, 3, 3, 3, 3, 3, 0, 0, 5, 5, 5, 5, 5, 5, 5,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 6, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 6, 6, 6, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 6, 6, 6, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 6, 6, 6, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5,
+		6, 6, 6, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 5, 5, 5, 5, 5, 5, 5
+	};
+
+	rcContext ctx;
+	ReverseWorkerContext parallelCtx;
+	rcContext* const contexts[] = { &ctx, &parallelCtx };
+	for (int n = 0; n < 2; ++n)
+	{
+		rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+		REQUIRE(chf);
+		buildRoomsHeightfield(contexts[n], *chf);
+		REQUIRE(rcBuildDistanceField(contexts[n], *chf));
+		REQUIRE(rcBuildRegions(contexts[n], *chf, 0, 0, 0));
+
+		REQUIRE(chf->maxRegions == 7);
+		for (int i = 0; i < chf->width*chf->height; ++i)
+		{
+			const rcCompactCell& c = chf->cells[i];
+			const unsigned short reg = c.count ? chf->spans[c.index].reg : 0;
+			CHECK(reg == expected[i]);
+		}
+
+		rcFreeCompactHeightfield(chf);
+	}
+}
+
+TEST_CASE("rcBuildContours")
+{
+	// The contours of the serial tracing the per region tasks replaced, in scan order.
+	static const unsigned short expectedRegs[] = { 2, 3, 4, 5, 6, 1 };
+	static const int expectedVerts[] = { 7, 7, 4, 6, 7, 11 };
+	static const int expectedRawVerts[] = { 40, 40, 30, 46, 36, 62 };
+	const int nexpected = 6;
+
+	rcContext ctx;
+	ReverseWorkerContext parallelCtx;
+	rcContext* const contexts[] = { &ctx, &parallelCtx };
+	rcCompactHeightfield* chfs[2];
+	rcContourSet* csets[2];
+	for (int n = 0; n < 2; ++n)
+	{
+		chfs[n] = rcAllocCompactHeightfield();
+		REQUIRE(chfs[n]);
+		buildRoomsHeightfield(contexts[n], *chfs[n]);
+		REQUIRE(rcBuildDistanceField(contexts[n], *chfs[n]));
+		REQUIRE(rcBuildRegions(contexts[n], *chfs[n], 0, 0, 0));
+		csets[n] = rcAllocContourSet();
+		REQUIRE(csets[n]);
+		REQUIRE(rcBuildContours(contexts[n], *chfs[n], 1.0f, 8, *csets[n]));
+
+		REQUIRE(csets[n]->nconts == nexpected);
+		for (int i = 0; i < nexpected; ++i)
+		{
+			const rcContour& cont = csets[n]->conts[i];
+			CHECK(cont.reg == expectedRegs[i]);
+			CHECK(cont.nverts == expectedVerts[i]);
+			CHECK(cont.nrverts == expectedRawVerts[i]);
+		}
+	}
+
+	// The contours traced on several workers are the same as the serial ones.
+	for (int i = 0; i < nexpected; ++i)
+	{
+		const rcContour& cont = csets[1]->conts[i];
+		const rcContour& other = csets[0]->conts[i];
+		REQUIRE(cont.nverts == other.nverts);
+		REQUIRE(cont.nrverts == other.nrverts);
+		CHECK(cont.area == other.area);
+		CHECK(memcmp(cont.verts, other.verts, sizeof(int)*4*cont.nverts) == 0);
+		CHECK(memcmp(cont.rverts, other.rverts, sizeof(int)*4*cont.nrverts) == 0);
+	}
+
+	for (int n = 0; n < 2; ++n)
+	{
+		rcFreeContourSet(csets[n]);
+		rcFreeCompactHeightfield(chfs[n]);
+	}
+}
+
+TEST_CASE("rcBuildPolyMesh")
+{
+	// The polygons of the implementation the merge queue replaced.
+	static const unsigned short N = RC_MESH_NULL_IDX;
+	static const unsigned short expectedRegs[] = { 2, 2, 3, 3, 3, 4, 5, 5, 6, 6, 1, 1, 1, 1 };
+	static const unsigned short expectedPolys[] = {
+		0, 1, 2, 3, 4, N, 4, N, N, N, 1, N,
+		6, 0, 4, 5, N, N, N, 0, N, N, N, N,
+		10, 11, 1, 9, N, N, N, N, 4, N, N, N,
+		0, 7, 8, 9, N, N, N, N, N, 4, N, N,
+		9, 1, 0, N, N, N, 2, 0, 3, N, N, N,
+		12, 13, 14, 15, N, N, 6, N, N, N, N, N,
+		13, 12, 16, 19, N, N, 5, N, 7, N, N, N,
+		18, 19, 16, 17, N, N, N, 6, N, N, N, N,
+		23, 24, 25, 22, N, N, N, N, 9, 12, N, N,
+		25, 26, 20, 21, 22, N, N, N, 10, N, 8, N,
+		21, 20, 29, 28, N, N, 9, N, 13, N, N, N,
+		31, 32, 33, 27, N, N, N, N, 12, 13, N, N,
+		33, 23, 22, 27, N, N, N, 8, N, 11, N, N,
+		27, 28, 29, 30, 31, N, N, 10, N, N, 11, N
+	};
+	const int nexpected = 14;
+
+	rcContext ctx;
+	ReverseWorkerContext parallelCtx;
+	rcContext* const contexts[] = { &ctx, &parallelCtx };
+	for (int n = 0; n < 2; ++n)
+	{
+		rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+		REQUIRE(chf);
+		buildRoomsHeightfield(contexts[n], *chf);
+		REQUIRE(rcBuildDistanceField(contexts[n], *chf));
+		REQUIRE(rcBuildRegions(contexts[n], *chf, 0, 0, 0));
+		rcContourSet* cset = rcAllocContourSet();
+		REQUIRE(cset);
+		REQUIRE(rcBuildContours(contexts[n], *chf, 1.0f, 8, *cset));
+		rcPolyMesh* pmesh = rcAllocPolyMesh();
+		REQUIRE(pmesh);
+		REQUIRE(rcBuildPolyMesh(contexts[n], *cset, 6, *pmesh));
+
+		REQUIRE(pmesh->nvp == 6);
+		REQUIRE(pmesh->nverts == 34);
+		REQUIRE(pmesh->npolys == nexpected);
+		for (int i = 0; i < nexpected; ++i)
+			CHECK(pmesh->regs[i] == expectedRegs[i]);
+		CHECK(memcmp(pmesh->polys, expectedPolys, sizeof(expectedPolys)) == 0);
+
+		rcFreePolyMesh(pmesh);
+		rcFreeContourSet(cset);
+		rcFreeCompactHeightfield(chf);
+	}
+}
+
+// Returns the height of the triangle (a,b,c) at the xz-location of p, or false if p is outside of it.
+static bool getTriHeight(const float* p, const float* a, const float* b, const float* c, float& h)
+{
+	const float EPS = 1e-4f;
+	const float v0x = c[0]-a[0], v0z = c[2]-a[2];
+	const float v1x = b[0]-a[0], v1z = b[2]-a[2];
+	const float v2x = p[0]-a[0], v2z = p[2]-a[2];
+	const float denom = v0x*v1z - v0z*v1x;
+	if (fabsf(denom) < EPS)
+		return false;
+	const float u = (v1z*v2x - v1x*v2z) / denom;
+	const float v = (v0x*v2z - v0z*v2x) / denom;
+	if (u < -EPS || v < -EPS || u+v > 1+EPS)
+		return false;
+	h = a[1] + (c[1]-a[1])*u + (b[1]-a[1])*v;
+	return true;
+}
+
+TEST_CASE("rcBuildPolyMeshDetail")
+{
+	rcContext ctx;
+	const int size = 24;
+	const float cs = 1.0f;
+	const float ch = 0.1f;
+	const float bmin[] = { 0, 0, 0 };
+	const float bmax[] = { 24, 10, 24 };
+
+	// Rolling hills, every span is connected to its neighbours.
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&ctx, solid, size, size, bmin, bmax, cs, ch));
+	for (int y = 0; y < size; ++y)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			const int h = 20 + (int)(12.0f*sinf(x*0.5f)*cosf(y*0.4f));
+			REQUIRE(rcAddSpan(&ctx, solid, x, y, 0, (unsigned short)h, RC_WALKABLE_AREA, 1));
+		}
+	}
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	REQUIRE(chf);
+	REQUIRE(rcBuildCompactHeightfield(&ctx, 2, 20, solid, *chf));
+	REQUIRE(rcBuildRegionsMonotone(&ctx, *chf, 0, 0, 0));
+	rcContourSet* cset = rcAllocContourSet();
+	REQUIRE(cset);
+	REQUIRE(rcBuildContours(&ctx, *chf, 1.0f, 8, *cset));
+	rcPolyMesh* pmesh = rcAllocPolyMesh();
+	REQUIRE(pmesh);
+	REQUIRE(rcBuildPolyMesh(&ctx, *cset, 6, *pmesh));
+	REQUIRE(pmesh->npolys > 0);
+
+	const float sampleDist = 2.0f;
+	const float sampleMaxError = 0.2f;
+	rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+	REQUIRE(dmesh);
+	REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, sampleDist, sampleMaxError, *dmesh));
+	REQUIRE(dmesh->nmeshes == pmesh->npolys);
+
+	// The polygons built in reverse on several workers give the same detail mesh.
+	ReverseWorkerContext parallelCtx;
+	rcPolyMeshDetail* other = rcAllocPolyMeshDetail();
+	REQUIRE(other);
+	REQUIRE(rcBuildPolyMeshDetail(&parallelCtx, *pmesh, *chf, sampleDist, sampleMaxError, *other));
+	REQUIRE(other->nmeshes == dmesh->nmeshes);
+	REQUIRE(other->nverts == dmesh->nverts);
+	REQUIRE(other->ntris == dmesh->ntris);
+	CHECK(memcmp(other->meshes, dmesh->meshes, sizeof(unsigned int)*4*dmesh->nmeshes) == 0);
+	CHECK(memcmp(other->verts, dmesh->verts, sizeof(float)*3*dmesh->nverts) == 0);
+	CHECK(memcmp(other->tris, dmesh->tris, 4*dmesh->ntris) == 0);
+	rcFreePolyMeshDetail(other);
+
+	// The detail vertices are bumped up by one cell.
+	const float bump = ch;
+	// The samples are jittered by up to a tenth of a cell, where the surface rises by up to 0.6 per cell.
+	const float jitterError = 0.08f;
+
+	int checkedSamples = 0;
+	int refinedPolys = 0;
+	for (int i = 0; i < pmesh->npolys; ++i)
+	{
+		const unsigned short* p = &pmesh->polys[i*pmesh->nvp*2];
+		float poly[6*3];
+		int npoly = 0;
+		for (int j = 0; j < pmesh->nvp && p[j] != RC_MESH_NULL_IDX; ++j, ++npoly)
+		{
+			const unsigned short* v = &pmesh->verts[p[j]*3];
+			poly[npoly*3+0] = v[0]*cs;
+			poly[npoly*3+1] = v[1]*ch;
+			poly[npoly*3+2] = v[2]*cs;
+		}
+
+		const unsigned int* m = &dmesh->meshes[i*4];
+		const float* verts = &dmesh->verts[m[0]*3];
+		const int nverts = (int)m[1];
+		const unsigned char* tris = &dmesh->tris[m[2]*4];
+		const int ntris = (int)m[3];
+
+		// Every sample the detail mesh was refined with is within the error of the surface.
+		float pbmin[3], pbmax[3];
+		rcVcopy(pbmin, poly);
+		rcVcopy(pbmax, poly);
+		for (int j = 1; j < npoly; ++j)
+		{
+			rcVmin(pbmin, &poly[j*3]);
+			rcVmax(pbmax, &poly[j*3]);
+		}
+		for (int z = (int)floorf(pbmin[2]/sampleDist); z < (int)ceilf(pbmax[2]/sampleDist); ++z)
+		{
+			for (int x = (int)floorf(pbmin[0]/sampleDist); x < (int)ceilf(pbmax[0]/sampleDist); ++x)
+			{
+				const float pt[3] = { x*sampleDist, 0, z*sampleDist };
+				// Only the samples inside the polygon and away from its edges, like the detail mesh.
+				bool inside = false;
+				float dmin = FLT_MAX;
+				for (int j = 0, k = npoly-1; j < npoly; k = j++)
+				{
+					const float* vj = &poly[j*3];
+					const float* vk = &poly[k*3];
+					if (((vj[2] > pt[2]) != (vk[2] > pt[2])) &&
+						(pt[0] < (vk[0]-vj[0]) * (pt[2]-vj[2]) / (vk[2]-vj[2]) + vj[0]))
+						inside = !inside;
+					const float ex = vj[0]-vk[0], ez = vj[2]-vk[2];
+					const float d = ex*ex + ez*ez;
+					float t = d > 0 ? ((pt[0]-vk[0])*ex + (pt[2]-vk[2])*ez) / d : 0;
+					t = rcClamp(t, 0.0f, 1.0f);
+					dmin = rcMin(dmin, rcSqr(vk[0] + t*ex - pt[0]) + rcSqr(vk[2] + t*ez - pt[2]));
+				}
+				if (!inside || dmin < sampleDist/2)
+					continue;
+
+				const int cx = (int)floorf(pt[0]/cs + 0.01f);
+				const int cz = (int)floorf(pt[2]/cs + 0.01f);
+				const rcCompactCell& cell = chf->cells[cx + cz*size];
+				REQUIRE(cell.count == 1);
+				const float sampleHeight = chf->spans[cell.index].y*ch + bump;
+
+				bool found = false;
+				for (int j = 0; j < ntris && !found; ++j)
+				{
+					float h = 0;
+					const unsigned char* t = &tris[j*4];
+					found = getTriHeight(pt, &verts[t[0]*3], &verts[t[1]*3], &verts[t[2]*3], h);
+					if (found)
+						CHECK(fabsf(h - sampleHeight) <= sampleMaxError + jitterError);
+				}
+				REQUIRE(found);
+				checkedSamples++;
+			}
+		}
+
+		// The triangles are Delaunay once samples were added: no vertex is inside the circumcircle of a triangle.
+		bool hasInterior = false;
+		for (int j = npoly; j < nverts; ++j)
+		{
+			float dmin = FLT_MAX;
+			for (int k = 0, l = npoly-1; k < npoly; l = k++)
+			{
+				const float* a = &poly[l*3];
+				const float* b = &poly[k*3];
+				const float ex = b[0]-a[0], ez = b[2]-a[2];
+				dmin = rcMin(dmin, fabsf(ex*(verts[j*3+2]-a[2]) - ez*(verts[j*3+0]-a[0])) / sqrtf(ex*ex + ez*ez));
+			}
+			if (dmin > 1e-3f)
+				hasInterior = true;
+		}
+		if (!hasInterior)
+			continue;
+		refinedPolys++;
+		for (int j = 0; j < ntris; ++j)
+		{
+			const float* a = &verts[tris[j*4+0]*3];
+			const float* b = &verts[tris[j*4+1]*3];
+			const float* c = &verts[tris[j*4+2]*3];
+			const float bx = b[0]-a[0], bz = b[2]-a[2];
+			const float cx = c[0]-a[0], cz = c[2]-a[2];
+			const float d = 2*(bx*cz - bz*cx);
+			REQUIRE(fabsf(d) > 1e-6f);
+			const float ux = (cz*(bx*bx + bz*bz) - bz*(cx*cx + cz*cz)) / d;
+			const float uz = (bx*(cx*cx + cz*cz) - cx*(bx*bx + bz*bz)) / d;
+			const float r = sqrtf(ux*ux + uz*uz);
+			for (int k = 0; k < nverts; ++k)
+			{
+				const float dist = sqrtf(rcSqr(verts[k*3+0]-a[0] - ux) + rcSqr(verts[k*3+2]-a[2] - uz));
+				CHECK(dist >= r - 1e-3f*rcMax(r, 1.0f));
+			}
+		}
+	}
+	// The surface is bumpy enough to refine the detail of several polygons.
+	REQUIRE(checkedSamples > 0);
+	REQUIRE(refinedPolys > 1);
+
+	rcFreePolyMeshDetail(dmesh);
+	rcFreePolyMesh(pmesh);
+	rcFreeContourSet(cset);
+	rcFreeCompactHeightfield(chf);
+}
+
+TEST_CASE("rcGetAllocStats")
+{
+	SECTION("Allocations are accounted per hint and subsystem")
+	{
+		rcAllocStats before;
+		if (!rcGetAllocStats(RC_MEM_CONTOURS, before))
+		{
+			// Memory usage is only accounted when built with RC_MEMORY_STATS.
+			REQUIRE(before.liveBytes == 0);
+			REQUIRE(before.totalCount == 0);
+			return;
+		}
+		rcAllocStats beforeTemp;
+		REQUIRE(rcGetAllocStats(RC_ALLOC_TEMP, beforeTemp));
+
+		void* mem = rcAlloc(1000, RC_ALLOC_TEMP, RC_MEM_CONTOURS);
+		REQUIRE(mem);
+
+		rcAllocStats stats;
+		REQUIRE(rcGetAllocStats(RC_MEM_CONTOURS, stats));
+		REQUIRE(stats.liveBytes == before.liveBytes + 1000);
+		REQUIRE(stats.liveCount == before.liveCount + 1);
+		REQUIRE(stats.peakBytes >= stats.liveBytes);
+		REQUIRE(rcGetAllocStats(RC_ALLOC_TEMP, stats));
+		REQUIRE(stats.liveBytes == beforeTemp.liveBytes + 1000);
+
+		rcFree(mem);
+
+		REQUIRE(rcGetAllocStats(RC_MEM_CONTOURS, stats));
+		REQUIRE(stats.liveBytes == before.liveBytes);
+		REQUIRE(stats.liveCount == before.liveCount);
+		REQUIRE(stats.totalCount == before.totalCount + 1);
+		REQUIRE(stats.peakBytes >= before.liveBytes + 1000);
+
+		rcResetAllocStats();
+		REQUIRE(rcGetAllocStats(RC_MEM_CONTOURS, stats));
+		REQUIRE(stats.peakBytes == stats.liveBytes);
+		REQUIRE(stats.totalCount == 0);
+	}
+}